@@ -43,6 +43,7 @@ To-Do
 #define BT_UUID_LORAWAN_DEV_EUI_VAL         BT_UUID_128_ENCODE(0x5a8cd4ac, 0x1520, 0x4c9d, 0xb488, 0x12942c26af43)
 #define BT_UUID_LORAWAN_JOIN_EUI_VAL        BT_UUID_128_ENCODE(0x5a8cd4ac, 0x1520, 0x4c9d, 0xb488, 0x12942c26af44)
 #define BT_UUID_LORAWAN_APP_KEY_VAL         BT_UUID_128_ENCODE(0x5a8cd4ac, 0x1520, 0x4c9d, 0xb488, 0x12942c26af45)
+#define BT_UUID_LORAWAN_AIRTIME_VAL         BT_UUID_128_ENCODE(0x5a8cd4ac, 0x1520, 0x4c9d, 0xb488, 0x12942c26af46)
 
 #define BT_UUID_LORAWAN                     BT_UUID_DECLARE_128(BT_UUID_LORAWAN_VAL)
 #define BT_UUID_LORAWAN_ENABLED             BT_UUID_DECLARE_128(BT_UUID_LORAWAN_ENABLED_VAL)
@@ -50,6 +51,7 @@ To-Do
 #define BT_UUID_LORAWAN_DEV_EUI             BT_UUID_DECLARE_128(BT_UUID_LORAWAN_DEV_EUI_VAL)
 #define BT_UUID_LORAWAN_JOIN_EUI            BT_UUID_DECLARE_128(BT_UUID_LORAWAN_JOIN_EUI_VAL)
 #define BT_UUID_LORAWAN_APP_KEY             BT_UUID_DECLARE_128(BT_UUID_LORAWAN_APP_KEY_VAL)
+#define BT_UUID_LORAWAN_AIRTIME             BT_UUID_DECLARE_128(BT_UUID_LORAWAN_AIRTIME_VAL)
 
 
 /**
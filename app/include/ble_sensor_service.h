@@ -55,6 +55,10 @@
 #define BT_UUID_SENSOR2_DATA_VAL            BT_UUID_128_ENCODE(0x07de1ad6, 0x4f7a, 0x4156, 0x9836, 0x77690b6ed2cc)
 #define BT_UUID_SENSOR2_DATA_TIMESTAMP_VAL  BT_UUID_128_ENCODE(0x07de1ad6, 0x4f7a, 0x4156, 0x9836, 0x77690b6ed2cd)
 
+#define BT_UUID_SENSOR1_SCHEDULE_STATS_VAL  BT_UUID_128_ENCODE(0x07de1ad6, 0x4f7a, 0x4156, 0x9836, 0x77690b6ed2ce)
+#define BT_UUID_SENSOR2_SCHEDULE_STATS_VAL  BT_UUID_128_ENCODE(0x07de1ad6, 0x4f7a, 0x4156, 0x9836, 0x77690b6ed2cf)
+#define BT_UUID_RADIO_SCHEDULE_STATS_VAL    BT_UUID_128_ENCODE(0x07de1ad6, 0x4f7a, 0x4156, 0x9836, 0x77690b6ed2d0)
+
 /* Attach the UUIDs for the Sensor service */
 #define BT_UUID_SENSOR                      BT_UUID_DECLARE_128(BT_UUID_SENSOR_VAL)
 #define BT_UUID_SENSOR_STATE                BT_UUID_DECLARE_128(BT_UUID_SENSOR_STATE_VAL)
@@ -73,6 +77,10 @@
 #define BT_UUID_SENSOR2_DATA                BT_UUID_DECLARE_128(BT_UUID_SENSOR2_DATA_VAL)
 #define BT_UUID_SENSOR2_DATA_TIMESTAMP      BT_UUID_DECLARE_128(BT_UUID_SENSOR2_DATA_TIMESTAMP_VAL)
 
+#define BT_UUID_SENSOR1_SCHEDULE_STATS      BT_UUID_DECLARE_128(BT_UUID_SENSOR1_SCHEDULE_STATS_VAL)
+#define BT_UUID_SENSOR2_SCHEDULE_STATS      BT_UUID_DECLARE_128(BT_UUID_SENSOR2_SCHEDULE_STATS_VAL)
+#define BT_UUID_RADIO_SCHEDULE_STATS        BT_UUID_DECLARE_128(BT_UUID_RADIO_SCHEDULE_STATS_VAL)
+
 /**
  * @brief Initialize the BLE sensor service
  * 
@@ -0,0 +1,81 @@
+/**
+ * @file sensor_airtime.h
+ * @author Tyler Garcia
+ * @brief This is a library to calculate the time on air of LoRa packets and the payload limits of the
+ * US915 data rates, used to size uplinks for the data rate they are sent at.
+ * @version 0.1
+ * @date 2025-06-09
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#ifndef SENSOR_AIRTIME_H
+#define SENSOR_AIRTIME_H
+
+#include <zephyr/lorawan/lorawan.h>
+#include <stdint.h>
+
+/* Number of preamble symbols used by LoRaWAN */
+#define SENSOR_AIRTIME_PREAMBLE_SYMBOLS         8
+
+/* Bytes the LoRaWAN MAC adds to the application payload (MHDR, DevAddr, FCtrl, FCnt, FPort and MIC) */
+#define SENSOR_AIRTIME_LORAWAN_OVERHEAD         13
+
+/* Coding rate used by LoRaWAN uplinks, as the denominator of 4/x */
+#define SENSOR_AIRTIME_LORAWAN_CODING_RATE      5
+
+/* Highest US915 uplink data rate */
+#define SENSOR_AIRTIME_MAX_DATARATE             LORAWAN_DR_4
+
+/**
+ * @brief Structure for the LoRa modulation of a packet.
+ */
+typedef struct {
+    /* Spreading factor, 7 to 12 */
+    uint8_t spreading_factor;
+    /* Bandwidth in kHz, 125, 250 or 500 */
+    uint16_t bandwidth_khz;
+    /* Coding rate as the denominator of 4/x, 5 to 8 */
+    uint8_t coding_rate;
+} sensor_airtime_modulation_t;
+
+/**
+ * @brief Calculate the time on air of a LoRa packet with an explicit header and CRC.
+ * 
+ * @param modulation The modulation of the packet
+ * @param payload_length The length of the PHY payload in bytes
+ * @param time_on_air_us The time on air in microseconds
+ * @return int 0 on success, -EINVAL if the modulation is not valid
+ */
+int sensor_airtime_get_time_on_air_us(const sensor_airtime_modulation_t *modulation, uint16_t payload_length, uint32_t *time_on_air_us);
+
+/**
+ * @brief Get the modulation of a US915 uplink data rate.
+ * 
+ * @param datarate The data rate
+ * @param modulation The modulation used at the data rate
+ * @return int 0 on success, -EINVAL if the data rate is not a US915 uplink data rate
+ */
+int sensor_airtime_get_modulation(enum lorawan_datarate datarate, sensor_airtime_modulation_t *modulation);
+
+/**
+ * @brief Get the maximum application payload of a US915 uplink data rate, larger payloads are rejected by the MAC.
+ * 
+ * @param datarate The data rate
+ * @param max_payload The maximum application payload in bytes
+ * @return int 0 on success, -EINVAL if the data rate is not a US915 uplink data rate
+ */
+int sensor_airtime_get_max_payload(enum lorawan_datarate datarate, uint16_t *max_payload);
+
+/**
+ * @brief Calculate the time on air of a LoRaWAN uplink, including the MAC overhead.
+ * 
+ * @param datarate The data rate of the uplink
+ * @param payload_length The length of the application payload in bytes
+ * @param time_on_air_us The time on air in microseconds
+ * @return int 0 on success, -EINVAL if the data rate is not valid, -EMSGSIZE if the payload does not fit the data rate
+ */
+int sensor_airtime_get_uplink_time_on_air_us(enum lorawan_datarate datarate, uint16_t payload_length, uint32_t *time_on_air_us);
+
+#endif
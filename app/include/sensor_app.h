@@ -16,11 +16,25 @@
 #define SENSOR_APP_H
 
 #include "sensor_id.h"
+#include "sensor_scheduling.h"
 #include <stdint.h>
 
 #define SENSOR_VOLTAGE_NAME_LENGTH      20
 #define SENSOR_TYPE_NAME_LENGTH         20
 
+/* Frame counters reserved ahead of the one in use, the stored frame counter is only written once per reservation */
+#define SENSOR_APP_FCNT_GAP             100
+
+/* A new reservation is made once fewer than this many reserved frame counters are left, covers the retries of an uplink */
+#define SENSOR_APP_FCNT_MARGIN          (SENSOR_APP_FCNT_GAP / 2)
+
+/* Ports of uplinks with the full header and with the compact header */
+#define SENSOR_APP_FULL_HEADER_PORT     2
+#define SENSOR_APP_COMPACT_PORT         5
+
+/* Uplinks with the compact header between full headers, so a full header missed by the network is sent again */
+#define SENSOR_APP_FULL_HEADER_INTERVAL 24
+
 /**
  * @brief Enum for the sensor app state.
  * This is used to track the state of the sensor app.
@@ -54,6 +68,15 @@ enum sensor_nvs_address {
     SENSOR_NVS_ADDRESS_SENSOR_2_POWER,
     SENSOR_NVS_ADDRESS_SENSOR_2_TYPE,
     SENSOR_NVS_ADDRESS_SENSOR_2_FREQUENCY,
+    SENSOR_NVS_ADDRESS_SENSOR_1_WARMUP,
+    SENSOR_NVS_ADDRESS_SENSOR_2_WARMUP,
+    SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR,
+    SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP,
+    SENSOR_NVS_ADDRESS_LORAWAN_SESSION_NWK_SKEY,
+    SENSOR_NVS_ADDRESS_LORAWAN_SESSION_APP_SKEY,
+    SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_DOWN,
+    SENSOR_NVS_ADDRESS_LORAWAN_SESSION_MAC_PARAMS,
+    SENSOR_NVS_ADDRESS_DOWNLINK_CONFIG,
 	SENSOR_NVS_ADDRESS_LIMIT,
 };
 
@@ -86,17 +109,17 @@ typedef struct {
     uint8_t is_sensor_1_enabled;
     /* Whether sensor 2 is enabled */
     uint8_t is_sensor_2_enabled;
-    /* Frequency of sensor 1 */
-    uint8_t sensor_1_frequency;
-    /* Frequency of sensor 2 */
-    uint8_t sensor_2_frequency;
+    /* Interval between readings of sensor 1 in seconds */
+    uint32_t sensor_1_frequency;
+    /* Interval between readings of sensor 2 in seconds */
+    uint32_t sensor_2_frequency;
     /* Data from sensor 1 */
     uint8_t *sensor_1_latest_data;
-    /* Time since the latest data was received from sensor 1 */
+    /* Timestamp of the latest data from sensor 1, see sensor_app_get_current_timestamp_seconds */
     uint32_t sensor_1_latest_data_timestamp;
     /* Data from sensor 2 */
     uint8_t *sensor_2_latest_data;
-    /* Time since the latest data was received from sensor 2 */
+    /* Timestamp of the latest data from sensor 2, see sensor_app_get_current_timestamp_seconds */
     uint32_t sensor_2_latest_data_timestamp;
 } sensor_app_config_t;
 
@@ -128,6 +151,41 @@ int sensor_app_running_state(void);
  */
 int sensor_app_error_state(void);
 
+/**
+ * @brief Wake the running state to apply a configuration change, such as a state change written over BLE.
+ * 
+ */
+void sensor_app_notify_config_changed(void);
+
+/**
+ * @brief Get the lateness statistics of the sensor or radio schedule.
+ * 
+ * @param id The id of the schedule.
+ * @param stats The statistics of the schedule.
+ * @return int 0 on success, negative error code on failure
+ */
+int sensor_app_get_schedule_stats(enum sensor_scheduling_id id, sensor_scheduling_stats_t *stats);
+
+/**
+ * @brief Get an interval in seconds from a BLE write, either 4 bytes of seconds in little-endian or the legacy 
+ * single byte of minutes.
+ * 
+ * @param buf The data written.
+ * @param len The length of the data written.
+ * @param min_seconds The shortest interval accepted.
+ * @param seconds The interval in seconds, set even when it is below min_seconds.
+ * @return int 0 on success, -EINVAL if the length is neither, -ERANGE if the interval is below min_seconds
+ */
+int sensor_app_get_interval_from_write(const void *buf, uint16_t len, uint32_t min_seconds, uint32_t *seconds);
+
+/**
+ * @brief Get the timestamp of the current time, in UTC seconds once the time is synchronized and in seconds on the 
+ * scheduling timebase before that, the same timebase the latest data timestamps are on.
+ * 
+ * @return uint32_t The timestamp in seconds
+ */
+uint32_t sensor_app_get_current_timestamp_seconds(void);
+
 /**
  * @brief Start the BLE advertising and services.
  * 
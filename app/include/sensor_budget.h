@@ -0,0 +1,93 @@
+/**
+ * @file sensor_budget.h
+ * @author Tyler Garcia
+ * @brief This is a library to keep the time on air of the uplinks within a daily fair use budget. The time on air
+ * is kept in hourly buckets over a rolling 24 hours, and as the budget runs low the uplinks are first sent
+ * unconfirmed, then merged and finally deferred until older time on air leaves the window.
+ * @version 0.1
+ * @date 2025-06-15
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#ifndef SENSOR_BUDGET_H
+#define SENSOR_BUDGET_H
+
+#include <stdint.h>
+
+/* Time on air allowed in a rolling 24 hours, the fair use limit of public networks such as TTN */
+#define SENSOR_BUDGET_DAILY_US              30000000
+
+/* Number of hourly buckets in the rolling window */
+#define SENSOR_BUDGET_BUCKETS               24
+
+/* Length of each bucket */
+#define SENSOR_BUDGET_BUCKET_MS             3600000ULL
+
+/* Percent of the budget left below which uplinks are sent unconfirmed */
+#define SENSOR_BUDGET_UNCONFIRMED_PERCENT   50
+
+/* Percent of the budget left below which uplinks are merged */
+#define SENSOR_BUDGET_MERGE_PERCENT         25
+
+/**
+ * @brief Enum for the steps the governor takes as the budget runs low, each includes the steps before it.
+ */
+enum sensor_budget_level {
+    SENSOR_BUDGET_LEVEL_NORMAL = 0,     // Uplinks are sent as configured
+    SENSOR_BUDGET_LEVEL_UNCONFIRMED,    // Confirmed uplinks are sent unconfirmed
+    SENSOR_BUDGET_LEVEL_MERGE,          // Uplinks are skipped so their samples go out together in a later one
+    SENSOR_BUDGET_LEVEL_DEFER,          // The uplink does not fit the budget and waits
+};
+
+/**
+ * @brief Structure to hold the time on air of the uplinks over the rolling window.
+ */
+typedef struct {
+    /* Time on air of each hour in microseconds, indexed by the hour modulo the number of buckets */
+    uint32_t buckets_us[SENSOR_BUDGET_BUCKETS];
+    /* Hour of uptime of the newest bucket */
+    uint64_t current_hour;
+} sensor_budget_t;
+
+/**
+ * @brief Record the time on air of a transmission.
+ * 
+ * @param budget The budget
+ * @param now_ms The uptime of the transmission in milliseconds
+ * @param time_on_air_us Time on air of the transmission in microseconds
+ */
+void sensor_budget_record(sensor_budget_t *budget, uint64_t now_ms, uint32_t time_on_air_us);
+
+/**
+ * @brief Get the time on air used in the rolling window.
+ * 
+ * @param budget The budget
+ * @param now_ms The current uptime in milliseconds
+ * @return uint32_t The time on air used in microseconds
+ */
+uint32_t sensor_budget_get_used_us(sensor_budget_t *budget, uint64_t now_ms);
+
+/**
+ * @brief Get the step the governor takes for the next uplink, from the budget left once it is sent.
+ * 
+ * @param budget The budget
+ * @param now_ms The current uptime in milliseconds
+ * @param time_on_air_us Time on air of the next uplink in microseconds
+ * @return enum sensor_budget_level The step to take
+ */
+enum sensor_budget_level sensor_budget_get_level(sensor_budget_t *budget, uint64_t now_ms, uint32_t time_on_air_us);
+
+/**
+ * @brief Get the delay until enough time on air leaves the window for an uplink to fit the budget.
+ * 
+ * @param budget The budget
+ * @param now_ms The current uptime in milliseconds
+ * @param time_on_air_us Time on air of the uplink in microseconds
+ * @param delay_ms The delay in milliseconds, 0 if the uplink fits now
+ * @return int 0 on success, -EINVAL if the uplink is longer than the whole budget
+ */
+int sensor_budget_get_delay_ms(sensor_budget_t *budget, uint64_t now_ms, uint32_t time_on_air_us, uint32_t *delay_ms);
+
+#endif
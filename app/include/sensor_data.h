@@ -20,6 +20,25 @@
 
 #define MAX_DATA_BUFFER_SIZE 100
 
+/* Warm-up used until a channel has learned its own profile. */
+#define SENSOR_WARMUP_DEFAULT_MS            1000
+/* Longest warm-up that will be learned, readings are assumed stable after this. */
+#define SENSOR_WARMUP_MAX_MS                5000
+/* Shortest warm-up that will be applied. */
+#define SENSOR_WARMUP_MIN_MS                10
+/* Time between readings while learning the warm-up. */
+#define SENSOR_WARMUP_STEP_MS               20
+/* Readings within this percentage of each other are considered stable. */
+#define SENSOR_WARMUP_TOLERANCE_PERCENT     1
+/* Absolute tolerance so readings close to 0 can still be considered stable. */
+#define SENSOR_WARMUP_TOLERANCE_FLOOR       0.01f
+/* Number of consecutive readings that have to be within tolerance of the latest one to finish learning. */
+#define SENSOR_WARMUP_STABLE_READINGS       3
+/* Extra margin added to the learned warm-up as a percentage. */
+#define SENSOR_WARMUP_MARGIN_PERCENT        25
+/* Number of reads after which the warm-up is learned again to track sensor aging. */
+#define SENSOR_WARMUP_RELEARN_READS         500
+
 /**
  * @brief Types of data that can be stored in the sensor data buffer. Currently unused, plans to keep it
  * for future use to potentially store in sensor_data_t struct.
@@ -33,6 +52,19 @@ enum sensor_data_type {
     DATA_TYPE_LIMIT
 };
 
+/**
+ * @brief Learned warm-up profile for a sensor channel. This is stored in NVS by the application 
+ * and is only applied while the sensor type and voltage match the ones it was learned with.
+ */
+typedef struct {
+    /* Time in ms from power on until the readings are stable, 0 if not learned. */
+    uint32_t warmup_ms;
+    /* Sensor type the warm-up was learned with. */
+    uint8_t type;
+    /* Sensor voltage the warm-up was learned with. */
+    uint8_t voltage;
+} sensor_warmup_profile_t;
+
 /**
  * @brief Structure for the sensor data.
  * This is used to store the sensor data and timestamp for each sensor.
@@ -58,11 +90,15 @@ typedef struct {
     int latest_timestamp;
     /* Number of samples in the buffer. */
     uint32_t num_samples;
+    /* Learned warm-up profile for the sensor. */
+    sensor_warmup_profile_t warmup;
+    /* Number of reads since the warm-up was last learned. */
+    uint32_t reads_since_warmup;
 } sensor_data_t;
 
 /**
  * @brief Setup the sensor data. If the sensor chosen has continuous power, the power will be turned on when the sensor is setup. If not 
- * the power will be turned on only when the data is read. PULSE_SENSORs use continuous power. To disable a sensor, set the type to NULL_SENSOR.
+ * the power will be turned on only when the data is read. PULSE_SENSORs, QUADRATURE_SENSORs and PULSE_DIR_SENSORs use continuous power. To disable a sensor, set the type to NULL_SENSOR.
  * This is important when using a sensor with continuous power, as it will turn off the power when the sensor is deinitialized.
  * 
  * @param sensor_data The sensor data to setup holding the sensor id and power id.
@@ -81,6 +117,35 @@ int sensor_data_setup(sensor_data_t *sensor_data, enum sensor_types type, enum s
  */
 int sensor_data_read(sensor_data_t *sensor_data, int timestamp);
 
+/**
+ * @brief Learn the warm-up time of a switched power sensor. The sensor is powered on and read every SENSOR_WARMUP_STEP_MS
+ * until the spread of the last SENSOR_WARMUP_STABLE_READINGS readings is within tolerance of the latest one. The time 
+ * until the stable readings started, plus SENSOR_WARMUP_MARGIN_PERCENT, is stored in the warmup profile and used by 
+ * sensor_data_read. If the readings do not stabilise within SENSOR_WARMUP_MAX_MS the profile is marked unlearned and 
+ * sensor_data_read keeps using SENSOR_WARMUP_DEFAULT_MS. The sensor is powered for up to SENSOR_WARMUP_MAX_MS, this is 
+ * meant to run when the sensor is commissioned rather than before a scheduled reading.
+ * 
+ * @param sensor_data The sensor data to learn the warm-up for.
+ * @return int 0 if successful, -1 if the sensor is not setup, does not use switched power or did not stabilise.
+ */
+int sensor_data_learn_warmup(sensor_data_t *sensor_data);
+
+/**
+ * @brief Check if the warm-up of a sensor should be learned. This is the case when the sensor uses switched power and 
+ * has no profile for its current type and voltage, or SENSOR_WARMUP_RELEARN_READS reads have been taken since it was learned.
+ * 
+ * @param sensor_data The sensor data to check.
+ * @return int 1 if the warm-up should be learned, 0 if not.
+ */
+int sensor_data_warmup_needs_learning(sensor_data_t *sensor_data);
+
+/**
+ * @brief Set the temperature used to compensate the analog sensor readings.
+ * 
+ * @param temperature The board temperature in °C.
+ */
+void sensor_data_set_temperature(float temperature);
+
 /**
  * @brief Print the sensor data from data and timestamp ring buffers. Displaying it from the oldest to newest.
  * 
@@ -95,6 +160,16 @@ int sensor_data_print_data(sensor_data_t *sensor_data);
  */
 int sensor_data_clear(sensor_data_t *sensor_data);
 
+/**
+ * @brief Clear the oldest samples of the sensor data once they have been sent, keeping any samples taken 
+ * while sending. Counters are reset the same as sensor_data_clear.
+ * 
+ * @param sensor_data The sensor data to clear the samples from.
+ * @param num_samples The number of samples that were sent.
+ * @return int 0 on success, -1 on failure
+ */
+int sensor_data_clear_sent(sensor_data_t *sensor_data, uint32_t num_samples);
+
 /**
  * @brief Format the sensor data for LoRaWAN, this breaks the data into a uint8_t array.
  * 
@@ -105,4 +180,17 @@ int sensor_data_clear(sensor_data_t *sensor_data);
  */
 int sensor_data_format_for_lorawan(sensor_data_t *sensor_data, uint8_t *data, uint8_t *data_len);
 
+/**
+ * @brief Pack as many of the oldest samples as fit in a length for LoRaWAN, formatted the same as 
+ * sensor_data_format_for_lorawan. Samples are never split, the samples that do not fit are left for the next uplink.
+ * 
+ * @param sensor_data The sensor data to pack.
+ * @param data The buffer to pack the samples into.
+ * @param max_length The maximum number of bytes to pack.
+ * @param data_len The number of bytes packed.
+ * @param num_samples The number of samples packed.
+ * @return int 0 if successful, -1 if failed.
+ */
+int sensor_data_pack_for_lorawan(sensor_data_t *sensor_data, uint8_t *data, uint16_t max_length, uint16_t *data_len, uint32_t *num_samples);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+/**
+ * @file sensor_downlink.h
+ * @author Tyler Garcia
+ * @brief This is a library to parse downlink commands for remote configuration. A downlink is a sequence number
+ * followed by commands, each a type byte, a length byte and its value. Every command of a downlink is validated
+ * before any is applied, and the result is acknowledged with the sequence number in the next uplink.
+ * @version 0.1
+ * @date 2025-06-14
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#ifndef SENSOR_DOWNLINK_H
+#define SENSOR_DOWNLINK_H
+
+#include "sensor_id.h"
+#include <zephyr/sys/util.h>
+#include <stdint.h>
+
+/* Port downlink commands are received on */
+#define SENSOR_DOWNLINK_PORT                10
+
+/* Port of the uplink that acknowledges a downlink, the acknowledgement comes before the usual payload */
+#define SENSOR_DOWNLINK_ACK_PORT            4
+
+/* Length of the acknowledgement, the sequence number and status of the downlink */
+#define SENSOR_DOWNLINK_ACK_LENGTH          2
+
+/* Longest downlink accepted */
+#define SENSOR_DOWNLINK_MAX_LENGTH          64
+
+/* Number of sensors that can be configured, numbered from 1 in the commands */
+#define SENSOR_DOWNLINK_MAX_SENSORS         2
+
+/* Shortest uplink interval that can be set, in seconds */
+#define SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL    60
+
+/* Most attempts a confirmed uplink can be set to */
+#define SENSOR_DOWNLINK_MAX_SEND_ATTEMPTS   15
+
+/**
+ * @brief Enum for the type of a downlink command, the value of each is listed in the comment.
+ */
+enum sensor_downlink_type {
+    SENSOR_DOWNLINK_SENSOR_ENABLED = 0x01,      // Sensor number, 1 to enable or 0 to disable
+    SENSOR_DOWNLINK_SENSOR_TYPE = 0x02,         // Sensor number, enum sensor_types
+    SENSOR_DOWNLINK_SENSOR_VOLTAGE = 0x03,      // Sensor number, enum sensor_voltage
+    SENSOR_DOWNLINK_SENSOR_INTERVAL = 0x04,     // Sensor number, reading interval in seconds as 4 bytes MSB first
+    SENSOR_DOWNLINK_LORAWAN_INTERVAL = 0x10,    // Uplink interval in seconds as 4 bytes MSB first
+    SENSOR_DOWNLINK_LORAWAN_CONFIRMED = 0x11,   // Attempts of a confirmed uplink, 0 for unconfirmed uplinks
+    SENSOR_DOWNLINK_REBOOT = 0x20,              // No value, reboots once the acknowledgement is sent
+    SENSOR_DOWNLINK_FLUSH = 0x21,               // No value, clears the buffered samples
+};
+
+/**
+ * @brief Enum for the status of a downlink sent in its acknowledgement.
+ */
+enum sensor_downlink_status {
+    SENSOR_DOWNLINK_STATUS_OK = 0,              // All commands were applied
+    SENSOR_DOWNLINK_STATUS_MALFORMED,           // A command runs past the end of the downlink or has the wrong length
+    SENSOR_DOWNLINK_STATUS_UNKNOWN_TYPE,        // A command type is not known
+    SENSOR_DOWNLINK_STATUS_INVALID_VALUE,       // A command value is out of range
+};
+
+/* Bits of the sensor settings set by a downlink */
+#define SENSOR_DOWNLINK_SET_ENABLED         BIT(0)
+#define SENSOR_DOWNLINK_SET_TYPE            BIT(1)
+#define SENSOR_DOWNLINK_SET_VOLTAGE         BIT(2)
+#define SENSOR_DOWNLINK_SET_INTERVAL        BIT(3)
+
+/**
+ * @brief Structure to hold the settings of a sensor set by a downlink.
+ */
+typedef struct {
+    /* SENSOR_DOWNLINK_SET_ bits of the settings that are set */
+    uint8_t set_fields;
+    /* Whether the sensor is enabled */
+    uint8_t is_enabled;
+    /* Type of the sensor */
+    enum sensor_types type;
+    /* Power voltage of the sensor */
+    enum sensor_voltage voltage;
+    /* Interval between readings in seconds */
+    uint32_t interval;
+} sensor_downlink_sensor_t;
+
+/**
+ * @brief Structure to hold all the commands of a downlink.
+ */
+typedef struct {
+    /* Sequence number of the downlink, returned in its acknowledgement */
+    uint8_t sequence;
+    /* Settings of each sensor */
+    sensor_downlink_sensor_t sensors[SENSOR_DOWNLINK_MAX_SENSORS];
+    /* Whether the uplink interval is set */
+    uint8_t is_lorawan_interval_set;
+    /* Interval between uplinks in seconds */
+    uint32_t lorawan_interval;
+    /* Whether the confirmed uplink attempts are set */
+    uint8_t is_send_attempts_set;
+    /* Attempts of a confirmed uplink, 0 for unconfirmed uplinks */
+    uint8_t send_attempts;
+    /* Whether to reboot once the acknowledgement is sent */
+    uint8_t is_reboot;
+    /* Whether to clear the buffered samples */
+    uint8_t is_flush;
+} sensor_downlink_commands_t;
+
+/**
+ * @brief Parse and validate all the commands of a downlink. Nothing should be applied unless it succeeds.
+ * 
+ * @param data The downlink
+ * @param length The length of the downlink
+ * @param commands The commands of the downlink, the sequence number is set whenever the downlink has one
+ * @param status The status to acknowledge the downlink with
+ * @return int 0 on success, -EINVAL if any command is not valid
+ */
+int sensor_downlink_parse(const uint8_t *data, uint8_t length, sensor_downlink_commands_t *commands,
+    enum sensor_downlink_status *status);
+
+/**
+ * @brief Check if a downlink changes the configuration, which is applied with the sensors stopped.
+ * 
+ * @param commands The commands of the downlink
+ * @return int 1 if the configuration changes, 0 if not
+ */
+int sensor_downlink_has_config(const sensor_downlink_commands_t *commands);
+
+/**
+ * @brief Write the acknowledgement of a downlink.
+ * 
+ * @param sequence The sequence number of the downlink
+ * @param status The status of the downlink
+ * @param data Where to write the acknowledgement, SENSOR_DOWNLINK_ACK_LENGTH bytes
+ * @return int The number of bytes written
+ */
+int sensor_downlink_write_ack(uint8_t sequence, enum sensor_downlink_status status, uint8_t *data);
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file sensor_fragment.h
+ * @author Tyler Garcia
+ * @brief This is a library to split a backlog of samples that does not fit one uplink into self-describing
+ * fragments, sent on their own port and paced to respect the duty cycle.
+ * 
+ * Each fragment starts with a header, followed by whole samples formatted the same as the regular uplink:
+ * - Byte 0: Sequence number, incremented for every fragment and wrapping at 255
+ * - Byte 1: Channel of the samples (sensor id + 1), the highest bit is set on the last fragment of the backlog
+ * - Byte 2-5: Timestamp of the first sample, most significant byte first
+ * @version 0.1
+ * @date 2025-06-10
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#ifndef SENSOR_FRAGMENT_H
+#define SENSOR_FRAGMENT_H
+
+#include <stdint.h>
+
+/* LoRaWAN port the fragments are sent on */
+#define SENSOR_FRAGMENT_PORT                3
+
+/* Length of the header at the start of each fragment */
+#define SENSOR_FRAGMENT_HEADER_LENGTH       6
+
+/* Flag in the channel byte set on the last fragment of the backlog */
+#define SENSOR_FRAGMENT_LAST_FLAG           0x80
+
+/* Share of the time the radio may transmit, the time between fragments is paced to it */
+#define SENSOR_FRAGMENT_DUTY_CYCLE_PERCENT  1
+
+/* Minimum time between fragments, leaves room for the receive windows of the previous uplink */
+#define SENSOR_FRAGMENT_MIN_INTERVAL_MS     5000
+
+/**
+ * @brief Structure for the header of a fragment.
+ */
+typedef struct {
+    /* Sequence number of the fragment */
+    uint8_t sequence;
+    /* Channel of the samples in the fragment */
+    uint8_t channel;
+    /* Whether this is the last fragment of the backlog */
+    uint8_t is_last;
+    /* Timestamp of the first sample in the fragment */
+    uint32_t first_timestamp;
+} sensor_fragment_header_t;
+
+/**
+ * @brief Write the header of a fragment.
+ * 
+ * @param header The header to write
+ * @param data Where to write the header, at least SENSOR_FRAGMENT_HEADER_LENGTH bytes
+ * @return int The number of bytes written, -EINVAL if the channel does not fit the channel byte
+ */
+int sensor_fragment_write_header(const sensor_fragment_header_t *header, uint8_t *data);
+
+/**
+ * @brief Read the header of a fragment, as the host does to reassemble the backlog.
+ * 
+ * @param data The fragment
+ * @param length The length of the fragment
+ * @param header The header read
+ * @return int 0 on success, -EINVAL if the fragment is too short
+ */
+int sensor_fragment_read_header(const uint8_t *data, uint16_t length, sensor_fragment_header_t *header);
+
+/**
+ * @brief Get the time to wait after a fragment before sending the next one, so the radio stays
+ * within SENSOR_FRAGMENT_DUTY_CYCLE_PERCENT.
+ * 
+ * @param time_on_air_us The time on air of the previous fragment in microseconds
+ * @return uint32_t The time to wait in milliseconds
+ */
+uint32_t sensor_fragment_get_interval_ms(uint32_t time_on_air_us);
+
+#endif
@@ -35,6 +35,12 @@ enum sensor_types {
     CURRENT_SENSOR,
     /* Sensor is set to read low pulses from d1 pin. */
     PULSE_SENSOR,
+    /* Sensor is set to decode d1/d2 as quadrature into a signed count. */
+    QUADRATURE_SENSOR,
+    /* Sensor is set to count pulses on d1, d2 active counts down. */
+    PULSE_DIR_SENSOR,
+    /* Sensor is set to measure the frequency of rising edges on d1. */
+    FREQUENCY_SENSOR,
     /* Used to denote size of enum. */
     SENSOR_TYPE_LIMIT
 };
@@ -0,0 +1,78 @@
+/**
+ * @file sensor_join.h
+ * @author Tyler Garcia
+ * @brief This is a library to schedule LoRaWAN join attempts. Failed attempts back off exponentially and the
+ * time on air of join requests is kept within the join duty cycle of the LoRaWAN specification.
+ * @version 0.1
+ * @date 2025-06-13
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#ifndef SENSOR_JOIN_H
+#define SENSOR_JOIN_H
+
+#include <zephyr/lorawan/lorawan.h>
+#include <stdint.h>
+
+/* Delay before the first retry, doubled after each failed attempt */
+#define SENSOR_JOIN_BACKOFF_BASE_MS         10000
+
+/* Longest delay between attempts */
+#define SENSOR_JOIN_BACKOFF_MAX_MS          3600000
+
+/* Random extra delay as a percent of the backoff, so devices that reset together do not join together */
+#define SENSOR_JOIN_JITTER_PERCENT          10
+
+/* Join requests are counted at the slowest data rate, the longest time on air they can have */
+#define SENSOR_JOIN_DATARATE                LORAWAN_DR_0
+
+/* Length of a join request with its MAC header and MIC */
+#define SENSOR_JOIN_REQUEST_LENGTH          23
+
+/* Nonces reserved in NVS at a time, so a nonce is never reused after a reset */
+#define SENSOR_JOIN_NONCE_BLOCK             16
+
+/**
+ * @brief Structure to hold the state of the join attempts since the device was reset.
+ */
+typedef struct {
+    /* Whether a join has been attempted, the duty cycle windows start from the first attempt */
+    uint8_t is_started;
+    /* Uptime of the first attempt in milliseconds */
+    uint64_t start_ms;
+    /* Consecutive failed attempts */
+    uint32_t failed_attempts;
+    /* Duty cycle window the time on air is counted in */
+    uint32_t window;
+    /* Time on air of the join requests in the window in microseconds */
+    uint32_t window_time_on_air_us;
+} sensor_join_backoff_t;
+
+/**
+ * @brief Get the delay before the next join attempt. It is the exponential backoff of the failed attempts, extended
+ * to the next duty cycle window when the attempt would exceed the time on air allowed in its window. The windows
+ * from the first attempt allow 36 s in the first hour, 36 s in the next 10 hours, then 8.7 s every 24 hours.
+ * 
+ * @param backoff The join state
+ * @param now_ms The current uptime in milliseconds
+ * @param time_on_air_us Time on air of a join request in microseconds
+ * @param random A random number for the jitter
+ * @param delay_ms The delay before the next attempt in milliseconds
+ * @return int 0 on success, -EINVAL if the time on air does not fit any window
+ */
+int sensor_join_get_delay_ms(const sensor_join_backoff_t *backoff, uint64_t now_ms, uint32_t time_on_air_us,
+    uint32_t random, uint32_t *delay_ms);
+
+/**
+ * @brief Record a join attempt, counting its time on air and its result.
+ * 
+ * @param backoff The join state
+ * @param now_ms The uptime of the attempt in milliseconds
+ * @param time_on_air_us Time on air of the join request in microseconds
+ * @param is_success Whether the network was joined
+ */
+void sensor_join_record_attempt(sensor_join_backoff_t *backoff, uint64_t now_ms, uint32_t time_on_air_us, uint8_t is_success);
+
+#endif
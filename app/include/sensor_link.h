@@ -0,0 +1,107 @@
+/**
+ * @file sensor_link.h
+ * @author Tyler Garcia
+ * @brief This is a library to choose the uplink data rate from the quality of the link. The SNR of downlinks and
+ * the margins of LinkCheckAns are combined into an estimate, and the fastest data rate with enough margin is used.
+ * Consecutive failed confirmed uplinks fall back to a slower data rate.
+ * @version 0.1
+ * @date 2025-06-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#ifndef SENSOR_LINK_H
+#define SENSOR_LINK_H
+
+#include <zephyr/lorawan/lorawan.h>
+#include <stdint.h>
+
+/* Slowest data rate used, the uplink header does not fit the 11 bytes of DR0 */
+#define SENSOR_LINK_MIN_DATARATE            LORAWAN_DR_1
+
+/* Fastest data rate used, the 125 kHz data rates share the noise floor of the downlink measurements */
+#define SENSOR_LINK_MAX_DATARATE            LORAWAN_DR_3
+
+/* Data rate used until the link has been measured */
+#define SENSOR_LINK_DEFAULT_DATARATE        LORAWAN_DR_1
+
+/* Margin above the demodulation floor a data rate needs, in tenths of a dB */
+#define SENSOR_LINK_MARGIN_DB10             100
+
+/* Consecutive failed confirmed uplinks that fall back to a slower data rate */
+#define SENSOR_LINK_MAX_FAILURES            3
+
+/* Uplinks without a measurement of the link before a link check is requested */
+#define SENSOR_LINK_CHECK_INTERVAL          8
+
+/* Uplinks since the last acknowledged one before an uplink is sent confirmed to check delivery */
+#define SENSOR_LINK_CONFIRMED_INTERVAL      16
+
+/* Uplinks after a link check is due without any downlink before the link is considered lost */
+#define SENSOR_LINK_LOSS_UPLINKS            3
+
+/**
+ * @brief Report the SNR of a downlink, from the downlink callback.
+ * 
+ * @param rssi The RSSI of the downlink in dBm
+ * @param snr The SNR of the downlink in dB
+ */
+void sensor_link_report_downlink(int16_t rssi, int8_t snr);
+
+/**
+ * @brief Report a LinkCheckAns, the margin is above the demodulation floor of the data rate the request was sent at.
+ * 
+ * @param demod_margin The margin of the uplink at the gateway in dB
+ * @param nb_gateways The number of gateways that received the uplink
+ */
+void sensor_link_report_link_check(uint8_t demod_margin, uint8_t nb_gateways);
+
+/**
+ * @brief Report the result of an uplink. Failed confirmed uplinks count towards falling back to a slower data rate.
+ * 
+ * @param is_confirmed Whether the uplink was confirmed
+ * @param is_success Whether the uplink was sent, and acknowledged if confirmed
+ */
+void sensor_link_report_uplink(uint8_t is_confirmed, uint8_t is_success);
+
+/**
+ * @brief Get the data rate to send uplinks at.
+ * 
+ * @return enum lorawan_datarate The data rate
+ */
+enum lorawan_datarate sensor_link_get_datarate(void);
+
+/**
+ * @brief Get the estimated SNR of the link.
+ * 
+ * @param snr_db10 The SNR in tenths of a dB
+ * @return int 0 on success, -EAGAIN if the link has not been measured
+ */
+int sensor_link_get_snr(int16_t *snr_db10);
+
+/**
+ * @brief Check if a link check should be sent with the next uplink, the link has not been measured for
+ * SENSOR_LINK_CHECK_INTERVAL uplinks.
+ * 
+ * @return int 1 if a link check is needed, 0 if not
+ */
+int sensor_link_needs_link_check(void);
+
+/**
+ * @brief Check if the next uplink should be confirmed. Uplinks are unconfirmed unless the data is critical, 
+ * SENSOR_LINK_CONFIRMED_INTERVAL uplinks have gone without an acknowledgement, or the link shows signs of loss: 
+ * the last confirmed uplink failed or link checks went unanswered for SENSOR_LINK_LOSS_UPLINKS uplinks.
+ * 
+ * @param is_critical Whether the data of the uplink must be delivered
+ * @return int 1 if the uplink should be confirmed, 0 if not
+ */
+int sensor_link_needs_confirmed(uint8_t is_critical);
+
+/**
+ * @brief Forget the link estimate and return to the default data rate, such as after a new join.
+ * 
+ */
+void sensor_link_reset(void);
+
+#endif
@@ -12,20 +12,60 @@
 #ifndef SENSOR_LORAWAN_H
 #define SENSOR_LORAWAN_H
 
+#include "sensor_budget.h"
 #include <zephyr/lorawan/lorawan.h>
 #include <stdint.h>
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
 
 #define MAX_LORAWAN_PAYLOAD 255
 
+/* Number of 16 bit words in the channel mask, the largest mask of the LoRaMAC regions */
+#define SENSOR_LORAWAN_CHANNELS_MASK_SIZE 6
+
+/**
+ * @brief Structure to hold the receive window and channel parameters of a session, set by the JoinAccept and 
+ * changed by the network with MAC commands.
+ */
+typedef struct {
+    /* Delay from the end of an uplink to the first receive window in milliseconds. */
+    uint32_t rx1_delay;
+    /* Frequency of the second receive window in Hz. */
+    uint32_t rx2_frequency;
+    /* Data rate of the second receive window. */
+    uint8_t rx2_datarate;
+    /* Offset of the first receive window data rate from the uplink data rate. */
+    uint8_t rx1_dr_offset;
+    /* Enabled channels, a bit for each channel. */
+    uint16_t channels_mask[SENSOR_LORAWAN_CHANNELS_MASK_SIZE];
+} lorawan_mac_params_t;
+
+/**
+ * @brief Structure to hold a LoRaWAN session, restored at start instead of joining the network again.
+ */
+typedef struct {
+    /* Device address assigned by the network at join. */
+    uint32_t dev_addr;
+    /* Uplink frame counter the restored session continues from. */
+    uint32_t fcnt_up;
+    /* Downlink frame counter of the last downlink received, the 32 bit counter of later downlinks is rebuilt from it. */
+    uint32_t fcnt_down;
+    /* Receive window and channel parameters. */
+    lorawan_mac_params_t mac_params;
+    /* Network session key. */
+    uint8_t nwk_skey[16];
+    /* Application session key. */
+    uint8_t app_skey[16];
+} lorawan_session_t;
+
 /**
  * @brief Structure to hold the LoRaWAN setup, used to join the network.
  */
 typedef struct {
     /* Whether the LoRaWAN is enabled. */
     uint8_t is_lorawan_enabled;
-    /* LoRaWAN frequency. */
-    uint8_t lorawan_frequency;
+    /* Interval between LoRaWAN uplinks in seconds. */
+    uint32_t lorawan_frequency;
     /* LoRaWAN Device. */
     const struct device *lora_dev;
     /* LoRaWAN uplink class. */
@@ -36,6 +76,12 @@ typedef struct {
     int join_attempts;
     /* Device Nonce for LoRaWAN Network. Should be tracked seperately for different euis. */
     uint16_t dev_nonce;
+    /* Nonces below this one are reserved in storage and can be used without storing them. */
+    uint16_t dev_nonce_reserved;
+    /* Stores the first nonce after a newly reserved block, called before any nonce of the block is used. Returns 0 on success. */
+    int (*store_dev_nonce)(uint16_t dev_nonce_reserved);
+    /* Called from the join thread with the result of a background join, 0 if joined. Can be NULL. */
+    void (*join_callback)(int result);
     /* Delay between joinattempts in milliseconds. */
     uint32_t delay;
     /* Device EUI for LoRaWAN Network. */
@@ -44,8 +90,15 @@ typedef struct {
     uint8_t join_eui[8];
     /* App Key for LoRaWAN Network. */
     uint8_t app_key[16];
-    /* How many attempts to send data when waiting for an ack, if 0, it will send an unconfirmed message. */
+    /* How many attempts to send a confirmed message, uplinks are only confirmed when the link policy asks for it. 
+     * If 0, every message is sent unconfirmed. */
     uint8_t send_attempts;
+    /* Session of the last join, set after a join. */
+    lorawan_session_t session;
+    /* Whether the session is valid, a valid session is restored instead of joining. */
+    uint8_t is_session_valid;
+    /* Whether the last setup restored the session instead of joining. */
+    uint8_t is_session_restored;
 } lorawan_setup_t;
 
 /**
@@ -60,8 +113,12 @@ typedef struct {
     uint8_t port;
     /* How many attempts to send data when waiting for an ack, if 0, it will send an unconfirmed message. */
     uint8_t attempts;
+    /* Whether the data must be delivered, it is sent confirmed when attempts is not 0. */
+    uint8_t is_critical;
     /* Delay between attempts in milliseconds. */
     uint32_t delay;
+    /* Set by sensor_lorawan_send_data, whether the data was sent confirmed and acknowledged. */
+    uint8_t is_acked;
 } lorawan_data_t;
 
 /**
@@ -80,21 +137,84 @@ int is_lorawan_configured(lorawan_setup_t *setup);
 void sensor_lorawan_log_network_config(lorawan_setup_t *setup);
 
 /**
- * @brief Setup LoRaWAN Network with a given lorawan_setup_t configuration. 
+ * @brief Setup LoRaWAN Network with a given lorawan_setup_t configuration. A valid session is restored without 
+ * joining, otherwise the network is joined in the background and the new session is set in the setup. Join attempts
+ * back off exponentially within the join duty cycle, and nonces are reserved in blocks before they are used.
  * 
- * @param setup setup configuration used to join lorawan network
- * @return int 0 if successful connection, < 0 if unsuccessful
+ * @param setup setup configuration used to join lorawan network, it must stay valid during the background join
+ * @return int 0 if the session was restored, -EINPROGRESS if the network is being joined in the background, 
+ * < 0 if unsuccessful
  */
 int sensor_lorawan_setup(lorawan_setup_t *setup);
 
 /**
- * @brief Send data to the LoRaWAN Network.
+ * @brief Wait for the network to be joined after sensor_lorawan_setup.
+ * 
+ * @param timeout How long to wait
+ * @return int 0 if joined, -ENOTCONN if the join failed, -EAGAIN if the wait timed out
+ */
+int sensor_lorawan_wait_joined(k_timeout_t timeout);
+
+/**
+ * @brief Send data to the LoRaWAN Network, at the data rate chosen from the link quality. Data with attempts may 
+ * still be sent unconfirmed by the link policy or the airtime budget, is_acked is set only when it was acknowledged.
  * 
  * @param data lorawan_data_t structure containing the data to send.
- * @return int 0 if successful, -1 if failed.
+ * @return int 0 if successful, -EMSGSIZE if the payload does not fit the highest data rate, -1 if failed.
  */
 int sensor_lorawan_send_data(lorawan_data_t *data);
 
+/**
+ * @brief Set the highest data rate uplinks can be sent at. Each uplink is sent at the data rate chosen from the 
+ * link quality, capped to this one.
+ * 
+ * @param datarate The highest data rate, LORAWAN_DR_0 to LORAWAN_DR_4
+ * @return int 0 if successful, -EINVAL if the data rate is not a valid uplink data rate
+ */
+int sensor_lorawan_set_max_datarate(enum lorawan_datarate datarate);
+
+/**
+ * @brief Get the maximum application payload at the data rate chosen from the link quality, the size to pack uplinks to.
+ * 
+ * @param max_payload The maximum payload in bytes
+ * @return int 0 if successful, < 0 if failed
+ */
+int sensor_lorawan_get_max_payload(uint16_t *max_payload);
+
+/**
+ * @brief Get the time on air of the last uplink, for a single transmission.
+ * 
+ * @param time_on_air_us The time on air in microseconds
+ * @return int 0 if successful, < 0 if failed
+ */
+int sensor_lorawan_get_last_time_on_air_us(uint32_t *time_on_air_us);
+
+/**
+ * @brief Get the step the airtime governor takes for the next uplink, counted at the maximum payload of the 
+ * data rate. Uplinks that do not fit the budget are refused by sensor_lorawan_send_data.
+ * 
+ * @return enum sensor_budget_level The step to take
+ */
+enum sensor_budget_level sensor_lorawan_get_budget_level(void);
+
+/**
+ * @brief Get the time on air of the uplinks in the rolling 24 hours of the airtime budget.
+ * 
+ * @param used_us The time on air used in microseconds
+ * @param level The step the governor takes for the next uplink
+ * @return int 0 if successful, < 0 if failed
+ */
+int sensor_lorawan_get_airtime(uint32_t *used_us, enum sensor_budget_level *level);
+
+/**
+ * @brief Get the current session from the LoRaMAC context, with the frame counters of the last uplink sent and
+ * downlink received and the receive parameters last set by the network.
+ * 
+ * @param session The session
+ * @return int 0 if successful, -EIO if the context could not be read, -ENOENT if the session keys are not found
+ */
+int sensor_lorawan_get_session(lorawan_session_t *session);
+
 /**
  * @brief Check if the LoRaWAN Network is connected.
  * 
@@ -102,5 +222,20 @@ int sensor_lorawan_send_data(lorawan_data_t *data);
  */
 int is_lorawan_connected(void);
 
+/**
+ * @brief Request the network time with a DeviceTimeReq MAC command, sent along with the next uplink.
+ * 
+ * @return int 0 if successful, < 0 if the request could not be queued
+ */
+int sensor_lorawan_request_time(void);
+
+/**
+ * @brief Get the GPS time kept by the LoRaWAN stack, set from the latest DeviceTimeAns.
+ * 
+ * @param gps_time The GPS time in seconds
+ * @return int 0 if successful, -EAGAIN if no DeviceTimeAns was received since the time was requested, < 0 if failed
+ */
+int sensor_lorawan_get_gps_time(uint32_t *gps_time);
+
 #endif
 
@@ -0,0 +1,92 @@
+/**
+ * @file sensor_radio.h
+ * @author Tyler Garcia
+ * @brief This is a library that owns the LoRaWAN radio in its own thread. Prepared uplinks are queued by priority
+ * and sent in the background, the result of each is returned through its completion callback.
+ * @version 0.1
+ * @date 2025-06-11
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#ifndef SENSOR_RADIO_H
+#define SENSOR_RADIO_H
+
+#include "sensor_lorawan.h"
+#include <stdint.h>
+
+/* Number of uplinks that can wait in each priority queue */
+#define SENSOR_RADIO_QUEUE_LENGTH       4
+
+/* Stack size of the radio thread, sending runs the LoRaWAN stack */
+#define SENSOR_RADIO_STACKSIZE          4096
+
+/* Priority of the radio thread, below sensor acquisition */
+#define SENSOR_RADIO_THREAD_PRIORITY    5
+
+/**
+ * @brief Enum for the priority of an uplink, high priority uplinks are sent before any low priority uplink.
+ */
+enum sensor_radio_priority {
+    SENSOR_RADIO_PRIORITY_HIGH,
+    SENSOR_RADIO_PRIORITY_LOW,
+    SENSOR_RADIO_PRIORITY_LIMIT,
+};
+
+/**
+ * @brief Enum for the result of an uplink passed to its completion callback.
+ */
+enum sensor_radio_result {
+    SENSOR_RADIO_RESULT_SENT,       // Unconfirmed uplink was sent
+    SENSOR_RADIO_RESULT_ACKED,      // Confirmed uplink was acknowledged by the network
+    SENSOR_RADIO_RESULT_FAILED,     // Uplink failed after all of its attempts
+    SENSOR_RADIO_RESULT_DROPPED,    // Uplink was dropped from a full queue or flushed before it was sent
+};
+
+/**
+ * @brief Callback for when an uplink is complete, called from the radio thread.
+ * 
+ * @param result The result of the uplink.
+ * @param user_data The user data of the uplink.
+ */
+typedef void (*sensor_radio_callback_t)(enum sensor_radio_result result, void *user_data);
+
+/**
+ * @brief Structure for an uplink prepared for the radio thread.
+ */
+typedef struct {
+    /* Payload, port and attempts of the uplink */
+    lorawan_data_t data;
+    /* Priority of the uplink */
+    enum sensor_radio_priority priority;
+    /* Called with the result of the uplink, can be NULL */
+    sensor_radio_callback_t callback;
+    /* Passed to the callback */
+    void *user_data;
+} sensor_radio_uplink_t;
+
+/**
+ * @brief Queue an uplink to be sent by the radio thread and return without waiting for it. When the queue of its
+ * priority is full, the oldest uplink in that queue is dropped to make room.
+ * 
+ * @param uplink The uplink to queue, it is copied into the queue.
+ * @return int 0 on success, -EINVAL if the priority is not valid
+ */
+int sensor_radio_enqueue(const sensor_radio_uplink_t *uplink);
+
+/**
+ * @brief Drop all queued uplinks, their callbacks are called with SENSOR_RADIO_RESULT_DROPPED. An uplink already
+ * being sent is not affected.
+ * 
+ */
+void sensor_radio_flush(void);
+
+/**
+ * @brief Get the number of uplinks waiting in the queues.
+ * 
+ * @return int The number of queued uplinks.
+ */
+int sensor_radio_get_queued(void);
+
+#endif
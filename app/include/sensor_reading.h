@@ -31,12 +31,27 @@ typedef struct {
     const struct adc_dt_spec voltage_read;
     /* ADC spec for current sensor. */
     const struct adc_dt_spec current_read;
+    /* QDEC device wired to d1/d2, NULL to decode quadrature with GPIO interrupts. The node must use 
+     * steps = <360> so one degree of rotation reported by the driver is one count. */
+    const struct device *qdec;
+    /* Gain drift of the voltage reading in ppm/°C, positive if the reading rises with temperature. */
+    int16_t voltage_tempco_ppm;
+    /* Gain drift of the current reading in ppm/°C, positive if the reading rises with temperature. */
+    int16_t current_tempco_ppm;
 } sensor_reading_config_t;
 
 #define VOLTAGE_READ_DIVIDER_HIGH     100
 #define VOLTAGE_READ_DIVIDER_LOW      13
 #define CURRENT_READ_RESISTOR         50
 #define PULSE_DEBOUNCE_MS             50
+/* Time edges are counted for a FREQUENCY_SENSOR reading, sets the resolution to 1000 / FREQUENCY_GATE_MS Hz. */
+#define FREQUENCY_GATE_MS             100
+/* Default drift of the divider ratio, set by the mismatch of the divider resistors. */
+#define VOLTAGE_READ_TEMPCO_PPM       25
+/* Default drift of the current shunt resistor. */
+#define CURRENT_READ_TEMPCO_PPM       100
+/* Temperature in hundredths of °C that the readings are calibrated at. */
+#define TEMPCO_REFERENCE_CENTI_C      2500
 
 /**
  * @brief Setup sensor for sensor_type with hardware configuration 
@@ -55,9 +70,17 @@ int sensor_reading_setup(sensor_reading_config_t *config, enum sensor_types sens
  */
 enum sensor_types get_sensor_reading_setup(sensor_reading_config_t *config);
 
+/**
+ * @brief Set the board temperature used to compensate the voltage and current readings. The value is cached
+ * so the readings do not need to fetch the temperature themselves.
+ * 
+ * @param temperature_centi_c temperature in hundredths of °C
+ */
+void sensor_reading_set_temperature(int32_t temperature_centi_c);
+
 /**
  * @brief Get the sensor voltage reading for a given sensor, takes into account 
- * the VOLTAGE_READ_DIVIDER_HIGH and VOLTAGE_READ_DIVIDER_LOW values
+ * the VOLTAGE_READ_DIVIDER_HIGH and VOLTAGE_READ_DIVIDER_LOW values and the voltage_tempco_ppm
  * 
  * @param config sensor hardware configuration
  * @return float voltage on sensor voltage_read pin, -1 if sensor is not configured to VOLTAGE_SENSOR
@@ -66,7 +89,7 @@ float get_sensor_voltage_reading(sensor_reading_config_t *config);
 
 /**
  * @brief Get the sensor current reading for a given sensor in milliamperes, takes 
- * into account the CURRENT_READ_RESISTOR
+ * into account the CURRENT_READ_RESISTOR and the current_tempco_ppm
  * 
  * @param config sensor hardware configuration
  * @return float current on sensor current_read pin in mA, -1 if sensor is not configured to CURRENT_SENSOR
@@ -89,4 +112,32 @@ int get_sensor_pulse_count(sensor_reading_config_t *config);
  */
 int reset_sensor_pulse_count(sensor_reading_config_t *config);
 
+/**
+ * @brief Get the net signed count of a QUADRATURE_SENSOR or PULSE_DIR_SENSOR since initialization or last reset.
+ * Quadrature is decoded on every edge of d1 and d2, so one full cycle counts 4.
+ * 
+ * @param config sensor hardware configuration
+ * @param count the net count, negative when moving in reverse
+ * @return int 0 if successful, -1 if sensor is not configured to QUADRATURE_SENSOR or PULSE_DIR_SENSOR
+ */
+int get_sensor_signed_count(sensor_reading_config_t *config, int32_t *count);
+
+/**
+ * @brief Reset the signed count for a given sensor to 0.
+ * 
+ * @param config sensor hardware configuration
+ * @return int 0 if successful, -1 if sensor is not configured to QUADRATURE_SENSOR or PULSE_DIR_SENSOR
+ */
+int reset_sensor_signed_count(sensor_reading_config_t *config);
+
+/**
+ * @brief Get the frequency of rising edges on d1 by counting them for FREQUENCY_GATE_MS. With the nrfx TIMER,
+ * GPIOTE and PPI drivers enabled the edges are counted in hardware, otherwise they are counted with a GPIO interrupt.
+ * 
+ * @param config sensor hardware configuration
+ * @param frequency measured frequency in Hz
+ * @return int 0 if successful, -1 if sensor is not configured to FREQUENCY_SENSOR or the count failed
+ */
+int get_sensor_frequency(sensor_reading_config_t *config, float *frequency);
+
 #endif
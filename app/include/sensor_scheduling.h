@@ -17,9 +17,16 @@
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 
+/* Maximum number of schedules that can be queued at once, all share a single alarm channel */
+#define SENSOR_SCHEDULING_MAX_SCHEDULES     16
+
+/* Counter channel used for the alarm of the nearest schedule */
+#define SENSOR_SCHEDULING_ALARM_CHANNEL     0
+
 /**
  * @brief Enum for the sensor scheduling id.
- * This is used to identify the sensor or radio to schedule.
+ * This is used to identify the sensor or radio to schedule. The id only labels a schedule, any number of 
+ * schedules up to SENSOR_SCHEDULING_MAX_SCHEDULES can be added.
  */
 enum sensor_scheduling_id{
     SENSOR_SCHEDULING_ID_SENSOR1,
@@ -29,9 +36,42 @@ enum sensor_scheduling_id{
 };
 
 /**
- * @brief Structure for the sensor scheduling configuration, each sensor and radio will have a schedule.
+ * @brief Enum for what a schedule does with the periods it missed because an event was handled late.
+ */
+enum sensor_scheduling_catch_up {
+    SENSOR_SCHEDULING_CATCH_UP_SKIP,    // Skip the missed periods and continue with the next period still ahead
+    SENSOR_SCHEDULING_CATCH_UP_ONCE,    // Trigger one event right away for all the missed periods, then continue
+    SENSOR_SCHEDULING_CATCH_UP_ALL,     // Trigger an event for every missed period back to back until caught up
+};
+
+/**
+ * @brief Structure for the lateness statistics of a schedule, the lateness of an event is the time from when it was 
+ * due until the schedule was reset after handling it.
  */
 typedef struct {
+    /* Maximum lateness of an event in milliseconds */
+    uint32_t max_lateness_ms;
+    /* Mean lateness of the events in milliseconds */
+    uint32_t mean_lateness_ms;
+    /* Number of periods that were skipped */
+    uint32_t missed_periods;
+    /* Number of events the statistics were taken over */
+    uint32_t event_count;
+} sensor_scheduling_stats_t;
+
+typedef struct sensor_scheduling_cfg sensor_scheduling_cfg_t;
+
+/**
+ * @brief Callback called from the alarm interrupt when a schedule is triggered.
+ * 
+ * @param schedule The schedule that was triggered
+ */
+typedef void (*sensor_scheduling_trigger_cb_t)(sensor_scheduling_cfg_t *schedule);
+
+/**
+ * @brief Structure for the sensor scheduling configuration, each sensor and radio will have a schedule.
+ */
+struct sensor_scheduling_cfg {
     /* The id of the component to schedule */
     enum sensor_scheduling_id id;
     /* The frequency of the schedule in seconds */
@@ -40,11 +80,39 @@ typedef struct {
     uint8_t is_scheduled;
     /* Whether this component schedule has been triggered */
     uint8_t is_triggered;
-    /* Last event time in seconds */
-    uint32_t last_event_time;
+    /* Last event time in milliseconds */
+    uint64_t last_event_ms;
     /* An optional trigger that isn't based on the frequency and is used for one-time events */
     uint8_t one_time_trigger;
-} sensor_scheduling_cfg_t;
+    /* Time of the next event in milliseconds, used to order the schedules */
+    uint64_t next_event_ms;
+    /* Whether this schedule is waiting in the queue for its next event */
+    uint8_t is_queued;
+    /* Position of this schedule in the queue, only valid when is_queued is set */
+    uint8_t queue_index;
+    /* Optional callback when the schedule is triggered, used to wake the thread handling it */
+    sensor_scheduling_trigger_cb_t trigger_callback;
+    /* Whether the events are anchored to anchor_ms + k * frequency_seconds instead of the last event */
+    uint8_t is_anchored;
+    /* Time in milliseconds that the events of an anchored schedule line up to */
+    uint64_t anchor_ms;
+    /* Number of periods since anchor_ms of the next event of an anchored schedule */
+    uint64_t event_index;
+    /* Number of periods skipped because the schedule was reset after their deadline had passed */
+    uint32_t missed_periods;
+    /* Maximum offset in milliseconds of each event of an anchored schedule from its anchored time, 0 for no jitter */
+    uint32_t jitter_ms;
+    /* State of the pseudo-random generator drawing the jitter of each event */
+    uint32_t jitter_state;
+    /* What to do with the periods missed when the schedule is reset late */
+    enum sensor_scheduling_catch_up catch_up;
+    /* Maximum lateness of an event in milliseconds */
+    uint32_t max_lateness_ms;
+    /* Sum of the lateness of the events in milliseconds, used for the mean */
+    uint64_t total_lateness_ms;
+    /* Number of events reset since the schedule was added */
+    uint32_t event_count;
+};
 
 /**
  * @brief Initialize the sensor scheduling module
@@ -55,13 +123,36 @@ typedef struct {
 int sensor_scheduling_init(const struct device *timer);
 
 /**
- * @brief Add a schedule to the sensor scheduling module
+ * @brief Add a schedule to the sensor scheduling module, the first event is frequency_seconds from now.
+ * Adding a schedule that is already added restarts it.
  * 
  * @param schedule The schedule to add
- * @return int 0 on success, negative error code on failure
+ * @return int 0 on success, -ENOMEM if SENSOR_SCHEDULING_MAX_SCHEDULES are already queued, negative error code on failure
  */
 int sensor_scheduling_add_schedule(sensor_scheduling_cfg_t *schedule);
 
+/**
+ * @brief Add a schedule whose events are anchored to anchor_ms + k * frequency_seconds. The events do not drift with 
+ * the time taken to handle them, and periods that were missed are skipped and counted in missed_periods.
+ * The first event is the first anchored time after now.
+ * 
+ * @param schedule The schedule to add
+ * @param anchor_ms The time in milliseconds that the events line up to, on the scheduling timebase
+ * @return int 0 on success, -ENOMEM if SENSOR_SCHEDULING_MAX_SCHEDULES are already queued, negative error code on failure
+ */
+int sensor_scheduling_add_anchored_schedule(sensor_scheduling_cfg_t *schedule, uint64_t anchor_ms);
+
+/**
+ * @brief Set a random jitter on the events of an anchored schedule, each event is offset from its anchored time by up 
+ * to jitter_ms either way. The anchored times are kept so the period still holds on average. Set before adding the schedule.
+ * 
+ * @param schedule The schedule to set the jitter for, frequency_seconds must be set
+ * @param jitter_ms The maximum offset of an event in milliseconds, must be less than half the period
+ * @param seed The seed of the jitter, schedules with different seeds draw different offsets
+ * @return int 0 on success, -EINVAL if the jitter is too large for the period
+ */
+int sensor_scheduling_set_jitter(sensor_scheduling_cfg_t *schedule, uint32_t jitter_ms, uint32_t seed);
+
 /**
  * @brief Remove a schedule from the sensor scheduling module
  * 
@@ -72,13 +163,33 @@ int sensor_scheduling_remove_schedule(sensor_scheduling_cfg_t *schedule);
 
 /**
  * @brief Reset a schedule in the sensor scheduling module. This will set the alarm to trigger at the given frequency from the last event time.
- * Triggering the next event based on the last event time keeps the schedule from drifting.
+ * Triggering the next event based on the last event time keeps the schedule from drifting. Anchored schedules trigger at the next 
+ * anchored time instead. Periods that have already passed are handled by the catch_up policy of the schedule, the ones skipped are 
+ * counted in missed_periods. The lateness of the event is added to the statistics of the schedule.
  * 
  * @param schedule The schedule to reset
  * @return int 0 on success, negative error code on failure
  */
 int sensor_scheduling_reset_schedule(sensor_scheduling_cfg_t *schedule);
 
+/**
+ * @brief Get the lateness statistics of a schedule since it was added.
+ * 
+ * @param schedule The schedule to get the statistics of
+ * @param stats The statistics of the schedule
+ * @return int 0 on success, negative error code on failure
+ */
+int sensor_scheduling_get_stats(sensor_scheduling_cfg_t *schedule, sensor_scheduling_stats_t *stats);
+
+/**
+ * @brief Get the time in seconds that the latest event of a schedule was due at, used to timestamp what the event does.
+ * For an anchored schedule this lines up exactly with anchor_ms + k * frequency_seconds.
+ * 
+ * @param schedule The schedule to get the event time from
+ * @return int The due time of the event in seconds if the schedule is triggered, the current time in seconds otherwise
+ */
+int sensor_scheduling_get_event_seconds(sensor_scheduling_cfg_t *schedule);
+
 /**
  * @brief Get the current time in seconds since the scheduling module was initialized
  * 
@@ -86,4 +197,12 @@ int sensor_scheduling_reset_schedule(sensor_scheduling_cfg_t *schedule);
  */
 int sensor_scheduling_get_seconds(void);
 
+/**
+ * @brief Get the current time in milliseconds since the scheduling module was initialized, from the 64-bit timebase
+ * 
+ * @param ms The current time in milliseconds
+ * @return int 0 on success, negative error code on failure
+ */
+int sensor_scheduling_get_ms(uint64_t *ms);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+/**
+ * @file sensor_time.h
+ * @author Tyler Garcia
+ * @brief This is a library to keep UTC time on top of the scheduling timebase. The time is synchronized
+ * from the network and the drift of the local clock is corrected between synchronizations.
+ * @version 0.1
+ * @date 2025-06-02
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#ifndef SENSOR_TIME_H
+#define SENSOR_TIME_H
+
+#include <stdint.h>
+
+/* Seconds between the Unix epoch (1970-01-01) and the GPS epoch (1980-01-06) */
+#define SENSOR_TIME_GPS_UNIX_OFFSET_SECONDS     315964800
+
+/* Leap seconds between GPS time and UTC */
+#define SENSOR_TIME_GPS_LEAP_SECONDS            18
+
+/* GPS time of 2020-01-01, GPS times before this are from a network that has not set the time */
+#define SENSOR_TIME_MIN_VALID_GPS_SECONDS       1261872018
+
+/* Minimum time between the reference and the latest synchronization to estimate the drift */
+#define SENSOR_TIME_MIN_DRIFT_INTERVAL_MS       (6ULL * 60 * 60 * 1000)
+
+/* Limit of the drift estimate, anything above this is treated as a bad synchronization */
+#define SENSOR_TIME_MAX_DRIFT_PPM               500
+
+/* Time after the latest synchronization that the time should be synchronized again */
+#define SENSOR_TIME_RESYNC_INTERVAL_MS          (24ULL * 60 * 60 * 1000)
+
+/**
+ * @brief Synchronize the UTC time to a time on the scheduling timebase.
+ * The first synchronization is kept as the reference to estimate the drift of the local clock. A synchronization
+ * with a drift out of bounds is not applied but becomes the new reference.
+ * 
+ * @param local_ms The time on the scheduling timebase in milliseconds
+ * @param utc_ms The UTC time in milliseconds since the Unix epoch at local_ms
+ * @return int 0 on success, -EINVAL if the drift to the reference is out of bounds
+ */
+int sensor_time_sync(uint64_t local_ms, uint64_t utc_ms);
+
+/**
+ * @brief Synchronize the UTC time from a GPS time, as received with the LoRaWAN DeviceTimeAns.
+ * 
+ * @param local_ms The time on the scheduling timebase in milliseconds
+ * @param gps_seconds The GPS time in seconds at local_ms
+ * @return int 0 on success, -EINVAL if the GPS time is not valid
+ */
+int sensor_time_sync_gps(uint64_t local_ms, uint32_t gps_seconds);
+
+/**
+ * @brief Check if the UTC time has been synchronized.
+ * 
+ * @return int 1 if synchronized, 0 if not
+ */
+int sensor_time_is_synced(void);
+
+/**
+ * @brief Check if the UTC time should be synchronized, either it never was or the latest synchronization is
+ * older than SENSOR_TIME_RESYNC_INTERVAL_MS.
+ * 
+ * @param local_ms The current time on the scheduling timebase in milliseconds
+ * @return int 1 if a synchronization is needed, 0 if not
+ */
+int sensor_time_needs_sync(uint64_t local_ms);
+
+/**
+ * @brief Get the estimated drift of the local clock, positive when the local clock runs slow.
+ * 
+ * @param drift_ppm The drift in parts per million
+ * @return int 0 on success, -EAGAIN if the drift has not been estimated yet
+ */
+int sensor_time_get_drift_ppm(int32_t *drift_ppm);
+
+/**
+ * @brief Convert a time on the scheduling timebase to UTC, corrected for the drift.
+ * 
+ * @param local_ms The time on the scheduling timebase in milliseconds
+ * @param utc_ms The UTC time in milliseconds since the Unix epoch
+ * @return int 0 on success, -EAGAIN if the time is not synchronized
+ */
+int sensor_time_local_to_utc_ms(uint64_t local_ms, uint64_t *utc_ms);
+
+/**
+ * @brief Convert a UTC time to the scheduling timebase, corrected for the drift.
+ * 
+ * @param utc_ms The UTC time in milliseconds since the Unix epoch
+ * @param local_ms The time on the scheduling timebase in milliseconds
+ * @return int 0 on success, -EAGAIN if the time is not synchronized, -ERANGE if the time is before the timebase started
+ */
+int sensor_time_utc_to_local_ms(uint64_t utc_ms, uint64_t *local_ms);
+
+/**
+ * @brief Get the time on the scheduling timebase of the next UTC time that is a multiple of a period,
+ * used to anchor schedules to wall-clock boundaries such as :00 and :15.
+ * 
+ * @param local_ms The current time on the scheduling timebase in milliseconds
+ * @param period_seconds The period to align to in seconds
+ * @param anchor_ms The time on the scheduling timebase of the next aligned UTC time
+ * @return int 0 on success, -EAGAIN if the time is not synchronized, -EINVAL if the period is 0
+ */
+int sensor_time_get_aligned_anchor_ms(uint64_t local_ms, uint32_t period_seconds, uint64_t *anchor_ms);
+
+/**
+ * @brief Forget the synchronization and the drift estimate.
+ * 
+ */
+void sensor_time_reset(void);
+
+#endif
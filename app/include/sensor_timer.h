@@ -24,12 +24,17 @@ typedef struct {
     counter_alarm_callback_t callback;
     /* Alarm time in seconds */
     uint32_t alarm_seconds;
+    /* Milliseconds added to alarm_seconds */
+    uint32_t alarm_ms;
     /* Counter channel to set the alarm on */
     uint8_t channel;
     /* 0 = alarm not set, 1 = alarm set */
     uint8_t is_alarm_set;
 } sensor_timer_alarm_cfg_t;
 
+/* Maximum number of alarm channels, the RTC has 4 compare channels */
+#define SENSOR_TIMER_MAX_CHANNELS   4
+
 /* Convert minutes to seconds to use in the sensor timer */
 #define MINUTES_TO_SECONDS(minutes) (minutes * 60)
 
@@ -54,6 +59,23 @@ int sensor_timer_start(const struct device *dev);
  */
 int sensor_timer_get_current_seconds(const struct device *dev);
 
+/**
+ * @brief Get the total ticks the timer has been running as a 64-bit value that does not wrap. The read is safe 
+ * against the top value callback and never goes backwards. This value is reset when the timer is reset.
+ * @param dev The timer device to get the total ticks from.
+ * @param total_ticks The total ticks the timer has been running.
+ * @return 0 on success, negative error code on failure.
+ */
+int sensor_timer_get_total_ticks(const struct device *dev, uint64_t *total_ticks);
+
+/**
+ * @brief Get the total milliseconds the timer has been running, from the total ticks. This value is reset when the timer is reset.
+ * @param dev The timer device to get the total milliseconds from.
+ * @param total_ms The total milliseconds the timer has been running.
+ * @return 0 on success, negative error code on failure.
+ */
+int sensor_timer_get_total_ms(const struct device *dev, uint64_t *total_ms);
+
 /**
  * @brief Get the total seconds the timer has been running. This value is reset when the timer is reset.
  * @param dev The timer device to get the total seconds from.
@@ -76,8 +98,9 @@ int sensor_timer_stop(const struct device *dev);
 int sensor_timer_reset(const struct device *dev);
 
 /**
- * @brief Set the alarm for the chosen sensor timer instance, also setting the top value of the timer to the chosen alarm value. 
- * When the alarm is triggered, the callback function will be called and the timer will be reset. In alarm callback, the is_alarm_set needs to be set to 0 manually.
+ * @brief Set the alarm for the chosen sensor timer instance. Alarms longer than the top value of the timer are split into 
+ * the fewest intermediate wake-ups and the callback is only called at the deadline. In alarm callback, the is_alarm_set 
+ * needs to be set to 0 manually.
  * @param dev The timer device to set the alarm for.
  * @param sensor_timer_alarm_cfg The alarm configuration to set.
  * @return 0 on success, negative error code on failure.
@@ -16,6 +16,8 @@
 #include <zephyr/logging/log.h>
 #include "sensor_nvs.h"
 #include "sensor_app.h"
+#include "sensor_downlink.h"
+#include <zephyr/sys/byteorder.h>
 
 LOG_MODULE_REGISTER(BLE_LORAWAN_SERVICE, LOG_LEVEL_INF);
 
@@ -23,6 +25,20 @@ LOG_MODULE_REGISTER(BLE_LORAWAN_SERVICE, LOG_LEVEL_INF);
 static lorawan_setup_t *lorawan_service_setup;
 static int is_lorawan_service_setup = 0;
 
+/**
+ * @brief Forget the stored session, it belongs to the previous keys so the network is joined again.
+ * 
+ */
+static void forget_session(void)
+{
+	if (!lorawan_service_setup->is_session_valid) {
+		return;
+	}
+	LOG_INF("LoRaWAN keys changed, the next start joins again");
+	lorawan_service_setup->is_session_valid = 0;
+	sensor_nvs_delete(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR);
+}
+
 static ssize_t read_enabled(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
 {
 	if(!is_lorawan_service_setup)
@@ -84,22 +100,26 @@ static ssize_t write_frequency(struct bt_conn *conn, const struct bt_gatt_attr *
 		return BT_GATT_ERR(BT_ATT_ERR_WRITE_NOT_PERMITTED);
 	}
 
-	// Check bounds of data
-	if (len != sizeof(lorawan_service_setup->lorawan_frequency)) {
-		LOG_ERR("Write date: Data length incorrect for LoRaWAN frequency");
-		LOG_ERR("len: %d, expected: %d", len, sizeof(lorawan_service_setup->lorawan_frequency));
-		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
-	}
-
 	if (offset != 0) {
 		LOG_ERR("Write date: Incorrect data offset for LoRaWAN frequency");
 		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
 	}
 
-	// Store incoming data into lorawan enabled buffer
-	memcpy(&lorawan_service_setup->lorawan_frequency, buf, len);
+	// Check bounds of data, the interval is in seconds or in minutes for a single byte
+	uint32_t seconds;
+	int ret = sensor_app_get_interval_from_write(buf, len, SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL, &seconds);
+	if (ret == -ERANGE) {
+		LOG_ERR("Write date: LoRaWAN frequency of %u seconds is below %d seconds", seconds, SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL);
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+	if (ret < 0) {
+		LOG_ERR("Write date: Data length incorrect for LoRaWAN frequency");
+		LOG_ERR("len: %d, expected: %d or 1", len, sizeof(lorawan_service_setup->lorawan_frequency));
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+	lorawan_service_setup->lorawan_frequency = seconds;
 
-	LOG_INF("LoRaWAN frequency new value: %d", lorawan_service_setup->lorawan_frequency);
+	LOG_INF("LoRaWAN frequency new value: %u seconds", lorawan_service_setup->lorawan_frequency);
 	sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_FREQUENCY, &lorawan_service_setup->lorawan_frequency, sizeof(lorawan_service_setup->lorawan_frequency));
 	return len;
 }
@@ -143,6 +163,7 @@ static ssize_t write_dev_eui(struct bt_conn *conn, const struct bt_gatt_attr *at
 		lorawan_service_setup->dev_eui[0],lorawan_service_setup->dev_eui[1],lorawan_service_setup->dev_eui[2],lorawan_service_setup->dev_eui[3], \
 		lorawan_service_setup->dev_eui[4],lorawan_service_setup->dev_eui[5],lorawan_service_setup->dev_eui[6],lorawan_service_setup->dev_eui[7]);
 	sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_DEV_EUI, lorawan_service_setup->dev_eui, sizeof(lorawan_service_setup->dev_eui));
+	forget_session();
 	return len;
 }
 
@@ -185,6 +206,7 @@ static ssize_t write_join_eui(struct bt_conn *conn, const struct bt_gatt_attr *a
 		lorawan_service_setup->join_eui[0],lorawan_service_setup->join_eui[1],lorawan_service_setup->join_eui[2],lorawan_service_setup->join_eui[3], \
 		lorawan_service_setup->join_eui[4],lorawan_service_setup->join_eui[5],lorawan_service_setup->join_eui[6],lorawan_service_setup->join_eui[7]);
 	sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_JOIN_EUI, lorawan_service_setup->join_eui, sizeof(lorawan_service_setup->join_eui));
+	forget_session();
 	return len;
 }
 
@@ -229,9 +251,33 @@ static ssize_t write_app_key(struct bt_conn *conn, const struct bt_gatt_attr *at
 		lorawan_service_setup->app_key[8],lorawan_service_setup->app_key[9],lorawan_service_setup->app_key[10],lorawan_service_setup->app_key[11], \
 		lorawan_service_setup->app_key[12],lorawan_service_setup->app_key[13],lorawan_service_setup->app_key[14],lorawan_service_setup->app_key[15]);
 	sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_APP_KEY, lorawan_service_setup->app_key, sizeof(lorawan_service_setup->app_key));
+	forget_session();
 	return len;
 }
 
+/**
+ * @brief Read the airtime budget, the time on air used over the rolling 24 hours and the budget in milliseconds 
+ * as 4 bytes each in little-endian, followed by the step of the airtime governor.
+ * 
+ */
+static ssize_t read_airtime(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
+{
+	uint8_t airtime[9];
+	uint32_t used_us;
+	enum sensor_budget_level level;
+	if(!is_lorawan_service_setup)
+	{
+		LOG_ERR("LoRaWAN BLE Service is not initialized");
+		return BT_GATT_ERR(BT_ATT_ERR_READ_NOT_PERMITTED);
+	}
+
+	sensor_lorawan_get_airtime(&used_us, &level);
+	sys_put_le32(used_us / 1000, &airtime[0]);
+	sys_put_le32(SENSOR_BUDGET_DAILY_US / 1000, &airtime[4]);
+	airtime[8] = level;
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, airtime, sizeof(airtime));
+}
+
 /* LoRaWAN Service Declaration */
 BT_GATT_SERVICE_DEFINE(lorawan_svc, BT_GATT_PRIMARY_SERVICE(BT_UUID_LORAWAN),
 
@@ -240,6 +286,7 @@ BT_GATT_SERVICE_DEFINE(lorawan_svc, BT_GATT_PRIMARY_SERVICE(BT_UUID_LORAWAN),
 	BT_GATT_CHARACTERISTIC(BT_UUID_LORAWAN_DEV_EUI, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, read_dev_eui, write_dev_eui, NULL),
 	BT_GATT_CHARACTERISTIC(BT_UUID_LORAWAN_JOIN_EUI, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, read_join_eui, write_join_eui, NULL),
 	BT_GATT_CHARACTERISTIC(BT_UUID_LORAWAN_APP_KEY, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, read_app_key, write_app_key, NULL),
+	BT_GATT_CHARACTERISTIC(BT_UUID_LORAWAN_AIRTIME, BT_GATT_CHRC_READ, BT_GATT_PERM_READ, read_airtime, NULL, NULL),
 
 );
 
@@ -17,6 +17,7 @@
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
 #include "sensor_nvs.h"
 #include "sensor_names.h"
 
@@ -63,6 +64,7 @@ static ssize_t write_sensor_state(struct bt_conn *conn, const struct bt_gatt_att
 	LOG_INF("Sensor state RECEIVED: %d", sensor_state);
     sensor_app_config->state = sensor_state;
     sensor_nvs_write(SENSOR_NVS_ADDRESS_APP_STATE, &sensor_app_config->state, sizeof(sensor_app_config->state));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -103,6 +105,7 @@ static ssize_t write_sensor1_enabled(struct bt_conn *conn, const struct bt_gatt_
 
 	LOG_INF("Sensor 1 enabled new value: %d", sensor_app_config->is_sensor_1_enabled);
     sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_1_ENABLED, &sensor_app_config->is_sensor_1_enabled, sizeof(sensor_app_config->is_sensor_1_enabled));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -155,6 +158,7 @@ static ssize_t write_sensor1_config(struct bt_conn *conn, const struct bt_gatt_a
 	strcpy(sensor_app_config->sensor_1_type_name, sensor_1_config_name);
 	// Store index of sensor type to nvs
     sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_1_TYPE, &sensor_app_config->sensor_1_type, sizeof(sensor_app_config->sensor_1_type));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -207,6 +211,7 @@ static ssize_t write_sensor1_pwr_config(struct bt_conn *conn, const struct bt_ga
 	strcpy(sensor_app_config->sensor_1_voltage_name, sensor_1_voltage_name);
 	// Store index of output voltage to nvs
     sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_1_POWER, &sensor_app_config->sensor_1_voltage, strlen(sensor_app_config->sensor_1_voltage_name));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -231,22 +236,20 @@ static ssize_t write_sensor1_data_freq(struct bt_conn *conn, const struct bt_gat
 		return BT_GATT_ERR(BT_ATT_ERR_WRITE_NOT_PERMITTED);
 	}
 
-	// Check bounds of data
-	if (len != sizeof(sensor_app_config->sensor_1_frequency)) {
-		LOG_ERR("Write date: Data length incorrect for sensor 1 frequency");
-		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
-	}
-
 	if (offset != 0) {
 		LOG_ERR("Write date: Incorrect data offset for sensor 1 frequency");
 		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
 	}
 
-	// Store incoming data into lorawan enabled buffer
-	memcpy(&sensor_app_config->sensor_1_frequency, buf, len);
+	// Check bounds of data, the interval is in seconds or in minutes for a single byte
+	if (sensor_app_get_interval_from_write(buf, len, 0, &sensor_app_config->sensor_1_frequency) < 0) {
+		LOG_ERR("Write date: Data length incorrect for sensor 1 frequency");
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
 
-	LOG_INF("Sensor 1 frequency new value: %d", sensor_app_config->sensor_1_frequency);
+	LOG_INF("Sensor 1 frequency new value: %u seconds", sensor_app_config->sensor_1_frequency);
     sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_1_FREQUENCY, &sensor_app_config->sensor_1_frequency, sizeof(sensor_app_config->sensor_1_frequency));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -268,7 +271,9 @@ static ssize_t read_sensor1_data_time(struct bt_conn *conn, const struct bt_gatt
 		LOG_ERR("Sensor BLE Service is not initialized");
 		return BT_GATT_ERR(BT_ATT_ERR_READ_NOT_PERMITTED);
 	}
-    return bt_gatt_attr_read(conn, attr, buf, len, offset, &sensor_app_config->sensor_1_latest_data_timestamp, sizeof(sensor_app_config->sensor_1_latest_data_timestamp));
+    // Seconds since the latest data, worked out when read so it does not go stale between readings
+    uint32_t data_age = sensor_app_get_current_timestamp_seconds() - sensor_app_config->sensor_1_latest_data_timestamp;
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &data_age, sizeof(data_age));
 }
 
 static ssize_t read_sensor2_enabled(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
@@ -308,6 +313,7 @@ static ssize_t write_sensor2_enabled(struct bt_conn *conn, const struct bt_gatt_
 
 	LOG_INF("Sensor 2 enabled new value: %d", sensor_app_config->is_sensor_2_enabled);
     sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_2_ENABLED, &sensor_app_config->is_sensor_2_enabled, sizeof(sensor_app_config->is_sensor_2_enabled));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -360,6 +366,7 @@ static ssize_t write_sensor2_config(struct bt_conn *conn, const struct bt_gatt_a
 	strcpy(sensor_app_config->sensor_2_type_name, sensor_2_config_name);
 	// Store index of sensor type to nvs
     sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_2_TYPE, &sensor_app_config->sensor_2_type, sizeof(sensor_app_config->sensor_2_type));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -412,6 +419,7 @@ static ssize_t write_sensor2_pwr_config(struct bt_conn *conn, const struct bt_ga
 	strcpy(sensor_app_config->sensor_2_voltage_name, sensor_2_voltage_name);
 	// Store index of output voltage to nvs
     sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_2_POWER, &sensor_app_config->sensor_2_voltage, strlen(sensor_app_config->sensor_2_voltage_name));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -436,22 +444,20 @@ static ssize_t write_sensor2_data_freq(struct bt_conn *conn, const struct bt_gat
 		return BT_GATT_ERR(BT_ATT_ERR_WRITE_NOT_PERMITTED);
 	}
 
-	// Check bounds of data
-	if (len != sizeof(sensor_app_config->sensor_2_frequency)) {
-		LOG_ERR("Write date: Data length incorrect for sensor 2 frequency");
-		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
-	}
-
 	if (offset != 0) {
 		LOG_ERR("Write date: Incorrect data offset for sensor 2 frequency");
 		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
 	}
 
-	// Store incoming data into lorawan enabled buffer
-	memcpy(&sensor_app_config->sensor_2_frequency, buf, len);
+	// Check bounds of data, the interval is in seconds or in minutes for a single byte
+	if (sensor_app_get_interval_from_write(buf, len, 0, &sensor_app_config->sensor_2_frequency) < 0) {
+		LOG_ERR("Write date: Data length incorrect for sensor 2 frequency");
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
 
-	LOG_INF("Sensor 2 frequency new value: %d", sensor_app_config->sensor_2_frequency);
+	LOG_INF("Sensor 2 frequency new value: %u seconds", sensor_app_config->sensor_2_frequency);
     sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_2_FREQUENCY, &sensor_app_config->sensor_2_frequency, sizeof(sensor_app_config->sensor_2_frequency));
+    sensor_app_notify_config_changed();
 	return len;
 }
 
@@ -473,7 +479,48 @@ static ssize_t read_sensor2_data_time(struct bt_conn *conn, const struct bt_gatt
 		LOG_ERR("Sensor BLE Service is not initialized");
 		return BT_GATT_ERR(BT_ATT_ERR_READ_NOT_PERMITTED);
 	}
-    return bt_gatt_attr_read(conn, attr, buf, len, offset, &sensor_app_config->sensor_2_latest_data_timestamp, sizeof(sensor_app_config->sensor_2_latest_data_timestamp));
+    uint32_t data_age = sensor_app_get_current_timestamp_seconds() - sensor_app_config->sensor_2_latest_data_timestamp;
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &data_age, sizeof(data_age));
+}
+
+/**
+ * @brief Read the lateness statistics of a schedule as max lateness, mean lateness, missed periods and event count, 
+ * each a little-endian uint32.
+ */
+static ssize_t read_schedule_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset, 
+    enum sensor_scheduling_id id)
+{
+    sensor_scheduling_stats_t stats;
+    uint8_t stats_buffer[4 * sizeof(uint32_t)];
+    if(!is_sensor_service_setup)
+	{
+		LOG_ERR("Sensor BLE Service is not initialized");
+		return BT_GATT_ERR(BT_ATT_ERR_READ_NOT_PERMITTED);
+	}
+    if(sensor_app_get_schedule_stats(id, &stats) < 0)
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+    }
+    sys_put_le32(stats.max_lateness_ms, &stats_buffer[0]);
+    sys_put_le32(stats.mean_lateness_ms, &stats_buffer[4]);
+    sys_put_le32(stats.missed_periods, &stats_buffer[8]);
+    sys_put_le32(stats.event_count, &stats_buffer[12]);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, stats_buffer, sizeof(stats_buffer));
+}
+
+static ssize_t read_sensor1_schedule_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
+{
+    return read_schedule_stats(conn, attr, buf, len, offset, SENSOR_SCHEDULING_ID_SENSOR1);
+}
+
+static ssize_t read_sensor2_schedule_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
+{
+    return read_schedule_stats(conn, attr, buf, len, offset, SENSOR_SCHEDULING_ID_SENSOR2);
+}
+
+static ssize_t read_radio_schedule_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
+{
+    return read_schedule_stats(conn, attr, buf, len, offset, SENSOR_SCHEDULING_ID_RADIO);
 }
 
 /* LED Button Service Declaration */
@@ -494,6 +541,10 @@ BT_GATT_SERVICE_DEFINE(sensor_svc, BT_GATT_PRIMARY_SERVICE(BT_UUID_SENSOR),
     BT_GATT_CHARACTERISTIC(BT_UUID_SENSOR2_DATA_FREQ, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, read_sensor2_data_freq, write_sensor2_data_freq, NULL),
     BT_GATT_CHARACTERISTIC(BT_UUID_SENSOR2_DATA, BT_GATT_CHRC_READ, BT_GATT_PERM_READ, read_sensor2_data, NULL, NULL),
     BT_GATT_CHARACTERISTIC(BT_UUID_SENSOR2_DATA_TIMESTAMP, BT_GATT_CHRC_READ, BT_GATT_PERM_READ, read_sensor2_data_time, NULL, NULL),
+
+    BT_GATT_CHARACTERISTIC(BT_UUID_SENSOR1_SCHEDULE_STATS, BT_GATT_CHRC_READ, BT_GATT_PERM_READ, read_sensor1_schedule_stats, NULL, NULL),
+    BT_GATT_CHARACTERISTIC(BT_UUID_SENSOR2_SCHEDULE_STATS, BT_GATT_CHRC_READ, BT_GATT_PERM_READ, read_sensor2_schedule_stats, NULL, NULL),
+    BT_GATT_CHARACTERISTIC(BT_UUID_RADIO_SCHEDULE_STATS, BT_GATT_CHRC_READ, BT_GATT_PERM_READ, read_radio_schedule_stats, NULL, NULL),
 );
 
 int ble_sensor_service_init(sensor_app_config_t *config)
@@ -0,0 +1,98 @@
+/**
+ * @file sensor_airtime.c
+ * @author Tyler Garcia
+ * @brief This is a library to calculate the time on air of LoRa packets and the payload limits of the
+ * US915 data rates, used to size uplinks for the data rate they are sent at.
+ * @version 0.1
+ * @date 2025-06-09
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "sensor_airtime.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(SENSOR_AIRTIME, LOG_LEVEL_INF);
+
+/**
+ * @brief Structure for a US915 uplink data rate.
+ */
+typedef struct {
+    /* Spreading factor used at the data rate */
+    uint8_t spreading_factor;
+    /* Bandwidth used at the data rate in kHz */
+    uint16_t bandwidth_khz;
+    /* Maximum application payload at the data rate in bytes */
+    uint16_t max_payload;
+} us915_datarate_t;
+
+/* US915 uplink data rates DR0 to DR4, from the LoRaWAN Regional Parameters */
+static const us915_datarate_t us915_datarates[] = {
+    [LORAWAN_DR_0] = {.spreading_factor = 10, .bandwidth_khz = 125, .max_payload = 11},
+    [LORAWAN_DR_1] = {.spreading_factor = 9, .bandwidth_khz = 125, .max_payload = 53},
+    [LORAWAN_DR_2] = {.spreading_factor = 8, .bandwidth_khz = 125, .max_payload = 125},
+    [LORAWAN_DR_3] = {.spreading_factor = 7, .bandwidth_khz = 125, .max_payload = 242},
+    [LORAWAN_DR_4] = {.spreading_factor = 8, .bandwidth_khz = 500, .max_payload = 242},
+};
+
+int sensor_airtime_get_time_on_air_us(const sensor_airtime_modulation_t *modulation, uint16_t payload_length, uint32_t *time_on_air_us)
+{
+    uint8_t sf = modulation->spreading_factor;
+    if (sf < 7 || sf > 12 || modulation->bandwidth_khz == 0 || modulation->coding_rate < 5 || modulation->coding_rate > 8) {
+        LOG_ERR("Invalid modulation SF%d, %d kHz, CR 4/%d", sf, modulation->bandwidth_khz, modulation->coding_rate);
+        return -EINVAL;
+    }
+    uint32_t symbol_us = ((1U << sf) * 1000U) / modulation->bandwidth_khz;
+    /* Low data rate optimization is required when a symbol is 16 ms or longer */
+    int32_t low_datarate_optimize = (symbol_us >= 16000) ? 1 : 0;
+    /* Explicit header and CRC, as used by LoRaWAN uplinks */
+    int32_t numerator = (8 * (int32_t)payload_length) - (4 * sf) + 28 + 16;
+    int32_t denominator = 4 * (sf - (2 * low_datarate_optimize));
+    uint32_t payload_symbols = 8;
+    if (numerator > 0) {
+        payload_symbols += ((numerator + denominator - 1) / denominator) * modulation->coding_rate;
+    }
+    /* The preamble is followed by 4.25 symbols of sync word, counted in quarter symbols */
+    uint64_t preamble_us = ((uint64_t)((SENSOR_AIRTIME_PREAMBLE_SYMBOLS * 4) + 17) * symbol_us) / 4;
+    *time_on_air_us = (uint32_t)(preamble_us + ((uint64_t)payload_symbols * symbol_us));
+    return 0;
+}
+
+int sensor_airtime_get_modulation(enum lorawan_datarate datarate, sensor_airtime_modulation_t *modulation)
+{
+    if (datarate > SENSOR_AIRTIME_MAX_DATARATE) {
+        LOG_ERR("DR%d is not a US915 uplink data rate", datarate);
+        return -EINVAL;
+    }
+    modulation->spreading_factor = us915_datarates[datarate].spreading_factor;
+    modulation->bandwidth_khz = us915_datarates[datarate].bandwidth_khz;
+    modulation->coding_rate = SENSOR_AIRTIME_LORAWAN_CODING_RATE;
+    return 0;
+}
+
+int sensor_airtime_get_max_payload(enum lorawan_datarate datarate, uint16_t *max_payload)
+{
+    if (datarate > SENSOR_AIRTIME_MAX_DATARATE) {
+        LOG_ERR("DR%d is not a US915 uplink data rate", datarate);
+        return -EINVAL;
+    }
+    *max_payload = us915_datarates[datarate].max_payload;
+    return 0;
+}
+
+int sensor_airtime_get_uplink_time_on_air_us(enum lorawan_datarate datarate, uint16_t payload_length, uint32_t *time_on_air_us)
+{
+    sensor_airtime_modulation_t modulation;
+    int ret = sensor_airtime_get_modulation(datarate, &modulation);
+    if (ret < 0) {
+        return ret;
+    }
+    if (payload_length > us915_datarates[datarate].max_payload) {
+        LOG_ERR("Payload of %d bytes does not fit DR%d", payload_length, datarate);
+        return -EMSGSIZE;
+    }
+    return sensor_airtime_get_time_on_air_us(&modulation, payload_length + SENSOR_AIRTIME_LORAWAN_OVERHEAD, time_on_air_us);
+}
@@ -19,12 +19,21 @@
 #include "sensor_nvs.h"
 #include "sensor_lorawan.h"
 #include "sensor_pmic.h"
+#include "sensor_time.h"
+#include "sensor_fragment.h"
+#include "sensor_radio.h"
+#include "sensor_downlink.h"
 #include "ble_sensor_service.h"
 #include "ble_lorawan_service.h"
 #include "ble_device_service.h"
 #include "sensor_names.h"
 #include <zephyr/logging/log.h>
 #include <zephyr/kernel.h>
+#include <zephyr/sys/reboot.h>
+#include <zephyr/sys/byteorder.h>
+#if defined(CONFIG_STATS)
+#include <zephyr/stats/stats.h>
+#endif
 
 LOG_MODULE_REGISTER(SENSOR_APP, LOG_LEVEL_INF);
 
@@ -36,29 +45,232 @@ struct k_thread blethread_id;
 
 static sensor_app_config_t *sensor_app_config;
 
+/* Sensor acquisition runs above the radio so a long uplink never delays a reading. The radio queue only builds 
+ * the payloads and handles downlinks, the sends and joins run on their own threads. */
+#define ACQUISITION_STACKSIZE       2048
+#define ACQUISITION_PRIORITY        2
+#define RADIO_STACKSIZE             2048
+#define RADIO_PRIORITY              5
+K_THREAD_STACK_DEFINE(acquisition_stack, ACQUISITION_STACKSIZE);
+K_THREAD_STACK_DEFINE(radio_stack, RADIO_STACKSIZE);
+static struct k_work_q acquisition_work_q;
+static struct k_work_q radio_work_q;
+static bool is_work_q_started;
+
+static void sensor1_work_handler(struct k_work *work);
+static void sensor2_work_handler(struct k_work *work);
+static void radio_work_handler(struct k_work *work);
+static void fragment_work_handler(struct k_work *work);
+static void downlink_work_handler(struct k_work *work);
+static void pmic_work_handler(struct k_work *work);
+K_WORK_DEFINE(sensor1_work, sensor1_work_handler);
+K_WORK_DEFINE(sensor2_work, sensor2_work_handler);
+K_WORK_DEFINE(radio_work, radio_work_handler);
+K_WORK_DELAYABLE_DEFINE(fragment_work, fragment_work_handler);
+K_WORK_DEFINE(downlink_work, downlink_work_handler);
+K_WORK_DELAYABLE_DEFINE(pmic_work, pmic_work_handler);
+
+/* Maximum fragments sent after an uplink, a larger backlog waits for the next uplink */
+#define SENSOR_APP_MAX_FRAGMENTS_PER_UPLINK     8
+
+/* Sequence number of the next fragment */
+static uint8_t fragment_sequence;
+
+/* Fragments sent since the last uplink */
+static uint8_t fragments_sent;
+
+/* Whether an uplink or fragment is queued or being sent. Only one is in flight so no sample is packed twice. */
+static atomic_t is_uplink_in_flight;
+
+/* Whether an uplink came due while another was in flight, it is sent once that one is complete */
+static atomic_t is_uplink_deferred;
+
+/* Samples of each sensor carried by the uplink in flight, cleared once it is sent */
+static uint32_t in_flight_sensor1_samples;
+static uint32_t in_flight_sensor2_samples;
+
+/* Sensor data and samples carried by the fragment in flight */
+static sensor_data_t *in_flight_fragment_data;
+static uint32_t in_flight_fragment_samples;
+
+/* Whether the network time was requested along with the uplink in flight */
+static uint8_t is_in_flight_time_requested;
+
+/* Longest configuration in the full header, the versions, LoRaWAN configuration and both sensors */
+#define SENSOR_APP_CONFIG_MAX_LENGTH        32
+
+/* When the airtime budget runs low, only one of this many uplinks is sent and the samples of the others go with it */
+#define SENSOR_APP_MERGED_UPLINKS           2
+
+/* Uplinks skipped since the last uplink sent while the airtime budget is low */
+static uint8_t uplinks_merged;
+
+/* Whether a full header has been sent since boot */
+static uint8_t is_full_header_sent;
+
+/* Configuration hash of the last full header sent */
+static uint32_t sent_config_hash;
+
+/* Uplinks sent with the compact header since the last full header */
+static uint8_t uplinks_since_full_header;
+
+/* Whether the uplink in flight carries the full header and the configuration hash it was built with */
+static uint8_t is_in_flight_full_header;
+static uint32_t in_flight_config_hash;
+
+/* Protects the sensor data shared between the acquisition and radio work queues */
+K_MUTEX_DEFINE(sensor_data_lock);
+
+/**
+ * @brief Structure to hold a downlink from the LoRaWAN callback until the radio work queue handles it.
+ */
+typedef struct {
+    /* Length of the downlink */
+    uint8_t length;
+    /* The downlink */
+    uint8_t data[SENSOR_DOWNLINK_MAX_LENGTH];
+} downlink_message_t;
+
+/* Downlinks waiting to be handled */
+K_MSGQ_DEFINE(downlink_queue, sizeof(downlink_message_t), 2, 1);
+
+/**
+ * @brief Structure to hold the configuration of a downlink as it is committed to NVS before it is applied, packed 
+ * so the whole of it fits in one NVS entry.
+ */
+typedef struct __packed {
+    /* Sequence number of the downlink */
+    uint8_t sequence;
+    /* Settings of each sensor, as in sensor_downlink_sensor_t */
+    struct __packed {
+        uint8_t set_fields;
+        uint8_t is_enabled;
+        uint8_t type;
+        uint8_t voltage;
+        uint32_t interval;
+    } sensors[SENSOR_DOWNLINK_MAX_SENSORS];
+    /* Uplink interval in seconds, if set */
+    uint8_t is_lorawan_interval_set;
+    uint32_t lorawan_interval;
+    /* Attempts of a confirmed uplink, if set */
+    uint8_t is_send_attempts_set;
+    uint8_t send_attempts;
+} downlink_config_record_t;
+
+BUILD_ASSERT(sizeof(downlink_config_record_t) <= SENSOR_NVS_MAX_SIZE, "Downlink configuration does not fit one NVS entry");
+
+/* Configuration of the last valid downlink, applied when the running state starts with the sensors stopped */
+static sensor_downlink_commands_t staged_downlink;
+
+/* Whether a downlink configuration is waiting to be applied */
+static atomic_t is_downlink_staged;
+
+/* Acknowledgement of the last downlink, sent in front of the next uplink */
+static uint8_t pending_ack[SENSOR_DOWNLINK_ACK_LENGTH];
+static uint8_t is_ack_pending;
+
+/* Acknowledgement carried by the uplink in flight */
+static uint8_t in_flight_ack[SENSOR_DOWNLINK_ACK_LENGTH];
+static uint8_t is_in_flight_ack;
+
+/* Whether to reboot once the acknowledgement is sent */
+static atomic_t is_reboot_requested;
+
+/* Protects the staged configuration and the acknowledgements */
+K_MUTEX_DEFINE(downlink_lock);
+
+/* Event that wakes the running state when the configuration changes */
+#define SENSOR_APP_EVENT_CONFIG_CHANGED     BIT(0)
+
+K_EVENT_DEFINE(sensor_app_events);
+
+/* Sensor readings line up to multiples of their period from this time on the scheduling timebase */
+#define SENSOR_APP_SCHEDULE_ANCHOR_MS       0
+
+/* Once the network time is synchronized, sensor readings line up to UTC multiples of their period such as :00 and :15 */
+#define SENSOR_APP_ALIGN_TO_WALL_CLOCK      1
+
+/* Phase difference below which an aligned schedule is not restarted after a time synchronization */
+#define SENSOR_APP_ALIGN_TOLERANCE_MS       1000
+
+/* Minimum delay from adding the radio schedule to the first uplink, so the sensors are read first */
+#define SENSOR_APP_RADIO_START_DELAY_MS     2000
+
+/* Maximum offset of each uplink from its period as a percent of the period, spreads uplinks across a fleet */
+#define SENSOR_APP_RADIO_JITTER_PERCENT     10
+
+/* Interval between refreshes of the cached PMIC status, the temperature changes slowly compared to the readings */
+#define SENSOR_APP_PMIC_REFRESH_MS          60000
+
+static void schedule_triggered(sensor_scheduling_cfg_t *schedule);
+
+/* A late reading is not repeated, readings stay on their anchored times */
 static sensor_scheduling_cfg_t sensor1_schedule = {
     .id = SENSOR_SCHEDULING_ID_SENSOR1,
-    .frequency_seconds = 0
+    .frequency_seconds = 0,
+    .trigger_callback = schedule_triggered,
+    .catch_up = SENSOR_SCHEDULING_CATCH_UP_SKIP,
 };
 
 static sensor_scheduling_cfg_t sensor2_schedule = {
     .id = SENSOR_SCHEDULING_ID_SENSOR2,
-    .frequency_seconds = 0
+    .frequency_seconds = 0,
+    .trigger_callback = schedule_triggered,
+    .catch_up = SENSOR_SCHEDULING_CATCH_UP_SKIP,
 };
 
+/* One uplink right away sends everything read during a late uplink */
 static sensor_scheduling_cfg_t radio_schedule = {
     .id = SENSOR_SCHEDULING_ID_RADIO,
-    .frequency_seconds = 0
+    .frequency_seconds = 0,
+    .trigger_callback = schedule_triggered,
+    .catch_up = SENSOR_SCHEDULING_CATCH_UP_ONCE,
+};
+
+#if defined(CONFIG_STATS)
+/* Lateness statistics of the schedules, readable with the mcumgr statistics group */
+STATS_SECT_START(schedule_stats)
+STATS_SECT_ENTRY32(max_lateness_ms)
+STATS_SECT_ENTRY32(mean_lateness_ms)
+STATS_SECT_ENTRY32(missed_periods)
+STATS_SECT_ENTRY32(event_count)
+STATS_SECT_END;
+
+STATS_NAME_START(schedule_stats)
+STATS_NAME(schedule_stats, max_lateness_ms)
+STATS_NAME(schedule_stats, mean_lateness_ms)
+STATS_NAME(schedule_stats, missed_periods)
+STATS_NAME(schedule_stats, event_count)
+STATS_NAME_END(schedule_stats);
+
+/* Lateness statistics of each schedule by its id */
+static STATS_SECT_DECL(schedule_stats) schedule_lateness_stats[SENSOR_SCHEDULING_ID_LIMIT];
+
+/* Names the statistics of each schedule are registered with */
+static const char *const schedule_stats_names[SENSOR_SCHEDULING_ID_LIMIT] = {
+    [SENSOR_SCHEDULING_ID_SENSOR1] = "sched_sensor1",
+    [SENSOR_SCHEDULING_ID_SENSOR2] = "sched_sensor2",
+    [SENSOR_SCHEDULING_ID_RADIO] = "sched_radio",
 };
+#endif
+
+static int store_dev_nonce(uint16_t dev_nonce_reserved);
+static void lorawan_join_complete(int result);
+static void downlink_received(uint8_t port, uint8_t flags, int16_t rssi, int8_t snr, uint8_t len, const uint8_t *data);
 
 static lorawan_setup_t lorawan_setup = {
     .is_lorawan_enabled = 0,
     .lorawan_frequency = 0,
 	.lora_dev = DEVICE_DT_GET(DT_ALIAS(lora0)),
 	.uplink_class = LORAWAN_CLASS_A,
-	.downlink_callback = {0},
+	.downlink_callback = {
+		.port = SENSOR_DOWNLINK_PORT,
+		.cb = downlink_received,
+	},
 	.join_attempts = 20,
 	.dev_nonce = 240,
+	.store_dev_nonce = store_dev_nonce,
+	.join_callback = lorawan_join_complete,
 	.delay = 1000,
 	.dev_eui =  {0},
 	.join_eui = {0},
@@ -96,6 +308,242 @@ static ble_config_t ble_config = {
 	.adv_interval_max_ms = 510
 };
 
+/**
+ * @brief Submit the work for a schedule to its work queue.
+ * 
+ * @param id The id of the schedule to submit the work for.
+ */
+static void submit_schedule_work(enum sensor_scheduling_id id)
+{
+    switch(id)
+    {
+        case SENSOR_SCHEDULING_ID_SENSOR1:
+            k_work_submit_to_queue(&acquisition_work_q, &sensor1_work);
+            break;
+        case SENSOR_SCHEDULING_ID_SENSOR2:
+            k_work_submit_to_queue(&acquisition_work_q, &sensor2_work);
+            break;
+        case SENSOR_SCHEDULING_ID_RADIO:
+            k_work_submit_to_queue(&radio_work_q, &radio_work);
+            break;
+        default:
+            LOG_ERR("No work for schedule %d", id);
+            break;
+    }
+}
+
+/**
+ * @brief Submit the work for a triggered schedule, called from the alarm interrupt.
+ * 
+ * @param schedule The schedule that was triggered.
+ */
+static void schedule_triggered(sensor_scheduling_cfg_t *schedule)
+{
+    submit_schedule_work(schedule->id);
+}
+
+void sensor_app_notify_config_changed(void)
+{
+    k_event_post(&sensor_app_events, SENSOR_APP_EVENT_CONFIG_CHANGED);
+}
+
+int sensor_app_get_interval_from_write(const void *buf, uint16_t len, uint32_t min_seconds, uint32_t *seconds)
+{
+    if (len == sizeof(uint32_t)) {
+        *seconds = sys_get_le32(buf);
+    }
+    else if (len == sizeof(uint8_t)) {
+        *seconds = MINUTES_TO_SECONDS((uint32_t)*(const uint8_t *)buf);
+    }
+    else {
+        return -EINVAL;
+    }
+    if (*seconds < min_seconds) {
+        return -ERANGE;
+    }
+    return 0;
+}
+
+/**
+ * @brief Fetch the PMIC status and pass its temperature on to compensate the sensor readings.
+ * 
+ * @return int 0 on success, negative error code on failure
+ */
+static int update_pmic_status(void)
+{
+    int ret = sensor_pmic_status_get(&pmic_status);
+    if(ret < 0)
+    {
+        return ret;
+    }
+    sensor_data_set_temperature(pmic_status.temp);
+    return 0;
+}
+
+/**
+ * @brief Refresh the cached PMIC status on the radio work queue, the readings and uplinks only use the cached status.
+ * 
+ * @param work The PMIC work.
+ */
+static void pmic_work_handler(struct k_work *work)
+{
+    if(update_pmic_status() < 0)
+    {
+        LOG_WRN("Failed to refresh the PMIC status");
+    }
+    k_work_schedule_for_queue(&radio_work_q, &pmic_work, K_MSEC(SENSOR_APP_PMIC_REFRESH_MS));
+}
+
+/**
+ * @brief Get the timestamp of a time on the scheduling timebase, in UTC seconds once the time is synchronized 
+ * and in seconds on the scheduling timebase before that.
+ * 
+ * @param local_ms The time on the scheduling timebase in milliseconds
+ * @return uint32_t The timestamp in seconds
+ */
+static uint32_t get_timestamp_seconds(uint64_t local_ms)
+{
+    uint64_t utc_ms;
+    if(sensor_time_local_to_utc_ms(local_ms, &utc_ms) == 0)
+    {
+        return (uint32_t)(utc_ms / 1000);
+    }
+    return (uint32_t)(local_ms / 1000);
+}
+
+uint32_t sensor_app_get_current_timestamp_seconds(void)
+{
+    uint64_t current_ms;
+    if(sensor_scheduling_get_ms(&current_ms) < 0)
+    {
+        return (uint32_t)sensor_scheduling_get_seconds();
+    }
+    return get_timestamp_seconds(current_ms);
+}
+
+/**
+ * @brief Get the anchor of a sensor schedule, the next UTC multiple of its period when the time is synchronized 
+ * and SENSOR_APP_SCHEDULE_ANCHOR_MS otherwise.
+ * 
+ * @param schedule The schedule to get the anchor for, the frequency must be set.
+ * @return uint64_t The anchor on the scheduling timebase in milliseconds
+ */
+static uint64_t get_schedule_anchor_ms(sensor_scheduling_cfg_t *schedule)
+{
+    uint64_t current_ms;
+    uint64_t anchor_ms;
+    if(SENSOR_APP_ALIGN_TO_WALL_CLOCK && sensor_scheduling_get_ms(&current_ms) == 0 && 
+        sensor_time_get_aligned_anchor_ms(current_ms, schedule->frequency_seconds, &anchor_ms) == 0)
+    {
+        return anchor_ms;
+    }
+    return SENSOR_APP_SCHEDULE_ANCHOR_MS;
+}
+
+/**
+ * @brief Restart an anchored sensor schedule on the wall-clock anchor if its phase has moved from it.
+ * 
+ * @param schedule The schedule to align.
+ */
+static void align_sensor_schedule(sensor_scheduling_cfg_t *schedule)
+{
+    if(!schedule->is_scheduled || !schedule->is_anchored)
+    {
+        return;
+    }
+    uint64_t anchor_ms = get_schedule_anchor_ms(schedule);
+    uint64_t period_ms = (uint64_t)schedule->frequency_seconds * 1000;
+    uint64_t phase_ms = (anchor_ms > schedule->anchor_ms ? anchor_ms - schedule->anchor_ms : schedule->anchor_ms - anchor_ms) % period_ms;
+    if(phase_ms < SENSOR_APP_ALIGN_TOLERANCE_MS || period_ms - phase_ms < SENSOR_APP_ALIGN_TOLERANCE_MS)
+    {
+        return;
+    }
+    sensor_scheduling_remove_schedule(schedule);
+    if(sensor_scheduling_add_anchored_schedule(schedule, anchor_ms) < 0)
+    {
+        LOG_ERR("Failed to align schedule %d to the wall-clock", schedule->id);
+        return;
+    }
+    LOG_INF("Schedule %d aligned to the wall-clock", schedule->id);
+}
+
+/**
+ * @brief Synchronize the UTC time from the network time received with the latest uplink and align the sensor schedules to it.
+ * 
+ */
+static void update_time_sync(void)
+{
+    uint32_t gps_time;
+    uint64_t current_ms;
+    int ret = sensor_lorawan_get_gps_time(&gps_time);
+    if(ret == -EAGAIN)
+    {
+        LOG_WRN("Network did not answer the time request");
+        return;
+    }
+    if(ret < 0 || sensor_scheduling_get_ms(&current_ms) < 0)
+    {
+        LOG_ERR("Failed to get the network time");
+        return;
+    }
+    if(sensor_time_sync_gps(current_ms, gps_time) < 0)
+    {
+        return;
+    }
+    if(sensor_app_config->is_sensor_1_enabled)
+    {
+        align_sensor_schedule(&sensor1_schedule);
+    }
+    if(sensor_app_config->is_sensor_2_enabled)
+    {
+        align_sensor_schedule(&sensor2_schedule);
+    }
+}
+
+/**
+ * @brief Get a seed that differs between devices from the DevEUI, with a 32-bit FNV-1a hash.
+ * 
+ * @return uint32_t The seed
+ */
+static uint32_t get_dev_eui_seed(void)
+{
+    uint32_t hash = 2166136261u;
+    for(int i = 0; i < sizeof(lorawan_setup.dev_eui); i++)
+    {
+        hash ^= lorawan_setup.dev_eui[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Add the radio schedule with a phase and per-period jitter drawn from the DevEUI, so that devices 
+ * powered up together do not transmit together.
+ * 
+ * @return int 0 on success, negative error code on failure
+ */
+static int add_radio_schedule(void)
+{
+    int ret;
+    uint64_t current_ms;
+    uint32_t seed = get_dev_eui_seed();
+    uint64_t period_ms = (uint64_t)radio_schedule.frequency_seconds * 1000;
+    ret = sensor_scheduling_get_ms(&current_ms);
+    if(ret < 0)
+    {
+        return ret;
+    }
+    ret = sensor_scheduling_set_jitter(&radio_schedule, (uint32_t)((period_ms * SENSOR_APP_RADIO_JITTER_PERCENT) / 100), seed);
+    if(ret < 0)
+    {
+        return ret;
+    }
+    /* Scramble the seed so the phase does not follow the first jitter drawn from it */
+    uint64_t phase_ms = (uint64_t)(seed * 2654435761u) % period_ms;
+    LOG_INF("Radio schedule phase %llu ms", phase_ms);
+    return sensor_scheduling_add_anchored_schedule(&radio_schedule, current_ms + SENSOR_APP_RADIO_START_DELAY_MS + phase_ms);
+}
+
 static int initialize_nvs_address(enum sensor_nvs_address address, void *data, size_t size)
 {
     int ret;
@@ -112,17 +560,142 @@ static int initialize_nvs_address(enum sensor_nvs_address address, void *data, s
     return 0;
 }
 
+/**
+ * @brief Initialize an interval in seconds from NVS. Intervals used to be stored as a single byte of minutes, 
+ * those are converted to seconds and stored again in the current format.
+ * 
+ * @param address The NVS address of the interval.
+ * @param seconds The interval in seconds, the default is stored if nothing is found.
+ * @return int 0 on success, -1 on failure
+ */
+static int initialize_interval_nvs_address(enum sensor_nvs_address address, uint32_t *seconds)
+{
+    uint32_t stored_seconds;
+    uint8_t legacy_minutes;
+    if(sensor_nvs_read(address, &stored_seconds, sizeof(stored_seconds)) == 0)
+    {
+        *seconds = stored_seconds;
+        return 0;
+    }
+    if(sensor_nvs_read(address, &legacy_minutes, sizeof(legacy_minutes)) == 0)
+    {
+        LOG_INF("Migrating interval at NVS address %d from %d minutes to seconds", address, legacy_minutes);
+        *seconds = MINUTES_TO_SECONDS((uint32_t)legacy_minutes);
+    }
+    if(sensor_nvs_write(address, seconds, sizeof(*seconds)) < 0)
+    {
+        LOG_DBG("Failed to write data to NVS address %d", address);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read the session of the last join from NVS, it is only valid when all of its parts are found. Sessions 
+ * stored without their downlink frame counter and receive parameters are joined again.
+ * 
+ */
+static void initialize_lorawan_session_nvs(void)
+{
+    lorawan_session_t *session = &lorawan_setup.session;
+    lorawan_setup.is_session_valid = 
+        sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR, &session->dev_addr, sizeof(session->dev_addr)) == 0 &&
+        sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP, &session->fcnt_up, sizeof(session->fcnt_up)) == 0 &&
+        sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_NWK_SKEY, session->nwk_skey, sizeof(session->nwk_skey)) == 0 &&
+        sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_APP_SKEY, session->app_skey, sizeof(session->app_skey)) == 0 &&
+        sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_DOWN, &session->fcnt_down, sizeof(session->fcnt_down)) == 0 &&
+        sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_MAC_PARAMS, &session->mac_params, sizeof(session->mac_params)) == 0;
+    if(lorawan_setup.is_session_valid)
+    {
+        LOG_INF("Found LoRaWAN session, DevAddr: 0x%08x", session->dev_addr);
+    }
+}
+
+/**
+ * @brief Reserve the next SENSOR_APP_FCNT_GAP frame counters in NVS. A restored session continues after the 
+ * reserved ones, so no frame counter is reused without writing NVS for every uplink.
+ * 
+ * @param fcnt_up The uplink frame counter in use.
+ */
+static void reserve_frame_counters(uint32_t fcnt_up)
+{
+    lorawan_setup.session.fcnt_up = fcnt_up + SENSOR_APP_FCNT_GAP;
+    sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP, &lorawan_setup.session.fcnt_up, sizeof(lorawan_setup.session.fcnt_up));
+}
+
+/**
+ * @brief Store the downlink frame counter and the receive parameters of the session. NVS does not write data that 
+ * is unchanged, so the parameters are only written when the network changes them.
+ * 
+ */
+static void save_lorawan_session_state(void)
+{
+    lorawan_session_t *session = &lorawan_setup.session;
+    sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_DOWN, &session->fcnt_down, sizeof(session->fcnt_down));
+    sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_MAC_PARAMS, &session->mac_params, sizeof(session->mac_params));
+}
+
+/**
+ * @brief Store the session after joining or restoring it. NVS does not write data that is unchanged, so a restored 
+ * session only writes its frame counter reservation.
+ * 
+ */
+static void save_lorawan_session(void)
+{
+    lorawan_session_t *session = &lorawan_setup.session;
+    if(!lorawan_setup.is_session_valid)
+    {
+        return;
+    }
+    if(!lorawan_setup.is_session_restored)
+    {
+        /* The device address marks the session valid, it goes first so a reset part way never mixes two sessions. */
+        sensor_nvs_delete(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR);
+        sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_NWK_SKEY, session->nwk_skey, sizeof(session->nwk_skey));
+        sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_APP_SKEY, session->app_skey, sizeof(session->app_skey));
+    }
+    save_lorawan_session_state();
+    reserve_frame_counters(session->fcnt_up);
+    sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR, &session->dev_addr, sizeof(session->dev_addr));
+}
+
+/**
+ * @brief Reserve more frame counters once the uplinks are close to using up the reserved ones, and store the 
+ * receive parameters the network changed since the join. Called from the radio thread after every uplink.
+ * 
+ */
+static void update_frame_counter_reservation(void)
+{
+    lorawan_session_t current_session;
+    if(!lorawan_setup.is_session_valid || sensor_lorawan_get_session(&current_session) < 0)
+    {
+        return;
+    }
+    lorawan_setup.session.mac_params = current_session.mac_params;
+    if(current_session.fcnt_up + SENSOR_APP_FCNT_MARGIN >= lorawan_setup.session.fcnt_up)
+    {
+        LOG_INF("Reserving frame counters from %d", current_session.fcnt_up);
+        /* An older downlink frame counter is still accepted, so it is only stored along with the reservation. */
+        lorawan_setup.session.fcnt_down = current_session.fcnt_down;
+        reserve_frame_counters(current_session.fcnt_up);
+    }
+    save_lorawan_session_state();
+}
+
 static int initialize_lorawan_nvs(void)
 {
     LOG_INF("Reading LoRaWAN NVS");
     initialize_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_ENABLED, &lorawan_setup.is_lorawan_enabled, sizeof(lorawan_setup.is_lorawan_enabled));
-    initialize_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_FREQUENCY, &lorawan_setup.lorawan_frequency, sizeof(lorawan_setup.lorawan_frequency));
+    initialize_interval_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_FREQUENCY, &lorawan_setup.lorawan_frequency);
     initialize_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_DEV_EUI, &lorawan_setup.dev_eui, sizeof(lorawan_setup.dev_eui));
     initialize_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_JOIN_EUI, &lorawan_setup.join_eui, sizeof(lorawan_setup.join_eui));
     initialize_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_APP_KEY, &lorawan_setup.app_key, sizeof(lorawan_setup.app_key));
     initialize_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_DEV_NONCE, &lorawan_setup.dev_nonce, sizeof(lorawan_setup.dev_nonce));
+    /* The stored nonce is the end of the last reserved block, any nonce before it may have been used. */
+    lorawan_setup.dev_nonce_reserved = lorawan_setup.dev_nonce;
     initialize_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_JOIN_ATTEMPTS, &lorawan_setup.join_attempts, sizeof(lorawan_setup.join_attempts));
     initialize_nvs_address(SENSOR_NVS_ADDRESS_LORAWAN_SEND_ATTEMPTS, &lorawan_setup.send_attempts, sizeof(lorawan_setup.send_attempts));
+    initialize_lorawan_session_nvs();
     return 0;
 }
 
@@ -136,14 +709,17 @@ static int initialize_sensor_nvs(void)
     get_sensor_voltage_name_from_index(sensor_app_config->sensor_1_voltage_name, sensor_app_config->sensor_1_voltage);
     initialize_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_1_TYPE, &sensor_app_config->sensor_1_type, sizeof(sensor_app_config->sensor_1_type));
     get_sensor_type_name_from_index(sensor_app_config->sensor_1_type_name, sensor_app_config->sensor_1_type);
-    initialize_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_1_FREQUENCY, &sensor_app_config->sensor_1_frequency, sizeof(sensor_app_config->sensor_1_frequency));
+    initialize_interval_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_1_FREQUENCY, &sensor_app_config->sensor_1_frequency);
 
     initialize_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_2_ENABLED, &sensor_app_config->is_sensor_2_enabled, sizeof(sensor_app_config->is_sensor_2_enabled));
     initialize_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_2_POWER, &sensor_app_config->sensor_2_voltage, sizeof(sensor_app_config->sensor_2_voltage));
     get_sensor_voltage_name_from_index(sensor_app_config->sensor_2_voltage_name, sensor_app_config->sensor_2_voltage);
     initialize_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_2_TYPE, &sensor_app_config->sensor_2_type, sizeof(sensor_app_config->sensor_2_type));
     get_sensor_type_name_from_index(sensor_app_config->sensor_2_type_name, sensor_app_config->sensor_2_type);
-    initialize_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_2_FREQUENCY, &sensor_app_config->sensor_2_frequency, sizeof(sensor_app_config->sensor_2_frequency));
+    initialize_interval_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_2_FREQUENCY, &sensor_app_config->sensor_2_frequency);
+
+    initialize_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_1_WARMUP, &sensor1_data.warmup, sizeof(sensor1_data.warmup));
+    initialize_nvs_address(SENSOR_NVS_ADDRESS_SENSOR_2_WARMUP, &sensor2_data.warmup, sizeof(sensor2_data.warmup));
     return 0;
 }
 
@@ -171,344 +747,1407 @@ static int initialize_nvs(void)
     return 0;
 }
 
-static int sensor_lorawan_connection(void)
+/**
+ * @brief Store the end of a newly reserved block of nonces, called by the join before any nonce of the block is used.
+ * 
+ * @param dev_nonce_reserved The first nonce after the block.
+ * @return int 0 on success, -1 on failure
+ */
+static int store_dev_nonce(uint16_t dev_nonce_reserved)
+{
+    LOG_INF("Reserving dev nonces up to %d", dev_nonce_reserved);
+    return sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_DEV_NONCE, &dev_nonce_reserved, sizeof(dev_nonce_reserved));
+}
+
+/**
+ * @brief Called from the join thread once a background join is complete.
+ * 
+ * @param result 0 if joined, < 0 if the join failed.
+ */
+static void lorawan_join_complete(int result)
+{
+    if(result == 0)
+    {
+        /* Save the session so the next start restores it instead of joining. */
+        save_lorawan_session();
+        return;
+    }
+    if(sensor_app_config->state == SENSOR_APP_STATE_RUNNING)
+    {
+        /* As when joining before running, uplinks cannot be sent without the network. */
+        LOG_ERR("Failed to join LoRaWAN while running");
+        sensor_app_config->state = SENSOR_APP_STATE_ERROR;
+        k_event_post(&sensor_app_events, SENSOR_APP_EVENT_CONFIG_CHANGED);
+    }
+}
+
+/**
+ * @brief Connect to LoRaWAN by restoring the stored session or joining in the background.
+ * 
+ * @param join_timeout How long to wait for a background join, uplinks wait for it to finish when not waited for.
+ * @return int 0 on success or while still joining, -1 on failure
+ */
+static int sensor_lorawan_connection(k_timeout_t join_timeout)
 {
     int ret;
     sensor_lorawan_log_network_config(&lorawan_setup);
     if(is_lorawan_configured(&lorawan_setup) == 0)
     {
         ret = sensor_lorawan_setup(&lorawan_setup);
-        /* Save the dev nonce to NVS after connection attempt. */
-        sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_DEV_NONCE, &lorawan_setup.dev_nonce, sizeof(lorawan_setup.dev_nonce));
+        if(ret == -EINPROGRESS)
+        {
+            LOG_INF("Joining LoRaWAN in the background");
+            ret = sensor_lorawan_wait_joined(join_timeout);
+            /* The join keeps running in the background after the wait. */
+            return (ret == 0 || ret == -EAGAIN) ? 0 : -1;
+        }
         if(ret < 0)
         {
             LOG_ERR("Failed to connect to LoRaWAN");
             return -1;
         }
-        }
-        else
-        {
+        /* Save the session so the next start restores it instead of joining. */
+        save_lorawan_session();
+    }
+    else
+    {
         LOG_INF("LoRaWAN is enabled but not configured");
     }
     return 0;
 }
 
-static int add_sensor_data_to_lorawan_payload(sensor_data_t *sensor_data)
+/**
+ * @brief Pack as many of the oldest samples of a sensor as fit in the rest of the payload.
+ * 
+ * @param sensor_data The sensor data to add to the payload.
+ * @param max_length The maximum length of the payload.
+ * @param num_samples The number of samples added, to clear once they are sent.
+ * @param leftover_samples The number of samples that did not fit, left for the next uplink.
+ * @return int 0 on success, -1 on failure
+ */
+static int add_sensor_data_to_lorawan_payload(sensor_data_t *sensor_data, uint16_t max_length, uint32_t *num_samples, uint32_t *leftover_samples)
 {
     int ret;
-    uint8_t sensor_data_buffer[(sensor_data->data_size * sensor_data->num_samples) + (sensor_data->timestamp_size * sensor_data->num_samples)];
-    uint8_t sensor_data_buffer_len;
-    ret = sensor_data_format_for_lorawan(sensor_data, sensor_data_buffer, &sensor_data_buffer_len);
+    uint16_t packed_length;
+    *num_samples = 0;
+    *leftover_samples = 0;
+    if(lorawan_data.length >= max_length)
+    {
+        *leftover_samples = sensor_data->num_samples;
+        return 0;
+    }
+    ret = sensor_data_pack_for_lorawan(sensor_data, &lorawan_data.data[lorawan_data.length], max_length - lorawan_data.length, &packed_length, num_samples);
     if(ret < 0)
     {
         LOG_ERR("Failed to format sensor data for LoRaWAN");
         return -1;
     }
-    uint8_t initial_data_length = lorawan_data.length;
-    for(int i = 0; i < sensor_data_buffer_len; i++)
+    lorawan_data.length += packed_length;
+    if(sensor_data->num_samples > *num_samples)
     {
-        lorawan_data.data[i + initial_data_length] = sensor_data_buffer[i];
+        *leftover_samples = sensor_data->num_samples - *num_samples;
     }
-    lorawan_data.length = sensor_data_buffer_len + initial_data_length;
-
     return 0;
 }
 
-static int add_sensor_configuration_to_lorawan_payload(void)
+/**
+ * @brief Add an interval in seconds to the payload as 4 bytes, most significant byte first like the timestamps.
+ * 
+ * @param data Where to add the interval in the payload.
+ * @param seconds The interval in seconds.
+ * @return int The number of bytes added.
+ */
+static int add_interval_to_lorawan_payload(uint8_t *data, uint32_t seconds)
 {
-    uint8_t i = lorawan_data.length;
+    data[0] = (seconds >> 24) & 0xFF;
+    data[1] = (seconds >> 16) & 0xFF;
+    data[2] = (seconds >> 8) & 0xFF;
+    data[3] = seconds & 0xFF;
+    return sizeof(seconds);
+}
+
+/**
+ * @brief Add the hardware and firmware versions to the payload.
+ * 
+ * @param data Where to add the versions in the payload.
+ * @return int The number of bytes added.
+ */
+static int add_versions_to_lorawan_payload(uint8_t *data)
+{
+    uint8_t i = 0;
     uint8_t hw_version_major;
     uint8_t hw_version_minor;
     uint8_t hw_version_patch; // Not added to payload yet
     sscanf(CONFIG_BOARD_REVISION, "%hhu.%hhu.%hhu", &hw_version_major, &hw_version_minor, &hw_version_patch);
     LOG_DBG("HW Version: %hhu.%hhu.%hhu", hw_version_major, hw_version_minor, hw_version_patch);
-    lorawan_data.data[i++] = hw_version_major;
-    lorawan_data.data[i++] = hw_version_minor;
-    lorawan_data.data[i++] = CONFIG_APP_VERSION_MAJOR;
-    lorawan_data.data[i++] = CONFIG_APP_VERSION_MINOR;
-    lorawan_data.data[i++] = CONFIG_APP_VERSION_PATCH;
-    lorawan_data.data[i++] = CONFIG_APP_VERSION_COMMIT;
-
-    // Get timestamp and check for error
-    int timestamp = sensor_scheduling_get_seconds();
+    data[i++] = hw_version_major;
+    data[i++] = hw_version_minor;
+    data[i++] = CONFIG_APP_VERSION_MAJOR;
+    data[i++] = CONFIG_APP_VERSION_MINOR;
+    data[i++] = CONFIG_APP_VERSION_PATCH;
+    data[i++] = CONFIG_APP_VERSION_COMMIT;
+    return i;
+}
+
+/**
+ * @brief Add the LoRaWAN configuration to the payload, the uplink interval is in seconds.
+ * 
+ * @param data Where to add the LoRaWAN configuration in the payload.
+ * @return int The number of bytes added.
+ */
+static int add_lorawan_configuration_to_lorawan_payload(uint8_t *data)
+{
+    uint8_t i = 0;
+    i += add_interval_to_lorawan_payload(&data[i], lorawan_setup.lorawan_frequency);
+    data[i++] = lorawan_setup.send_attempts;
+    return i;
+}
+
+/**
+ * @brief Add the battery voltage and PMIC temperature to the payload.
+ * 
+ * @param data Where to add the PMIC information in the payload.
+ * @return int The number of bytes added.
+ */
+static int add_pmic_status_to_lorawan_payload(uint8_t *data)
+{
+    uint8_t i = 0;
+    // Break voltage into 2 bytes (high byte first, then low byte)
+    int16_t voltage_hundreths = (int16_t)(pmic_status.voltage * 100.0f);
+    data[i++] = (voltage_hundreths >> 8) & 0xFF;  // High byte
+    data[i++] = voltage_hundreths & 0xFF;         // Low byte
+
+    // Break temperature into 2 bytes (high byte first, then low byte)
+    int16_t temperature_hundreths = (int16_t)(pmic_status.temp * 100.0f);
+    data[i++] = (temperature_hundreths >> 8) & 0xFF;  // High byte
+    data[i++] = temperature_hundreths & 0xFF;         // Low byte
+    return i;
+}
+
+/**
+ * @brief Add the enabled sensors and the voltage, type and interval of each to the payload.
+ * 
+ * @param data Where to add the sensor configuration in the payload.
+ * @return int The number of bytes added.
+ */
+static int add_sensors_to_lorawan_payload(uint8_t *data)
+{
+    uint8_t i = 0;
+    data[i++] = (sensor_app_config->is_sensor_1_enabled << 0) | (sensor_app_config->is_sensor_2_enabled << 1);
+    if(sensor_app_config->is_sensor_1_enabled)
+    {
+        LOG_DBG("Adding Sensor 1 configuration to LoRaWAN payload");
+        data[i++] = sensor_app_config->sensor_1_voltage;
+        data[i++] = sensor_app_config->sensor_1_type;
+        i += add_interval_to_lorawan_payload(&data[i], sensor_app_config->sensor_1_frequency);
+    }
+    if(sensor_app_config->is_sensor_2_enabled)
+    {
+        LOG_DBG("Adding Sensor 2 configuration to LoRaWAN payload");
+        data[i++] = sensor_app_config->sensor_2_voltage;
+        data[i++] = sensor_app_config->sensor_2_type;
+        i += add_interval_to_lorawan_payload(&data[i], sensor_app_config->sensor_2_frequency);
+    }
+    return i;
+}
+
+/**
+ * @brief Get the hash of the configuration in the full header, the versions, LoRaWAN configuration and sensors 
+ * in the order they are sent. The low byte is the configuration epoch sent in the compact header, so the network 
+ * can check it against the hash of the last full header it received.
+ * 
+ * @return uint32_t The FNV-1a hash of the configuration.
+ */
+static uint32_t get_configuration_hash(void)
+{
+    uint8_t config[SENSOR_APP_CONFIG_MAX_LENGTH];
+    uint8_t length = 0;
+    length += add_versions_to_lorawan_payload(&config[length]);
+    length += add_lorawan_configuration_to_lorawan_payload(&config[length]);
+    length += add_sensors_to_lorawan_payload(&config[length]);
+    uint32_t hash = 2166136261u;
+    for(int i = 0; i < length; i++)
+    {
+        hash ^= config[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Add the full header to the payload, the versions, timestamp, LoRaWAN configuration, PMIC information 
+ * and sensor configuration.
+ * 
+ * @return int 0 on success
+ */
+static int add_sensor_configuration_to_lorawan_payload(void)
+{
+    uint8_t i = lorawan_data.length;
+    i += add_versions_to_lorawan_payload(&lorawan_data.data[i]);
+
+    // Timestamp in UTC seconds once the network time is synchronized, seconds since boot before that
+    uint32_t timestamp = sensor_app_get_current_timestamp_seconds();
     lorawan_data.data[i++] = (timestamp >> 24) & 0xFF;  // Most significant byte
     lorawan_data.data[i++] = (timestamp >> 16) & 0xFF;
     lorawan_data.data[i++] = (timestamp >> 8) & 0xFF;
     lorawan_data.data[i++] = timestamp & 0xFF;  
 
     // LoRaWAN configuration
-    lorawan_data.data[i++] = lorawan_setup.lorawan_frequency;
-    lorawan_data.data[i++] = lorawan_setup.send_attempts;
+    i += add_lorawan_configuration_to_lorawan_payload(&lorawan_data.data[i]);
     // PMIC Information
-    sensor_pmic_status_get(&pmic_status);
-    // Break voltage into 2 bytes (high byte first, then low byte)
-    int16_t voltage_hundreths = (int16_t)(pmic_status.voltage * 100.0f);
-    lorawan_data.data[i++] = (voltage_hundreths >> 8) & 0xFF;  // High byte
-    lorawan_data.data[i++] = voltage_hundreths & 0xFF;         // Low byte
+    i += add_pmic_status_to_lorawan_payload(&lorawan_data.data[i]);
+    // Sensor configuration
+    i += add_sensors_to_lorawan_payload(&lorawan_data.data[i]);
+    lorawan_data.length = i;
+    LOG_DBG("Added %d bytes to payload for Sensor Configuration", i);
+    return 0;
+}
 
-    // Break temperature into 2 bytes (high byte first, then low byte)
-    int16_t temperature_hundreths = (int16_t)(pmic_status.temp * 100.0f);
-    lorawan_data.data[i++] = (temperature_hundreths >> 8) & 0xFF;  // High byte
-    lorawan_data.data[i++] = temperature_hundreths & 0xFF;         // Low byte
+/**
+ * @brief Add the compact header to the payload, the configuration epoch and the PMIC information. It replaces 
+ * the full header once the network has the configuration.
+ * 
+ * @param epoch The configuration epoch, the low byte of the configuration hash.
+ * @return int 0 on success
+ */
+static int add_compact_header_to_lorawan_payload(uint8_t epoch)
+{
+    uint8_t i = lorawan_data.length;
+    lorawan_data.data[i++] = epoch;
+    i += add_pmic_status_to_lorawan_payload(&lorawan_data.data[i]);
+    lorawan_data.length = i;
+    LOG_DBG("Added %d bytes to payload for the compact header", i);
+    return 0;
+}
 
-    // Sensor configuration
-    lorawan_data.data[i++] = (sensor_app_config->is_sensor_1_enabled << 0) | (sensor_app_config->is_sensor_2_enabled << 1);
+static void uplink_complete(enum sensor_radio_result result, void *user_data);
+static void fragment_complete(enum sensor_radio_result result, void *user_data);
+
+/**
+ * @brief Build the uplink from the full or compact header and the oldest samples, and queue it for the radio. 
+ * The samples are cleared once the radio reports the uplink was sent.
+ * 
+ * @return int 0 on success, -1 on failure
+ */
+static int format_and_queue_lorawan_payload(void)
+{
+    int ret;
+    uint32_t sensor1_sent_samples = 0;
+    uint32_t sensor2_sent_samples = 0;
+    uint32_t sensor1_leftover_samples = 0;
+    uint32_t sensor2_leftover_samples = 0;
+    /* Pack up to the maximum payload of the data rate, larger payloads are rejected by the MAC. */
+    uint16_t max_length = sizeof(lorawan_data.data);
+    if(sensor_lorawan_get_max_payload(&max_length) < 0 || max_length > sizeof(lorawan_data.data))
+    {
+        max_length = sizeof(lorawan_data.data);
+    }
+    /* The acknowledgement of the last downlink goes in front of the sensor configuration. */
+    k_mutex_lock(&downlink_lock, K_FOREVER);
+    is_in_flight_ack = is_ack_pending;
+    if(is_in_flight_ack)
+    {
+        memcpy(in_flight_ack, pending_ack, sizeof(in_flight_ack));
+        memcpy(lorawan_data.data, pending_ack, sizeof(pending_ack));
+        lorawan_data.length = sizeof(pending_ack);
+    }
+    k_mutex_unlock(&downlink_lock);
+    /* The full header goes out after boot, after a configuration change, with an acknowledgement and every 
+     * so many uplinks, the other uplinks only carry the configuration epoch and the PMIC information. */
+    in_flight_config_hash = get_configuration_hash();
+    is_in_flight_full_header = is_in_flight_ack || !is_full_header_sent || in_flight_config_hash != sent_config_hash
+        || uplinks_since_full_header >= SENSOR_APP_FULL_HEADER_INTERVAL;
+    /* Only hold the sensor data while building the payload so readings continue during the send. */
+    k_mutex_lock(&sensor_data_lock, K_FOREVER);
+    if(is_in_flight_full_header)
+    {
+        add_sensor_configuration_to_lorawan_payload();
+    }
+    else
+    {
+        add_compact_header_to_lorawan_payload(in_flight_config_hash & 0xFF);
+    }
+    if(lorawan_data.length > max_length)
+    {
+        k_mutex_unlock(&sensor_data_lock);
+        LOG_ERR("Sensor configuration of %d bytes does not fit the maximum payload of %d bytes", lorawan_data.length, max_length);
+        memset(&lorawan_data, 0, sizeof(lorawan_data));
+        return -1;
+    }
+    /* Add the sensor data to the LoRaWAN payload. */
+    if(sensor_app_config->is_sensor_1_enabled)
+    {
+        add_sensor_data_to_lorawan_payload(&sensor1_data, max_length, &sensor1_sent_samples, &sensor1_leftover_samples);
+    }
+    if(sensor_app_config->is_sensor_2_enabled)
+    {
+        add_sensor_data_to_lorawan_payload(&sensor2_data, max_length, &sensor2_sent_samples, &sensor2_leftover_samples);
+    }
+    k_mutex_unlock(&sensor_data_lock);
+    if(sensor1_leftover_samples > 0 || sensor2_leftover_samples > 0)
+    {
+        LOG_WRN("Payload full at %d bytes, %d sensor 1 and %d sensor 2 samples left for fragments", 
+            lorawan_data.length, sensor1_leftover_samples, sensor2_leftover_samples);
+    }
+    LOG_INF("Queueing LoRaWAN payload with length %d", lorawan_data.length);
+    if(is_in_flight_ack)
+    {
+        lorawan_data.port = SENSOR_DOWNLINK_ACK_PORT;
+    }
+    else
+    {
+        lorawan_data.port = is_in_flight_full_header ? SENSOR_APP_FULL_HEADER_PORT : SENSOR_APP_COMPACT_PORT;
+    }
+    /* An acknowledgement is sent confirmed, a lost one would leave the network resending its downlink. */
+    lorawan_data.is_critical = is_in_flight_ack;
+    lorawan_data.attempts = lorawan_setup.send_attempts;
+    lorawan_data.delay = lorawan_setup.delay;
+    sensor_radio_uplink_t uplink = {
+        .data = lorawan_data,
+        .priority = SENSOR_RADIO_PRIORITY_HIGH,
+        .callback = uplink_complete,
+    };
+    memset(&lorawan_data, 0, sizeof(lorawan_data));
+    in_flight_sensor1_samples = sensor1_sent_samples;
+    in_flight_sensor2_samples = sensor2_sent_samples;
+    ret = sensor_radio_enqueue(&uplink);
+    if(ret < 0)
+    {
+        LOG_ERR("Failed to queue LoRaWAN payload");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Get the number of samples waiting to be sent for the enabled sensors, the sensor data lock must be held.
+ * 
+ * @return uint32_t The number of samples waiting to be sent.
+ */
+static uint32_t get_backlog_samples(void)
+{
+    uint32_t backlog_samples = 0;
+    if(sensor_app_config->is_sensor_1_enabled)
+    {
+        backlog_samples += sensor1_data.num_samples;
+    }
+    if(sensor_app_config->is_sensor_2_enabled)
+    {
+        backlog_samples += sensor2_data.num_samples;
+    }
+    return backlog_samples;
+}
+
+/**
+ * @brief Queue the oldest samples of the backlog as a fragment, one sensor per fragment. 
+ * 
+ * @return int 0 on success, 1 if there is no backlog, -1 on failure
+ */
+static int format_and_queue_fragment(void)
+{
+    int ret;
+    sensor_data_t *sensor_data = NULL;
+    uint16_t packed_length;
+    uint32_t num_samples;
+    uint32_t first_timestamp = 0;
+    uint16_t max_length = sizeof(lorawan_data.data);
+    if(sensor_lorawan_get_max_payload(&max_length) < 0 || max_length > sizeof(lorawan_data.data))
+    {
+        max_length = sizeof(lorawan_data.data);
+    }
+    k_mutex_lock(&sensor_data_lock, K_FOREVER);
+    if(sensor_app_config->is_sensor_1_enabled && sensor1_data.num_samples > 0)
+    {
+        sensor_data = &sensor1_data;
+    }
+    else if(sensor_app_config->is_sensor_2_enabled && sensor2_data.num_samples > 0)
+    {
+        sensor_data = &sensor2_data;
+    }
+    if(sensor_data == NULL)
+    {
+        k_mutex_unlock(&sensor_data_lock);
+        return 1;
+    }
+    ret = sensor_data_pack_for_lorawan(sensor_data, &lorawan_data.data[SENSOR_FRAGMENT_HEADER_LENGTH], 
+        max_length - SENSOR_FRAGMENT_HEADER_LENGTH, &packed_length, &num_samples);
+    if(ret < 0 || num_samples == 0)
+    {
+        k_mutex_unlock(&sensor_data_lock);
+        LOG_ERR("Failed to pack fragment for sensor %d", sensor_data->id + 1);
+        return -1;
+    }
+    memcpy(&first_timestamp, &lorawan_data.data[SENSOR_FRAGMENT_HEADER_LENGTH], MIN(sensor_data->timestamp_size, sizeof(first_timestamp)));
+    sensor_fragment_header_t header = {
+        .sequence = fragment_sequence,
+        .channel = sensor_data->id + 1,
+        .is_last = (get_backlog_samples() == num_samples),
+        .first_timestamp = first_timestamp,
+    };
+    k_mutex_unlock(&sensor_data_lock);
+    sensor_fragment_write_header(&header, lorawan_data.data);
+    lorawan_data.length = SENSOR_FRAGMENT_HEADER_LENGTH + packed_length;
+    LOG_INF("Queueing fragment %d with %d samples of sensor %d", header.sequence, num_samples, header.channel);
+    lorawan_data.port = SENSOR_FRAGMENT_PORT;
+    lorawan_data.attempts = lorawan_setup.send_attempts;
+    lorawan_data.delay = lorawan_setup.delay;
+    sensor_radio_uplink_t uplink = {
+        .data = lorawan_data,
+        .priority = SENSOR_RADIO_PRIORITY_LOW,
+        .callback = fragment_complete,
+    };
+    memset(&lorawan_data, 0, sizeof(lorawan_data));
+    in_flight_fragment_data = sensor_data;
+    in_flight_fragment_samples = num_samples;
+    ret = sensor_radio_enqueue(&uplink);
+    if(ret < 0)
+    {
+        LOG_ERR("Failed to queue fragment %d", header.sequence);
+        return -1;
+    }
+    fragment_sequence++;
+    return 0;
+}
+
+/**
+ * @brief Schedule the next fragment if there is a backlog, paced by the time on air of the last uplink.
+ * 
+ */
+static void schedule_fragment(void)
+{
+    uint32_t time_on_air_us = 0;
+    /* An uplink can complete after the running state is left */
+    if(sensor_app_config->state != SENSOR_APP_STATE_RUNNING)
+    {
+        return;
+    }
+    k_mutex_lock(&sensor_data_lock, K_FOREVER);
+    uint32_t backlog_samples = get_backlog_samples();
+    k_mutex_unlock(&sensor_data_lock);
+    if(backlog_samples == 0)
+    {
+        return;
+    }
+    if(fragments_sent >= SENSOR_APP_MAX_FRAGMENTS_PER_UPLINK)
+    {
+        LOG_WRN("%d samples left for the next uplink", backlog_samples);
+        return;
+    }
+    /* Fragments are extra uplinks, once the airtime budget is low the backlog goes with the next uplink instead. */
+    if(sensor_lorawan_get_budget_level() >= SENSOR_BUDGET_LEVEL_MERGE)
+    {
+        LOG_WRN("Airtime budget low, %d samples left for the next uplink", backlog_samples);
+        return;
+    }
+    sensor_lorawan_get_last_time_on_air_us(&time_on_air_us);
+    k_work_schedule_for_queue(&radio_work_q, &fragment_work, K_MSEC(sensor_fragment_get_interval_ms(time_on_air_us)));
+}
+
+/**
+ * @brief Check that the app passes all the requirements to be in the running state.
+ * 
+ * @return int 0 on success, -1 on failure
+ */
+static int running_state_initialization_check(void)
+{
+    if(sensor_app_config->state != SENSOR_APP_STATE_RUNNING)
+    {
+        LOG_ERR("App is not in the running state");
+        return -1;
+    }
+    /* Check that either sensor 1 or sensor 2 is enabled. */
+    if(!sensor_app_config->is_sensor_1_enabled && !sensor_app_config->is_sensor_2_enabled)
+    {
+        LOG_ERR("Neither sensor 1 or sensor 2 is enabled");
+        return -1;
+    }
+    /* Make sure that if sensor 1 is enabled, it is initialized to a valid sensor type and has a non-zero frequency. */
+    if(sensor_app_config->is_sensor_1_enabled && sensor_app_config->sensor_1_type == NULL_SENSOR)
+    {
+        LOG_ERR("Sensor 1 is enabled but not initialized to any sensor types");
+        sensor_app_config->is_sensor_1_enabled = 0;
+        return -1;
+    }
+    if(sensor_app_config->is_sensor_1_enabled && sensor_app_config->sensor_1_frequency == 0)
+    {
+        LOG_ERR("Sensor 1 is enabled but has 0 frequency");
+        sensor_app_config->is_sensor_1_enabled = 0;
+        return -1;
+    }
+    /* Make sure that if sensor 2 is enabled, it is initialized to a valid sensor type and has a non-zero frequency. */
+    if(sensor_app_config->is_sensor_2_enabled && sensor_app_config->sensor_2_frequency == 0)
+    {
+        LOG_ERR("Sensor 2 is enabled but has 0 frequency");
+        sensor_app_config->is_sensor_2_enabled = 0;
+        return -1;
+    }
+    if(sensor_app_config->is_sensor_2_enabled && sensor_app_config->sensor_2_type == NULL_SENSOR)
+    {
+        LOG_ERR("Sensor 2 is enabled but not initialized to any sensor types");
+        sensor_app_config->is_sensor_2_enabled = 0;
+        return -1;
+    }
+    /* Make sure that if lorawan is enabled, it has a valid frequency. */
+    if(lorawan_setup.is_lorawan_enabled && lorawan_setup.lorawan_frequency == 0)
+    {
+        LOG_ERR("LoRaWAN is enabled but has 0 frequency");
+        lorawan_setup.is_lorawan_enabled = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Initialize the sensor schedules.
+ * 
+ * @return int 0 on success, -1 on failure
+ */
+static int initialize_sensor_schedule(void)
+{
+    int ret;
+    if(sensor_app_config->is_sensor_1_enabled && sensor_app_config->sensor_1_frequency > 0)
+    {
+        sensor1_schedule.frequency_seconds = sensor_app_config->sensor_1_frequency;
+        ret = sensor_scheduling_add_anchored_schedule(&sensor1_schedule, get_schedule_anchor_ms(&sensor1_schedule));
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to add sensor 1 schedule");
+        }
+        else
+        {
+            sensor1_schedule.one_time_trigger = 1;
+            LOG_INF("Sensor 1 schedule added at a frequency of %d seconds", sensor1_schedule.frequency_seconds);
+        }
+    }
+    if(sensor_app_config->is_sensor_2_enabled && sensor_app_config->sensor_2_frequency > 0)
+    {
+        sensor2_schedule.frequency_seconds = sensor_app_config->sensor_2_frequency;
+        ret = sensor_scheduling_add_anchored_schedule(&sensor2_schedule, get_schedule_anchor_ms(&sensor2_schedule));
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to add sensor 2 schedule");
+        }
+        else
+        {
+            sensor2_schedule.one_time_trigger = 1;
+            LOG_INF("Sensor 2 schedule added at a frequency of %d seconds", sensor2_schedule.frequency_seconds);
+        }
+    }
+    if(lorawan_setup.is_lorawan_enabled && lorawan_setup.lorawan_frequency > 0)
+    {
+        radio_schedule.frequency_seconds = lorawan_setup.lorawan_frequency;
+        /* The first uplink waits for the phase of the schedule instead of a one time trigger, 
+        so a fleet restarted by a power restore does not transmit in lockstep. */
+        ret = add_radio_schedule();
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to add radio schedule");
+        }
+        else
+        {
+            LOG_INF("Radio schedule added at a frequency of %d seconds", radio_schedule.frequency_seconds);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Initialize the sensor data to read from the correct sensor configuration.
+ * 
+ * @return int 0 on success, -1 on failure
+ */
+static int initialize_sensor_data(void)
+{
+    int ret;
+    if(sensor_app_config->is_sensor_1_enabled && sensor_app_config->sensor_1_type != NULL_SENSOR)
+    {
+        ret = sensor_data_setup(&sensor1_data, sensor_app_config->sensor_1_type, sensor_app_config->sensor_1_voltage);
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to initialize sensor 1 data");
+            return ret;
+        }
+    }
+    if(sensor_app_config->is_sensor_2_enabled && sensor_app_config->sensor_2_type != NULL_SENSOR)
+    {
+        ret = sensor_data_setup(&sensor2_data, sensor_app_config->sensor_2_type, sensor_app_config->sensor_2_voltage);
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to initialize sensor 2 data");
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static int disable_sensor(void)
+{
+    int ret;
     if(sensor_app_config->is_sensor_1_enabled)
     {
-        LOG_DBG("Adding Sensor 1 configuration to LoRaWAN payload");
-        lorawan_data.data[i++] = sensor_app_config->sensor_1_voltage;
-        lorawan_data.data[i++] = sensor_app_config->sensor_1_type;
-        lorawan_data.data[i++] = sensor_app_config->sensor_1_frequency;
+        ret = sensor_data_setup(&sensor1_data, NULL_SENSOR, SENSOR_VOLTAGE_OFF);
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to disable sensor 1");
+            return ret;
+        }
+        ret = sensor_scheduling_remove_schedule(&sensor1_schedule);
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to remove sensor 1 schedule");
+            return ret;
+        }
+    }
+    if(sensor_app_config->is_sensor_2_enabled)
+    {
+        ret = sensor_data_setup(&sensor2_data, NULL_SENSOR, SENSOR_VOLTAGE_OFF);
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to disable sensor 2");
+            return ret;
+        }
+        ret = sensor_scheduling_remove_schedule(&sensor2_schedule);
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to remove sensor 2 schedule");
+            return ret;
+        }
+    }
+    LOG_INF("Sensors disabled");
+    if(lorawan_setup.is_lorawan_enabled)
+    {
+        ret = sensor_scheduling_remove_schedule(&radio_schedule);
+        if(ret < 0)
+        {
+            LOG_ERR("Failed to remove radio schedule");
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Learn the warm-up of a sensor when it is first commissioned with its current type and voltage, 
+ * or when it is due to be learned again, and save the profile to NVS.
+ * 
+ * @param sensor_data The sensor data to learn the warm-up for.
+ * @param address The NVS address the warm-up profile is stored at.
+ */
+static void update_sensor_warmup(sensor_data_t *sensor_data, enum sensor_nvs_address address)
+{
+    if(!sensor_data_warmup_needs_learning(sensor_data))
+    {
+        return;
+    }
+    /* A sensor that does not stabilise is left unlearned, that is saved too so a stale profile is not restored. */
+    if(sensor_data_learn_warmup(sensor_data) < 0)
+    {
+        LOG_WRN("Failed to learn warm-up for sensor %d, using the default", sensor_data->id);
+    }
+    if(sensor_nvs_write(address, &sensor_data->warmup, sizeof(sensor_data->warmup)) < 0)
+    {
+        LOG_ERR("Failed to save warm-up for sensor %d", sensor_data->id);
+    }
+}
+
+/**
+ * @brief Learn the warm-up of the enabled sensors that need it. This powers each sensor for up to SENSOR_WARMUP_MAX_MS 
+ * so it runs when the sensors are commissioned, before their schedules start reading them.
+ * 
+ */
+static void learn_sensor_warmups(void)
+{
+    if(sensor_app_config->is_sensor_1_enabled)
+    {
+        update_sensor_warmup(&sensor1_data, SENSOR_NVS_ADDRESS_SENSOR_1_WARMUP);
+    }
+    if(sensor_app_config->is_sensor_2_enabled)
+    {
+        update_sensor_warmup(&sensor2_data, SENSOR_NVS_ADDRESS_SENSOR_2_WARMUP);
+    }
+}
+
+int sensor_app_get_schedule_stats(enum sensor_scheduling_id id, sensor_scheduling_stats_t *stats)
+{
+    switch(id)
+    {
+        case SENSOR_SCHEDULING_ID_SENSOR1:
+            return sensor_scheduling_get_stats(&sensor1_schedule, stats);
+        case SENSOR_SCHEDULING_ID_SENSOR2:
+            return sensor_scheduling_get_stats(&sensor2_schedule, stats);
+        case SENSOR_SCHEDULING_ID_RADIO:
+            return sensor_scheduling_get_stats(&radio_schedule, stats);
+        default:
+            LOG_ERR("No schedule with id %d", id);
+            return -EINVAL;
+    }
+}
+
+#if defined(CONFIG_STATS)
+/**
+ * @brief Register the lateness statistics of the schedules with the statistics subsystem, only registered once.
+ * 
+ */
+static void register_schedule_stats(void)
+{
+    static bool is_registered;
+    if(is_registered)
+    {
+        return;
+    }
+    is_registered = true;
+    for(int id = 0; id < SENSOR_SCHEDULING_ID_LIMIT; id++)
+    {
+        stats_init_and_reg(STATS_HDR(schedule_lateness_stats[id]), STATS_SIZE_32, 4, STATS_NAME_INIT_PARMS(schedule_stats), 
+            schedule_stats_names[id]);
+    }
+}
+
+/**
+ * @brief Publish the lateness statistics of a schedule.
+ * 
+ * @param id The id of the schedule.
+ * @param stats The statistics of the schedule.
+ */
+static void set_schedule_stats(enum sensor_scheduling_id id, const sensor_scheduling_stats_t *stats)
+{
+    STATS_SET(schedule_lateness_stats[id], max_lateness_ms, stats->max_lateness_ms);
+    STATS_SET(schedule_lateness_stats[id], mean_lateness_ms, stats->mean_lateness_ms);
+    STATS_SET(schedule_lateness_stats[id], missed_periods, stats->missed_periods);
+    STATS_SET(schedule_lateness_stats[id], event_count, stats->event_count);
+}
+#endif
+
+/**
+ * @brief Reset a schedule after handling its event and publish its lateness statistics.
+ * 
+ * @param schedule The schedule to reset.
+ */
+static void reset_schedule(sensor_scheduling_cfg_t *schedule)
+{
+    sensor_scheduling_reset_schedule(schedule);
+#if defined(CONFIG_STATS)
+    sensor_scheduling_stats_t stats;
+    if(schedule->id < SENSOR_SCHEDULING_ID_LIMIT && sensor_scheduling_get_stats(schedule, &stats) == 0)
+    {
+        set_schedule_stats(schedule->id, &stats);
+    }
+#endif
+}
+
+/**
+ * @brief Read a sensor for its triggered schedule and pass the reading on to the app configuration.
+ * 
+ * @param schedule The schedule of the sensor.
+ * @param sensor_data The sensor data to read into.
+ * @param latest_data The latest data of the sensor in the app configuration.
+ * @param latest_data_timestamp The timestamp of the latest data in the app configuration.
+ */
+static void read_scheduled_sensor(sensor_scheduling_cfg_t *schedule, sensor_data_t *sensor_data, 
+    uint8_t **latest_data, uint32_t *latest_data_timestamp)
+{
+    sensor_pmic_led_on();
+    schedule->one_time_trigger = 0;
+    LOG_INF("Sensor %d schedule triggered", sensor_data->id + 1);
+    k_mutex_lock(&sensor_data_lock, K_FOREVER);
+    sensor_data_read(sensor_data, get_timestamp_seconds((uint64_t)sensor_scheduling_get_event_seconds(schedule) * 1000));
+    sensor_data_print_data(sensor_data);
+    *latest_data = sensor_data->latest_data;
+    *latest_data_timestamp = (uint32_t)sensor_data->latest_timestamp;
+    k_mutex_unlock(&sensor_data_lock);
+    reset_schedule(schedule);
+    sensor_pmic_led_off();
+}
+
+static void sensor1_work_handler(struct k_work *work)
+{
+    if(!sensor_app_config->is_sensor_1_enabled)
+    {
+        return;
+    }
+    read_scheduled_sensor(&sensor1_schedule, &sensor1_data, &sensor_app_config->sensor_1_latest_data, 
+        &sensor_app_config->sensor_1_latest_data_timestamp);
+}
+
+static void sensor2_work_handler(struct k_work *work)
+{
+    if(!sensor_app_config->is_sensor_2_enabled)
+    {
+        return;
+    }
+    read_scheduled_sensor(&sensor2_schedule, &sensor2_data, &sensor_app_config->sensor_2_latest_data, 
+        &sensor_app_config->sensor_2_latest_data_timestamp);
+}
+
+/**
+ * @brief Called from the LoRaWAN stack for every downlink on the downlink port, handled on the radio work queue.
+ * 
+ */
+static void downlink_received(uint8_t port, uint8_t flags, int16_t rssi, int8_t snr, uint8_t len, const uint8_t *data)
+{
+    downlink_message_t message = {0};
+    if(len == 0)
+    {
+        return;
+    }
+    if(len > sizeof(message.data))
+    {
+        LOG_ERR("Downlink of %d bytes is longer than %d bytes", len, SENSOR_DOWNLINK_MAX_LENGTH);
+        return;
+    }
+    message.length = len;
+    memcpy(message.data, data, len);
+    if(k_msgq_put(&downlink_queue, &message, K_NO_WAIT) < 0)
+    {
+        LOG_ERR("Downlink queue full, dropping downlink");
+        return;
+    }
+    k_work_submit_to_queue(&radio_work_q, &downlink_work);
+}
+
+/**
+ * @brief Set the acknowledgement sent in front of the next uplink, replacing one that was not sent yet.
+ * 
+ * @param sequence The sequence number of the downlink.
+ * @param status The status of the downlink.
+ */
+static void set_downlink_ack(uint8_t sequence, enum sensor_downlink_status status)
+{
+    k_mutex_lock(&downlink_lock, K_FOREVER);
+    sensor_downlink_write_ack(sequence, status, pending_ack);
+    is_ack_pending = 1;
+    k_mutex_unlock(&downlink_lock);
+}
+
+/**
+ * @brief Clear the acknowledgement once the uplink carrying it is sent, unless a newer one replaced it, then reboot 
+ * if a downlink asked for it and nothing is left to acknowledge.
+ * 
+ */
+static void downlink_ack_sent(void)
+{
+    k_mutex_lock(&downlink_lock, K_FOREVER);
+    if(is_ack_pending && memcmp(pending_ack, in_flight_ack, sizeof(pending_ack)) == 0)
+    {
+        is_ack_pending = 0;
+    }
+    uint8_t is_reboot_allowed = !is_ack_pending && !atomic_get(&is_downlink_staged);
+    k_mutex_unlock(&downlink_lock);
+    if(is_reboot_allowed && atomic_cas(&is_reboot_requested, 1, 0))
+    {
+        LOG_INF("Rebooting as requested by downlink");
+        sys_reboot(SYS_REBOOT_COLD);
+    }
+}
+
+/**
+ * @brief Settings of a sensor in the app configuration with their NVS addresses.
+ */
+typedef struct {
+    /* Whether the sensor is enabled */
+    uint8_t *is_enabled;
+    /* Type of the sensor and its name */
+    enum sensor_types *type;
+    char *type_name;
+    /* Power voltage of the sensor and its name */
+    enum sensor_voltage *voltage;
+    char *voltage_name;
+    /* Interval between readings in seconds */
+    uint32_t *frequency;
+    /* NVS addresses of the settings */
+    enum sensor_nvs_address enabled_address;
+    enum sensor_nvs_address type_address;
+    enum sensor_nvs_address power_address;
+    enum sensor_nvs_address frequency_address;
+} sensor_settings_t;
+
+/**
+ * @brief Apply the settings of a sensor set by a downlink and write the changed ones to NVS.
+ * 
+ * @param sensor The settings set by the downlink.
+ * @param settings The settings in the app configuration.
+ */
+static void apply_downlink_sensor_settings(const sensor_downlink_sensor_t *sensor, const sensor_settings_t *settings)
+{
+    if(sensor->set_fields & SENSOR_DOWNLINK_SET_ENABLED)
+    {
+        *settings->is_enabled = sensor->is_enabled;
+        sensor_nvs_write(settings->enabled_address, settings->is_enabled, sizeof(*settings->is_enabled));
+    }
+    if(sensor->set_fields & SENSOR_DOWNLINK_SET_TYPE)
+    {
+        *settings->type = sensor->type;
+        get_sensor_type_name_from_index(settings->type_name, *settings->type);
+        sensor_nvs_write(settings->type_address, settings->type, sizeof(*settings->type));
     }
-    if(sensor_app_config->is_sensor_2_enabled)
+    if(sensor->set_fields & SENSOR_DOWNLINK_SET_VOLTAGE)
     {
-        LOG_DBG("Adding Sensor 2 configuration to LoRaWAN payload");
-        lorawan_data.data[i++] = sensor_app_config->sensor_2_voltage;
-        lorawan_data.data[i++] = sensor_app_config->sensor_2_type;
-        lorawan_data.data[i++] = sensor_app_config->sensor_2_frequency;
+        *settings->voltage = sensor->voltage;
+        get_sensor_voltage_name_from_index(settings->voltage_name, *settings->voltage);
+        sensor_nvs_write(settings->power_address, settings->voltage, sizeof(*settings->voltage));
+    }
+    if(sensor->set_fields & SENSOR_DOWNLINK_SET_INTERVAL)
+    {
+        *settings->frequency = sensor->interval;
+        sensor_nvs_write(settings->frequency_address, settings->frequency, sizeof(*settings->frequency));
+    }
+}
+
+/**
+ * @brief Check that a sensor is still usable with the settings of a downlink, an enabled sensor needs a type.
+ * 
+ * @param sensor The settings set by the downlink.
+ * @param is_enabled Whether the sensor is enabled now.
+ * @param type The type of the sensor now.
+ * @param is_enabled_after Whether the sensor is enabled with the downlink applied.
+ * @return int 0 if usable, -1 if not
+ */
+static int check_downlink_sensor_settings(const sensor_downlink_sensor_t *sensor, uint8_t is_enabled, enum sensor_types type, 
+    uint8_t *is_enabled_after)
+{
+    *is_enabled_after = (sensor->set_fields & SENSOR_DOWNLINK_SET_ENABLED) ? sensor->is_enabled : is_enabled;
+    enum sensor_types type_after = (sensor->set_fields & SENSOR_DOWNLINK_SET_TYPE) ? sensor->type : type;
+    if(*is_enabled_after && type_after == NULL_SENSOR)
+    {
+        return -1;
     }
-    lorawan_data.length = i;
-    LOG_DBG("Added %d bytes to payload for Sensor Configuration", i);
     return 0;
 }
 
-static int format_and_send_lorawan_payload(void)
+/**
+ * @brief Pack the configuration of a downlink into the record committed to NVS.
+ * 
+ * @param commands The commands of the downlink.
+ * @param record The record to fill.
+ */
+static void pack_downlink_config(const sensor_downlink_commands_t *commands, downlink_config_record_t *record)
 {
-    int ret;
-    add_sensor_configuration_to_lorawan_payload();
-    /* Add the sensor data to the LoRaWAN payload. */
-    if(sensor_app_config->is_sensor_1_enabled)
+    memset(record, 0, sizeof(*record));
+    record->sequence = commands->sequence;
+    for(int i = 0; i < SENSOR_DOWNLINK_MAX_SENSORS; i++)
     {
-        add_sensor_data_to_lorawan_payload(&sensor1_data);
+        record->sensors[i].set_fields = commands->sensors[i].set_fields;
+        record->sensors[i].is_enabled = commands->sensors[i].is_enabled;
+        record->sensors[i].type = commands->sensors[i].type;
+        record->sensors[i].voltage = commands->sensors[i].voltage;
+        record->sensors[i].interval = commands->sensors[i].interval;
     }
-    if(sensor_app_config->is_sensor_2_enabled)
+    record->is_lorawan_interval_set = commands->is_lorawan_interval_set;
+    record->lorawan_interval = commands->lorawan_interval;
+    record->is_send_attempts_set = commands->is_send_attempts_set;
+    record->send_attempts = commands->send_attempts;
+}
+
+/**
+ * @brief Unpack the configuration of a downlink from the record committed to NVS.
+ * 
+ * @param record The record read from NVS.
+ * @param commands The commands of the downlink, only the configuration is set.
+ */
+static void unpack_downlink_config(const downlink_config_record_t *record, sensor_downlink_commands_t *commands)
+{
+    memset(commands, 0, sizeof(*commands));
+    commands->sequence = record->sequence;
+    for(int i = 0; i < SENSOR_DOWNLINK_MAX_SENSORS; i++)
     {
-        add_sensor_data_to_lorawan_payload(&sensor2_data);
+        commands->sensors[i].set_fields = record->sensors[i].set_fields;
+        commands->sensors[i].is_enabled = record->sensors[i].is_enabled;
+        commands->sensors[i].type = record->sensors[i].type;
+        commands->sensors[i].voltage = record->sensors[i].voltage;
+        commands->sensors[i].interval = record->sensors[i].interval;
     }
-    LOG_INF("Sending LoRaWAN payload with length %d", lorawan_data.length);
-    lorawan_data.port = 2;
-    lorawan_data.attempts = lorawan_setup.send_attempts;
-    lorawan_data.delay = lorawan_setup.delay;
-    ret = sensor_lorawan_send_data(&lorawan_data);
-    memset(&lorawan_data, 0, sizeof(lorawan_data));
-    if(ret < 0)
+    commands->is_lorawan_interval_set = record->is_lorawan_interval_set;
+    commands->lorawan_interval = record->lorawan_interval;
+    commands->is_send_attempts_set = record->is_send_attempts_set;
+    commands->send_attempts = record->send_attempts;
+}
+
+/**
+ * @brief Apply the configuration of a downlink committed to NVS to the app configuration, and write each changed 
+ * setting to its own NVS address. Applying it again sets the same values.
+ * 
+ * @param commands The commands of the downlink.
+ */
+static void apply_downlink_config(const sensor_downlink_commands_t *commands)
+{
+    sensor_settings_t sensor1_settings = {
+        .is_enabled = &sensor_app_config->is_sensor_1_enabled,
+        .type = &sensor_app_config->sensor_1_type,
+        .type_name = sensor_app_config->sensor_1_type_name,
+        .voltage = &sensor_app_config->sensor_1_voltage,
+        .voltage_name = sensor_app_config->sensor_1_voltage_name,
+        .frequency = &sensor_app_config->sensor_1_frequency,
+        .enabled_address = SENSOR_NVS_ADDRESS_SENSOR_1_ENABLED,
+        .type_address = SENSOR_NVS_ADDRESS_SENSOR_1_TYPE,
+        .power_address = SENSOR_NVS_ADDRESS_SENSOR_1_POWER,
+        .frequency_address = SENSOR_NVS_ADDRESS_SENSOR_1_FREQUENCY,
+    };
+    sensor_settings_t sensor2_settings = {
+        .is_enabled = &sensor_app_config->is_sensor_2_enabled,
+        .type = &sensor_app_config->sensor_2_type,
+        .type_name = sensor_app_config->sensor_2_type_name,
+        .voltage = &sensor_app_config->sensor_2_voltage,
+        .voltage_name = sensor_app_config->sensor_2_voltage_name,
+        .frequency = &sensor_app_config->sensor_2_frequency,
+        .enabled_address = SENSOR_NVS_ADDRESS_SENSOR_2_ENABLED,
+        .type_address = SENSOR_NVS_ADDRESS_SENSOR_2_TYPE,
+        .power_address = SENSOR_NVS_ADDRESS_SENSOR_2_POWER,
+        .frequency_address = SENSOR_NVS_ADDRESS_SENSOR_2_FREQUENCY,
+    };
+    apply_downlink_sensor_settings(&commands->sensors[0], &sensor1_settings);
+    apply_downlink_sensor_settings(&commands->sensors[1], &sensor2_settings);
+    if(commands->is_lorawan_interval_set)
     {
-        LOG_ERR("Failed to send LoRaWAN payload");
-        return -1;
+        lorawan_setup.lorawan_frequency = commands->lorawan_interval;
+        sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_FREQUENCY, &lorawan_setup.lorawan_frequency, sizeof(lorawan_setup.lorawan_frequency));
     }
-    LOG_INF("LoRaWAN payload sent successfully");
-    /* Clear the sensor data. */
-    if(sensor_app_config->is_sensor_1_enabled)
+    if(commands->is_send_attempts_set)
     {
-        sensor_data_clear(&sensor1_data);
+        lorawan_setup.send_attempts = commands->send_attempts;
+        sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SEND_ATTEMPTS, &lorawan_setup.send_attempts, sizeof(lorawan_setup.send_attempts));
     }
-    if(sensor_app_config->is_sensor_2_enabled)
+    /* Every setting is stored, the committed configuration is no longer needed. */
+    sensor_nvs_delete(SENSOR_NVS_ADDRESS_DOWNLINK_CONFIG);
+    LOG_INF("Applied configuration of downlink %d", commands->sequence);
+    set_downlink_ack(commands->sequence, SENSOR_DOWNLINK_STATUS_OK);
+}
+
+/**
+ * @brief Finish applying the configuration of a downlink that was committed to NVS before a reset, so the settings 
+ * stored at separate addresses are never left with only part of it.
+ * 
+ */
+static void apply_committed_downlink(void)
+{
+    downlink_config_record_t record;
+    sensor_downlink_commands_t commands;
+    if(sensor_nvs_read(SENSOR_NVS_ADDRESS_DOWNLINK_CONFIG, &record, sizeof(record)) < 0)
     {
-        sensor_data_clear(&sensor2_data);
+        return;
     }
-    return 0;
+    LOG_WRN("Finishing the configuration of downlink %d interrupted by a reset", record.sequence);
+    unpack_downlink_config(&record, &commands);
+    apply_downlink_config(&commands);
 }
 
 /**
- * @brief Check that the app passes all the requirements to be in the running state.
+ * @brief Apply the configuration of the last valid downlink, all of it or none of it. The whole configuration is 
+ * committed to NVS in a single write before any setting is changed, a reset after that finishes applying it at the 
+ * next boot. The result is acknowledged once applied. The sensors must be stopped.
  * 
- * @return int 0 on success, -1 on failure
  */
-static int running_state_initialization_check(void)
+static void apply_staged_downlink(void)
 {
-    if(sensor_app_config->state != SENSOR_APP_STATE_RUNNING)
+    sensor_downlink_commands_t commands;
+    downlink_config_record_t record;
+    uint8_t is_sensor_1_enabled;
+    uint8_t is_sensor_2_enabled;
+    k_mutex_lock(&downlink_lock, K_FOREVER);
+    if(!atomic_cas(&is_downlink_staged, 1, 0))
     {
-        LOG_ERR("App is not in the running state");
-        return -1;
+        k_mutex_unlock(&downlink_lock);
+        return;
     }
-    /* Check that either sensor 1 or sensor 2 is enabled. */
-    if(!sensor_app_config->is_sensor_1_enabled && !sensor_app_config->is_sensor_2_enabled)
+    commands = staged_downlink;
+    k_mutex_unlock(&downlink_lock);
+    /* The running state needs at least one usable sensor, so a downlink that leaves none is not applied. */
+    if(check_downlink_sensor_settings(&commands.sensors[0], sensor_app_config->is_sensor_1_enabled, 
+            sensor_app_config->sensor_1_type, &is_sensor_1_enabled) < 0 
+        || check_downlink_sensor_settings(&commands.sensors[1], sensor_app_config->is_sensor_2_enabled, 
+            sensor_app_config->sensor_2_type, &is_sensor_2_enabled) < 0 
+        || (!is_sensor_1_enabled && !is_sensor_2_enabled))
     {
-        LOG_ERR("Neither sensor 1 or sensor 2 is enabled");
-        return -1;
+        LOG_ERR("Downlink %d leaves no usable sensor, not applied", commands.sequence);
+        set_downlink_ack(commands.sequence, SENSOR_DOWNLINK_STATUS_INVALID_VALUE);
+        return;
     }
-    /* Make sure that if sensor 1 is enabled, it is initialized to a valid sensor type and has a non-zero frequency. */
-    if(sensor_app_config->is_sensor_1_enabled && sensor_app_config->sensor_1_type == NULL_SENSOR)
+    pack_downlink_config(&commands, &record);
+    if(sensor_nvs_write(SENSOR_NVS_ADDRESS_DOWNLINK_CONFIG, &record, sizeof(record)) < 0)
     {
-        LOG_ERR("Sensor 1 is enabled but not initialized to any sensor types");
-        sensor_app_config->is_sensor_1_enabled = 0;
-        return -1;
+        /* Nothing was changed, and without an acknowledgement the network sends the downlink again. */
+        LOG_ERR("Failed to commit downlink %d, not applied", commands.sequence);
+        return;
     }
-    if(sensor_app_config->is_sensor_1_enabled && sensor_app_config->sensor_1_frequency == 0)
+    apply_downlink_config(&commands);
+}
+
+/**
+ * @brief Clear the buffered samples of both sensors. Samples in flight are not cleared again once sent.
+ * 
+ */
+static void flush_sensor_data(void)
+{
+    k_mutex_lock(&sensor_data_lock, K_FOREVER);
+    sensor_data_clear(&sensor1_data);
+    sensor_data_clear(&sensor2_data);
+    in_flight_sensor1_samples = 0;
+    in_flight_sensor2_samples = 0;
+    in_flight_fragment_samples = 0;
+    k_mutex_unlock(&sensor_data_lock);
+    k_work_cancel_delayable(&fragment_work);
+    LOG_INF("Buffered samples flushed by downlink");
+}
+
+/**
+ * @brief Validate a downlink and act on it. The configuration is staged and the running state is restarted so the 
+ * sensors are reconfigured while stopped, the other commands are acknowledged right away.
+ * 
+ * @param message The downlink.
+ */
+static void handle_downlink(const downlink_message_t *message)
+{
+    sensor_downlink_commands_t commands;
+    enum sensor_downlink_status status;
+    if(sensor_downlink_parse(message->data, message->length, &commands, &status) < 0)
     {
-        LOG_ERR("Sensor 1 is enabled but has 0 frequency");
-        sensor_app_config->is_sensor_1_enabled = 0;
-        return -1;
+        LOG_ERR("Rejected downlink %d (%d)", commands.sequence, status);
+        set_downlink_ack(commands.sequence, status);
+        return;
     }
-    /* Make sure that if sensor 2 is enabled, it is initialized to a valid sensor type and has a non-zero frequency. */
-    if(sensor_app_config->is_sensor_2_enabled && sensor_app_config->sensor_2_frequency == 0)
+    LOG_INF("Downlink %d received", commands.sequence);
+    if(commands.is_flush)
     {
-        LOG_ERR("Sensor 2 is enabled but has 0 frequency");
-        sensor_app_config->is_sensor_2_enabled = 0;
-        return -1;
+        flush_sensor_data();
     }
-    if(sensor_app_config->is_sensor_2_enabled && sensor_app_config->sensor_2_type == NULL_SENSOR)
+    if(commands.is_reboot)
     {
-        LOG_ERR("Sensor 2 is enabled but not initialized to any sensor types");
-        sensor_app_config->is_sensor_2_enabled = 0;
-        return -1;
+        atomic_set(&is_reboot_requested, 1);
     }
-    /* Make sure that if lorawan is enabled, it has a valid frequency. */
-    if(lorawan_setup.is_lorawan_enabled && lorawan_setup.lorawan_frequency == 0)
+    if(!sensor_downlink_has_config(&commands))
     {
-        LOG_ERR("LoRaWAN is enabled but has 0 frequency");
-        lorawan_setup.is_lorawan_enabled = 0;
-        return -1;
+        set_downlink_ack(commands.sequence, SENSOR_DOWNLINK_STATUS_OK);
+        return;
+    }
+    k_mutex_lock(&downlink_lock, K_FOREVER);
+    staged_downlink = commands;
+    atomic_set(&is_downlink_staged, 1);
+    k_mutex_unlock(&downlink_lock);
+    sensor_app_notify_config_changed();
+}
+
+static void downlink_work_handler(struct k_work *work)
+{
+    downlink_message_t message;
+    while(k_msgq_get(&downlink_queue, &message, K_NO_WAIT) == 0)
+    {
+        handle_downlink(&message);
     }
-    return 0;
 }
 
 /**
- * @brief Initialize the sensor schedules.
+ * @brief Release the radio for the next uplink, sending an uplink that came due in the meantime.
  * 
- * @return int 0 on success, -1 on failure
  */
-static int initialize_sensor_schedule(void)
+static void release_uplink_in_flight(void)
 {
-    int ret;
-    if(sensor_app_config->is_sensor_1_enabled && sensor_app_config->sensor_1_frequency > 0)
+    atomic_clear(&is_uplink_in_flight);
+    if(atomic_cas(&is_uplink_deferred, 1, 0))
     {
-        sensor1_schedule.frequency_seconds = MINUTES_TO_SECONDS(sensor_app_config->sensor_1_frequency);
-        ret = sensor_scheduling_add_schedule(&sensor1_schedule);
-        if(ret < 0)
+        k_work_submit_to_queue(&radio_work_q, &radio_work);
+    }
+}
+
+/**
+ * @brief Called from the radio thread once the uplink is complete.
+ * 
+ * @param result The result of the uplink.
+ * @param user_data Not used.
+ */
+static void uplink_complete(enum sensor_radio_result result, void *user_data)
+{
+    /* A failed uplink still used its frame counters. */
+    if(result != SENSOR_RADIO_RESULT_DROPPED)
+    {
+        update_frame_counter_reservation();
+    }
+    if(result == SENSOR_RADIO_RESULT_SENT || result == SENSOR_RADIO_RESULT_ACKED)
+    {
+        LOG_INF("LoRaWAN payload sent successfully");
+        /* Clear the sent sensor data, keeping any readings taken while sending. */
+        k_mutex_lock(&sensor_data_lock, K_FOREVER);
+        if(sensor_app_config->is_sensor_1_enabled)
         {
-            LOG_ERR("Failed to add sensor 1 schedule");
+            sensor_data_clear_sent(&sensor1_data, in_flight_sensor1_samples);
         }
-        else
+        if(sensor_app_config->is_sensor_2_enabled)
         {
-            sensor1_schedule.one_time_trigger = 1;
-            LOG_INF("Sensor 1 schedule added at a frequency of %d seconds", sensor1_schedule.frequency_seconds);
+            sensor_data_clear_sent(&sensor2_data, in_flight_sensor2_samples);
         }
-    }
-    if(sensor_app_config->is_sensor_2_enabled && sensor_app_config->sensor_2_frequency > 0)
-    {
-        sensor2_schedule.frequency_seconds = MINUTES_TO_SECONDS(sensor_app_config->sensor_2_frequency);
-        ret = sensor_scheduling_add_schedule(&sensor2_schedule);
-        if(ret < 0)
+        k_mutex_unlock(&sensor_data_lock);
+        if(is_in_flight_time_requested)
         {
-            LOG_ERR("Failed to add sensor 2 schedule");
+            update_time_sync();
         }
-        else
+        if(is_in_flight_ack)
         {
-            sensor2_schedule.one_time_trigger = 1;
-            LOG_INF("Sensor 2 schedule added at a frequency of %d seconds", sensor2_schedule.frequency_seconds);
+            downlink_ack_sent();
         }
-    }
-    if(lorawan_setup.is_lorawan_enabled && lorawan_setup.lorawan_frequency > 0)
-    {
-        k_sleep(K_SECONDS(2)); // schedule radio to start after sensors are read
-        radio_schedule.frequency_seconds = MINUTES_TO_SECONDS(lorawan_setup.lorawan_frequency);
-        ret = sensor_scheduling_add_schedule(&radio_schedule);
-        if(ret < 0)
+        if(is_in_flight_full_header)
         {
-            LOG_ERR("Failed to add radio schedule");
+            is_full_header_sent = 1;
+            sent_config_hash = in_flight_config_hash;
+            uplinks_since_full_header = 0;
         }
-        else
+        else if(uplinks_since_full_header < UINT8_MAX)
         {
-            radio_schedule.one_time_trigger = 1;
-            LOG_INF("Radio schedule added at a frequency of %d seconds", radio_schedule.frequency_seconds);
+            uplinks_since_full_header++;
         }
+        release_uplink_in_flight();
+        schedule_fragment();
+    }
+    else
+    {
+        LOG_ERR("Failed to send LoRaWAN payload (%d)", result);
+        release_uplink_in_flight();
     }
-    return 0;
 }
 
 /**
- * @brief Initialize the sensor data to read from the correct sensor configuration.
+ * @brief Called from the radio thread once the fragment is complete.
  * 
- * @return int 0 on success, -1 on failure
+ * @param result The result of the fragment.
+ * @param user_data Not used.
  */
-static int initialize_sensor_data(void)
+static void fragment_complete(enum sensor_radio_result result, void *user_data)
 {
-    int ret;
-    if(sensor_app_config->is_sensor_1_enabled && sensor_app_config->sensor_1_type != NULL_SENSOR)
+    if(result != SENSOR_RADIO_RESULT_DROPPED)
     {
-        ret = sensor_data_setup(&sensor1_data, sensor_app_config->sensor_1_type, sensor_app_config->sensor_1_voltage);
-        if(ret < 0)
-        {
-            LOG_ERR("Failed to initialize sensor 1 data");
-            return ret;
-        }
+        update_frame_counter_reservation();
     }
-    if(sensor_app_config->is_sensor_2_enabled && sensor_app_config->sensor_2_type != NULL_SENSOR)
+    if(result == SENSOR_RADIO_RESULT_SENT || result == SENSOR_RADIO_RESULT_ACKED)
     {
-        ret = sensor_data_setup(&sensor2_data, sensor_app_config->sensor_2_type, sensor_app_config->sensor_2_voltage);
-        if(ret < 0)
-        {
-            LOG_ERR("Failed to initialize sensor 2 data");
-            return ret;
-        }
+        k_mutex_lock(&sensor_data_lock, K_FOREVER);
+        sensor_data_clear_sent(in_flight_fragment_data, in_flight_fragment_samples);
+        k_mutex_unlock(&sensor_data_lock);
+        fragments_sent++;
+        release_uplink_in_flight();
+        schedule_fragment();
+    }
+    else
+    {
+        /* The backlog stays buffered for the next uplink. */
+        LOG_ERR("Failed to send fragment (%d)", result);
+        release_uplink_in_flight();
     }
-    return 0;
 }
 
-static int disable_sensor(void)
+static void radio_work_handler(struct k_work *work)
 {
     int ret;
-    if(sensor_app_config->is_sensor_1_enabled)
+    if(!lorawan_setup.is_lorawan_enabled)
     {
-        ret = sensor_data_setup(&sensor1_data, NULL_SENSOR, SENSOR_VOLTAGE_OFF);
-        if(ret < 0)
-        {
-            LOG_ERR("Failed to disable sensor 1");
-            return ret;
-        }
-        ret = sensor_scheduling_remove_schedule(&sensor1_schedule);
-        if(ret < 0)
-        {
-            LOG_ERR("Failed to remove sensor 1 schedule");
-            return ret;
-        }
+        return;
     }
-    if(sensor_app_config->is_sensor_2_enabled)
+    sensor_pmic_led_on();
+    radio_schedule.one_time_trigger = 0;
+    LOG_INF("Radio schedule triggered");
+    reset_schedule(&radio_schedule);
+    if(!is_lorawan_connected())
     {
-        ret = sensor_data_setup(&sensor2_data, NULL_SENSOR, SENSOR_VOLTAGE_OFF);
-        if(ret < 0)
-        {
-            LOG_ERR("Failed to disable sensor 2");
-            return ret;
-        }
-        ret = sensor_scheduling_remove_schedule(&sensor2_schedule);
-        if(ret < 0)
-        {
-            LOG_ERR("Failed to remove sensor 2 schedule");
-            return ret;
-        }
+        LOG_WRN("LoRaWAN is not joined yet, keeping the samples for the next uplink");
+        sensor_pmic_led_off();
+        return;
     }
-    LOG_INF("Sensors disabled");
-    if(lorawan_setup.is_lorawan_enabled)
+    /* Keep within the airtime budget, the samples stay buffered for a later uplink. */
+    enum sensor_budget_level budget_level = sensor_lorawan_get_budget_level();
+    if(budget_level == SENSOR_BUDGET_LEVEL_DEFER)
+    {
+        LOG_WRN("Airtime budget used up, keeping the samples for the next uplink");
+        sensor_pmic_led_off();
+        return;
+    }
+    if(budget_level == SENSOR_BUDGET_LEVEL_MERGE && ++uplinks_merged < SENSOR_APP_MERGED_UPLINKS)
+    {
+        LOG_WRN("Airtime budget low, merging the samples into the next uplink");
+        sensor_pmic_led_off();
+        return;
+    }
+    uplinks_merged = 0;
+    /* The uplink carries the oldest samples, so any fragments still pending start over after it. */
+    k_work_cancel_delayable(&fragment_work);
+    if(!atomic_cas(&is_uplink_in_flight, 0, 1))
+    {
+        LOG_WRN("Previous uplink is still in flight, sending once it is complete");
+        atomic_set(&is_uplink_deferred, 1);
+        sensor_pmic_led_off();
+        return;
+    }
+    fragments_sent = 0;
+    /* Ask for the network time along with the uplink when it is due to be synchronized. */
+    uint64_t current_ms;
+    is_in_flight_time_requested = sensor_scheduling_get_ms(&current_ms) == 0 && sensor_time_needs_sync(current_ms) 
+        && sensor_lorawan_request_time() == 0;
+    /* Queue the LoRaWAN payload, the radio thread sends it without holding up this queue. */
+    ret = format_and_queue_lorawan_payload();
+    if(ret < 0)
+    {
+        LOG_ERR("Failed to queue LoRaWAN payload");
+        release_uplink_in_flight();
+    }
+    sensor_pmic_led_off();
+}
+
+static void fragment_work_handler(struct k_work *work)
+{
+    if(!lorawan_setup.is_lorawan_enabled)
+    {
+        return;
+    }
+    /* A regular uplink in flight carries the oldest samples and schedules the fragments after it. */
+    if(!atomic_cas(&is_uplink_in_flight, 0, 1))
+    {
+        return;
+    }
+    sensor_pmic_led_on();
+    int ret = format_and_queue_fragment();
+    if(ret != 0)
     {
-        ret = sensor_scheduling_remove_schedule(&radio_schedule);
         if(ret < 0)
         {
-            LOG_ERR("Failed to remove radio schedule");
-            return ret;
+            /* The backlog stays buffered for the next uplink. */
+            LOG_ERR("Failed to queue fragment");
         }
+        release_uplink_in_flight();
     }
-    return 0;
+    sensor_pmic_led_off();
 }
 
-static int update_sensor_data_timestamps(void)
+/**
+ * @brief Start the acquisition and radio work queues, only started once.
+ * 
+ */
+static void start_work_queues(void)
 {
-    if(sensor_app_config->is_sensor_1_enabled)
-    {
-        sensor_app_config->sensor_1_latest_data_timestamp = (sensor_scheduling_get_seconds() - sensor1_data.latest_timestamp);
-    }
-    if(sensor_app_config->is_sensor_2_enabled)
+    if(is_work_q_started)
     {
-        sensor_app_config->sensor_2_latest_data_timestamp = (sensor_scheduling_get_seconds() - sensor2_data.latest_timestamp);
+        return;
     }
-    return 0;
+    struct k_work_queue_config acquisition_cfg = {
+        .name = "acquisition_wq",
+    };
+    struct k_work_queue_config radio_cfg = {
+        .name = "radio_wq",
+    };
+    k_work_queue_init(&acquisition_work_q);
+    k_work_queue_start(&acquisition_work_q, acquisition_stack, K_THREAD_STACK_SIZEOF(acquisition_stack), 
+        ACQUISITION_PRIORITY, &acquisition_cfg);
+    k_work_queue_init(&radio_work_q);
+    k_work_queue_start(&radio_work_q, radio_stack, K_THREAD_STACK_SIZEOF(radio_stack), 
+        RADIO_PRIORITY, &radio_cfg);
+    is_work_q_started = true;
 }
 
 int sensor_app_init(sensor_app_config_t *config)
 {
     int ret;
     sensor_app_config = config;
+    /* The first uplink after boot carries the full header. */
+    is_full_header_sent = 0;
+    uplinks_since_full_header = 0;
+    start_work_queues();
+#if defined(CONFIG_STATS)
+    register_schedule_stats();
+#endif
     ret = sensor_scheduling_init(sensor_timer);
     if(ret < 0)
     {
@@ -521,12 +2160,15 @@ int sensor_app_init(sensor_app_config_t *config)
         LOG_ERR("Failed to initialize NVS");
         return ret;
     }
+    /* A downlink committed before a reset is applied before the configuration is used. */
+    apply_committed_downlink();
     ret = sensor_pmic_init();
     if(ret < 0)
     {
         LOG_ERR("Failed to initialize PMIC");
         return ret;
     }
+    k_work_reschedule_for_queue(&radio_work_q, &pmic_work, K_NO_WAIT);
     return 0;
 }
 
@@ -540,13 +2182,15 @@ int sensor_app_configuration_state(void)
         k_msleep(500);
         sensor_pmic_led_off();
         k_msleep(500);
-        sensor_pmic_status_get(&pmic_status);
+        /* Keep the status shown over BLE current while it is being configured. */
+        k_work_reschedule_for_queue(&radio_work_q, &pmic_work, K_NO_WAIT);
     }
     
     if(lorawan_setup.is_lorawan_enabled && sensor_app_config->connect_network_during_configuration)
     {
         sensor_pmic_led_on();
-        ret = sensor_lorawan_connection();
+        /* Wait for the join so a failure returns to configuration while the keys can still be changed. */
+        ret = sensor_lorawan_connection(K_FOREVER);
         if(ret < 0)
         {
             LOG_ERR("Failed to connect to LoRaWAN, returning to configuration state");
@@ -561,6 +2205,8 @@ int sensor_app_configuration_state(void)
 int sensor_app_running_state(void)
 {
     int ret;
+    /* Apply the configuration of a downlink received since the sensors were stopped. */
+    apply_staged_downlink();
     /* Check that the app passes all the requirements to be in the running state. */
     ret = running_state_initialization_check();
     if(ret < 0)
@@ -573,7 +2219,8 @@ int sensor_app_running_state(void)
     if(lorawan_setup.is_lorawan_enabled && !is_lorawan_connected())
     {
         sensor_pmic_led_on();
-        ret = sensor_lorawan_connection();
+        /* Sensors start reading while the network is joined in the background. */
+        ret = sensor_lorawan_connection(K_NO_WAIT);
         if(ret < 0)
         {
             LOG_ERR("Failed to connect to LoRaWAN");
@@ -582,19 +2229,21 @@ int sensor_app_running_state(void)
         }
         sensor_pmic_led_off();
     }
-    /* Initialize the sensor schedules. */
-    ret = initialize_sensor_schedule();
+    /* Initialize the sensor data. */
+    ret = initialize_sensor_data();
     if(ret < 0)
     {
-        LOG_ERR("Failed to initialize sensor schedules");
+        LOG_ERR("Failed to initialize sensor data");
         sensor_app_config->state = SENSOR_APP_STATE_ERROR;
         return ret;
     }
-    /* Initialize the sensor data. */
-    ret = initialize_sensor_data();
+    /* Learn the warm-ups of newly commissioned sensors before anything reads them. */
+    learn_sensor_warmups();
+    /* Initialize the sensor schedules. */
+    ret = initialize_sensor_schedule();
     if(ret < 0)
     {
-        LOG_ERR("Failed to initialize sensor data");
+        LOG_ERR("Failed to initialize sensor schedules");
         sensor_app_config->state = SENSOR_APP_STATE_ERROR;
         return ret;
     }
@@ -604,52 +2253,34 @@ int sensor_app_running_state(void)
     LOG_INF("Sensor 2: INDEX: %d NAME: %s", sensor_app_config->sensor_2_type, sensor_app_config->sensor_2_type_name);
     LOG_INF("Sensor 2 Power: INDEX: %d NAME: %s", sensor_app_config->sensor_2_voltage, sensor_app_config->sensor_2_voltage_name);
 
-    while(sensor_app_config->state == SENSOR_APP_STATE_RUNNING)
-    {
-        if(sensor_app_config->is_sensor_1_enabled && (sensor1_schedule.is_triggered || sensor1_schedule.one_time_trigger))
-		{
-            sensor_pmic_led_on();
-			sensor1_schedule.one_time_trigger = 0;
-			LOG_INF("Sensor 1 schedule triggered");
-			sensor_data_read(&sensor1_data, sensor_scheduling_get_seconds());
-			sensor_data_print_data(&sensor1_data);
-			sensor_scheduling_reset_schedule(&sensor1_schedule);
-            sensor_app_config->sensor_1_latest_data = sensor1_data.latest_data;
-            sensor_app_config->sensor_1_latest_data_timestamp = (sensor_scheduling_get_seconds() - sensor1_data.latest_timestamp);
-            sensor_pmic_led_off();
-        }
-		if(sensor_app_config->is_sensor_2_enabled && (sensor2_schedule.is_triggered || sensor2_schedule.one_time_trigger))
-		{
-            sensor_pmic_led_on();
-			sensor2_schedule.one_time_trigger = 0;
-			LOG_INF("Sensor 2 schedule triggered");
-			sensor_data_read(&sensor2_data, sensor_scheduling_get_seconds());
-			sensor_data_print_data(&sensor2_data);
-			sensor_scheduling_reset_schedule(&sensor2_schedule);
-            sensor_app_config->sensor_2_latest_data = sensor2_data.latest_data;
-            sensor_app_config->sensor_2_latest_data_timestamp = (sensor_scheduling_get_seconds() - sensor2_data.latest_timestamp);
-            sensor_pmic_led_off();
-        }
-		if(lorawan_setup.is_lorawan_enabled && (radio_schedule.is_triggered || radio_schedule.one_time_trigger))
-		{
-            sensor_pmic_led_on();
-			radio_schedule.one_time_trigger = 0;
-			LOG_INF("Radio schedule triggered");
-
-			sensor_scheduling_reset_schedule(&radio_schedule);
-            /* Send the LoRaWAN payload. */
-			ret = format_and_send_lorawan_payload();
-            if(ret < 0)
-            {
-                LOG_ERR("Failed to send LoRaWAN payload");
-            }
-            sensor_pmic_led_off();
-		}
+    /* Handle the one time triggers set while adding the schedules without waiting for an alarm. */
+    if(sensor1_schedule.one_time_trigger)
+    {
+        submit_schedule_work(SENSOR_SCHEDULING_ID_SENSOR1);
+    }
+    if(sensor2_schedule.one_time_trigger)
+    {
+        submit_schedule_work(SENSOR_SCHEDULING_ID_SENSOR2);
+    }
+    if(radio_schedule.one_time_trigger)
+    {
+        submit_schedule_work(SENSOR_SCHEDULING_ID_RADIO);
+    }
+    /* The work queues handle the schedules, sleep until the state changes or a downlink reconfigures the sensors. */
+    while(sensor_app_config->state == SENSOR_APP_STATE_RUNNING && !atomic_get(&is_downlink_staged))
+    {
+        k_event_wait(&sensor_app_events, SENSOR_APP_EVENT_CONFIG_CHANGED, false, K_FOREVER);
+        k_event_clear(&sensor_app_events, SENSOR_APP_EVENT_CONFIG_CHANGED);
         LOG_DBG("App is in the running state");
-        k_msleep(1000);
-        update_sensor_data_timestamps();
-        sensor_pmic_status_get(&pmic_status);
     }
+    /* Let any reading or uplink in progress finish before disabling the sensors. */
+    struct k_work_sync work_sync;
+    k_work_cancel_sync(&sensor1_work, &work_sync);
+    k_work_cancel_sync(&sensor2_work, &work_sync);
+    k_work_cancel_sync(&radio_work, &work_sync);
+    k_work_cancel_delayable_sync(&fragment_work, &work_sync);
+    /* Uplinks still queued are dropped, an uplink being sent is left to complete. */
+    sensor_radio_flush();
     /* Disable sensors.*/
     ret = disable_sensor();
     if(ret < 0)
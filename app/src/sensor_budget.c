@@ -0,0 +1,91 @@
+/**
+ * @file sensor_budget.c
+ * @author Tyler Garcia
+ * @brief This is a library to keep the time on air of the uplinks within a daily fair use budget. The time on air
+ * is kept in hourly buckets over a rolling 24 hours, and as the budget runs low the uplinks are first sent
+ * unconfirmed, then merged and finally deferred until older time on air leaves the window.
+ * @version 0.1
+ * @date 2025-06-15
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "sensor_budget.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(SENSOR_BUDGET, LOG_LEVEL_INF);
+
+/**
+ * @brief Move the window forward to the current hour, emptying the buckets of the hours that left it.
+ * 
+ * @param budget The budget
+ * @param now_ms The current uptime in milliseconds
+ */
+static void advance(sensor_budget_t *budget, uint64_t now_ms)
+{
+    uint64_t hour = now_ms / SENSOR_BUDGET_BUCKET_MS;
+    if (hour <= budget->current_hour) {
+        return;
+    }
+    uint64_t elapsed_hours = MIN(hour - budget->current_hour, SENSOR_BUDGET_BUCKETS);
+    for (uint64_t i = 1; i <= elapsed_hours; i++) {
+        budget->buckets_us[(budget->current_hour + i) % SENSOR_BUDGET_BUCKETS] = 0;
+    }
+    budget->current_hour = hour;
+}
+
+void sensor_budget_record(sensor_budget_t *budget, uint64_t now_ms, uint32_t time_on_air_us)
+{
+    advance(budget, now_ms);
+    uint32_t *bucket_us = &budget->buckets_us[budget->current_hour % SENSOR_BUDGET_BUCKETS];
+    *bucket_us = (*bucket_us > UINT32_MAX - time_on_air_us) ? UINT32_MAX : *bucket_us + time_on_air_us;
+}
+
+uint32_t sensor_budget_get_used_us(sensor_budget_t *budget, uint64_t now_ms)
+{
+    advance(budget, now_ms);
+    uint64_t used_us = 0;
+    for (int i = 0; i < SENSOR_BUDGET_BUCKETS; i++) {
+        used_us += budget->buckets_us[i];
+    }
+    return (uint32_t)MIN(used_us, UINT32_MAX);
+}
+
+enum sensor_budget_level sensor_budget_get_level(sensor_budget_t *budget, uint64_t now_ms, uint32_t time_on_air_us)
+{
+    uint64_t used_us = (uint64_t)sensor_budget_get_used_us(budget, now_ms) + time_on_air_us;
+    if (used_us > SENSOR_BUDGET_DAILY_US) {
+        return SENSOR_BUDGET_LEVEL_DEFER;
+    }
+    uint64_t left_us = SENSOR_BUDGET_DAILY_US - used_us;
+    if (left_us * 100 < (uint64_t)SENSOR_BUDGET_DAILY_US * SENSOR_BUDGET_MERGE_PERCENT) {
+        return SENSOR_BUDGET_LEVEL_MERGE;
+    }
+    if (left_us * 100 < (uint64_t)SENSOR_BUDGET_DAILY_US * SENSOR_BUDGET_UNCONFIRMED_PERCENT) {
+        return SENSOR_BUDGET_LEVEL_UNCONFIRMED;
+    }
+    return SENSOR_BUDGET_LEVEL_NORMAL;
+}
+
+int sensor_budget_get_delay_ms(sensor_budget_t *budget, uint64_t now_ms, uint32_t time_on_air_us, uint32_t *delay_ms)
+{
+    if (time_on_air_us > SENSOR_BUDGET_DAILY_US) {
+        LOG_ERR("Time on air of %d us is longer than the budget", time_on_air_us);
+        return -EINVAL;
+    }
+    uint64_t used_us = (uint64_t)sensor_budget_get_used_us(budget, now_ms) + time_on_air_us;
+    /* The oldest buckets leave the window first, each at the end of the hour 24 hours after it started */
+    for (uint64_t i = 0; used_us > SENSOR_BUDGET_DAILY_US && i < SENSOR_BUDGET_BUCKETS; i++) {
+        uint64_t hour = budget->current_hour + 1 + i;
+        used_us -= budget->buckets_us[hour % SENSOR_BUDGET_BUCKETS];
+        if (used_us <= SENSOR_BUDGET_DAILY_US) {
+            *delay_ms = (uint32_t)((hour * SENSOR_BUDGET_BUCKET_MS) - now_ms);
+            return 0;
+        }
+    }
+    *delay_ms = 0;
+    return 0;
+}
@@ -35,6 +35,10 @@ typedef struct {
 /* Sensor data configurations. */
 static sensor_data_config_t sensor_data_config[SENSOR_INDEX_LIMIT];
 
+/* QDEC device for a sensor alias, NULL when the board does not route the sensor to a QDEC. */
+#define SENSOR_QDEC_DEVICE(alias) \
+    COND_CODE_1(DT_NODE_HAS_STATUS(DT_ALIAS(alias), okay), (DEVICE_DT_GET(DT_ALIAS(alias))), (NULL))
+
 /* Sensor power configurations for power 1. */
 static sensor_power_config_t sensor_output1 = {
 	.power_id = SENSOR_POWER_1,
@@ -68,7 +72,10 @@ sensor_reading_config_t sensor1_reading_config = {
 	.d1 = GPIO_DT_SPEC_GET(DT_ALIAS(sensor1d1), gpios),	
 	.d2 = GPIO_DT_SPEC_GET(DT_ALIAS(sensor1d2), gpios),
 	.voltage_read = ADC_DT_SPEC_GET_BY_NAME(DT_PATH(zephyr_user), voltage_sensor1),
-    .current_read = ADC_DT_SPEC_GET_BY_NAME(DT_PATH(zephyr_user), current_sensor1)
+    .current_read = ADC_DT_SPEC_GET_BY_NAME(DT_PATH(zephyr_user), current_sensor1),
+    .qdec = SENSOR_QDEC_DEVICE(sensor1qdec),
+    .voltage_tempco_ppm = VOLTAGE_READ_TEMPCO_PPM,
+    .current_tempco_ppm = CURRENT_READ_TEMPCO_PPM
 };
 
 sensor_reading_config_t sensor2_reading_config = {
@@ -76,7 +83,10 @@ sensor_reading_config_t sensor2_reading_config = {
 	.d1 = GPIO_DT_SPEC_GET(DT_ALIAS(sensor2d1), gpios),	
 	.d2 = GPIO_DT_SPEC_GET(DT_ALIAS(sensor2d2), gpios),
 	.voltage_read = ADC_DT_SPEC_GET_BY_NAME(DT_PATH(zephyr_user), voltage_sensor2),
-    .current_read = ADC_DT_SPEC_GET_BY_NAME(DT_PATH(zephyr_user), current_sensor2)
+    .current_read = ADC_DT_SPEC_GET_BY_NAME(DT_PATH(zephyr_user), current_sensor2),
+    .qdec = SENSOR_QDEC_DEVICE(sensor2qdec),
+    .voltage_tempco_ppm = VOLTAGE_READ_TEMPCO_PPM,
+    .current_tempco_ppm = CURRENT_READ_TEMPCO_PPM
 };
 
 static sensor_reading_config_t *sensor_reading_configs[] = {
@@ -84,6 +94,68 @@ static sensor_reading_config_t *sensor_reading_configs[] = {
     &sensor2_reading_config
 };
 
+/**
+ * @brief Check if a sensor type counts events and so needs its power on all the time.
+ * 
+ * @param type The type of sensor.
+ * @return int 1 if the sensor is a counter, 0 if not.
+ */
+static int is_counter_sensor(enum sensor_types type)
+{
+    return (type == PULSE_SENSOR || type == QUADRATURE_SENSOR || type == PULSE_DIR_SENSOR);
+}
+
+/**
+ * @brief Check if the learned warm-up profile matches the current sensor setup.
+ * 
+ * @param sensor_data The sensor data to check.
+ * @return int 1 if the profile can be used, 0 if not.
+ */
+static int is_warmup_profile_valid(sensor_data_t *sensor_data)
+{
+    return (sensor_data->warmup.warmup_ms != 0 &&
+            sensor_data->warmup.type == sensor_data_config[sensor_data->id].type &&
+            sensor_data->warmup.voltage == sensor_data_config[sensor_data->id].voltage_enum);
+}
+
+/**
+ * @brief Set the sensor power output, waiting the given delay instead of the configured one. The configured delay is 
+ * restored afterwards, the continuously powered sensors still settle with it.
+ * 
+ * @param sensor_data The sensor data to set the power of.
+ * @param voltage The voltage to set.
+ * @param delay_ms Time to wait after setting the voltage.
+ */
+static void set_sensor_output_delayed(sensor_data_t *sensor_data, enum sensor_voltage voltage, uint32_t delay_ms)
+{
+    sensor_power_config_t *power_config = sensor_power_configs[sensor_data->power_id];
+    uint32_t configured_delay_ms = power_config->delay_ms;
+    power_config->delay_ms = delay_ms;
+    set_sensor_output(power_config, voltage);
+    power_config->delay_ms = configured_delay_ms;
+}
+
+/**
+ * @brief Turn on the sensor power, waiting the given warm-up time before returning.
+ * 
+ * @param sensor_data The sensor data to power on.
+ * @param warmup_ms Time to wait for the sensor to stabilize.
+ */
+static void sensor_power_on(sensor_data_t *sensor_data, uint32_t warmup_ms)
+{
+    set_sensor_output_delayed(sensor_data, sensor_data_config[sensor_data->id].voltage_enum, warmup_ms);
+}
+
+/**
+ * @brief Turn off the sensor power, nothing has to settle so no delay is used.
+ * 
+ * @param sensor_data The sensor data to power off.
+ */
+static void sensor_power_off(sensor_data_t *sensor_data)
+{
+    set_sensor_output_delayed(sensor_data, SENSOR_VOLTAGE_OFF, 0);
+}
+
 int sensor_data_setup(sensor_data_t *sensor_data, enum sensor_types type, enum sensor_voltage voltage_enum)
 {
     if (sensor_data->id >= SENSOR_INDEX_LIMIT || sensor_data->power_id >= SENSOR_POWER_INDEX_LIMIT
@@ -98,7 +170,7 @@ int sensor_data_setup(sensor_data_t *sensor_data, enum sensor_types type, enum s
     /* Setup the sensor reading configuration. */
     sensor_reading_setup(sensor_reading_configs[sensor_data->id], type);
 
-    if(sensor_data_config[sensor_data->id].type == PULSE_SENSOR) 
+    if(is_counter_sensor(sensor_data_config[sensor_data->id].type)) 
     {
         sensor_data_config[sensor_data->id].is_sensor_power_continuous = 1;
         /* If the sensor type is continuous, the power should be on all the time. */
@@ -196,7 +268,7 @@ int sensor_data_read(sensor_data_t *sensor_data, int timestamp)
     int ret;
     if (sensor_data_config[sensor_data->id].is_sensor_power_continuous == 0)
     {
-        set_sensor_output(sensor_power_configs[sensor_data->power_id], sensor_data_config[sensor_data->id].voltage_enum);
+        sensor_power_on(sensor_data, is_warmup_profile_valid(sensor_data) ? sensor_data->warmup.warmup_ms : SENSOR_WARMUP_DEFAULT_MS);
     }
     switch(sensor_data_config[sensor_data->id].type)
     {
@@ -215,6 +287,37 @@ int sensor_data_read(sensor_data_t *sensor_data, int timestamp)
             }
             break;
         }
+        case QUADRATURE_SENSOR:
+        case PULSE_DIR_SENSOR:
+        {
+            int32_t count;
+            ret = get_sensor_signed_count(sensor_reading_configs[sensor_data->id], &count);
+            if (ret < 0) {
+                LOG_ERR("Failed to get signed count for sensor %d", sensor_data->id);
+                return -1;
+            }
+            memcpy(sensor_data->latest_data, &count, sensor_data->data_size);
+            ret = put_data_into_ring_buffer(sensor_data, &count);
+            if (ret < 0) {
+                return -1;
+            }
+            break;
+        }
+        case FREQUENCY_SENSOR:
+        {
+            float frequency;
+            ret = get_sensor_frequency(sensor_reading_configs[sensor_data->id], &frequency);
+            if (ret < 0) {
+                LOG_ERR("Failed to get frequency for sensor %d", sensor_data->id);
+                return -1;
+            }
+            memcpy(sensor_data->latest_data, &frequency, sensor_data->data_size);
+            ret = put_data_into_ring_buffer(sensor_data, &frequency);
+            if (ret < 0) {
+                return -1;
+            }
+            break;
+        }
         case VOLTAGE_SENSOR:
         {
             float voltage = get_sensor_voltage_reading(sensor_reading_configs[sensor_data->id]);
@@ -248,11 +351,124 @@ int sensor_data_read(sensor_data_t *sensor_data, int timestamp)
     }
     if (sensor_data_config[sensor_data->id].is_sensor_power_continuous == 0)
     {
-        set_sensor_output(sensor_power_configs[sensor_data->power_id], SENSOR_VOLTAGE_OFF);
+        sensor_power_off(sensor_data);
     }
+    sensor_data->reads_since_warmup++;
     return 0;
 }
 
+/**
+ * @brief Take a single analog reading used to learn the warm-up.
+ * 
+ * @param sensor_data The sensor data to read.
+ * @return float The reading of the sensor.
+ */
+static float read_warmup_value(sensor_data_t *sensor_data)
+{
+    if (sensor_data_config[sensor_data->id].type == CURRENT_SENSOR)
+    {
+        return get_sensor_current_reading(sensor_reading_configs[sensor_data->id]);
+    }
+    return get_sensor_voltage_reading(sensor_reading_configs[sensor_data->id]);
+}
+
+/**
+ * @brief Check if a window of readings taken while learning the warm-up is stable, the spread of the whole window 
+ * has to be within tolerance of its latest reading so a slow drift is not taken as stable.
+ * 
+ * @param window The readings of the window.
+ * @param latest The latest reading of the window.
+ * @return int 1 if the readings are stable, 0 if not.
+ */
+static int is_warmup_window_stable(const float *window, float latest)
+{
+    float min = window[0];
+    float max = window[0];
+    for (uint8_t i = 1; i < SENSOR_WARMUP_STABLE_READINGS; i++)
+    {
+        min = MIN(min, window[i]);
+        max = MAX(max, window[i]);
+    }
+    float magnitude = latest < 0 ? -latest : latest;
+    float tolerance = (magnitude * (float)SENSOR_WARMUP_TOLERANCE_PERCENT / 100.0f) + SENSOR_WARMUP_TOLERANCE_FLOOR;
+    return (max - min) <= tolerance;
+}
+
+int sensor_data_learn_warmup(sensor_data_t *sensor_data)
+{
+    enum sensor_types type = sensor_data_config[sensor_data->id].type;
+    if (sensor_data_config[sensor_data->id].is_sensor_setup == 0 || sensor_data_config[sensor_data->id].is_sensor_power_continuous)
+    {
+        LOG_ERR("Sensor %d does not use switched power, no warm-up to learn", sensor_data->id);
+        return -1;
+    }
+    if (type != VOLTAGE_SENSOR && type != CURRENT_SENSOR)
+    {
+        LOG_ERR("Sensor %d is not an analog sensor, no warm-up to learn", sensor_data->id);
+        return -1;
+    }
+    /* The latest readings and the times they were taken at, used as a ring. */
+    float window[SENSOR_WARMUP_STABLE_READINGS];
+    int64_t window_times[SENSOR_WARMUP_STABLE_READINGS];
+    uint32_t readings = 0;
+    int is_stable = 0;
+    uint32_t warmup_ms = 0;
+    sensor_power_on(sensor_data, 0);
+    int64_t start = k_uptime_get();
+    int64_t current_time = 0;
+    while (current_time < SENSOR_WARMUP_MAX_MS)
+    {
+        uint8_t slot = readings % SENSOR_WARMUP_STABLE_READINGS;
+        window[slot] = read_warmup_value(sensor_data);
+        window_times[slot] = current_time;
+        readings++;
+        if (readings >= SENSOR_WARMUP_STABLE_READINGS && is_warmup_window_stable(window, window[slot]))
+        {
+            /* The oldest reading of the window is in the slot written next. */
+            uint32_t stable_since = (uint32_t)window_times[readings % SENSOR_WARMUP_STABLE_READINGS];
+            warmup_ms = stable_since + ((stable_since * SENSOR_WARMUP_MARGIN_PERCENT) / 100);
+            is_stable = 1;
+            break;
+        }
+        k_msleep(SENSOR_WARMUP_STEP_MS);
+        current_time = k_uptime_get() - start;
+    }
+    sensor_power_off(sensor_data);
+    if (!is_stable)
+    {
+        /* Mark the profile unlearned so the readings keep using the default warm-up. */
+        sensor_data->warmup.warmup_ms = 0;
+        LOG_WRN("Sensor %d readings did not stabilise within %d ms, using the default warm-up", sensor_data->id, SENSOR_WARMUP_MAX_MS);
+        return -1;
+    }
+    sensor_data->warmup.warmup_ms = CLAMP(warmup_ms, SENSOR_WARMUP_MIN_MS, SENSOR_WARMUP_MAX_MS);
+    sensor_data->warmup.type = type;
+    sensor_data->warmup.voltage = sensor_data_config[sensor_data->id].voltage_enum;
+    sensor_data->reads_since_warmup = 0;
+    LOG_INF("Sensor %d warm-up learned: %d ms", sensor_data->id, sensor_data->warmup.warmup_ms);
+    return 0;
+}
+
+int sensor_data_warmup_needs_learning(sensor_data_t *sensor_data)
+{
+    enum sensor_types type = sensor_data_config[sensor_data->id].type;
+    if (sensor_data_config[sensor_data->id].is_sensor_setup == 0 || sensor_data_config[sensor_data->id].is_sensor_power_continuous
+        || (type != VOLTAGE_SENSOR && type != CURRENT_SENSOR))
+    {
+        return 0;
+    }
+    if (!is_warmup_profile_valid(sensor_data))
+    {
+        return 1;
+    }
+    return sensor_data->reads_since_warmup >= SENSOR_WARMUP_RELEARN_READS;
+}
+
+void sensor_data_set_temperature(float temperature)
+{
+    sensor_reading_set_temperature((int32_t)(temperature * 100.0f));
+}
+
 int sensor_data_print_data(sensor_data_t *sensor_data)
 {
     uint32_t data_size = ring_buf_size_get(&sensor_data->data_ring_buf);
@@ -293,6 +509,17 @@ int sensor_data_print_data(sensor_data_t *sensor_data)
                 memcpy(&pulse_count, temp_data, sensor_data->data_size);
                 LOG_INF("Sample %d: Pulse Count = %d, Timestamp = %u", i, pulse_count, timestamp);
                 break;
+            case QUADRATURE_SENSOR:
+            case PULSE_DIR_SENSOR:
+                int32_t count;
+                memcpy(&count, temp_data, sensor_data->data_size);
+                LOG_INF("Sample %d: Signed Count = %d, Timestamp = %u", i, count, timestamp);
+                break;
+            case FREQUENCY_SENSOR:
+                float frequency;
+                memcpy(&frequency, temp_data, sensor_data->data_size);
+                LOG_INF("Sample %d: Frequency = %f Hz, Timestamp = %u", i, (double)frequency, timestamp);
+                break;
             case VOLTAGE_SENSOR:
                 float voltage;
                 memcpy(&voltage, temp_data, sensor_data->data_size);
@@ -346,6 +573,38 @@ int sensor_data_clear(sensor_data_t *sensor_data)
         {
             reset_sensor_pulse_count(sensor_reading_configs[sensor_data->id]);
         }
+        else if (sensor_data_config[sensor_data->id].type == QUADRATURE_SENSOR || sensor_data_config[sensor_data->id].type == PULSE_DIR_SENSOR)
+        {
+            reset_sensor_signed_count(sensor_reading_configs[sensor_data->id]);
+        }
+    }
+    return 0;
+}
+
+int sensor_data_clear_sent(sensor_data_t *sensor_data, uint32_t num_samples)
+{
+    if (sensor_data_config[sensor_data->id].is_sensor_setup == 0 || sensor_data->data_ring_buf.buffer == NULL 
+        || sensor_data->timestamp_ring_buf.buffer == NULL)
+    {
+        LOG_ERR("Sensor %d is not setup", sensor_data->id);
+        return -1;
+    }
+    uint32_t stored_samples = ring_buf_size_get(&sensor_data->data_ring_buf) / sensor_data->data_size;
+    if (num_samples > stored_samples)
+    {
+        num_samples = stored_samples;
+    }
+    // Passing NULL drops the data without copying it
+    ring_buf_get(&sensor_data->data_ring_buf, NULL, num_samples * sensor_data->data_size);
+    ring_buf_get(&sensor_data->timestamp_ring_buf, NULL, num_samples * sensor_data->timestamp_size);
+    sensor_data->num_samples = stored_samples - num_samples;
+    if (sensor_data_config[sensor_data->id].type == PULSE_SENSOR)
+    {
+        reset_sensor_pulse_count(sensor_reading_configs[sensor_data->id]);
+    }
+    else if (sensor_data_config[sensor_data->id].type == QUADRATURE_SENSOR || sensor_data_config[sensor_data->id].type == PULSE_DIR_SENSOR)
+    {
+        reset_sensor_signed_count(sensor_reading_configs[sensor_data->id]);
     }
     return 0;
 }
@@ -404,4 +663,44 @@ int sensor_data_format_for_lorawan(sensor_data_t *sensor_data, uint8_t *data, ui
     }
     
     return 0;
-}
\ No newline at end of file
+}
+int sensor_data_pack_for_lorawan(sensor_data_t *sensor_data, uint8_t *data, uint16_t max_length, uint16_t *data_len, uint32_t *num_samples)
+{
+    *data_len = 0;
+    *num_samples = 0;
+    if (sensor_data->data_ring_buf.buffer == NULL || sensor_data->timestamp_ring_buf.buffer == NULL)
+    {
+        LOG_ERR("Sensor %d is not setup", sensor_data->id);
+        return -1;
+    }
+    size_t sample_size = sensor_data->timestamp_size + sensor_data->data_size;
+    uint32_t stored_samples = ring_buf_size_get(&sensor_data->data_ring_buf) / sensor_data->data_size;
+    uint32_t samples_to_pack = MIN(stored_samples, max_length / sample_size);
+    if (samples_to_pack == 0)
+    {
+        return 0;
+    }
+
+    // Peek only the oldest samples that fit, the rest stay in the buffer for the next uplink
+    uint8_t temp_data[samples_to_pack * sensor_data->data_size];
+    uint8_t temp_timestamp[samples_to_pack * sensor_data->timestamp_size];
+    if (ring_buf_peek(&sensor_data->data_ring_buf, temp_data, sizeof(temp_data)) != sizeof(temp_data) ||
+        ring_buf_peek(&sensor_data->timestamp_ring_buf, temp_timestamp, sizeof(temp_timestamp)) != sizeof(temp_timestamp))
+    {
+        LOG_ERR("Failed to peek samples from ring buffer");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < samples_to_pack; i++)
+    {
+        memcpy(data + (i * sample_size), temp_timestamp + (i * sensor_data->timestamp_size), sensor_data->timestamp_size);
+        memcpy(data + (i * sample_size) + sensor_data->timestamp_size, temp_data + (i * sensor_data->data_size), sensor_data->data_size);
+    }
+    *data_len = samples_to_pack * sample_size;
+    *num_samples = samples_to_pack;
+    if (samples_to_pack < stored_samples)
+    {
+        LOG_DBG("Packed %d of %d samples for sensor %d", samples_to_pack, stored_samples, sensor_data->id);
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file sensor_downlink.c
+ * @author Tyler Garcia
+ * @brief This is a library to parse downlink commands for remote configuration. A downlink is a sequence number
+ * followed by commands, each a type byte, a length byte and its value. Every command of a downlink is validated
+ * before any is applied, and the result is acknowledged with the sequence number in the next uplink.
+ * @version 0.1
+ * @date 2025-06-14
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "sensor_downlink.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(SENSOR_DOWNLINK, LOG_LEVEL_INF);
+
+/* Length of the type and length bytes of a command */
+#define COMMAND_HEADER_LENGTH   2
+
+/**
+ * @brief Get the settings of the sensor a command is for.
+ * 
+ * @param commands The commands of the downlink
+ * @param sensor_number The sensor number in the command, from 1
+ * @return sensor_downlink_sensor_t* The settings of the sensor, NULL if there is no such sensor
+ */
+static sensor_downlink_sensor_t *get_sensor(sensor_downlink_commands_t *commands, uint8_t sensor_number)
+{
+    if (sensor_number < 1 || sensor_number > SENSOR_DOWNLINK_MAX_SENSORS) {
+        LOG_ERR("Invalid sensor %d", sensor_number);
+        return NULL;
+    }
+    return &commands->sensors[sensor_number - 1];
+}
+
+/**
+ * @brief Parse and validate a single command.
+ * 
+ * @param type The type of the command
+ * @param value The value of the command
+ * @param length The length of the value
+ * @param commands The commands of the downlink to add it to
+ * @return enum sensor_downlink_status SENSOR_DOWNLINK_STATUS_OK if the command is valid
+ */
+static enum sensor_downlink_status parse_command(uint8_t type, const uint8_t *value, uint8_t length,
+    sensor_downlink_commands_t *commands)
+{
+    sensor_downlink_sensor_t *sensor = NULL;
+    switch (type) {
+        case SENSOR_DOWNLINK_SENSOR_ENABLED:
+        case SENSOR_DOWNLINK_SENSOR_TYPE:
+        case SENSOR_DOWNLINK_SENSOR_VOLTAGE:
+            if (length != 2) {
+                return SENSOR_DOWNLINK_STATUS_MALFORMED;
+            }
+            sensor = get_sensor(commands, value[0]);
+            break;
+        case SENSOR_DOWNLINK_SENSOR_INTERVAL:
+            if (length != 1 + sizeof(uint32_t)) {
+                return SENSOR_DOWNLINK_STATUS_MALFORMED;
+            }
+            sensor = get_sensor(commands, value[0]);
+            break;
+        case SENSOR_DOWNLINK_LORAWAN_INTERVAL:
+            if (length != sizeof(uint32_t)) {
+                return SENSOR_DOWNLINK_STATUS_MALFORMED;
+            }
+            break;
+        case SENSOR_DOWNLINK_LORAWAN_CONFIRMED:
+            if (length != 1) {
+                return SENSOR_DOWNLINK_STATUS_MALFORMED;
+            }
+            break;
+        case SENSOR_DOWNLINK_REBOOT:
+        case SENSOR_DOWNLINK_FLUSH:
+            if (length != 0) {
+                return SENSOR_DOWNLINK_STATUS_MALFORMED;
+            }
+            break;
+        default:
+            LOG_ERR("Unknown downlink command 0x%02x", type);
+            return SENSOR_DOWNLINK_STATUS_UNKNOWN_TYPE;
+    }
+    switch (type) {
+        case SENSOR_DOWNLINK_SENSOR_ENABLED:
+            if (sensor == NULL || value[1] > 1) {
+                return SENSOR_DOWNLINK_STATUS_INVALID_VALUE;
+            }
+            sensor->is_enabled = value[1];
+            sensor->set_fields |= SENSOR_DOWNLINK_SET_ENABLED;
+            break;
+        case SENSOR_DOWNLINK_SENSOR_TYPE:
+            if (sensor == NULL || value[1] >= SENSOR_TYPE_LIMIT) {
+                return SENSOR_DOWNLINK_STATUS_INVALID_VALUE;
+            }
+            sensor->type = value[1];
+            sensor->set_fields |= SENSOR_DOWNLINK_SET_TYPE;
+            break;
+        case SENSOR_DOWNLINK_SENSOR_VOLTAGE:
+            if (sensor == NULL || value[1] >= SENSOR_VOLTAGE_INDEX_LIMIT) {
+                return SENSOR_DOWNLINK_STATUS_INVALID_VALUE;
+            }
+            sensor->voltage = value[1];
+            sensor->set_fields |= SENSOR_DOWNLINK_SET_VOLTAGE;
+            break;
+        case SENSOR_DOWNLINK_SENSOR_INTERVAL:
+            if (sensor == NULL || sys_get_be32(&value[1]) == 0) {
+                return SENSOR_DOWNLINK_STATUS_INVALID_VALUE;
+            }
+            sensor->interval = sys_get_be32(&value[1]);
+            sensor->set_fields |= SENSOR_DOWNLINK_SET_INTERVAL;
+            break;
+        case SENSOR_DOWNLINK_LORAWAN_INTERVAL:
+            if (sys_get_be32(value) < SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL) {
+                return SENSOR_DOWNLINK_STATUS_INVALID_VALUE;
+            }
+            commands->lorawan_interval = sys_get_be32(value);
+            commands->is_lorawan_interval_set = 1;
+            break;
+        case SENSOR_DOWNLINK_LORAWAN_CONFIRMED:
+            if (value[0] > SENSOR_DOWNLINK_MAX_SEND_ATTEMPTS) {
+                return SENSOR_DOWNLINK_STATUS_INVALID_VALUE;
+            }
+            commands->send_attempts = value[0];
+            commands->is_send_attempts_set = 1;
+            break;
+        case SENSOR_DOWNLINK_REBOOT:
+            commands->is_reboot = 1;
+            break;
+        case SENSOR_DOWNLINK_FLUSH:
+            commands->is_flush = 1;
+            break;
+    }
+    return SENSOR_DOWNLINK_STATUS_OK;
+}
+
+int sensor_downlink_parse(const uint8_t *data, uint8_t length, sensor_downlink_commands_t *commands,
+    enum sensor_downlink_status *status)
+{
+    memset(commands, 0, sizeof(*commands));
+    if (length < 1) {
+        LOG_ERR("Downlink has no sequence number");
+        *status = SENSOR_DOWNLINK_STATUS_MALFORMED;
+        return -EINVAL;
+    }
+    commands->sequence = data[0];
+    uint16_t i = 1;
+    while (i < length) {
+        if (length - i < COMMAND_HEADER_LENGTH || data[i + 1] > length - i - COMMAND_HEADER_LENGTH) {
+            LOG_ERR("Downlink command at byte %d runs past the end", i);
+            *status = SENSOR_DOWNLINK_STATUS_MALFORMED;
+            return -EINVAL;
+        }
+        *status = parse_command(data[i], &data[i + COMMAND_HEADER_LENGTH], data[i + 1], commands);
+        if (*status != SENSOR_DOWNLINK_STATUS_OK) {
+            LOG_ERR("Downlink command 0x%02x rejected (%d)", data[i], *status);
+            return -EINVAL;
+        }
+        i += COMMAND_HEADER_LENGTH + data[i + 1];
+    }
+    *status = SENSOR_DOWNLINK_STATUS_OK;
+    return 0;
+}
+
+int sensor_downlink_has_config(const sensor_downlink_commands_t *commands)
+{
+    for (int i = 0; i < SENSOR_DOWNLINK_MAX_SENSORS; i++) {
+        if (commands->sensors[i].set_fields != 0) {
+            return 1;
+        }
+    }
+    return commands->is_lorawan_interval_set || commands->is_send_attempts_set;
+}
+
+int sensor_downlink_write_ack(uint8_t sequence, enum sensor_downlink_status status, uint8_t *data)
+{
+    data[0] = sequence;
+    data[1] = status;
+    return SENSOR_DOWNLINK_ACK_LENGTH;
+}
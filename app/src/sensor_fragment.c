@@ -0,0 +1,54 @@
+/**
+ * @file sensor_fragment.c
+ * @author Tyler Garcia
+ * @brief This is a library to split a backlog of samples that does not fit one uplink into self-describing
+ * fragments, sent on their own port and paced to respect the duty cycle.
+ * @version 0.1
+ * @date 2025-06-10
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "sensor_fragment.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(SENSOR_FRAGMENT, LOG_LEVEL_INF);
+
+int sensor_fragment_write_header(const sensor_fragment_header_t *header, uint8_t *data)
+{
+    if (header->channel & SENSOR_FRAGMENT_LAST_FLAG) {
+        LOG_ERR("Channel %d does not fit the fragment header", header->channel);
+        return -EINVAL;
+    }
+    data[0] = header->sequence;
+    data[1] = header->channel | (header->is_last ? SENSOR_FRAGMENT_LAST_FLAG : 0);
+    data[2] = (header->first_timestamp >> 24) & 0xFF;
+    data[3] = (header->first_timestamp >> 16) & 0xFF;
+    data[4] = (header->first_timestamp >> 8) & 0xFF;
+    data[5] = header->first_timestamp & 0xFF;
+    return SENSOR_FRAGMENT_HEADER_LENGTH;
+}
+
+int sensor_fragment_read_header(const uint8_t *data, uint16_t length, sensor_fragment_header_t *header)
+{
+    if (length < SENSOR_FRAGMENT_HEADER_LENGTH) {
+        LOG_ERR("Fragment of %d bytes is shorter than the header", length);
+        return -EINVAL;
+    }
+    header->sequence = data[0];
+    header->channel = data[1] & ~SENSOR_FRAGMENT_LAST_FLAG;
+    header->is_last = (data[1] & SENSOR_FRAGMENT_LAST_FLAG) ? 1 : 0;
+    header->first_timestamp = ((uint32_t)data[2] << 24) | ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 8) | data[5];
+    return 0;
+}
+
+uint32_t sensor_fragment_get_interval_ms(uint32_t time_on_air_us)
+{
+    /* The radio is off for the rest of the duty cycle period after each transmission */
+    uint64_t off_time_us = ((uint64_t)time_on_air_us * (100 - SENSOR_FRAGMENT_DUTY_CYCLE_PERCENT)) / SENSOR_FRAGMENT_DUTY_CYCLE_PERCENT;
+    uint32_t interval_ms = (uint32_t)MIN(off_time_us / 1000, UINT32_MAX);
+    return MAX(interval_ms, SENSOR_FRAGMENT_MIN_INTERVAL_MS);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file sensor_join.c
+ * @author Tyler Garcia
+ * @brief This is a library to schedule LoRaWAN join attempts. Failed attempts back off exponentially and the
+ * time on air of join requests is kept within the join duty cycle of the LoRaWAN specification.
+ * @version 0.1
+ * @date 2025-06-13
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "sensor_join.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(SENSOR_JOIN, LOG_LEVEL_INF);
+
+#define HOUR_MS     3600000ULL
+
+/* Windows of the join duty cycle from the first attempt */
+#define FIRST_WINDOW_MS             (1 * HOUR_MS)
+#define SECOND_WINDOW_MS            (10 * HOUR_MS)
+#define DAILY_WINDOW_MS             (24 * HOUR_MS)
+
+/* Time on air allowed in each window */
+#define FIRST_WINDOW_BUDGET_US      36000000
+#define SECOND_WINDOW_BUDGET_US     36000000
+#define DAILY_WINDOW_BUDGET_US      8700000
+
+/**
+ * @brief Get the duty cycle window for a time since the first attempt.
+ * 
+ * @param elapsed_ms Time since the first attempt in milliseconds
+ * @param end_ms End of the window since the first attempt in milliseconds
+ * @param budget_us Time on air allowed in the window in microseconds
+ * @return uint32_t The index of the window
+ */
+static uint32_t get_window(uint64_t elapsed_ms, uint64_t *end_ms, uint32_t *budget_us)
+{
+    if (elapsed_ms < FIRST_WINDOW_MS) {
+        *end_ms = FIRST_WINDOW_MS;
+        *budget_us = FIRST_WINDOW_BUDGET_US;
+        return 0;
+    }
+    if (elapsed_ms < FIRST_WINDOW_MS + SECOND_WINDOW_MS) {
+        *end_ms = FIRST_WINDOW_MS + SECOND_WINDOW_MS;
+        *budget_us = SECOND_WINDOW_BUDGET_US;
+        return 1;
+    }
+    uint64_t day = (elapsed_ms - FIRST_WINDOW_MS - SECOND_WINDOW_MS) / DAILY_WINDOW_MS;
+    *end_ms = FIRST_WINDOW_MS + SECOND_WINDOW_MS + ((day + 1) * DAILY_WINDOW_MS);
+    *budget_us = DAILY_WINDOW_BUDGET_US;
+    return 2 + (uint32_t)day;
+}
+
+/**
+ * @brief Get the exponential backoff after a number of failed attempts, with its jitter.
+ * 
+ * @param failed_attempts Consecutive failed attempts
+ * @param random A random number for the jitter
+ * @return uint64_t The backoff in milliseconds
+ */
+static uint64_t get_backoff_ms(uint32_t failed_attempts, uint32_t random)
+{
+    if (failed_attempts == 0) {
+        return 0;
+    }
+    uint64_t backoff_ms = SENSOR_JOIN_BACKOFF_MAX_MS;
+    /* Past this shift the base is above the maximum anyway */
+    if (failed_attempts <= 20) {
+        backoff_ms = MIN((uint64_t)SENSOR_JOIN_BACKOFF_BASE_MS << (failed_attempts - 1), SENSOR_JOIN_BACKOFF_MAX_MS);
+    }
+    uint64_t jitter_range_ms = (backoff_ms * SENSOR_JOIN_JITTER_PERCENT) / 100;
+    return backoff_ms + (random % (jitter_range_ms + 1));
+}
+
+int sensor_join_get_delay_ms(const sensor_join_backoff_t *backoff, uint64_t now_ms, uint32_t time_on_air_us,
+    uint32_t random, uint32_t *delay_ms)
+{
+    if (time_on_air_us > DAILY_WINDOW_BUDGET_US) {
+        LOG_ERR("Join time on air of %d us does not fit the duty cycle", time_on_air_us);
+        return -EINVAL;
+    }
+    uint64_t elapsed_ms = backoff->is_started ? now_ms - backoff->start_ms : 0;
+    uint64_t attempt_ms = elapsed_ms + get_backoff_ms(backoff->failed_attempts, random);
+    uint64_t window_end_ms;
+    uint32_t budget_us;
+    uint32_t window = get_window(attempt_ms, &window_end_ms, &budget_us);
+    uint32_t used_us = (backoff->is_started && window == backoff->window) ? backoff->window_time_on_air_us : 0;
+    if (used_us + time_on_air_us > budget_us) {
+        /* The next window starts with its full time on air */
+        LOG_WRN("Join duty cycle used up, waiting for the next window");
+        attempt_ms = window_end_ms;
+    }
+    *delay_ms = (uint32_t)MIN(attempt_ms - elapsed_ms, UINT32_MAX);
+    return 0;
+}
+
+void sensor_join_record_attempt(sensor_join_backoff_t *backoff, uint64_t now_ms, uint32_t time_on_air_us, uint8_t is_success)
+{
+    if (!backoff->is_started) {
+        backoff->is_started = 1;
+        backoff->start_ms = now_ms;
+        backoff->window = 0;
+        backoff->window_time_on_air_us = 0;
+    }
+    uint64_t window_end_ms;
+    uint32_t budget_us;
+    uint32_t window = get_window(now_ms - backoff->start_ms, &window_end_ms, &budget_us);
+    if (window != backoff->window) {
+        backoff->window = window;
+        backoff->window_time_on_air_us = 0;
+    }
+    backoff->window_time_on_air_us += time_on_air_us;
+    backoff->failed_attempts = is_success ? 0 : backoff->failed_attempts + 1;
+}
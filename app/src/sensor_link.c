@@ -0,0 +1,193 @@
+/**
+ * @file sensor_link.c
+ * @author Tyler Garcia
+ * @brief This is a library to choose the uplink data rate from the quality of the link. The SNR of downlinks and
+ * the margins of LinkCheckAns are combined into an estimate, and the fastest data rate with enough margin is used.
+ * Consecutive failed confirmed uplinks fall back to a slower data rate.
+ * @version 0.1
+ * @date 2025-06-12
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "sensor_link.h"
+#include "sensor_airtime.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(SENSOR_LINK, LOG_LEVEL_INF);
+
+/* Weight of the previous estimate against a new measurement, out of 4 */
+#define SNR_ESTIMATE_WEIGHT     3
+
+/* Estimated SNR of the link in tenths of a dB */
+static int16_t snr_estimate_db10;
+
+/* Whether the link has been measured since the last reset or fallback */
+static uint8_t is_measured;
+
+/* Data rate to send uplinks at */
+static enum lorawan_datarate link_datarate = SENSOR_LINK_DEFAULT_DATARATE;
+
+/* Consecutive failed confirmed uplinks */
+static uint8_t consecutive_failures;
+
+/* Uplinks since the link was last measured, starts due for a link check */
+static uint8_t uplinks_since_measurement = SENSOR_LINK_CHECK_INTERVAL;
+
+/* Uplinks since the last acknowledged uplink */
+static uint8_t uplinks_since_confirmed;
+
+/* Protects the estimate, it is reported from the LoRaWAN callbacks and read by the radio */
+static struct k_spinlock link_lock;
+
+/**
+ * @brief Get the SNR a data rate needs to be demodulated.
+ * 
+ * @param datarate The data rate
+ * @return int16_t The demodulation floor in tenths of a dB
+ */
+static int16_t get_demod_floor_db10(enum lorawan_datarate datarate)
+{
+    sensor_airtime_modulation_t modulation;
+    if (sensor_airtime_get_modulation(datarate, &modulation) < 0) {
+        return 0;
+    }
+    /* -7.5 dB at SF7, 2.5 dB lower for each step in spreading factor */
+    return -75 - ((modulation.spreading_factor - 7) * 25);
+}
+
+/**
+ * @brief Add a measurement of the SNR to the estimate and move to the fastest data rate with enough margin.
+ * Faster data rates are stepped up to one at a time, slower data rates are moved to right away. The lock must be held.
+ * 
+ * @param snr_db10 The measured SNR in tenths of a dB
+ */
+static void update_estimate(int16_t snr_db10)
+{
+    if (!is_measured) {
+        snr_estimate_db10 = snr_db10;
+        is_measured = 1;
+    }
+    else {
+        snr_estimate_db10 = ((snr_estimate_db10 * SNR_ESTIMATE_WEIGHT) + snr_db10) / (SNR_ESTIMATE_WEIGHT + 1);
+    }
+    uplinks_since_measurement = 0;
+    enum lorawan_datarate best_datarate = SENSOR_LINK_MIN_DATARATE;
+    for (enum lorawan_datarate dr = SENSOR_LINK_MIN_DATARATE; dr <= SENSOR_LINK_MAX_DATARATE; dr++) {
+        if (snr_estimate_db10 - get_demod_floor_db10(dr) >= SENSOR_LINK_MARGIN_DB10) {
+            best_datarate = dr;
+        }
+    }
+    if (best_datarate > link_datarate) {
+        link_datarate++;
+    }
+    else if (best_datarate < link_datarate) {
+        link_datarate = best_datarate;
+    }
+}
+
+void sensor_link_report_downlink(int16_t rssi, int8_t snr)
+{
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+    update_estimate(snr * 10);
+    enum lorawan_datarate datarate = link_datarate;
+    k_spin_unlock(&link_lock, key);
+    LOG_DBG("Downlink RSSI %d dBm, SNR %d dB, DR%d", rssi, snr, datarate);
+}
+
+void sensor_link_report_link_check(uint8_t demod_margin, uint8_t nb_gateways)
+{
+    if (nb_gateways == 0) {
+        return;
+    }
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+    update_estimate(get_demod_floor_db10(link_datarate) + (demod_margin * 10));
+    enum lorawan_datarate datarate = link_datarate;
+    k_spin_unlock(&link_lock, key);
+    LOG_INF("Link check margin %d dB from %d gateways, DR%d", demod_margin, nb_gateways, datarate);
+}
+
+void sensor_link_report_uplink(uint8_t is_confirmed, uint8_t is_success)
+{
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+    if (uplinks_since_measurement < UINT8_MAX) {
+        uplinks_since_measurement++;
+    }
+    if (is_confirmed && is_success) {
+        uplinks_since_confirmed = 0;
+    }
+    else if (uplinks_since_confirmed < UINT8_MAX) {
+        uplinks_since_confirmed++;
+    }
+    if (!is_confirmed) {
+        k_spin_unlock(&link_lock, key);
+        return;
+    }
+    if (is_success) {
+        consecutive_failures = 0;
+        k_spin_unlock(&link_lock, key);
+        return;
+    }
+    consecutive_failures++;
+    if (consecutive_failures >= SENSOR_LINK_MAX_FAILURES) {
+        /* The estimate led to a data rate that does not get through, it has to be measured again */
+        consecutive_failures = 0;
+        is_measured = 0;
+        if (link_datarate > SENSOR_LINK_MIN_DATARATE) {
+            link_datarate--;
+        }
+        LOG_WRN("%d confirmed uplinks failed, falling back to DR%d", SENSOR_LINK_MAX_FAILURES, link_datarate);
+    }
+    k_spin_unlock(&link_lock, key);
+}
+
+enum lorawan_datarate sensor_link_get_datarate(void)
+{
+    return link_datarate;
+}
+
+int sensor_link_get_snr(int16_t *snr_db10)
+{
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+    if (!is_measured) {
+        k_spin_unlock(&link_lock, key);
+        return -EAGAIN;
+    }
+    *snr_db10 = snr_estimate_db10;
+    k_spin_unlock(&link_lock, key);
+    return 0;
+}
+
+int sensor_link_needs_link_check(void)
+{
+    return uplinks_since_measurement >= SENSOR_LINK_CHECK_INTERVAL;
+}
+
+int sensor_link_needs_confirmed(uint8_t is_critical)
+{
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+    uint8_t is_link_lost = (consecutive_failures > 0)
+        || (uplinks_since_measurement >= SENSOR_LINK_CHECK_INTERVAL + SENSOR_LINK_LOSS_UPLINKS);
+    uint8_t is_check_due = uplinks_since_confirmed >= SENSOR_LINK_CONFIRMED_INTERVAL;
+    k_spin_unlock(&link_lock, key);
+    if (is_link_lost) {
+        LOG_WRN("Link shows signs of loss, sending confirmed");
+    }
+    return is_critical || is_link_lost || is_check_due;
+}
+
+void sensor_link_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&link_lock);
+    snr_estimate_db10 = 0;
+    is_measured = 0;
+    link_datarate = SENSOR_LINK_DEFAULT_DATARATE;
+    consecutive_failures = 0;
+    uplinks_since_measurement = SENSOR_LINK_CHECK_INTERVAL;
+    /* The join accept has just been received, so delivery does not need checking yet */
+    uplinks_since_confirmed = 0;
+    k_spin_unlock(&link_lock, key);
+}
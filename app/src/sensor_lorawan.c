@@ -10,15 +10,100 @@
  */
 
 #include "sensor_lorawan.h"
+#include "sensor_airtime.h"
+#include "sensor_link.h"
+#include "sensor_join.h"
+#include "sensor_budget.h"
 #include <zephyr/lorawan/lorawan.h>
+#include <LoRaMac.h>
+#include <utilities.h>
+#include <string.h>
 #include <errno.h>
 #include <zephyr/kernel.h>
+#include <zephyr/random/random.h>
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER(SENSOR_LORAWAN, LOG_LEVEL_INF);
 
 static int lorawan_connection_status = 0;
 
+/* Highest data rate uplinks can be sent at, the data rate from the link quality is capped to it */
+static enum lorawan_datarate max_datarate = LORAWAN_DR_3;
+
+/* Time on air of the last uplink, used to pace the uplinks that follow it */
+static uint32_t last_time_on_air_us;
+
+/* Time on air of every transmission over the rolling 24 hours */
+static sensor_budget_t airtime_budget;
+
+/* Protects the airtime budget, it is recorded by the radio and read by the app and BLE */
+static struct k_spinlock airtime_lock;
+
+/* Stack size of the join thread, joining runs the LoRaWAN stack */
+#define JOIN_STACKSIZE          4096
+
+/* Priority of the join thread, the same as the radio thread */
+#define JOIN_THREAD_PRIORITY    5
+
+/* Events posted when a background join is complete */
+#define JOIN_EVENT_JOINED       BIT(0)
+#define JOIN_EVENT_FAILED       BIT(1)
+
+K_EVENT_DEFINE(join_events);
+
+/* Given to start a background join */
+K_SEM_DEFINE(join_sem, 0, 1);
+
+/* Whether a background join is running */
+static atomic_t is_joining;
+
+/* Setup of the background join */
+static lorawan_setup_t *join_setup;
+
+/* Backoff and duty cycle of the join attempts since the reset */
+static sensor_join_backoff_t join_backoff;
+
+/**
+ * @brief Report the SNR of every downlink to the link quality estimate.
+ * 
+ */
+static void link_downlink_callback(uint8_t port, uint8_t flags, int16_t rssi, int8_t snr, uint8_t len, const uint8_t *data)
+{
+	sensor_link_report_downlink(rssi, snr);
+}
+
+static struct lorawan_downlink_cb link_downlink_cb = {
+	.port = LW_RECV_PORT_ANY,
+	.cb = link_downlink_callback,
+};
+
+/* Whether the link callbacks have been registered */
+static uint8_t is_link_callback_registered = 0;
+
+/* Whether the downlink callback of the setup has been registered */
+static uint8_t is_downlink_callback_registered = 0;
+
+/**
+ * @brief Report the margin of every LinkCheckAns to the link quality estimate.
+ * 
+ */
+static void link_check_ans_callback(uint8_t demod_margin, uint8_t nb_gateways, int16_t rssi, int8_t snr)
+{
+	sensor_link_report_link_check(demod_margin, nb_gateways);
+}
+
+/* Whether a DeviceTimeAns has been received since the network time was last requested */
+static atomic_t is_device_time_received;
+
+/**
+ * @brief Mark that a DeviceTimeAns was received, the stack keeps its GPS time only while this is set.
+ * 
+ */
+static void device_time_callback(void)
+{
+	atomic_set(&is_device_time_received, 1);
+}
+
 /**
  * @brief Check if the lorawan is configured. If it is, setup the join config object.
  * 
@@ -75,11 +160,142 @@ void sensor_lorawan_log_network_config(lorawan_setup_t *setup)
 		setup->app_key[12],setup->app_key[13],setup->app_key[14],setup->app_key[15]);
 }
 
+/**
+ * @brief Get the LoRaMAC context, which holds the session keys and frame counters.
+ * 
+ * @return LoRaMacNvmData_t* The context, NULL if it could not be read
+ */
+static LoRaMacNvmData_t *get_mac_context(void)
+{
+	MibRequestConfirm_t mib_req;
+	mib_req.Type = MIB_NVM_CTXS;
+	if (LoRaMacMibGetRequestConfirm(&mib_req) != LORAMAC_STATUS_OK) {
+		LOG_ERR("Failed to get the LoRaMAC context");
+		return NULL;
+	}
+	return mib_req.Param.Contexts;
+}
+
+BUILD_ASSERT(SENSOR_LORAWAN_CHANNELS_MASK_SIZE >= REGION_NVM_CHANNELS_MASK_SIZE,
+	"The session channel mask must hold the channel mask of the region");
+
+/* Copy of the LoRaMAC context the frame counters are restored through, too large for the stack */
+static LoRaMacNvmData_t restored_context;
+
+/**
+ * @brief Restore the receive window and channel parameters of a session, the ones the LoRaMAC has a MIB for.
+ * 
+ * @param mac_params The receive window and channel parameters
+ * @return int 0 if successful, -EIO if a parameter could not be set
+ */
+static int restore_mac_params(const lorawan_mac_params_t *mac_params)
+{
+	MibRequestConfirm_t mib_req;
+	LoRaMacStatus_t status;
+	mib_req.Type = MIB_RECEIVE_DELAY_1;
+	mib_req.Param.ReceiveDelay1 = mac_params->rx1_delay;
+	status = LoRaMacMibSetRequestConfirm(&mib_req);
+	// The second receive window always opens a second after the first
+	mib_req.Type = MIB_RECEIVE_DELAY_2;
+	mib_req.Param.ReceiveDelay2 = mac_params->rx1_delay + 1000;
+	status |= LoRaMacMibSetRequestConfirm(&mib_req);
+	mib_req.Type = MIB_RX2_CHANNEL;
+	mib_req.Param.Rx2Channel.Frequency = mac_params->rx2_frequency;
+	mib_req.Param.Rx2Channel.Datarate = mac_params->rx2_datarate;
+	status |= LoRaMacMibSetRequestConfirm(&mib_req);
+	// Class C listens on the parameters of the second receive window
+	mib_req.Type = MIB_RXC_CHANNEL;
+	mib_req.Param.RxCChannel.Frequency = mac_params->rx2_frequency;
+	mib_req.Param.RxCChannel.Datarate = mac_params->rx2_datarate;
+	status |= LoRaMacMibSetRequestConfirm(&mib_req);
+	mib_req.Type = MIB_CHANNELS_MASK;
+	mib_req.Param.ChannelsMask = (uint16_t *)mac_params->channels_mask;
+	status |= LoRaMacMibSetRequestConfirm(&mib_req);
+	if (status != LORAMAC_STATUS_OK) {
+		LOG_ERR("Failed to restore the receive parameters");
+		return -EIO;
+	}
+	return 0;
+}
+
+/**
+ * @brief Restore the frame counters and the data rate offset of the first receive window of a session. The LoRaMAC 
+ * has no MIB for these, so they are set in a copy of its context that the LoRaMAC validates and restores.
+ * 
+ * @param session The session
+ * @return int 0 if successful, -EIO if the context could not be read or restored, -EBUSY if the LoRaMAC is busy
+ */
+static int restore_mac_context(const lorawan_session_t *session)
+{
+	LoRaMacNvmData_t *nvm = get_mac_context();
+	if (nvm == NULL) {
+		return -EIO;
+	}
+	memcpy(&restored_context, nvm, sizeof(restored_context));
+	restored_context.Crypto.FCntList.FCntUp = session->fcnt_up;
+	restored_context.Crypto.FCntList.FCntDown = session->fcnt_down;
+	restored_context.MacGroup2.MacParams.Rx1DrOffset = session->mac_params.rx1_dr_offset;
+	// Only the groups with a valid CRC are restored, the groups that were not changed are kept as they are
+	restored_context.Crypto.Crc32 = Crc32((uint8_t *)&restored_context.Crypto, 
+		sizeof(restored_context.Crypto) - sizeof(restored_context.Crypto.Crc32));
+	restored_context.MacGroup2.Crc32 = Crc32((uint8_t *)&restored_context.MacGroup2, 
+		sizeof(restored_context.MacGroup2) - sizeof(restored_context.MacGroup2.Crc32));
+	// The context can only be restored while the LoRaMAC is stopped
+	if (LoRaMacStop() != LORAMAC_STATUS_OK) {
+		LOG_ERR("LoRaMAC is busy");
+		return -EBUSY;
+	}
+	MibRequestConfirm_t mib_req;
+	mib_req.Type = MIB_NVM_CTXS;
+	mib_req.Param.Contexts = &restored_context;
+	LoRaMacStatus_t status = LoRaMacMibSetRequestConfirm(&mib_req);
+	LoRaMacStart();
+	if (status != LORAMAC_STATUS_OK) {
+		LOG_ERR("Failed to restore the LoRaMAC context (%d)", status);
+		return -EIO;
+	}
+	return 0;
+}
+
+/**
+ * @brief Restore the session of the last join, activating with its keys and continuing from its frame counters 
+ * and receive parameters.
+ * 
+ * @param setup setup configuration holding the session
+ * @return int 0 if successful, < 0 if failed
+ */
+static int restore_session(lorawan_setup_t *setup)
+{
+	struct lorawan_join_config join_cfg = {
+		.mode = LORAWAN_ACT_ABP,
+		.dev_eui = setup->dev_eui,
+		.abp = {
+			.dev_addr = setup->session.dev_addr,
+			.app_skey = setup->session.app_skey,
+			.nwk_skey = setup->session.nwk_skey,
+			.app_eui = setup->join_eui,
+		},
+	};
+	int ret = lorawan_join(&join_cfg);
+	if (ret < 0) {
+		return ret;
+	}
+	ret = restore_mac_params(&setup->session.mac_params);
+	if (ret < 0) {
+		return ret;
+	}
+	return restore_mac_context(&setup->session);
+}
+
 int sensor_lorawan_setup(lorawan_setup_t *setup)
 {
 	const struct device *lora_dev = DEVICE_DT_GET(DT_ALIAS(lora0));
 	int ret;
 	
+	if (atomic_get(&is_joining)) {
+		LOG_INF("LoRaWAN join already in progress");
+		return -EINPROGRESS;
+	}
 	if (!device_is_ready(lora_dev)) {
 		LOG_ERR("%s: device not ready.", lora_dev->name);
 		return -1;
@@ -95,9 +311,18 @@ int sensor_lorawan_setup(lorawan_setup_t *setup)
 	if (ret < 0) {
 		return ret;
 	}
-	// Setup downlink callback if there is one
-	if (setup->downlink_callback.cb != NULL) {
+	// Setup downlink callback if there is one, registered once like the link callbacks
+	if (setup->downlink_callback.cb != NULL && !is_downlink_callback_registered) {
 		lorawan_register_downlink_callback(&setup->downlink_callback);
+		is_downlink_callback_registered = 1;
+	}
+	// Measure the link from every downlink and link check to choose the data rate, registered once as
+	// the downlink callbacks are kept in a list
+	if (!is_link_callback_registered) {
+		lorawan_register_downlink_callback(&link_downlink_cb);
+		lorawan_register_link_check_ans_callback(link_check_ans_callback);
+		lorawan_register_dt_callback(device_time_callback);
+		is_link_callback_registered = 1;
 	}
 	// Set the uplink class, default to A
 	ret = lorawan_set_class(setup->uplink_class);
@@ -105,36 +330,148 @@ int sensor_lorawan_setup(lorawan_setup_t *setup)
 		LOG_ERR("Failed to set class");
 		return ret;
 	}
+	k_event_clear(&join_events, JOIN_EVENT_JOINED | JOIN_EVENT_FAILED);
+	// Restore the session of the last join instead of joining again
+	setup->is_session_restored = 0;
+	if (setup->is_session_valid) {
+		ret = restore_session(setup);
+		if (ret == 0) {
+			LOG_INF("LoRaWAN session restored, DevAddr: 0x%08x, FCntUp: %d", setup->session.dev_addr, setup->session.fcnt_up);
+			setup->is_session_restored = 1;
+			lorawan_connection_status = 1;
+			k_event_post(&join_events, JOIN_EVENT_JOINED);
+			return 0;
+		}
+		LOG_WRN("Failed to restore LoRaWAN session (%d), joining", ret);
+		setup->is_session_valid = 0;
+	}
+	// Join in the background, the join thread posts the result
+	join_setup = setup;
+	atomic_set(&is_joining, 1);
+	k_sem_give(&join_sem);
+	return -EINPROGRESS;
+}
+
+int sensor_lorawan_wait_joined(k_timeout_t timeout)
+{
+	uint32_t events = k_event_wait(&join_events, JOIN_EVENT_JOINED | JOIN_EVENT_FAILED, false, timeout);
+	if (events & JOIN_EVENT_JOINED) {
+		return 0;
+	}
+	if (events & JOIN_EVENT_FAILED) {
+		return -ENOTCONN;
+	}
+	return -EAGAIN;
+}
 
-	int i = 0;
+/**
+ * @brief Reserve a new block of nonces when the next nonce is not reserved yet, so a nonce is never used before 
+ * it is stored.
+ * 
+ * @param setup setup configuration used to join lorawan network
+ * @return int 0 if successful, -ENOSPC if the nonces are used up, < 0 if the block could not be stored
+ */
+static int reserve_dev_nonce(lorawan_setup_t *setup)
+{
+	if (setup->dev_nonce < setup->dev_nonce_reserved || setup->store_dev_nonce == NULL) {
+		return 0;
+	}
+	if (setup->dev_nonce == UINT16_MAX) {
+		LOG_ERR("Dev nonces are used up");
+		return -ENOSPC;
+	}
+	uint16_t reserved = MIN((uint32_t)setup->dev_nonce + SENSOR_JOIN_NONCE_BLOCK, UINT16_MAX);
+	int ret = setup->store_dev_nonce(reserved);
+	if (ret < 0) {
+		LOG_ERR("Failed to reserve dev nonces (%d)", ret);
+		return ret;
+	}
+	setup->dev_nonce_reserved = reserved;
+	return 0;
+}
+
+/**
+ * @brief Join the network, waiting the backoff and join duty cycle before each attempt.
+ * 
+ * @param setup setup configuration used to join lorawan network
+ * @return int 0 if joined, < 0 if all attempts failed
+ */
+static int join_network(lorawan_setup_t *setup)
+{
+	struct lorawan_join_config join_cfg;
+	sensor_airtime_modulation_t modulation;
+	uint32_t time_on_air_us;
+	uint32_t delay_ms;
+	int ret;
+	if (get_lorawan_config(setup, &join_cfg) < 0) {
+		return -EINVAL;
+	}
+	ret = sensor_airtime_get_modulation(SENSOR_JOIN_DATARATE, &modulation);
+	if (ret == 0) {
+		ret = sensor_airtime_get_time_on_air_us(&modulation, SENSOR_JOIN_REQUEST_LENGTH, &time_on_air_us);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+	ret = -ETIMEDOUT;
 	// Join the network, if join_attempts is 0, it will join indefinitely
-	while (setup->join_attempts == 0 || i < setup->join_attempts) {
-		i++;
+	for (int i = 1; setup->join_attempts == 0 || i <= setup->join_attempts; i++) {
+		if (sensor_join_get_delay_ms(&join_backoff, k_uptime_get(), time_on_air_us, sys_rand32_get(), &delay_ms) < 0) {
+			return -EINVAL;
+		}
+		if (delay_ms > 0) {
+			LOG_INF("Next join attempt in %d s", delay_ms / 1000);
+			k_msleep(delay_ms);
+		}
+		ret = reserve_dev_nonce(setup);
+		if (ret < 0) {
+			return ret;
+		}
+		join_cfg.otaa.dev_nonce = setup->dev_nonce;
 		LOG_INF("Join Attempt %d: Dev Nonce: %d", i, join_cfg.otaa.dev_nonce);
 		ret = lorawan_join(&join_cfg);
-		join_cfg.otaa.dev_nonce++;
-		if (ret < 0) {
-			if ((ret =-ETIMEDOUT)) {
-				LOG_WRN("Timed-out waiting for response.");
-			} else {
-				LOG_ERR("Join failed (%d)", ret);
-			}
+		// The nonce is used whether or not the join succeeds
+		setup->dev_nonce++;
+		sensor_join_record_attempt(&join_backoff, k_uptime_get(), time_on_air_us, ret == 0);
+		if (ret == 0) {
+			LOG_INF("Join successful.");
+			return 0;
+		}
+		if (ret == -ETIMEDOUT) {
+			LOG_WRN("Timed-out waiting for response.");
 		} else {
-			LOG_INF("Join successful."); //Changed
-			break;
+			LOG_ERR("Join failed (%d)", ret);
 		}
 	}
-	// Save the dev_nonce for the next join
-	setup->dev_nonce = join_cfg.otaa.dev_nonce;
-	if (ret < 0) {
-		LOG_ERR("Failed to join LoRaWAN");
-		return ret;
+	return ret;
+}
+
+static void join_thread_entry(void *p1, void *p2, void *p3)
+{
+	while (1) {
+		k_sem_take(&join_sem, K_FOREVER);
+		lorawan_setup_t *setup = join_setup;
+		int ret = join_network(setup);
+		if (ret == 0) {
+			LOG_INF("LoRaWAN joined");
+			// Keep the new session so the next setup can restore it
+			setup->is_session_valid = sensor_lorawan_get_session(&setup->session) == 0;
+			// A new session starts from the default data rate until the link is measured
+			sensor_link_reset();
+			lorawan_connection_status = 1;
+		} else {
+			LOG_ERR("Failed to join LoRaWAN (%d)", ret);
+		}
+		atomic_clear(&is_joining);
+		if (setup->join_callback != NULL) {
+			setup->join_callback(ret);
+		}
+		k_event_post(&join_events, ret == 0 ? JOIN_EVENT_JOINED : JOIN_EVENT_FAILED);
 	}
-	LOG_INF("LoRaWAN joined");
-	lorawan_connection_status = 1;
-	return 0;
 }
 
+K_THREAD_DEFINE(join_thread, JOIN_STACKSIZE, join_thread_entry, NULL, NULL, NULL, JOIN_THREAD_PRIORITY, 0, 0);
+
 /**
  * @brief Reset the data to be sent after each lorawan_send_data call.
  * 
@@ -147,41 +484,115 @@ static void reset_data(lorawan_data_t *data)
 	data->length = 0;
 }
 
-static int set_datarate(uint8_t payload_length)
+/**
+ * @brief Get the data rate chosen from the link quality, capped to the max data rate.
+ * 
+ * @return enum lorawan_datarate the data rate
+ */
+static enum lorawan_datarate get_link_datarate(void)
 {
-	if(payload_length > 125)
-	{
-		lorawan_set_datarate(LORAWAN_DR_3);
-		return 0;
-	}
-	else if(payload_length > 53)
-	{
-		lorawan_set_datarate(LORAWAN_DR_2);
-		return 0;
-	}
-	else if(payload_length > 11)
-	{
-		lorawan_set_datarate(LORAWAN_DR_1);
-		return 0;
+	return MIN(sensor_link_get_datarate(), max_datarate);
+}
+
+/**
+ * @brief Set the data rate chosen from the link quality. A payload that does not fit it is sent at the
+ * slowest faster data rate, up to the max data rate, that fits it. 
+ * 
+ * @param payload_length length of the application payload
+ * @param datarate the data rate that was set
+ * @return int 0 if successful, -EMSGSIZE if the payload does not fit any allowed data rate
+ */
+static int set_datarate(uint16_t payload_length, enum lorawan_datarate *datarate)
+{
+	uint16_t max_payload;
+	for (enum lorawan_datarate dr = get_link_datarate(); dr <= max_datarate; dr++) {
+		if (sensor_airtime_get_max_payload(dr, &max_payload) == 0 && payload_length <= max_payload) {
+			*datarate = dr;
+			return lorawan_set_datarate(dr);
+		}
 	}
-	else
-	{
-		lorawan_set_datarate(LORAWAN_DR_0);
-		return 0;
+	LOG_ERR("Payload of %d bytes does not fit up to DR%d", payload_length, max_datarate);
+	return -EMSGSIZE;
+}
+
+int sensor_lorawan_set_max_datarate(enum lorawan_datarate datarate)
+{
+	if (datarate > SENSOR_AIRTIME_MAX_DATARATE) {
+		LOG_ERR("DR%d is not a valid uplink data rate", datarate);
+		return -EINVAL;
 	}
+	max_datarate = datarate;
+	return 0;
+}
+
+int sensor_lorawan_get_max_payload(uint16_t *max_payload)
+{
+	return sensor_airtime_get_max_payload(get_link_datarate(), max_payload);
+}
+
+/**
+ * @brief Record the time on air of a transmission in the airtime budget. Failed sends are counted too, as they 
+ * are usually a confirmed uplink that was sent but not acknowledged.
+ * 
+ * @param time_on_air_us Time on air of the transmission in microseconds
+ */
+static void record_airtime(uint32_t time_on_air_us)
+{
+	k_spinlock_key_t key = k_spin_lock(&airtime_lock);
+	sensor_budget_record(&airtime_budget, k_uptime_get(), time_on_air_us);
+	k_spin_unlock(&airtime_lock, key);
 }
 
 int sensor_lorawan_send_data(lorawan_data_t *lorawan_data)
 {
 	int ret;
+	enum lorawan_datarate datarate;
+	uint32_t time_on_air_us;
+	lorawan_data->is_acked = 0;
 	if (lorawan_data->length == 0) {
 		return -1;
 	}
-	set_datarate(lorawan_data->length);
+	ret = set_datarate(lorawan_data->length, &datarate);
+	if (ret < 0) {
+		reset_data(lorawan_data);
+		return ret;
+	}
+	ret = sensor_airtime_get_uplink_time_on_air_us(datarate, lorawan_data->length, &time_on_air_us);
+	if (ret < 0) {
+		reset_data(lorawan_data);
+		return ret;
+	}
+	last_time_on_air_us = time_on_air_us;
+	LOG_INF("Uplink of %d bytes at DR%d, %d ms on air", lorawan_data->length, datarate, time_on_air_us / 1000);
+	// Send unconfirmed unless the data is critical or the link policy asks to check delivery
+	if (lorawan_data->attempts > 0 && !sensor_link_needs_confirmed(lorawan_data->is_critical)) {
+		lorawan_data->attempts = 0;
+	}
+	// Keep within the airtime budget, dropping confirmations first and refusing uplinks that do not fit
+	uint32_t defer_ms = 0;
+	k_spinlock_key_t key = k_spin_lock(&airtime_lock);
+	enum sensor_budget_level budget_level = sensor_budget_get_level(&airtime_budget, k_uptime_get(), time_on_air_us);
+	sensor_budget_get_delay_ms(&airtime_budget, k_uptime_get(), time_on_air_us, &defer_ms);
+	k_spin_unlock(&airtime_lock, key);
+	if (budget_level == SENSOR_BUDGET_LEVEL_DEFER) {
+		LOG_WRN("Uplink does not fit the airtime budget for another %d s, deferring it", defer_ms / 1000);
+		reset_data(lorawan_data);
+		return -EAGAIN;
+	}
+	if (budget_level >= SENSOR_BUDGET_LEVEL_UNCONFIRMED && lorawan_data->attempts > 0) {
+		LOG_WRN("Airtime budget low, sending unconfirmed");
+		lorawan_data->attempts = 0;
+	}
+	// Measure the link with the uplink when no downlink has measured it for a while
+	if (sensor_link_needs_link_check()) {
+		lorawan_request_link_check(false);
+	}
 	if(lorawan_data->attempts == 0)
 	{
 		LOG_INF("Sending unconfirmed data");
 		ret = lorawan_send(lorawan_data->port, lorawan_data->data, lorawan_data->length, LORAWAN_MSG_UNCONFIRMED);
+		record_airtime(time_on_air_us);
+		sensor_link_report_uplink(0, ret == 0);
 		reset_data(lorawan_data);
 		return 0;
 	}
@@ -192,12 +603,15 @@ int sensor_lorawan_send_data(lorawan_data_t *lorawan_data)
 		{
 			LOG_INF("Attempt %d", i);
 			ret = lorawan_send(lorawan_data->port, lorawan_data->data, lorawan_data->length, LORAWAN_MSG_CONFIRMED);
+			record_airtime(time_on_air_us);
+			sensor_link_report_uplink(1, ret == 0);
 			if (ret < 0) {
 				LOG_ERR("Failed to send data with error %d", ret);
 				k_msleep(lorawan_data->delay);
 				continue;
 			} else {
 				LOG_INF("Data sent successfully");
+				lorawan_data->is_acked = 1;
 				reset_data(lorawan_data);
 				return 0; // This means ack was received
 			}
@@ -213,6 +627,89 @@ int sensor_lorawan_send_data(lorawan_data_t *lorawan_data)
 }
 
 
+int sensor_lorawan_get_last_time_on_air_us(uint32_t *time_on_air_us)
+{
+	*time_on_air_us = last_time_on_air_us;
+	return 0;
+}
+
+enum sensor_budget_level sensor_lorawan_get_budget_level(void)
+{
+	uint16_t max_payload;
+	uint32_t time_on_air_us = 0;
+	enum lorawan_datarate datarate = get_link_datarate();
+	if (sensor_airtime_get_max_payload(datarate, &max_payload) == 0) {
+		sensor_airtime_get_uplink_time_on_air_us(datarate, max_payload, &time_on_air_us);
+	}
+	k_spinlock_key_t key = k_spin_lock(&airtime_lock);
+	enum sensor_budget_level level = sensor_budget_get_level(&airtime_budget, k_uptime_get(), time_on_air_us);
+	k_spin_unlock(&airtime_lock, key);
+	return level;
+}
+
+int sensor_lorawan_get_airtime(uint32_t *used_us, enum sensor_budget_level *level)
+{
+	*level = sensor_lorawan_get_budget_level();
+	k_spinlock_key_t key = k_spin_lock(&airtime_lock);
+	*used_us = sensor_budget_get_used_us(&airtime_budget, k_uptime_get());
+	k_spin_unlock(&airtime_lock, key);
+	return 0;
+}
+
+int sensor_lorawan_get_session(lorawan_session_t *session)
+{
+	LoRaMacNvmData_t *nvm = get_mac_context();
+	if (nvm == NULL) {
+		return -EIO;
+	}
+	uint8_t found_keys = 0;
+	for (int i = 0; i < ARRAY_SIZE(nvm->SecureElement.KeyList); i++) {
+		// LoRaWAN 1.0.x uses the same key for all the network session keys
+		if (nvm->SecureElement.KeyList[i].KeyID == NWK_S_ENC_KEY) {
+			memcpy(session->nwk_skey, nvm->SecureElement.KeyList[i].KeyValue, sizeof(session->nwk_skey));
+			found_keys |= BIT(0);
+		} else if (nvm->SecureElement.KeyList[i].KeyID == APP_S_KEY) {
+			memcpy(session->app_skey, nvm->SecureElement.KeyList[i].KeyValue, sizeof(session->app_skey));
+			found_keys |= BIT(1);
+		}
+	}
+	if (found_keys != (BIT(0) | BIT(1))) {
+		LOG_ERR("Session keys not found");
+		return -ENOENT;
+	}
+	session->dev_addr = nvm->MacGroup2.DevAddr;
+	session->fcnt_up = nvm->Crypto.FCntList.FCntUp;
+	// LoRaWAN 1.0.x keeps a single downlink frame counter
+	session->fcnt_down = nvm->Crypto.FCntList.FCntDown;
+	session->mac_params.rx1_delay = nvm->MacGroup2.MacParams.ReceiveDelay1;
+	session->mac_params.rx2_frequency = nvm->MacGroup2.MacParams.Rx2Channel.Frequency;
+	session->mac_params.rx2_datarate = nvm->MacGroup2.MacParams.Rx2Channel.Datarate;
+	session->mac_params.rx1_dr_offset = nvm->MacGroup2.MacParams.Rx1DrOffset;
+	memset(session->mac_params.channels_mask, 0, sizeof(session->mac_params.channels_mask));
+	memcpy(session->mac_params.channels_mask, nvm->RegionGroup2.ChannelsMask, sizeof(nvm->RegionGroup2.ChannelsMask));
+	return 0;
+}
+
 int is_lorawan_connected(void) {
 	return lorawan_connection_status;
+}
+
+int sensor_lorawan_request_time(void)
+{
+	atomic_clear(&is_device_time_received);
+	int ret = lorawan_request_device_time(false);
+	if (ret < 0) {
+		LOG_ERR("Failed to request device time (%d)", ret);
+		return ret;
+	}
+	return 0;
+}
+
+int sensor_lorawan_get_gps_time(uint32_t *gps_time)
+{
+	// The stack returns its clock whether or not the network answered, which runs from 0 until it does
+	if (!atomic_get(&is_device_time_received)) {
+		return -EAGAIN;
+	}
+	return lorawan_device_time_get(gps_time);
 }
\ No newline at end of file
@@ -30,6 +30,9 @@ const char *sensor_type_names[] = {
     [VOLTAGE_SENSOR] = "VOLTAGE_SENSOR",
     [CURRENT_SENSOR] = "CURRENT_SENSOR",
     [PULSE_SENSOR]   = "PULSE_SENSOR",
+    [QUADRATURE_SENSOR] = "QUADRATURE_SENSOR",
+    [PULSE_DIR_SENSOR]  = "PULSE_DIR_SENSOR",
+    [FREQUENCY_SENSOR]  = "FREQUENCY_SENSOR",
 };
 
 int get_sensor_voltage_name_from_index(char * voltage_name, enum sensor_voltage voltage)
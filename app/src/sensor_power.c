@@ -16,6 +16,7 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/regulator.h>
 #include <zephyr/drivers/adc.h>
+#include <zephyr/pm/device_runtime.h>
 #include <stdio.h>
 #include <string.h>
 #include <zephyr/logging/log.h>
@@ -46,7 +47,10 @@ static void turn_on_regulator(sensor_power_config_t *config)
     if(!regulator_is_enabled(config->ldo_dev))
     {
         LOG_DBG("Enabling regulator");
-        regulator_enable(config->ldo_dev);
+        if(regulator_enable(config->ldo_dev) < 0)
+        {
+            LOG_ERR("Failed to enable regulator");
+        }
     }
 }
 
@@ -201,10 +205,16 @@ static int read_sensor_output_raw(sensor_power_config_t *config)
 	};
 	int err = adc_sequence_init_dt(&config->output_read, &sequence);
     if(err < 0)
+    {
+        return err;
+    }
+    err = pm_device_runtime_get(config->output_read.dev);
+    if(err < 0)
     {
         return err;
     }
 	err = adc_read(config->output_read.dev, &sequence);
+    pm_device_runtime_put(config->output_read.dev);
     if(err < 0)
     {
         return err;
@@ -0,0 +1,129 @@
+/**
+ * @file sensor_radio.c
+ * @author Tyler Garcia
+ * @brief This is a library that owns the LoRaWAN radio in its own thread. Prepared uplinks are queued by priority
+ * and sent in the background, the result of each is returned through its completion callback.
+ * @version 0.1
+ * @date 2025-06-11
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "sensor_radio.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(SENSOR_RADIO, LOG_LEVEL_INF);
+
+K_MSGQ_DEFINE(high_priority_queue, sizeof(sensor_radio_uplink_t), SENSOR_RADIO_QUEUE_LENGTH, 4);
+K_MSGQ_DEFINE(low_priority_queue, sizeof(sensor_radio_uplink_t), SENSOR_RADIO_QUEUE_LENGTH, 4);
+
+/* Given for every queued uplink, the radio thread waits on it instead of on a single queue */
+K_SEM_DEFINE(uplink_sem, 0, K_SEM_MAX_LIMIT);
+
+/* Makes dropping the oldest uplink and queueing the new one a single step */
+K_MUTEX_DEFINE(enqueue_lock);
+
+/* Queues in the order they are served */
+static struct k_msgq *const radio_queues[SENSOR_RADIO_PRIORITY_LIMIT] = {
+    [SENSOR_RADIO_PRIORITY_HIGH] = &high_priority_queue,
+    [SENSOR_RADIO_PRIORITY_LOW] = &low_priority_queue,
+};
+
+/**
+ * @brief Call the completion callback of an uplink if it has one.
+ * 
+ * @param uplink The uplink that is complete.
+ * @param result The result of the uplink.
+ */
+static void complete_uplink(sensor_radio_uplink_t *uplink, enum sensor_radio_result result)
+{
+    if (uplink->callback != NULL) {
+        uplink->callback(result, uplink->user_data);
+    }
+}
+
+/**
+ * @brief Get the next uplink to send, from the highest priority queue that has one.
+ * 
+ * @param uplink The next uplink.
+ * @return int 0 on success, -ENOMSG if all queues are empty
+ */
+static int get_next_uplink(sensor_radio_uplink_t *uplink)
+{
+    for (int i = 0; i < SENSOR_RADIO_PRIORITY_LIMIT; i++) {
+        if (k_msgq_get(radio_queues[i], uplink, K_NO_WAIT) == 0) {
+            return 0;
+        }
+    }
+    return -ENOMSG;
+}
+
+static void radio_thread_entry(void *p1, void *p2, void *p3)
+{
+    sensor_radio_uplink_t uplink;
+    while (1) {
+        k_sem_take(&uplink_sem, K_FOREVER);
+        /* The uplink this was given for may have been dropped or flushed */
+        if (get_next_uplink(&uplink) < 0) {
+            continue;
+        }
+        int ret = sensor_lorawan_send_data(&uplink.data);
+        if (ret < 0) {
+            LOG_ERR("Uplink on port %d failed (%d)", uplink.data.port, ret);
+            complete_uplink(&uplink, SENSOR_RADIO_RESULT_FAILED);
+        }
+        else {
+            /* The uplink may have been sent unconfirmed even if it asked for attempts */
+            complete_uplink(&uplink, uplink.data.is_acked ? SENSOR_RADIO_RESULT_ACKED : SENSOR_RADIO_RESULT_SENT);
+        }
+    }
+}
+
+K_THREAD_DEFINE(radio_thread, SENSOR_RADIO_STACKSIZE, radio_thread_entry, NULL, NULL, NULL,
+    SENSOR_RADIO_THREAD_PRIORITY, 0, 0);
+
+int sensor_radio_enqueue(const sensor_radio_uplink_t *uplink)
+{
+    sensor_radio_uplink_t dropped_uplink;
+    uint8_t is_dropped = 0;
+    if (uplink->priority >= SENSOR_RADIO_PRIORITY_LIMIT) {
+        LOG_ERR("Invalid uplink priority %d", uplink->priority);
+        return -EINVAL;
+    }
+    struct k_msgq *queue = radio_queues[uplink->priority];
+    k_mutex_lock(&enqueue_lock, K_FOREVER);
+    if (k_msgq_put(queue, uplink, K_NO_WAIT) != 0) {
+        /* Newer data is worth more than the oldest uplink still waiting */
+        is_dropped = k_msgq_get(queue, &dropped_uplink, K_NO_WAIT) == 0;
+        k_msgq_put(queue, uplink, K_NO_WAIT);
+    }
+    k_mutex_unlock(&enqueue_lock);
+    k_sem_give(&uplink_sem);
+    if (is_dropped) {
+        LOG_WRN("Uplink queue %d is full, dropped the oldest uplink", uplink->priority);
+        complete_uplink(&dropped_uplink, SENSOR_RADIO_RESULT_DROPPED);
+    }
+    return 0;
+}
+
+void sensor_radio_flush(void)
+{
+    sensor_radio_uplink_t uplink;
+    k_mutex_lock(&enqueue_lock, K_FOREVER);
+    while (get_next_uplink(&uplink) == 0) {
+        complete_uplink(&uplink, SENSOR_RADIO_RESULT_DROPPED);
+    }
+    k_mutex_unlock(&enqueue_lock);
+}
+
+int sensor_radio_get_queued(void)
+{
+    int queued = 0;
+    for (int i = 0; i < SENSOR_RADIO_PRIORITY_LIMIT; i++) {
+        queued += k_msgq_num_used_get(radio_queues[i]);
+    }
+    return queued;
+}
@@ -12,12 +12,37 @@
 
 #include "sensor_reading.h"
 #include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/pm/device_runtime.h>
+#if defined(CONFIG_SENSOR)
+#include <zephyr/drivers/sensor.h>
+#endif
+
+/* Count FREQUENCY_SENSOR edges in a TIMER through GPIOTE and PPI when the nrfx drivers are enabled */
+#if defined(CONFIG_NRFX_TIMER3) && defined(CONFIG_NRFX_TIMER4) && defined(CONFIG_NRFX_GPIOTE) && defined(CONFIG_NRFX_PPI)
+#define FREQUENCY_HW_COUNTER 1
+#include <nrfx_timer.h>
+#include <nrfx_gpiote.h>
+#include <helpers/nrfx_gppi.h>
+#else
+#define FREQUENCY_HW_COUNTER 0
+#endif
 
 typedef struct {
     struct gpio_callback cb;
     enum sensor_id id;
 } pulse_context_t;
 
+typedef struct {
+    struct gpio_callback d1_cb;
+    struct gpio_callback d2_cb;
+    sensor_reading_config_t *config;
+    /* Last decoded state, d1 in bit 1 and d2 in bit 0 */
+    uint8_t state;
+    /* Whether the count comes from the QDEC peripheral */
+    uint8_t uses_qdec;
+} counter_context_t;
+
 enum sensor_types sensor_setups[SENSOR_INDEX_LIMIT];
 
 static int pulse_count[SENSOR_INDEX_LIMIT];
@@ -26,6 +51,49 @@ static pulse_context_t pulse_cb_data[SENSOR_INDEX_LIMIT];
 
 static int64_t last_pulse_time[SENSOR_INDEX_LIMIT];
 
+static counter_context_t counter_cb_data[SENSOR_INDEX_LIMIT];
+
+static atomic_t signed_count[SENSOR_INDEX_LIMIT];
+
+typedef struct {
+    /* Callback counting edges when there is no hardware counter */
+    struct gpio_callback cb;
+    /* Edges counted by the callback during the gate */
+    atomic_t edges;
+#if FREQUENCY_HW_COUNTER
+    /* GPIOTE channel generating an event on each rising edge of d1 */
+    uint8_t gpiote_channel;
+    /* PPI channel connecting the GPIOTE event to the TIMER count task */
+    uint8_t ppi_channel;
+    /* Absolute pin number of d1 */
+    uint32_t pin;
+#endif
+} frequency_context_t;
+
+static frequency_context_t frequency_cb_data[SENSOR_INDEX_LIMIT];
+
+#if FREQUENCY_HW_COUNTER
+/* TIMER used as an edge counter for each sensor, TIMER0 and TIMER1 are left to the radio */
+static const nrfx_timer_t frequency_timers[SENSOR_INDEX_LIMIT] = {
+    NRFX_TIMER_INSTANCE(3),
+    NRFX_TIMER_INSTANCE(4),
+};
+
+/* GPIOTE instance shared with the Zephyr GPIO driver */
+static const nrfx_gpiote_t frequency_gpiote = NRFX_GPIOTE_INSTANCE(0);
+#endif
+
+/* Count change indexed by (previous state << 2) | new state, skipped states count as 0 */
+static const int8_t quadrature_steps[16] = {
+     0, -1,  1,  0,
+     1,  0,  0, -1,
+    -1,  0,  0,  1,
+     0,  1, -1,  0
+};
+
+/* Latest board temperature in hundredths of °C used for compensation */
+static volatile int32_t cached_temperature_centi_c = TEMPCO_REFERENCE_CENTI_C;
+
 /* Button Interrupt */
 static void pulse_captured(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
@@ -68,6 +136,251 @@ static int sensor_reading_pulse_setup(sensor_reading_config_t *config)
     return 0;
 }
 
+static void sensor_reading_pulse_remove(sensor_reading_config_t *config)
+{
+    gpio_pin_interrupt_configure_dt(&config->d1, GPIO_INT_DISABLE);
+    gpio_remove_callback(config->d1.port, &pulse_cb_data[config->id].cb);
+}
+
+static uint8_t read_quadrature_state(sensor_reading_config_t *config)
+{
+    return (uint8_t)(((gpio_pin_get_dt(&config->d1) > 0) << 1) | (gpio_pin_get_dt(&config->d2) > 0));
+}
+
+static void quadrature_update(counter_context_t *context)
+{
+    uint8_t state = read_quadrature_state(context->config);
+    int8_t step = quadrature_steps[(context->state << 2) | state];
+    context->state = state;
+    if (step != 0)
+    {
+        atomic_add(&signed_count[context->config->id], step);
+    }
+}
+
+/* Quadrature d1 Interrupt */
+static void quadrature_d1_captured(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    quadrature_update(CONTAINER_OF(cb, counter_context_t, d1_cb));
+}
+
+/* Quadrature d2 Interrupt */
+static void quadrature_d2_captured(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    quadrature_update(CONTAINER_OF(cb, counter_context_t, d2_cb));
+}
+
+/* Pulse and Direction Interrupt */
+static void pulse_dir_captured(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    counter_context_t *context = CONTAINER_OF(cb, counter_context_t, d1_cb);
+    atomic_add(&signed_count[context->config->id], gpio_pin_get_dt(&context->config->d2) > 0 ? -1 : 1);
+}
+
+#if defined(CONFIG_SENSOR)
+/**
+ * @brief Drop the count accumulated in the QDEC peripheral. A fetch adds to the driver's accumulator and only
+ * getting the channel clears it, so both are needed.
+ * 
+ * @param config sensor hardware configuration
+ */
+static void discard_qdec_count(sensor_reading_config_t *config)
+{
+    struct sensor_value value;
+    if (sensor_sample_fetch_chan(config->qdec, SENSOR_CHAN_ROTATION) == 0)
+    {
+        sensor_channel_get(config->qdec, SENSOR_CHAN_ROTATION, &value);
+    }
+}
+#endif
+
+static int sensor_reading_counter_setup(sensor_reading_config_t *config, enum sensor_types sensor_type)
+{
+    int ret;
+    counter_context_t *context = &counter_cb_data[config->id];
+    context->config = config;
+    context->uses_qdec = 0;
+    atomic_set(&signed_count[config->id], 0);
+
+#if defined(CONFIG_SENSOR)
+    // Use the QDEC peripheral when d1/d2 are routed to it, it counts without an interrupt per edge
+    if (sensor_type == QUADRATURE_SENSOR && config->qdec != NULL && device_is_ready(config->qdec))
+    {
+        // Discard anything accumulated before the sensor was set up
+        discard_qdec_count(config);
+        context->uses_qdec = 1;
+        return 0;
+    }
+#endif
+
+    if (!gpio_is_ready_dt(&config->d1) || !gpio_is_ready_dt(&config->d2)) 
+    {
+        return -1;
+    }
+    if (gpio_pin_configure_dt(&config->d1, GPIO_INPUT) != 0 || gpio_pin_configure_dt(&config->d2, GPIO_INPUT) != 0) 
+    {
+        return -1;
+    }
+
+    if (sensor_type == QUADRATURE_SENSOR)
+    {
+        context->state = read_quadrature_state(config);
+        ret = gpio_pin_interrupt_configure_dt(&config->d1, GPIO_INT_EDGE_BOTH);
+        if (ret == 0)
+        {
+            ret = gpio_pin_interrupt_configure_dt(&config->d2, GPIO_INT_EDGE_BOTH);
+        }
+        gpio_init_callback(&context->d1_cb, quadrature_d1_captured, BIT(config->d1.pin));
+        gpio_init_callback(&context->d2_cb, quadrature_d2_captured, BIT(config->d2.pin));
+        gpio_add_callback(config->d2.port, &context->d2_cb);
+    }
+    else
+    {
+        ret = gpio_pin_interrupt_configure_dt(&config->d1, GPIO_INT_EDGE_TO_INACTIVE);
+        gpio_init_callback(&context->d1_cb, pulse_dir_captured, BIT(config->d1.pin));
+    }
+    if (ret != 0) 
+    {
+        gpio_pin_interrupt_configure_dt(&config->d1, GPIO_INT_DISABLE);
+        gpio_pin_interrupt_configure_dt(&config->d2, GPIO_INT_DISABLE);
+        gpio_remove_callback(config->d2.port, &context->d2_cb);
+        return -1;
+    }
+    gpio_add_callback(config->d1.port, &context->d1_cb);
+    return 0;
+}
+
+static void sensor_reading_counter_remove(sensor_reading_config_t *config)
+{
+    counter_context_t *context = &counter_cb_data[config->id];
+    if (context->uses_qdec)
+    {
+        context->uses_qdec = 0;
+        return;
+    }
+    gpio_pin_interrupt_configure_dt(&config->d1, GPIO_INT_DISABLE);
+    gpio_pin_interrupt_configure_dt(&config->d2, GPIO_INT_DISABLE);
+    gpio_remove_callback(config->d1.port, &context->d1_cb);
+    gpio_remove_callback(config->d2.port, &context->d2_cb);
+}
+
+#if FREQUENCY_HW_COUNTER
+/* Counter mode never generates compare events, the handler is only needed by the driver */
+static void frequency_timer_handler(nrf_timer_event_t event_type, void *context)
+{
+}
+
+static uint32_t frequency_pin_psel(const struct gpio_dt_spec *spec)
+{
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(gpio1), okay)
+    if (spec->port == DEVICE_DT_GET(DT_NODELABEL(gpio1)))
+    {
+        return NRF_GPIO_PIN_MAP(1, spec->pin);
+    }
+#endif
+    return NRF_GPIO_PIN_MAP(0, spec->pin);
+}
+
+/**
+ * @brief Route rising edges on d1 to the count task of the sensor's TIMER, so edges are counted 
+ * without waking the CPU.
+ * 
+ * @param config sensor hardware configuration
+ * @return int 0 if successful, -1 otherwise
+ */
+static int frequency_hw_counter_setup(sensor_reading_config_t *config)
+{
+    frequency_context_t *context = &frequency_cb_data[config->id];
+    const nrfx_timer_t *timer = &frequency_timers[config->id];
+    context->pin = frequency_pin_psel(&config->d1);
+
+    nrfx_timer_config_t timer_config = NRFX_TIMER_DEFAULT_CONFIG(NRFX_MHZ_TO_HZ(1));
+    timer_config.mode = NRF_TIMER_MODE_LOW_POWER_COUNTER;
+    timer_config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    if (nrfx_timer_init(timer, &timer_config, frequency_timer_handler) != NRFX_SUCCESS)
+    {
+        return -1;
+    }
+    if (nrfx_gpiote_channel_alloc(&frequency_gpiote, &context->gpiote_channel) != NRFX_SUCCESS)
+    {
+        nrfx_timer_uninit(timer);
+        return -1;
+    }
+    nrf_gpio_pin_pull_t pull = NRF_GPIO_PIN_NOPULL;
+    nrfx_gpiote_trigger_config_t trigger_config = {
+        .trigger = NRFX_GPIOTE_TRIGGER_LOTOHI,
+        .p_in_channel = &context->gpiote_channel,
+    };
+    nrfx_gpiote_input_pin_config_t input_config = {
+        .p_pull_config = &pull,
+        .p_trigger_config = &trigger_config,
+        .p_handler_config = NULL,
+    };
+    if (nrfx_gpiote_input_configure(&frequency_gpiote, context->pin, &input_config) != NRFX_SUCCESS)
+    {
+        nrfx_gpiote_channel_free(&frequency_gpiote, context->gpiote_channel);
+        nrfx_timer_uninit(timer);
+        return -1;
+    }
+    if (nrfx_gppi_channel_alloc(&context->ppi_channel) != NRFX_SUCCESS)
+    {
+        nrfx_gpiote_pin_uninit(&frequency_gpiote, context->pin);
+        nrfx_gpiote_channel_free(&frequency_gpiote, context->gpiote_channel);
+        nrfx_timer_uninit(timer);
+        return -1;
+    }
+    nrfx_gppi_channel_endpoints_setup(context->ppi_channel,
+        nrfx_gpiote_in_event_address_get(&frequency_gpiote, context->pin),
+        nrfx_timer_task_address_get(timer, NRF_TIMER_TASK_COUNT));
+    return 0;
+}
+
+static void frequency_hw_counter_remove(sensor_reading_config_t *config)
+{
+    frequency_context_t *context = &frequency_cb_data[config->id];
+    nrfx_gppi_channels_disable(BIT(context->ppi_channel));
+    nrfx_gppi_channel_free(context->ppi_channel);
+    nrfx_gpiote_pin_uninit(&frequency_gpiote, context->pin);
+    nrfx_gpiote_channel_free(&frequency_gpiote, context->gpiote_channel);
+    nrfx_timer_uninit(&frequency_timers[config->id]);
+}
+#else
+/* Frequency Fallback Interrupt */
+static void frequency_edge_captured(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    frequency_context_t *context = CONTAINER_OF(cb, frequency_context_t, cb);
+    atomic_inc(&context->edges);
+}
+#endif
+
+static int sensor_reading_frequency_setup(sensor_reading_config_t *config)
+{
+    if (!gpio_is_ready_dt(&config->d1)) 
+    {
+        return -1;
+    }
+    if (gpio_pin_configure_dt(&config->d1, GPIO_INPUT) != 0) 
+    {
+        return -1;
+    }
+#if FREQUENCY_HW_COUNTER
+    return frequency_hw_counter_setup(config);
+#else
+    gpio_init_callback(&frequency_cb_data[config->id].cb, frequency_edge_captured, BIT(config->d1.pin));
+    return 0;
+#endif
+}
+
+static void sensor_reading_frequency_remove(sensor_reading_config_t *config)
+{
+#if FREQUENCY_HW_COUNTER
+    frequency_hw_counter_remove(config);
+#else
+    gpio_pin_interrupt_configure_dt(&config->d1, GPIO_INT_DISABLE);
+    gpio_remove_callback(config->d1.port, &frequency_cb_data[config->id].cb);
+#endif
+}
+
 static int sensor_reading_adc_setup(sensor_reading_config_t *config, enum sensor_types sensor_type)
 {
     int ret;
@@ -101,13 +414,22 @@ static int sensor_reading_adc_setup(sensor_reading_config_t *config, enum sensor
 
 int sensor_reading_setup(sensor_reading_config_t *config, enum sensor_types sensor_type)
 {
-    int ret;
+    int ret = 0;
     // If switching from pulse sensor to any other sensor remove the callback
     if (sensor_setups[config->id] == PULSE_SENSOR && sensor_type != PULSE_SENSOR)
     {
-        gpio_remove_callback(config->d1.port, &pulse_cb_data[config->id].cb);
+        sensor_reading_pulse_remove(config);
         reset_sensor_pulse_count(config);
     }
+    // Counters are always removed, switching between the two counter modes needs different interrupts
+    if (sensor_setups[config->id] == QUADRATURE_SENSOR || sensor_setups[config->id] == PULSE_DIR_SENSOR)
+    {
+        sensor_reading_counter_remove(config);
+    }
+    if (sensor_setups[config->id] == FREQUENCY_SENSOR)
+    {
+        sensor_reading_frequency_remove(config);
+    }
 
     switch (sensor_type)
     {
@@ -123,6 +445,13 @@ int sensor_reading_setup(sensor_reading_config_t *config, enum sensor_types sens
     case PULSE_SENSOR:
         ret = sensor_reading_pulse_setup(config);
         break;
+    case QUADRATURE_SENSOR:
+    case PULSE_DIR_SENSOR:
+        ret = sensor_reading_counter_setup(config, sensor_type);
+        break;
+    case FREQUENCY_SENSOR:
+        ret = sensor_reading_frequency_setup(config);
+        break;
     default:
         sensor_setups[config->id] = NULL_SENSOR;
         break;
@@ -166,6 +495,25 @@ static int read_sensor_output_raw(const struct adc_dt_spec *spec)
     return buf;
 }
 
+void sensor_reading_set_temperature(int32_t temperature_centi_c)
+{
+    cached_temperature_centi_c = temperature_centi_c;
+}
+
+/**
+ * @brief Remove the temperature drift from a reading in fixed point.
+ * 
+ * @param value_uv reading in microvolts
+ * @param tempco_ppm gain drift of the reading in ppm/°C
+ * @return int32_t compensated reading in microvolts
+ */
+static int32_t temperature_compensate(int32_t value_uv, int16_t tempco_ppm)
+{
+    int32_t delta_centi_c = cached_temperature_centi_c - TEMPCO_REFERENCE_CENTI_C;
+    int32_t drift_ppm = ((int32_t)tempco_ppm * delta_centi_c) / 100;
+    return (int32_t)(((int64_t)value_uv * 1000000) / (1000000 + drift_ppm));
+}
+
 float get_sensor_voltage_reading(sensor_reading_config_t *config)
 {
     if(get_sensor_reading_setup(config) != VOLTAGE_SENSOR)
@@ -174,19 +522,27 @@ float get_sensor_voltage_reading(sensor_reading_config_t *config)
     }
     int sum = 0;
     const int num_samples = 100;
+    // Keep the ADC resumed for the whole averaging sequence instead of per sample
+    int err = pm_device_runtime_get(config->voltage_read.dev);
+    if(err < 0)
+    {
+        return err;
+    }
     for (int i = 0; i < num_samples; i++) {
         sum += (int)read_sensor_output_raw(&config->voltage_read);
         k_msleep(1);
     }
+    pm_device_runtime_put(config->voltage_read.dev);
     int avg_raw = sum / num_samples;
 
     int val_mv = avg_raw;
-    int err = adc_raw_to_millivolts_dt(&config->voltage_read, &val_mv);
+    err = adc_raw_to_millivolts_dt(&config->voltage_read, &val_mv);
     if(err < 0)
     {
         return err;
     }
-	return (((float)val_mv/1000.0f) * (((float)VOLTAGE_READ_DIVIDER_HIGH + (float)VOLTAGE_READ_DIVIDER_LOW)/(float)VOLTAGE_READ_DIVIDER_LOW));
+    int32_t val_uv = temperature_compensate(val_mv * 1000, config->voltage_tempco_ppm);
+	return (((float)val_uv/1000000.0f) * (((float)VOLTAGE_READ_DIVIDER_HIGH + (float)VOLTAGE_READ_DIVIDER_LOW)/(float)VOLTAGE_READ_DIVIDER_LOW));
 }
 
 float get_sensor_current_reading(sensor_reading_config_t *config)
@@ -194,15 +550,22 @@ float get_sensor_current_reading(sensor_reading_config_t *config)
     if(get_sensor_reading_setup(config) != CURRENT_SENSOR)
     {
         return -1;
+    }
+    int err = pm_device_runtime_get(config->current_read.dev);
+    if(err < 0)
+    {
+        return err;
     }
 	int val_mv = (int)read_sensor_output_raw(&config->current_read);
-	int err = adc_raw_to_millivolts_dt(&config->current_read, &val_mv);
+    pm_device_runtime_put(config->current_read.dev);
+	err = adc_raw_to_millivolts_dt(&config->current_read, &val_mv);
     if(err < 0)
     {
         return err;
     }
+    int32_t val_uv = temperature_compensate(val_mv * 1000, config->current_tempco_ppm);
     // I = V/R
-    return (float)val_mv / (float)CURRENT_READ_RESISTOR;
+    return ((float)val_uv / 1000.0f) / (float)CURRENT_READ_RESISTOR;
 }
 
 int get_sensor_pulse_count(sensor_reading_config_t *config)
@@ -222,4 +585,128 @@ int reset_sensor_pulse_count(sensor_reading_config_t *config)
     }
     pulse_count[config->id] = 0;
     return 0;
-}
\ No newline at end of file
+}
+
+#if defined(CONFIG_SENSOR)
+/**
+ * @brief Move the count accumulated in the QDEC peripheral into the signed count.
+ * 
+ * @param config sensor hardware configuration
+ * @return int 0 if successful, < 0 otherwise
+ */
+static int read_qdec_count(sensor_reading_config_t *config)
+{
+    struct sensor_value value;
+    int ret = sensor_sample_fetch_chan(config->qdec, SENSOR_CHAN_ROTATION);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    ret = sensor_channel_get(config->qdec, SENSOR_CHAN_ROTATION, &value);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    // Each fetch only returns what was accumulated since the previous fetch
+    atomic_add(&signed_count[config->id], value.val1);
+    return 0;
+}
+#endif
+
+int get_sensor_signed_count(sensor_reading_config_t *config, int32_t *count)
+{
+    enum sensor_types type = get_sensor_reading_setup(config);
+    if (type != QUADRATURE_SENSOR && type != PULSE_DIR_SENSOR)
+    {
+        return -1;
+    }
+#if defined(CONFIG_SENSOR)
+    if (counter_cb_data[config->id].uses_qdec && read_qdec_count(config) < 0)
+    {
+        return -1;
+    }
+#endif
+    *count = (int32_t)atomic_get(&signed_count[config->id]);
+    return 0;
+}
+
+int reset_sensor_signed_count(sensor_reading_config_t *config)
+{
+    enum sensor_types type = get_sensor_reading_setup(config);
+    if (type != QUADRATURE_SENSOR && type != PULSE_DIR_SENSOR)
+    {
+        return -1;
+    }
+#if defined(CONFIG_SENSOR)
+    if (counter_cb_data[config->id].uses_qdec)
+    {
+        // Drop what the peripheral accumulated so far
+        discard_qdec_count(config);
+    }
+#endif
+    atomic_set(&signed_count[config->id], 0);
+    return 0;
+}
+
+/**
+ * @brief Count rising edges on d1 for FREQUENCY_GATE_MS. The calling thread sleeps during the gate.
+ * 
+ * @param config sensor hardware configuration
+ * @param edges number of edges counted
+ * @param gate_ticks length of the gate in kernel ticks
+ * @return int 0 if successful, < 0 otherwise
+ */
+static int count_frequency_edges(sensor_reading_config_t *config, uint32_t *edges, int64_t *gate_ticks)
+{
+#if FREQUENCY_HW_COUNTER
+    frequency_context_t *context = &frequency_cb_data[config->id];
+    const nrfx_timer_t *timer = &frequency_timers[config->id];
+    nrfx_timer_clear(timer);
+    nrfx_timer_enable(timer);
+    nrfx_gpiote_trigger_enable(&frequency_gpiote, context->pin, false);
+    int64_t start = k_uptime_ticks();
+    nrfx_gppi_channels_enable(BIT(context->ppi_channel));
+    k_msleep(FREQUENCY_GATE_MS);
+    nrfx_gppi_channels_disable(BIT(context->ppi_channel));
+    *gate_ticks = k_uptime_ticks() - start;
+    *edges = nrfx_timer_capture(timer, NRF_TIMER_CC_CHANNEL0);
+    nrfx_gpiote_trigger_disable(&frequency_gpiote, context->pin);
+    nrfx_timer_disable(timer);
+    return 0;
+#else
+    frequency_context_t *context = &frequency_cb_data[config->id];
+    atomic_set(&context->edges, 0);
+    gpio_add_callback(config->d1.port, &context->cb);
+    int ret = gpio_pin_interrupt_configure_dt(&config->d1, GPIO_INT_EDGE_TO_ACTIVE);
+    if (ret < 0)
+    {
+        gpio_remove_callback(config->d1.port, &context->cb);
+        return ret;
+    }
+    int64_t start = k_uptime_ticks();
+    k_msleep(FREQUENCY_GATE_MS);
+    gpio_pin_interrupt_configure_dt(&config->d1, GPIO_INT_DISABLE);
+    *gate_ticks = k_uptime_ticks() - start;
+    *edges = (uint32_t)atomic_get(&context->edges);
+    gpio_remove_callback(config->d1.port, &context->cb);
+    return 0;
+#endif
+}
+
+int get_sensor_frequency(sensor_reading_config_t *config, float *frequency)
+{
+    if (get_sensor_reading_setup(config) != FREQUENCY_SENSOR)
+    {
+        return -1;
+    }
+    uint32_t edges;
+    int64_t gate_ticks;
+    if (count_frequency_edges(config, &edges, &gate_ticks) < 0 || gate_ticks <= 0)
+    {
+        return -1;
+    }
+    // Use the measured gate, the sleep can run longer than requested
+    *frequency = ((float)edges * 1000000.0f) / (float)k_ticks_to_us_near64(gate_ticks);
+    return 0;
+}
+
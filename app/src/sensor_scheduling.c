@@ -2,6 +2,8 @@
  * @file sensor_scheduling.c
  * @author Tyler Garcia
  * @brief This is a library to schedule sensor readings and radio transmissions.
+ * Schedules are kept in a min-heap ordered by their next event time, and only the nearest 
+ * event is armed on the timer so any number of schedules share one alarm channel.
  * @version 0.1
  * @date 2025-05-12
  * 
@@ -18,76 +20,173 @@ LOG_MODULE_REGISTER(SENSOR_SCHEDULING, LOG_LEVEL_INF);
 /* The timer device to use for scheduling, this is set with calling the init function */
 static const struct device *scheduling_timer;
 
-/* The list of schedules, allowing the schedules to be accessed throughtout the library*/
-static sensor_scheduling_cfg_t *scheduling_list[SENSOR_SCHEDULING_ID_LIMIT];
+/* Min-heap of the queued schedules, the schedule with the nearest event is at index 0 */
+static sensor_scheduling_cfg_t *scheduling_queue[SENSOR_SCHEDULING_MAX_SCHEDULES];
 
-/* The channel id of the alarm for each scheduling id */
-static uint8_t scheduling_channels[SENSOR_SCHEDULING_ID_LIMIT];
+/* Number of schedules in the queue */
+static uint8_t scheduling_queue_size;
+
+/* Protects the queue, it is changed by both the alarm callback and the application */
+static struct k_spinlock scheduling_lock;
+
+static void scheduling_callback(const struct device *dev, uint8_t chan_id, uint32_t counter, void *user_data);
+
+static void queue_swap(uint8_t a, uint8_t b)
+{
+    sensor_scheduling_cfg_t *temp = scheduling_queue[a];
+    scheduling_queue[a] = scheduling_queue[b];
+    scheduling_queue[b] = temp;
+    scheduling_queue[a]->queue_index = a;
+    scheduling_queue[b]->queue_index = b;
+}
+
+static void queue_sift_up(uint8_t index)
+{
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (scheduling_queue[parent]->next_event_ms <= scheduling_queue[index]->next_event_ms) {
+            break;
+        }
+        queue_swap(parent, index);
+        index = parent;
+    }
+}
+
+static void queue_sift_down(uint8_t index)
+{
+    while (1) {
+        uint8_t smallest = index;
+        uint8_t left = (2 * index) + 1;
+        uint8_t right = left + 1;
+        if (left < scheduling_queue_size && 
+            scheduling_queue[left]->next_event_ms < scheduling_queue[smallest]->next_event_ms) {
+            smallest = left;
+        }
+        if (right < scheduling_queue_size && 
+            scheduling_queue[right]->next_event_ms < scheduling_queue[smallest]->next_event_ms) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        queue_swap(index, smallest);
+        index = smallest;
+    }
+}
 
 /**
- * @brief Callback function for the scheduling timer
+ * @brief Insert a schedule into the queue, the caller must hold scheduling_lock
  * 
- * @param dev The device that triggered the callback
- * @param chan_id The channel id that triggered the callback
- * @param ticks The ticks of the callback
+ * @param schedule the schedule to insert, next_event_ms must be set
+ * @return int 0 on success, -ENOMEM if the queue is full
  */
-static void scheduling_callback(const struct device *dev, uint8_t chan_id, uint32_t counter, void *user_data)
+static int queue_insert(sensor_scheduling_cfg_t *schedule)
 {
-    LOG_DBG("Scheduling callback called for channel %d", chan_id);
-    for(int i = 0; i < SENSOR_SCHEDULING_ID_LIMIT; i++) 
-    {
-        if(scheduling_list[i] != NULL) 
-        {
-            if(scheduling_channels[i] == chan_id && scheduling_list[i]->is_scheduled) {
-                scheduling_list[i]->is_triggered = 1;
-                scheduling_list[i]->last_event_time = sensor_timer_get_total_seconds(scheduling_timer);
-            }
-        }
+    if (scheduling_queue_size >= SENSOR_SCHEDULING_MAX_SCHEDULES) {
+        return -ENOMEM;
     }
+    schedule->queue_index = scheduling_queue_size;
+    schedule->is_queued = 1;
+    scheduling_queue[scheduling_queue_size++] = schedule;
+    queue_sift_up(schedule->queue_index);
+    return 0;
 }
 
 /**
- * @brief Add an alarm to a schedule, as of right now, the channel is the same as the schedule id
+ * @brief Remove a schedule from anywhere in the queue, the caller must hold scheduling_lock
  * 
- * @param schedule 
+ * @param schedule the schedule to remove
  */
-static void add_alarm_to_schedule(sensor_scheduling_cfg_t *schedule)
+static void queue_remove(sensor_scheduling_cfg_t *schedule)
 {
-    sensor_timer_alarm_cfg_t alarm_cfg = {
-        .channel = schedule->id,
-        .alarm_seconds = schedule->frequency_seconds,
-        .callback = scheduling_callback,
-        .is_alarm_set = 0,
-    };
-    scheduling_channels[schedule->id] = alarm_cfg.channel;
-    sensor_timer_set_alarm(scheduling_timer, &alarm_cfg);
+    if (!schedule->is_queued) {
+        return;
+    }
+    uint8_t index = schedule->queue_index;
+    schedule->is_queued = 0;
+    scheduling_queue_size--;
+    if (index == scheduling_queue_size) {
+        return;
+    }
+    scheduling_queue[index] = scheduling_queue[scheduling_queue_size];
+    scheduling_queue[index]->queue_index = index;
+    queue_sift_up(index);
+    queue_sift_down(scheduling_queue[index]->queue_index);
 }
 
 /**
- * @brief Renew an alarm for a schedule, this is called when the schedule is reset
+ * @brief Trigger every schedule that is due and arm the alarm for the nearest remaining one, 
+ * the caller must hold scheduling_lock. Triggered schedules leave the queue until they are reset.
  * 
- * @param schedule the schedule to renew the alarm for
- * @param time_to_next_event the time till the next alarm should go off
- * @return int 0 on success, -EINVAL on failure
+ * @return int 0 on success, negative error code on failure
  */
-static int renew_alarm_for_schedule(sensor_scheduling_cfg_t *schedule, uint32_t time_to_next_event)
+static int queue_process(void)
 {
-    if (schedule == NULL || !schedule->is_scheduled) {
+    uint64_t current_ms;
+    if (sensor_timer_get_total_ms(scheduling_timer, &current_ms) != 0) {
         return -EINVAL;
     }
-    LOG_INF("Renewing alarm for schedule %d, time to next alarm: %d seconds", schedule->id, time_to_next_event);
-    LOG_DBG("current time: %d", sensor_timer_get_total_seconds(scheduling_timer));
-    LOG_DBG("Time of last event: %d", schedule->last_event_time);
-    LOG_DBG("Time to next event: %d", time_to_next_event);
+    while (scheduling_queue_size > 0 && scheduling_queue[0]->next_event_ms <= current_ms) {
+        sensor_scheduling_cfg_t *schedule = scheduling_queue[0];
+        queue_remove(schedule);
+        schedule->is_triggered = 1;
+        schedule->last_event_ms = current_ms;
+        LOG_DBG("Schedule %d triggered at %llu ms", schedule->id, current_ms);
+        if (schedule->trigger_callback != NULL) {
+            schedule->trigger_callback(schedule);
+        }
+    }
+    if (scheduling_queue_size == 0) {
+        return 0;
+    }
+    uint64_t time_to_next_event = scheduling_queue[0]->next_event_ms - current_ms;
     sensor_timer_alarm_cfg_t alarm_cfg = {
-        .channel = scheduling_channels[schedule->id],
-        .alarm_seconds = time_to_next_event,
+        .channel = SENSOR_SCHEDULING_ALARM_CHANNEL,
+        .alarm_seconds = (uint32_t)(time_to_next_event / 1000),
+        .alarm_ms = (uint32_t)(time_to_next_event % 1000),
         .callback = scheduling_callback,
         .is_alarm_set = 0,
     };
     return sensor_timer_set_alarm(scheduling_timer, &alarm_cfg);
 }
 
+/**
+ * @brief Callback function for the scheduling timer
+ * 
+ * @param dev The device that triggered the callback
+ * @param chan_id The channel id that triggered the callback
+ * @param ticks The ticks of the callback
+ */
+static void scheduling_callback(const struct device *dev, uint8_t chan_id, uint32_t counter, void *user_data)
+{
+    LOG_DBG("Scheduling callback called for channel %d", chan_id);
+    k_spinlock_key_t key = k_spin_lock(&scheduling_lock);
+    if (queue_process() != 0) {
+        LOG_ERR("Failed to arm the next schedule");
+    }
+    k_spin_unlock(&scheduling_lock, key);
+}
+
+/**
+ * @brief Queue a schedule for its next event and re-arm the alarm for the nearest event
+ * 
+ * @param schedule the schedule to queue, next_event_ms must be set
+ * @return int 0 on success, negative error code on failure
+ */
+static int queue_schedule(sensor_scheduling_cfg_t *schedule)
+{
+    k_spinlock_key_t key = k_spin_lock(&scheduling_lock);
+    queue_remove(schedule);
+    int ret = queue_insert(schedule);
+    if (ret == 0) {
+        /* The channel is free to be set again once the previous alarm is canceled */
+        sensor_timer_cancel_alarm(scheduling_timer, SENSOR_SCHEDULING_ALARM_CHANNEL);
+        ret = queue_process();
+    }
+    k_spin_unlock(&scheduling_lock, key);
+    return ret;
+}
+
 int sensor_scheduling_init(const struct device *timer)
 {
     int ret;
@@ -100,24 +199,157 @@ int sensor_scheduling_init(const struct device *timer)
     return 0;
 }
 
-int sensor_scheduling_add_schedule(sensor_scheduling_cfg_t *schedule)
+/**
+ * @brief Get the index of the first anchored event after a time
+ * 
+ * @param schedule the anchored schedule
+ * @param time_ms the time in milliseconds
+ * @return uint64_t the number of periods from the anchor of the first event after time_ms
+ */
+static uint64_t next_anchored_index(sensor_scheduling_cfg_t *schedule, uint64_t time_ms)
+{
+    uint64_t period_ms = (uint64_t)schedule->frequency_seconds * 1000;
+    if (time_ms < schedule->anchor_ms) {
+        return 0;
+    }
+    return ((time_ms - schedule->anchor_ms) / period_ms) + 1;
+}
+
+/**
+ * @brief Draw the offset of the next event of a schedule from its jitter, with a xorshift generator
+ * 
+ * @param schedule the schedule to draw the offset for
+ * @return int64_t the offset in milliseconds, between -jitter_ms and jitter_ms
+ */
+static int64_t next_jitter_ms(sensor_scheduling_cfg_t *schedule)
+{
+    if (schedule->jitter_ms == 0) {
+        return 0;
+    }
+    uint32_t x = schedule->jitter_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    schedule->jitter_state = x;
+    return (int64_t)(x % ((2 * schedule->jitter_ms) + 1)) - schedule->jitter_ms;
+}
+
+/**
+ * @brief Get the time of an event of an anchored schedule, offset by the jitter of the schedule
+ * 
+ * @param schedule the anchored schedule
+ * @param event_index the number of periods from the anchor of the event
+ * @return uint64_t the time of the event in milliseconds
+ */
+static uint64_t anchored_event_ms(sensor_scheduling_cfg_t *schedule, uint64_t event_index)
+{
+    uint64_t event_ms = schedule->anchor_ms + (event_index * schedule->frequency_seconds * 1000);
+    int64_t jitter_ms = next_jitter_ms(schedule);
+    if (jitter_ms < 0 && (uint64_t)(-jitter_ms) > event_ms) {
+        return 0;
+    }
+    return event_ms + jitter_ms;
+}
+
+/**
+ * @brief Mark a schedule as scheduled and queue it for its first event
+ * 
+ * @param schedule the schedule to start, next_event_ms must be set
+ * @return int 0 on success, negative error code on failure
+ */
+static int start_schedule(sensor_scheduling_cfg_t *schedule)
 {
     /* Set the schedule as scheduled */
     schedule->is_scheduled = 1;
-    /* Add the schedule to the local list of schedules */
-    scheduling_list[schedule->id] = schedule;
-    /* Add the schedule to an alarm */
-    add_alarm_to_schedule(schedule);
+    schedule->is_triggered = 0;
+    schedule->missed_periods = 0;
+    schedule->max_lateness_ms = 0;
+    schedule->total_lateness_ms = 0;
+    schedule->event_count = 0;
+    /* Add the schedule to the queue */
+    int ret = queue_schedule(schedule);
+    if (ret != 0) {
+        LOG_ERR("Failed to add schedule %d", schedule->id);
+        schedule->is_scheduled = 0;
+        return ret;
+    }
+    return 0;
+}
+
+int sensor_scheduling_add_schedule(sensor_scheduling_cfg_t *schedule)
+{
+    uint64_t current_ms;
+    if (sensor_timer_get_total_ms(scheduling_timer, &current_ms) != 0) {
+        LOG_ERR("Failed to get current time for adding schedule");
+        return -EINVAL;
+    }
+    schedule->is_anchored = 0;
+    schedule->next_event_ms = current_ms + ((uint64_t)schedule->frequency_seconds * 1000);
+    return start_schedule(schedule);
+}
+
+int sensor_scheduling_add_anchored_schedule(sensor_scheduling_cfg_t *schedule, uint64_t anchor_ms)
+{
+    uint64_t current_ms;
+    if (schedule->frequency_seconds == 0) {
+        LOG_ERR("Anchored schedule %d needs a frequency", schedule->id);
+        return -EINVAL;
+    }
+    if (sensor_timer_get_total_ms(scheduling_timer, &current_ms) != 0) {
+        LOG_ERR("Failed to get current time for adding schedule");
+        return -EINVAL;
+    }
+    schedule->is_anchored = 1;
+    schedule->anchor_ms = anchor_ms;
+    schedule->event_index = next_anchored_index(schedule, current_ms);
+    schedule->next_event_ms = anchored_event_ms(schedule, schedule->event_index);
+    return start_schedule(schedule);
+}
+
+int sensor_scheduling_set_jitter(sensor_scheduling_cfg_t *schedule, uint32_t jitter_ms, uint32_t seed)
+{
+    /* Keeping each event within half a period of its anchored time keeps the events in order */
+    if ((uint64_t)jitter_ms * 2 >= (uint64_t)schedule->frequency_seconds * 1000 && jitter_ms != 0) {
+        LOG_ERR("Jitter of %u ms is too large for schedule %d", jitter_ms, schedule->id);
+        return -EINVAL;
+    }
+    schedule->jitter_ms = jitter_ms;
+    /* The generator never leaves a zero state */
+    schedule->jitter_state = (seed != 0) ? seed : 0x9E3779B9;
     return 0;
 }
 
 int sensor_scheduling_remove_schedule(sensor_scheduling_cfg_t *schedule)
 {
-    /* Remove the schedule from the local list of schedules */
-    sensor_timer_cancel_alarm(scheduling_timer, scheduling_channels[schedule->id]);
+    k_spinlock_key_t key = k_spin_lock(&scheduling_lock);
+    /* Only the alarm of the nearest schedule is armed, re-arm when it is the one being removed */
+    uint8_t was_nearest = schedule->is_queued && schedule->queue_index == 0;
+    queue_remove(schedule);
     schedule->is_scheduled = 0;
     schedule->is_triggered = 0;
-    return 0;
+    int ret = 0;
+    if (was_nearest) {
+        sensor_timer_cancel_alarm(scheduling_timer, SENSOR_SCHEDULING_ALARM_CHANNEL);
+        ret = queue_process();
+    }
+    k_spin_unlock(&scheduling_lock, key);
+    return ret;
+}
+
+/**
+ * @brief Add the lateness of an event to the statistics of a schedule
+ * 
+ * @param schedule the schedule the event belongs to
+ * @param lateness_ms the time from when the event was due until it was reset
+ */
+static void record_lateness(sensor_scheduling_cfg_t *schedule, uint64_t lateness_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&scheduling_lock);
+    uint32_t lateness = (uint32_t)MIN(lateness_ms, UINT32_MAX);
+    schedule->max_lateness_ms = MAX(schedule->max_lateness_ms, lateness);
+    schedule->total_lateness_ms += lateness;
+    schedule->event_count++;
+    k_spin_unlock(&scheduling_lock, key);
 }
 
 int sensor_scheduling_reset_schedule(sensor_scheduling_cfg_t *schedule)
@@ -127,29 +359,113 @@ int sensor_scheduling_reset_schedule(sensor_scheduling_cfg_t *schedule)
     {
         return 0;
     }
+    if (!schedule->is_scheduled) {
+        return -EINVAL;
+    }
     /* Reset the schedule */
-    uint32_t time_to_next_event;
-    int current_time = sensor_timer_get_total_seconds(scheduling_timer);
-    if(current_time < 0)
+    uint64_t current_ms;
+    if(sensor_timer_get_total_ms(scheduling_timer, &current_ms) != 0)
     {
         LOG_ERR("Failed to get current time for renewing schedule");
         return -EINVAL;
     }
-    /* If the time since the last event is less than the frequency, reset the alarm */
-    if(current_time - schedule->last_event_time < schedule->frequency_seconds)
+    uint64_t period_ms = (uint64_t)schedule->frequency_seconds * 1000;
+    /* The event being reset was due at next_event_ms */
+    uint64_t due_ms = schedule->next_event_ms;
+    record_lateness(schedule, (current_ms > due_ms) ? (current_ms - due_ms) : 0);
+    /* Count the periods that have passed since the event, other than the one it handled */
+    uint64_t missed;
+    uint64_t first_ahead_index = 0;
+    if(schedule->is_anchored)
     {
-        time_to_next_event = schedule->frequency_seconds - (current_time - schedule->last_event_time);
+        /* An event jittered early can trigger before its anchored time, the next one is still the one after it */
+        first_ahead_index = MAX(next_anchored_index(schedule, current_ms), schedule->event_index + 1);
+        missed = first_ahead_index - schedule->event_index - 1;
     }
     else
     {
-        LOG_ERR("Failed to reset schedule because the time since the last event is more than the frequency");
-        time_to_next_event = schedule->frequency_seconds;
+        missed = (current_ms > due_ms) ? (current_ms - due_ms) / period_ms : 0;
+    }
+    if(missed > 0)
+    {
+        LOG_WRN("Schedule %d is %llu periods behind", schedule->id, missed);
     }
+
+    if(schedule->catch_up == SENSOR_SCHEDULING_CATCH_UP_ALL)
+    {
+        /* Every period follows the one before it, so missed periods are already due and trigger back to back */
+        if(schedule->is_anchored)
+        {
+            schedule->event_index++;
+            schedule->next_event_ms = anchored_event_ms(schedule, schedule->event_index);
+        }
+        else
+        {
+            schedule->next_event_ms = due_ms + period_ms;
+        }
+    }
+    else if(missed == 0 || schedule->catch_up == SENSOR_SCHEDULING_CATCH_UP_SKIP)
+    {
+        /* The next event is the first one still ahead, any passed on the way are missed */
+        schedule->missed_periods += (uint32_t)missed;
+        if(schedule->is_anchored)
+        {
+            schedule->event_index = first_ahead_index;
+            schedule->next_event_ms = anchored_event_ms(schedule, first_ahead_index);
+        }
+        /* If the time since the last event is less than the frequency, the next event is from the last event */
+        else if(missed == 0)
+        {
+            schedule->next_event_ms = schedule->last_event_ms + period_ms;
+        }
+        else
+        {
+            schedule->next_event_ms = current_ms + period_ms;
+        }
+    }
+    else
+    {
+        /* One event right away stands in for all of the missed periods */
+        schedule->missed_periods += (uint32_t)(missed - 1);
+        if(schedule->is_anchored)
+        {
+            schedule->event_index = first_ahead_index - 1;
+        }
+        schedule->next_event_ms = current_ms;
+    }
+    LOG_INF("Renewing schedule %d, time to next event: %llu ms", schedule->id, 
+        (schedule->next_event_ms > current_ms) ? (schedule->next_event_ms - current_ms) : 0);
     schedule->is_triggered = 0;
-    return renew_alarm_for_schedule(schedule, time_to_next_event);
+    return queue_schedule(schedule);
+}
+
+int sensor_scheduling_get_stats(sensor_scheduling_cfg_t *schedule, sensor_scheduling_stats_t *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&scheduling_lock);
+    stats->max_lateness_ms = schedule->max_lateness_ms;
+    stats->mean_lateness_ms = (schedule->event_count > 0) ? 
+        (uint32_t)(schedule->total_lateness_ms / schedule->event_count) : 0;
+    stats->missed_periods = schedule->missed_periods;
+    stats->event_count = schedule->event_count;
+    k_spin_unlock(&scheduling_lock, key);
+    return 0;
+}
+
+int sensor_scheduling_get_event_seconds(sensor_scheduling_cfg_t *schedule)
+{
+    if (!schedule->is_triggered) {
+        return sensor_scheduling_get_seconds();
+    }
+    /* A triggered schedule keeps the due time of its event until it is reset */
+    return (int)(schedule->next_event_ms / 1000);
 }
 
 int sensor_scheduling_get_seconds(void)
 {
     return sensor_timer_get_total_seconds(scheduling_timer);
 }
+
+int sensor_scheduling_get_ms(uint64_t *ms)
+{
+    return sensor_timer_get_total_ms(scheduling_timer, ms);
+}
@@ -0,0 +1,166 @@
+/**
+ * @file sensor_time.c
+ * @author Tyler Garcia
+ * @brief This is a library to keep UTC time on top of the scheduling timebase. The time is synchronized
+ * from the network and the drift of the local clock is corrected between synchronizations.
+ * @version 0.1
+ * @date 2025-06-02
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#include "sensor_time.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(SENSOR_TIME, LOG_LEVEL_INF);
+
+#define PPM_SCALE   1000000LL
+
+/**
+ * @brief Structure for a synchronization between the scheduling timebase and UTC.
+ */
+typedef struct {
+    /* The time on the scheduling timebase in milliseconds */
+    uint64_t local_ms;
+    /* The UTC time in milliseconds at local_ms */
+    uint64_t utc_ms;
+} time_sync_t;
+
+/* First synchronization, the drift is estimated over the time since it */
+static time_sync_t reference_sync;
+
+/* Latest synchronization, conversions are made from it */
+static time_sync_t latest_sync;
+
+/* Whether the time has been synchronized */
+static uint8_t is_synced;
+
+/* Whether the drift has been estimated */
+static uint8_t is_drift_estimated;
+
+/* Estimated drift of the local clock in parts per million, positive when the local clock runs slow */
+static int32_t drift_ppm;
+
+/* Protects the synchronization, it is set from the radio and read while timestamping readings */
+static struct k_spinlock time_lock;
+
+int sensor_time_sync(uint64_t local_ms, uint64_t utc_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&time_lock);
+    if (!is_synced) {
+        reference_sync.local_ms = local_ms;
+        reference_sync.utc_ms = utc_ms;
+    }
+    else if (local_ms - reference_sync.local_ms >= SENSOR_TIME_MIN_DRIFT_INTERVAL_MS) {
+        /* The longer the time since the reference, the less the resolution of the sync matters */
+        int64_t local_elapsed = (int64_t)(local_ms - reference_sync.local_ms);
+        int64_t utc_elapsed = (int64_t)(utc_ms - reference_sync.utc_ms);
+        int64_t measured_ppm = ((utc_elapsed - local_elapsed) * PPM_SCALE) / local_elapsed;
+        if (measured_ppm > SENSOR_TIME_MAX_DRIFT_PPM || measured_ppm < -SENSOR_TIME_MAX_DRIFT_PPM) {
+            /* Either sync may be the bad one, start over from this one so a bad reference is not kept forever */
+            reference_sync.local_ms = local_ms;
+            reference_sync.utc_ms = utc_ms;
+            k_spin_unlock(&time_lock, key);
+            LOG_ERR("Time sync drift of %lld ppm is out of bounds", measured_ppm);
+            return -EINVAL;
+        }
+        drift_ppm = (int32_t)measured_ppm;
+        is_drift_estimated = 1;
+    }
+    latest_sync.local_ms = local_ms;
+    latest_sync.utc_ms = utc_ms;
+    is_synced = 1;
+    k_spin_unlock(&time_lock, key);
+    LOG_INF("Time synced to %llu ms UTC, drift %d ppm", utc_ms, drift_ppm);
+    return 0;
+}
+
+int sensor_time_sync_gps(uint64_t local_ms, uint32_t gps_seconds)
+{
+    if (gps_seconds < SENSOR_TIME_MIN_VALID_GPS_SECONDS) {
+        LOG_WRN("GPS time %u is not set by the network", gps_seconds);
+        return -EINVAL;
+    }
+    uint64_t utc_seconds = (uint64_t)gps_seconds + SENSOR_TIME_GPS_UNIX_OFFSET_SECONDS - SENSOR_TIME_GPS_LEAP_SECONDS;
+    return sensor_time_sync(local_ms, utc_seconds * 1000);
+}
+
+int sensor_time_is_synced(void)
+{
+    return is_synced;
+}
+
+int sensor_time_needs_sync(uint64_t local_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&time_lock);
+    int needs_sync = !is_synced || (local_ms - latest_sync.local_ms >= SENSOR_TIME_RESYNC_INTERVAL_MS);
+    k_spin_unlock(&time_lock, key);
+    return needs_sync;
+}
+
+int sensor_time_get_drift_ppm(int32_t *ppm)
+{
+    if (!is_drift_estimated) {
+        return -EAGAIN;
+    }
+    *ppm = drift_ppm;
+    return 0;
+}
+
+int sensor_time_local_to_utc_ms(uint64_t local_ms, uint64_t *utc_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&time_lock);
+    if (!is_synced) {
+        k_spin_unlock(&time_lock, key);
+        return -EAGAIN;
+    }
+    int64_t local_elapsed = (int64_t)(local_ms - latest_sync.local_ms);
+    *utc_ms = latest_sync.utc_ms + local_elapsed + ((local_elapsed * drift_ppm) / PPM_SCALE);
+    k_spin_unlock(&time_lock, key);
+    return 0;
+}
+
+int sensor_time_utc_to_local_ms(uint64_t utc_ms, uint64_t *local_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&time_lock);
+    if (!is_synced) {
+        k_spin_unlock(&time_lock, key);
+        return -EAGAIN;
+    }
+    int64_t utc_elapsed = (int64_t)(utc_ms - latest_sync.utc_ms);
+    int64_t local_elapsed = (utc_elapsed * PPM_SCALE) / (PPM_SCALE + drift_ppm);
+    if (local_elapsed < 0 && (uint64_t)(-local_elapsed) > latest_sync.local_ms) {
+        k_spin_unlock(&time_lock, key);
+        return -ERANGE;
+    }
+    *local_ms = latest_sync.local_ms + local_elapsed;
+    k_spin_unlock(&time_lock, key);
+    return 0;
+}
+
+int sensor_time_get_aligned_anchor_ms(uint64_t local_ms, uint32_t period_seconds, uint64_t *anchor_ms)
+{
+    uint64_t utc_ms;
+    if (period_seconds == 0) {
+        return -EINVAL;
+    }
+    int ret = sensor_time_local_to_utc_ms(local_ms, &utc_ms);
+    if (ret != 0) {
+        return ret;
+    }
+    uint64_t period_ms = (uint64_t)period_seconds * 1000;
+    uint64_t aligned_utc_ms = ((utc_ms / period_ms) + 1) * period_ms;
+    return sensor_time_utc_to_local_ms(aligned_utc_ms, anchor_ms);
+}
+
+void sensor_time_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&time_lock);
+    is_synced = 0;
+    is_drift_estimated = 0;
+    drift_ppm = 0;
+    k_spin_unlock(&time_lock, key);
+}
@@ -12,17 +12,52 @@
 
 #include <sensor_timer.h>
 #include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER(SENSOR_TIMER, LOG_LEVEL_INF);
 
-static uint32_t total_overflown_seconds = 0;
+/* Ticks counted by all the previous wraps of the counter */
+static uint64_t total_overflown_ticks = 0;
+
+/* Sequence counter for total_overflown_ticks, odd while it is being updated */
+static atomic_t timebase_sequence = ATOMIC_INIT(0);
+
+/* Latest total returned, used to detect a wrap whose callback has not run yet */
+static uint64_t last_total_ticks = 0;
+
+/* Kernel uptime of the latest total returned, to tell how far the total should have moved since */
+static int64_t last_total_uptime_ms = 0;
+
+static struct k_spinlock last_total_lock;
+
+/**
+ * @brief Alarm that may need several counter alarms to reach its deadline.
+ */
+typedef struct {
+    /* User callback to call at the deadline */
+    counter_alarm_callback_t callback;
+    /* Total ticks the user callback is due at */
+    uint64_t deadline_ticks;
+    /* Whether the alarm is waiting for its deadline */
+    uint8_t is_active;
+} chained_alarm_t;
+
+static chained_alarm_t chained_alarms[SENSOR_TIMER_MAX_CHANNELS];
+
+static void chained_alarm_callback(const struct device *dev, uint8_t chan_id, uint32_t ticks, void *user_data);
+
+static void set_overflown_ticks(uint64_t ticks)
+{
+    atomic_inc(&timebase_sequence);
+    total_overflown_ticks = ticks;
+    atomic_inc(&timebase_sequence);
+}
 
 static void top_value_callback(const struct device *dev, void *user_data)
 {
     LOG_DBG("Top value callback called");
-    uint32_t top_value_seconds = counter_get_top_value(dev) / counter_get_frequency(dev);
-    total_overflown_seconds += (top_value_seconds + 1);
+    set_overflown_ticks(total_overflown_ticks + (uint64_t)counter_get_top_value(dev) + 1);
 }
 
 int sensor_timer_init(const struct device *dev)
@@ -49,6 +84,10 @@ int sensor_timer_init(const struct device *dev)
 
 int sensor_timer_start(const struct device *dev)
 {
+    /* The uptime while stopped is not on the timebase, count the elapsed uptime from here */
+    k_spinlock_key_t key = k_spin_lock(&last_total_lock);
+    last_total_uptime_ms = k_uptime_get();
+    k_spin_unlock(&last_total_lock, key);
     return counter_start(dev);
 }
 
@@ -64,14 +103,66 @@ int sensor_timer_get_current_seconds(const struct device *dev)
     return (int)(ticks / counter_get_frequency(dev));
 }
 
+int sensor_timer_get_total_ticks(const struct device *dev, uint64_t *total_ticks)
+{
+    int ret;
+    atomic_val_t sequence;
+    uint64_t overflown_ticks;
+    uint32_t ticks;
+    /* Retry if the top value callback updated the overflown ticks while they were read */
+    do {
+        sequence = atomic_get(&timebase_sequence);
+        overflown_ticks = total_overflown_ticks;
+        ret = counter_get_value(dev, &ticks);
+        if (ret != 0) {
+            return ret;
+        }
+    } while ((sequence & 1) || sequence != atomic_get(&timebase_sequence));
+
+    uint64_t total = overflown_ticks + ticks;
+    uint64_t wrap_ticks = (uint64_t)counter_get_top_value(dev) + 1;
+    k_spinlock_key_t key = k_spin_lock(&last_total_lock);
+    int64_t uptime_ms = k_uptime_get();
+    /* Reading with interrupts locked can see the wrapped counter before the top value callback adds the 
+     * overflow, add the wrap here so time never goes backwards. Without a read since the wrap, a pending 
+     * interrupt with the counter in its first half and the total more than half a wrap behind the uptime 
+     * elapsed since the last read is the wrap. */
+    if (total < last_total_ticks) {
+        total += wrap_ticks;
+    }
+    else if ((ticks < (wrap_ticks / 2)) && (counter_get_pending_int(dev) > 0)) {
+        uint64_t expected_ticks = last_total_ticks + 
+            (((uint64_t)(uptime_ms - last_total_uptime_ms) * counter_get_frequency(dev)) / 1000);
+        if (total + (wrap_ticks / 2) < expected_ticks) {
+            total += wrap_ticks;
+        }
+    }
+    last_total_ticks = total;
+    last_total_uptime_ms = uptime_ms;
+    k_spin_unlock(&last_total_lock, key);
+    *total_ticks = total;
+    return 0;
+}
+
+int sensor_timer_get_total_ms(const struct device *dev, uint64_t *total_ms)
+{
+    uint64_t ticks;
+    int ret = sensor_timer_get_total_ticks(dev, &ticks);
+    if (ret != 0) {
+        return ret;
+    }
+    *total_ms = (ticks * 1000) / counter_get_frequency(dev);
+    return 0;
+}
+
 int sensor_timer_get_total_seconds(const struct device *dev)
 {
-    int current_seconds = sensor_timer_get_current_seconds(dev);
-    if (current_seconds < 0) {
-        LOG_ERR("Failed to get current seconds");
+    uint64_t ticks;
+    if (sensor_timer_get_total_ticks(dev, &ticks) != 0) {
+        LOG_ERR("Failed to get total ticks");
         return -EINVAL;
     }
-    return total_overflown_seconds + current_seconds;
+    return (int)(ticks / counter_get_frequency(dev));
 }
 
 int sensor_timer_reset(const struct device *dev)
@@ -108,48 +199,104 @@ int sensor_timer_reset(const struct device *dev)
     }
     
     /* Reset our overflow tracking */
-    total_overflown_seconds = 0;
+    set_overflown_ticks(0);
+    k_spinlock_key_t key = k_spin_lock(&last_total_lock);
+    last_total_ticks = 0;
+    last_total_uptime_ms = k_uptime_get();
+    k_spin_unlock(&last_total_lock, key);
     
     return 0;
 }
 
 int sensor_timer_stop(const struct device *dev)
 {
-    return counter_stop(dev);
+    uint64_t ticks;
+    int ret = counter_stop(dev);
+    if (ret != 0) {
+        return ret;
+    }
+    /* Keep the latest total at the stopped counter so the next start measures the elapsed uptime from it */
+    return sensor_timer_get_total_ticks(dev, &ticks);
 }
 
-// Replace the entire function from line 111 to 128 with:
-int sensor_timer_set_alarm(const struct device *dev, sensor_timer_alarm_cfg_t *sensor_timer_alarm_cfg)
+/**
+ * @brief Arm the counter for the next step of a chained alarm. Each step is as long as the counter allows 
+ * so the number of intermediate wake-ups is kept to a minimum.
+ * 
+ * @param dev The timer device
+ * @param channel The channel of the alarm
+ * @param remaining_ticks Ticks left until the deadline, must be greater than 0
+ * @return int 0 on success, negative error code on failure
+ */
+static int arm_chained_alarm(const struct device *dev, uint8_t channel, uint64_t remaining_ticks)
 {
-    int ret;
-    uint32_t alarm_ticks;
-    
-    // Convert seconds to ticks by multiplying by frequency
-    alarm_ticks = sensor_timer_alarm_cfg->alarm_seconds * counter_get_frequency(dev);
-    
+    uint32_t top_value = counter_get_top_value(dev);
     struct counter_alarm_cfg alarm_cfg = {
-        .callback = sensor_timer_alarm_cfg->callback,
-        .ticks = alarm_ticks,
+        .callback = chained_alarm_callback,
+        .ticks = (remaining_ticks > top_value) ? top_value : (uint32_t)remaining_ticks,
         .flags = 0,  // Relative alarm
     };
-    
-    /* Make sure the alarm ticks are not greater than the top value of the timer */
-    if (alarm_ticks > counter_get_top_value(dev)) {
-        LOG_ERR("Alarm ticks (%u) are greater than the top value (%u) of the timer", 
-                alarm_ticks, counter_get_top_value(dev));
+    return counter_set_channel_alarm(dev, channel, &alarm_cfg);
+}
+
+static void chained_alarm_callback(const struct device *dev, uint8_t chan_id, uint32_t ticks, void *user_data)
+{
+    chained_alarm_t *alarm = &chained_alarms[chan_id];
+    uint64_t now_ticks;
+    if (!alarm->is_active) {
+        return;
+    }
+    /* Intermediate wake-up, re-arm for what is left without calling the user */
+    if (sensor_timer_get_total_ticks(dev, &now_ticks) == 0 && now_ticks < alarm->deadline_ticks) {
+        if (arm_chained_alarm(dev, chan_id, alarm->deadline_ticks - now_ticks) == 0) {
+            return;
+        }
+        LOG_ERR("Failed to chain alarm on channel %d, calling it early", chan_id);
+    }
+    alarm->is_active = 0;
+    alarm->callback(dev, chan_id, ticks, user_data);
+}
+
+int sensor_timer_set_alarm(const struct device *dev, sensor_timer_alarm_cfg_t *sensor_timer_alarm_cfg)
+{
+    int ret;
+    uint8_t channel = sensor_timer_alarm_cfg->channel;
+    if (channel >= SENSOR_TIMER_MAX_CHANNELS || channel >= counter_get_num_of_channels(dev)) {
+        LOG_ERR("Alarm channel %d is not available", channel);
         return -EINVAL;
     }
+    
+    // Convert to ticks, rounding the milliseconds up so the alarm never fires early
+    uint64_t alarm_ticks = ((uint64_t)sensor_timer_alarm_cfg->alarm_seconds * counter_get_frequency(dev)) + 
+        DIV_ROUND_UP((uint64_t)sensor_timer_alarm_cfg->alarm_ms * counter_get_frequency(dev), 1000);
+    if (alarm_ticks == 0) {
+        alarm_ticks = 1;
+    }
+    uint64_t now_ticks;
+    ret = sensor_timer_get_total_ticks(dev, &now_ticks);
+    if (ret != 0) {
+        return ret;
+    }
 
+    /* Alarms longer than the top value of the timer are chained in the alarm callback */
+    chained_alarm_t *alarm = &chained_alarms[channel];
+    alarm->callback = sensor_timer_alarm_cfg->callback;
+    alarm->deadline_ticks = now_ticks + alarm_ticks;
+    alarm->is_active = 1;
     sensor_timer_alarm_cfg->is_alarm_set = 1;
-    ret = counter_set_channel_alarm(dev, sensor_timer_alarm_cfg->channel, &alarm_cfg);
+    ret = arm_chained_alarm(dev, channel, alarm_ticks);
     if (ret != 0) {
+        alarm->is_active = 0;
         return ret;
     }
     
-    return 0;  // Add missing return statement
+    return 0;
 }
 
 int sensor_timer_cancel_alarm(const struct device *dev, uint8_t channel)
 {
+    if (channel < SENSOR_TIMER_MAX_CHANNELS) {
+        chained_alarms[channel].is_active = 0;
+    }
     return counter_cancel_channel_alarm(dev, channel);
 }
\ No newline at end of file
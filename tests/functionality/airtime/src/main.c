@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Tests:
+ * - Time on air matches the LoRa modem formula
+ * - Low data rate optimization is used for long symbols
+ * - Uplink time on air includes the LoRaWAN overhead
+ * - Maximum payloads of the US915 data rates
+ * - Payloads that do not fit the data rate are rejected
+ */
+
+#include <zephyr/ztest.h>
+#include "sensor_airtime.h"
+
+ZTEST_SUITE(airtime, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Test that the time on air of SF7 and SF10 at 125 kHz matches the LoRa modem formula
+ * 
+ */
+ZTEST(airtime, test_airtime_time_on_air)
+{
+    uint32_t time_on_air_us;
+    sensor_airtime_modulation_t modulation = {
+        .spreading_factor = 7,
+        .bandwidth_khz = 125,
+        .coding_rate = 5,
+    };
+    int ret = sensor_airtime_get_time_on_air_us(&modulation, 24, &time_on_air_us);
+    zassert_ok(ret, "Time on air failed");
+    zassert_equal(time_on_air_us, 61696, "Expected 61696 us, actual is %d", time_on_air_us);
+    modulation.spreading_factor = 10;
+    ret = sensor_airtime_get_time_on_air_us(&modulation, 24, &time_on_air_us);
+    zassert_ok(ret, "Time on air failed");
+    zassert_equal(time_on_air_us, 370688, "Expected 370688 us, actual is %d", time_on_air_us);
+    modulation.spreading_factor = 13;
+    ret = sensor_airtime_get_time_on_air_us(&modulation, 24, &time_on_air_us);
+    zassert_equal(ret, -EINVAL, "Spreading factor 13 should fail");
+}
+
+/**
+ * @brief Test that low data rate optimization is used for SF12 at 125 kHz
+ * 
+ */
+ZTEST(airtime, test_airtime_low_datarate_optimization)
+{
+    uint32_t time_on_air_us;
+    sensor_airtime_modulation_t modulation = {
+        .spreading_factor = 12,
+        .bandwidth_khz = 125,
+        .coding_rate = 5,
+    };
+    int ret = sensor_airtime_get_time_on_air_us(&modulation, 24, &time_on_air_us);
+    zassert_ok(ret, "Time on air failed");
+    zassert_equal(time_on_air_us, 1482752, "Expected 1482752 us, actual is %d", time_on_air_us);
+}
+
+/**
+ * @brief Test that the uplink time on air adds the LoRaWAN overhead to the application payload
+ * 
+ */
+ZTEST(airtime, test_airtime_uplink_time_on_air)
+{
+    uint32_t time_on_air_us;
+    int ret = sensor_airtime_get_uplink_time_on_air_us(LORAWAN_DR_3, 11, &time_on_air_us);
+    zassert_ok(ret, "Uplink time on air failed");
+    zassert_equal(time_on_air_us, 61696, "Expected 61696 us, actual is %d", time_on_air_us);
+    ret = sensor_airtime_get_uplink_time_on_air_us(LORAWAN_DR_4, 11, &time_on_air_us);
+    zassert_ok(ret, "Uplink time on air failed");
+    zassert_equal(time_on_air_us, 28288, "Expected 28288 us, actual is %d", time_on_air_us);
+}
+
+/**
+ * @brief Test the maximum payloads of the US915 data rates
+ * 
+ */
+ZTEST(airtime, test_airtime_max_payload)
+{
+    const uint16_t expected_max_payload[] = {11, 53, 125, 242, 242};
+    uint16_t max_payload;
+    for (enum lorawan_datarate dr = LORAWAN_DR_0; dr <= LORAWAN_DR_4; dr++) {
+        int ret = sensor_airtime_get_max_payload(dr, &max_payload);
+        zassert_ok(ret, "Max payload of DR%d failed", dr);
+        zassert_equal(max_payload, expected_max_payload[dr], "Expected %d bytes at DR%d, actual is %d", expected_max_payload[dr], dr, max_payload);
+    }
+    zassert_equal(sensor_airtime_get_max_payload(LORAWAN_DR_5, &max_payload), -EINVAL, "DR5 is not a US915 uplink data rate");
+}
+
+/**
+ * @brief Test that a payload larger than the maximum of the data rate is rejected
+ * 
+ */
+ZTEST(airtime, test_airtime_payload_too_large)
+{
+    uint32_t time_on_air_us;
+    int ret = sensor_airtime_get_uplink_time_on_air_us(LORAWAN_DR_0, 12, &time_on_air_us);
+    zassert_equal(ret, -EMSGSIZE, "12 bytes should not fit DR0");
+    ret = sensor_airtime_get_uplink_time_on_air_us(LORAWAN_DR_3, 243, &time_on_air_us);
+    zassert_equal(ret, -EMSGSIZE, "243 bytes should not fit DR3");
+}
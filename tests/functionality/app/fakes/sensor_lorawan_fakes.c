@@ -7,6 +7,14 @@ DEFINE_FAKE_VOID_FUNC(sensor_lorawan_log_network_config, lorawan_setup_t*);
 DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_setup, lorawan_setup_t*);
 DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_send_data, lorawan_data_t*);
 DEFINE_FAKE_VALUE_FUNC(int, is_lorawan_connected);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_request_time);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_get_gps_time, uint32_t*);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_set_max_datarate, enum lorawan_datarate);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_get_max_payload, uint16_t*);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_get_last_time_on_air_us, uint32_t*);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_get_session, lorawan_session_t*);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_lorawan_wait_joined, k_timeout_t);
+DEFINE_FAKE_VALUE_FUNC(enum sensor_budget_level, sensor_lorawan_get_budget_level);
 
 // Reset all fakes
 void sensor_lorawan_fakes_reset(void)
@@ -16,4 +24,12 @@ void sensor_lorawan_fakes_reset(void)
     RESET_FAKE(sensor_lorawan_setup);
     RESET_FAKE(sensor_lorawan_send_data);
     RESET_FAKE(is_lorawan_connected);
+    RESET_FAKE(sensor_lorawan_request_time);
+    RESET_FAKE(sensor_lorawan_get_gps_time);
+    RESET_FAKE(sensor_lorawan_set_max_datarate);
+    RESET_FAKE(sensor_lorawan_get_max_payload);
+    RESET_FAKE(sensor_lorawan_get_last_time_on_air_us);
+    RESET_FAKE(sensor_lorawan_get_session);
+    RESET_FAKE(sensor_lorawan_wait_joined);
+    RESET_FAKE(sensor_lorawan_get_budget_level);
 }
\ No newline at end of file
@@ -6,13 +6,57 @@
 #include <zephyr/lorawan/lorawan.h>
 #include <stdint.h>
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include "sensor_budget.h"
 
 #define MAX_LORAWAN_PAYLOAD 255
 
+/* Number of 16 bit words in the channel mask, the largest mask of the LoRaMAC regions */
+#define SENSOR_LORAWAN_CHANNELS_MASK_SIZE 6
+
+/**
+ * @brief Structure to hold the receive window and channel parameters of a session, set by the JoinAccept and 
+ * changed by the network with MAC commands.
+ */
+typedef struct {
+    /* Delay from the end of an uplink to the first receive window in milliseconds. */
+    uint32_t rx1_delay;
+    /* Frequency of the second receive window in Hz. */
+    uint32_t rx2_frequency;
+    /* Data rate of the second receive window. */
+    uint8_t rx2_datarate;
+    /* Offset of the first receive window data rate from the uplink data rate. */
+    uint8_t rx1_dr_offset;
+    /* Enabled channels, a bit for each channel. */
+    uint16_t channels_mask[SENSOR_LORAWAN_CHANNELS_MASK_SIZE];
+} lorawan_mac_params_t;
+
+/**
+ * @brief Structure to hold a LoRaWAN session, restored at start instead of joining the network again.
+ */
+typedef struct {
+    /* Device address assigned by the network at join. */
+    uint32_t dev_addr;
+    /* Uplink frame counter the restored session continues from. */
+    uint32_t fcnt_up;
+    /* Downlink frame counter of the last downlink received, the 32 bit counter of later downlinks is rebuilt from it. */
+    uint32_t fcnt_down;
+    /* Receive window and channel parameters. */
+    lorawan_mac_params_t mac_params;
+    /* Network session key. */
+    uint8_t nwk_skey[16];
+    /* Application session key. */
+    uint8_t app_skey[16];
+} lorawan_session_t;
+
 /**
  * @brief Structure to hold the LoRaWAN setup, used to join the network.
  */
 typedef struct {
+    /* Whether the LoRaWAN is enabled. */
+    uint8_t is_lorawan_enabled;
+    /* Interval between LoRaWAN uplinks in seconds. */
+    uint32_t lorawan_frequency;
     /* LoRaWAN Device. */
     const struct device *lora_dev;
     /* LoRaWAN uplink class. */
@@ -23,6 +67,12 @@ typedef struct {
     int join_attempts;
     /* Device Nonce for LoRaWAN Network. Should be tracked seperately for different euis. */
     uint16_t dev_nonce;
+    /* Nonces below this one are reserved in storage and can be used without storing them. */
+    uint16_t dev_nonce_reserved;
+    /* Stores the first nonce after a newly reserved block, called before any nonce of the block is used. Returns 0 on success. */
+    int (*store_dev_nonce)(uint16_t dev_nonce_reserved);
+    /* Called from the join thread with the result of a background join, 0 if joined. Can be NULL. */
+    void (*join_callback)(int result);
     /* Delay between joinattempts in milliseconds. */
     uint32_t delay;
     /* Device EUI for LoRaWAN Network. */
@@ -31,7 +81,15 @@ typedef struct {
     uint8_t join_eui[8];
     /* App Key for LoRaWAN Network. */
     uint8_t app_key[16];
-
+    /* How many attempts to send a confirmed message, uplinks are only confirmed when the link policy asks for it. 
+     * If 0, every message is sent unconfirmed. */
+    uint8_t send_attempts;
+    /* Session of the last join, set after a join. */
+    lorawan_session_t session;
+    /* Whether the session is valid, a valid session is restored instead of joining. */
+    uint8_t is_session_valid;
+    /* Whether the last setup restored the session instead of joining. */
+    uint8_t is_session_restored;
 } lorawan_setup_t;
 
 /**
@@ -46,8 +104,12 @@ typedef struct {
     uint8_t port;
     /* How many attempts to send data when waiting for an ack, if 0, it will send an unconfirmed message. */
     uint8_t attempts;
+    /* Whether the data must be delivered, it is sent confirmed when attempts is not 0. */
+    uint8_t is_critical;
     /* Delay between attempts in milliseconds. */
     uint32_t delay;
+    /* Set by sensor_lorawan_send_data, whether the data was sent confirmed and acknowledged. */
+    uint8_t is_acked;
 } lorawan_data_t;
 
 // Declare fake functions
@@ -56,6 +118,14 @@ DECLARE_FAKE_VOID_FUNC(sensor_lorawan_log_network_config, lorawan_setup_t*);
 DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_setup, lorawan_setup_t*);
 DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_send_data, lorawan_data_t*);
 DECLARE_FAKE_VALUE_FUNC(int, is_lorawan_connected);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_request_time);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_get_gps_time, uint32_t*);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_set_max_datarate, enum lorawan_datarate);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_get_max_payload, uint16_t*);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_get_last_time_on_air_us, uint32_t*);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_get_session, lorawan_session_t*);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_lorawan_wait_joined, k_timeout_t);
+DECLARE_FAKE_VALUE_FUNC(enum sensor_budget_level, sensor_lorawan_get_budget_level);
 
 // Reset all fakes
 void sensor_lorawan_fakes_reset(void);
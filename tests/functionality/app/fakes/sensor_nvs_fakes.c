@@ -0,0 +1,19 @@
+// In tests/fakes/sensor_nvs_fakes.c
+#include "sensor_nvs_fakes.h"
+
+// Define fake functions
+DEFINE_FAKE_VALUE_FUNC(int, sensor_nvs_setup, uint8_t);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_nvs_write, uint8_t, const void *, size_t);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_nvs_read, uint8_t, void *, size_t);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_nvs_delete, uint8_t);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_nvs_clear);
+
+// Reset all fakes
+void sensor_nvs_fakes_reset(void)
+{
+    RESET_FAKE(sensor_nvs_setup);
+    RESET_FAKE(sensor_nvs_write);
+    RESET_FAKE(sensor_nvs_read);
+    RESET_FAKE(sensor_nvs_delete);
+    RESET_FAKE(sensor_nvs_clear);
+}
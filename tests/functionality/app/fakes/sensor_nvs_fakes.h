@@ -0,0 +1,21 @@
+// In tests/fakes/sensor_nvs_fakes.h
+#ifndef SENSOR_NVS_FAKES_H
+#define SENSOR_NVS_FAKES_H
+
+#include <zephyr/fff.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SENSOR_NVS_MAX_SIZE 32
+
+// Declare fake functions
+DECLARE_FAKE_VALUE_FUNC(int, sensor_nvs_setup, uint8_t);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_nvs_write, uint8_t, const void *, size_t);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_nvs_read, uint8_t, void *, size_t);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_nvs_delete, uint8_t);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_nvs_clear);
+
+// Reset all fakes
+void sensor_nvs_fakes_reset(void);
+
+#endif // SENSOR_NVS_FAKES_H
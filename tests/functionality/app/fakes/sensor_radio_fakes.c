@@ -0,0 +1,15 @@
+// In tests/fakes/sensor_radio_fakes.c
+#include "sensor_radio_fakes.h"
+
+// Define fake functions
+DEFINE_FAKE_VALUE_FUNC(int, sensor_radio_enqueue, const sensor_radio_uplink_t *);
+DEFINE_FAKE_VOID_FUNC(sensor_radio_flush);
+DEFINE_FAKE_VALUE_FUNC(int, sensor_radio_get_queued);
+
+// Reset all fakes
+void sensor_radio_fakes_reset(void)
+{
+    RESET_FAKE(sensor_radio_enqueue);
+    RESET_FAKE(sensor_radio_flush);
+    RESET_FAKE(sensor_radio_get_queued);
+}
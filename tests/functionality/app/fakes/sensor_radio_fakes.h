@@ -0,0 +1,39 @@
+// In tests/fakes/sensor_radio_fakes.h
+#ifndef SENSOR_RADIO_FAKES_H
+#define SENSOR_RADIO_FAKES_H
+
+#include <zephyr/fff.h>
+#include <stdint.h>
+#include "sensor_lorawan_fakes.h"
+
+enum sensor_radio_priority {
+    SENSOR_RADIO_PRIORITY_HIGH,
+    SENSOR_RADIO_PRIORITY_LOW,
+    SENSOR_RADIO_PRIORITY_LIMIT,
+};
+
+enum sensor_radio_result {
+    SENSOR_RADIO_RESULT_SENT,
+    SENSOR_RADIO_RESULT_ACKED,
+    SENSOR_RADIO_RESULT_FAILED,
+    SENSOR_RADIO_RESULT_DROPPED,
+};
+
+typedef void (*sensor_radio_callback_t)(enum sensor_radio_result result, void *user_data);
+
+typedef struct {
+    lorawan_data_t data;
+    enum sensor_radio_priority priority;
+    sensor_radio_callback_t callback;
+    void *user_data;
+} sensor_radio_uplink_t;
+
+// Declare fake functions
+DECLARE_FAKE_VALUE_FUNC(int, sensor_radio_enqueue, const sensor_radio_uplink_t *);
+DECLARE_FAKE_VOID_FUNC(sensor_radio_flush);
+DECLARE_FAKE_VALUE_FUNC(int, sensor_radio_get_queued);
+
+// Reset all fakes
+void sensor_radio_fakes_reset(void);
+
+#endif // SENSOR_RADIO_FAKES_H
@@ -7,6 +7,10 @@ DEFINE_FAKE_VALUE_FUNC(float, get_sensor_voltage_reading, sensor_reading_config_
 DEFINE_FAKE_VALUE_FUNC(float, get_sensor_current_reading, sensor_reading_config_t *);
 DEFINE_FAKE_VALUE_FUNC(int, get_sensor_pulse_count, sensor_reading_config_t *);
 DEFINE_FAKE_VALUE_FUNC(int, reset_sensor_pulse_count, sensor_reading_config_t *);
+DEFINE_FAKE_VOID_FUNC(sensor_reading_set_temperature, int32_t);
+DEFINE_FAKE_VALUE_FUNC(int, get_sensor_signed_count, sensor_reading_config_t *, int32_t *);
+DEFINE_FAKE_VALUE_FUNC(int, reset_sensor_signed_count, sensor_reading_config_t *);
+DEFINE_FAKE_VALUE_FUNC(int, get_sensor_frequency, sensor_reading_config_t *, float *);
 
 // Reset all fakes
 void sensor_reading_fakes_reset(void)
@@ -17,4 +21,8 @@ void sensor_reading_fakes_reset(void)
     RESET_FAKE(get_sensor_current_reading);
     RESET_FAKE(get_sensor_pulse_count);
     RESET_FAKE(reset_sensor_pulse_count);
+    RESET_FAKE(sensor_reading_set_temperature);
+    RESET_FAKE(get_sensor_signed_count);
+    RESET_FAKE(reset_sensor_signed_count);
+    RESET_FAKE(get_sensor_frequency);
 }
\ No newline at end of file
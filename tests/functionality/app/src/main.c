@@ -6,10 +6,20 @@
  * - Confirm schedule can be initialized
  * - multiple actions can be tied to one alarm 
  * - actions can be scheduled to occur at different times
+ * - intervals stored as a single byte of minutes are migrated to 4 bytes of seconds
+ * - intervals written over BLE are 4 bytes of seconds or a single byte of minutes, above a floor
+ * - a LoRaWAN session stored in part is joined again
+ * - a restored session reserves the frame counters after the stored one
+ * - a new reservation is only written once the uplinks are within the margin of the last one
+ * - a newly joined session is written with its DevAddr last
+ * - the full header is sent with the first uplink after boot, after a configuration change, with an acknowledgement, 
+ *   every SENSOR_APP_FULL_HEADER_INTERVAL uplinks and again after a failed uplink
+ * - the configuration of a downlink is committed to NVS in one write before its settings are written
  */
 
 #include <zephyr/ztest.h>
 #include "sensor_app.h"
+#include "sensor_downlink.h"
 
 #include <zephyr/logging/log.h>
 #include <zephyr/fff.h>
@@ -18,6 +28,8 @@
 #include "sensor_reading_fakes.h"
 #include "sensor_lorawan_fakes.h"
 #include "sensor_pmic_fakes.h"
+#include "sensor_radio_fakes.h"
+#include "sensor_nvs_fakes.h"
 
 LOG_MODULE_REGISTER(tests_app, LOG_LEVEL_DBG);
 
@@ -35,6 +47,316 @@ sensor_app_config_t sensor_app_config = {
     .sensor_2_frequency = 0,
 };
 
+/* Interval between uplinks of the tests that run the app, short so the tests do not wait long for them */
+#define TEST_LORAWAN_INTERVAL       2
+
+/* Uplinks are queued at most this long after the running state starts or the last one completes */
+#define TEST_UPLINK_TIMEOUT         K_SECONDS(3 * TEST_LORAWAN_INTERVAL)
+
+#define TEST_MAX_NVS_WRITES         64
+#define TEST_RUNNING_STACK_SIZE     4096
+
+/**
+ * @brief Entry of the NVS kept in RAM by the fakes, the data of an address and its length, 0 if not stored.
+ */
+typedef struct {
+    uint8_t data[SENSOR_NVS_MAX_SIZE];
+    size_t length;
+} test_nvs_entry_t;
+
+static test_nvs_entry_t nvs_entries[SENSOR_NVS_ADDRESS_LIMIT];
+
+/* Addresses in the order they were written, and whether a session was marked valid by its DevAddr at the time */
+static uint8_t nvs_write_log[TEST_MAX_NVS_WRITES];
+static uint8_t nvs_write_dev_addr_stored[TEST_MAX_NVS_WRITES];
+static int nvs_write_count;
+
+/* Session stored by an earlier join */
+static const lorawan_session_t stored_session = {
+    .dev_addr = 0x260B1234,
+    .fcnt_up = 1000,
+    .fcnt_down = 20,
+    .mac_params = {
+        .rx1_delay = 1000,
+        .rx2_frequency = 869525000,
+        .rx2_datarate = 3,
+        .channels_mask = {0x00FF},
+    },
+    .nwk_skey = {0x01},
+    .app_skey = {0x02},
+};
+
+/* Session set by the LoRaWAN fakes, joined by sensor_lorawan_setup and read back by sensor_lorawan_get_session */
+static lorawan_session_t test_session;
+
+/* Last uplink queued, until it is completed by the test or dropped by a flush */
+static sensor_radio_uplink_t queued_uplink;
+static uint8_t is_uplink_queued;
+K_SEM_DEFINE(uplink_sem, 0, 1);
+
+K_THREAD_STACK_DEFINE(running_stack, TEST_RUNNING_STACK_SIZE);
+static struct k_thread running_thread;
+static int running_ret;
+
+static int ram_nvs_setup(uint8_t nvs_address_count)
+{
+    return 0;
+}
+
+/**
+ * @brief Write an address of the NVS kept in RAM. As with NVS, unchanged data is not written and 
+ * sensor_nvs_write reports it as failed.
+ * 
+ */
+static int ram_nvs_write(uint8_t address, const void *data, size_t length)
+{
+    if(address >= SENSOR_NVS_ADDRESS_LIMIT || length > SENSOR_NVS_MAX_SIZE)
+    {
+        return -1;
+    }
+    test_nvs_entry_t *entry = &nvs_entries[address];
+    if(entry->length == length && memcmp(entry->data, data, length) == 0)
+    {
+        return -1;
+    }
+    if(nvs_write_count < TEST_MAX_NVS_WRITES)
+    {
+        nvs_write_log[nvs_write_count] = address;
+        nvs_write_dev_addr_stored[nvs_write_count] = nvs_entries[SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR].length != 0;
+    }
+    nvs_write_count++;
+    memcpy(entry->data, data, length);
+    entry->length = length;
+    return 0;
+}
+
+/**
+ * @brief Read an address of the NVS kept in RAM, as with NVS it fails unless the stored length is the one read.
+ * 
+ */
+static int ram_nvs_read(uint8_t address, void *data, size_t length)
+{
+    if(address >= SENSOR_NVS_ADDRESS_LIMIT || nvs_entries[address].length == 0 || nvs_entries[address].length != length)
+    {
+        return -1;
+    }
+    memcpy(data, nvs_entries[address].data, length);
+    return 0;
+}
+
+static int ram_nvs_delete(uint8_t address)
+{
+    if(address >= SENSOR_NVS_ADDRESS_LIMIT)
+    {
+        return -1;
+    }
+    nvs_entries[address].length = 0;
+    return 0;
+}
+
+static int ram_nvs_clear(void)
+{
+    memset(nvs_entries, 0, sizeof(nvs_entries));
+    return 0;
+}
+
+/**
+ * @brief Count the writes to an address since the write log was cleared.
+ * 
+ */
+static int count_nvs_writes(uint8_t address)
+{
+    int count = 0;
+    for(int i = 0; i < MIN(nvs_write_count, TEST_MAX_NVS_WRITES); i++)
+    {
+        count += nvs_write_log[i] == address;
+    }
+    return count;
+}
+
+static void clear_nvs_write_log(void)
+{
+    memset(nvs_write_log, 0, sizeof(nvs_write_log));
+    memset(nvs_write_dev_addr_stored, 0, sizeof(nvs_write_dev_addr_stored));
+    nvs_write_count = 0;
+}
+
+/**
+ * @brief Store every part of a session in NVS, as saved after a join.
+ * 
+ */
+static void store_lorawan_session(const lorawan_session_t *session)
+{
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR, &session->dev_addr, sizeof(session->dev_addr)), 
+        "Failed to store the session");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP, &session->fcnt_up, sizeof(session->fcnt_up)), 
+        "Failed to store the session");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_NWK_SKEY, session->nwk_skey, sizeof(session->nwk_skey)), 
+        "Failed to store the session");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_APP_SKEY, session->app_skey, sizeof(session->app_skey)), 
+        "Failed to store the session");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_DOWN, &session->fcnt_down, sizeof(session->fcnt_down)), 
+        "Failed to store the session");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_MAC_PARAMS, &session->mac_params, sizeof(session->mac_params)), 
+        "Failed to store the session");
+}
+
+static int restore_lorawan_session(lorawan_setup_t *setup)
+{
+    setup->is_session_restored = 1;
+    return 0;
+}
+
+static int join_lorawan_session(lorawan_setup_t *setup)
+{
+    setup->session = test_session;
+    setup->is_session_valid = 1;
+    setup->is_session_restored = 0;
+    return 0;
+}
+
+static int get_lorawan_session(lorawan_session_t *session)
+{
+    *session = test_session;
+    return 0;
+}
+
+static int queue_uplink(const sensor_radio_uplink_t *uplink)
+{
+    queued_uplink = *uplink;
+    is_uplink_queued = 1;
+    k_sem_give(&uplink_sem);
+    return 0;
+}
+
+/**
+ * @brief Drop the uplink still queued, as the radio does when it is flushed.
+ * 
+ */
+static void flush_uplinks(void)
+{
+    if(is_uplink_queued)
+    {
+        is_uplink_queued = 0;
+        queued_uplink.callback(SENSOR_RADIO_RESULT_DROPPED, queued_uplink.user_data);
+    }
+}
+
+/**
+ * @brief Wait for the app to queue its next uplink.
+ * 
+ */
+static void wait_for_uplink(void)
+{
+    zassert_ok(k_sem_take(&uplink_sem, TEST_UPLINK_TIMEOUT), "No uplink was queued");
+}
+
+/**
+ * @brief Report the result of the queued uplink to the app, as the radio thread does once it is sent.
+ * 
+ */
+static void complete_uplink(enum sensor_radio_result result)
+{
+    zassert_true(is_uplink_queued, "No uplink is queued");
+    is_uplink_queued = 0;
+    queued_uplink.callback(result, queued_uplink.user_data);
+}
+
+/**
+ * @brief Store LoRaWAN as enabled with the uplink interval of the tests, read by the app when it is initialized.
+ * 
+ */
+static void enable_lorawan(void)
+{
+    uint8_t is_lorawan_enabled = 1;
+    uint32_t lorawan_interval = TEST_LORAWAN_INTERVAL;
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_ENABLED, &is_lorawan_enabled, sizeof(is_lorawan_enabled)), 
+        "Failed to enable LoRaWAN");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_FREQUENCY, &lorawan_interval, sizeof(lorawan_interval)), 
+        "Failed to store the LoRaWAN interval");
+}
+
+/**
+ * @brief Initialize the app with sensor 1 set up to run, as at boot.
+ * 
+ */
+static void init_app(void)
+{
+    int ret;
+    ret = sensor_app_init(&sensor_app_config);
+    zassert_ok(ret, "App init failed");
+    sensor_app_config.state = SENSOR_APP_STATE_RUNNING;
+    sensor_app_config.is_sensor_1_enabled = 1;
+    sensor_app_config.sensor_1_type = PULSE_SENSOR;
+    sensor_app_config.sensor_1_frequency = 3600;
+    /* No time synchronization is requested along with the uplinks. */
+    sensor_lorawan_request_time_fake.return_val = -1;
+    sensor_radio_enqueue_fake.custom_fake = queue_uplink;
+    sensor_radio_flush_fake.custom_fake = flush_uplinks;
+}
+
+/**
+ * @brief Initialize the app with LoRaWAN enabled and sensor 1 set up to run.
+ * 
+ */
+static void init_app_with_lorawan(void)
+{
+    enable_lorawan();
+    init_app();
+}
+
+static void running_thread_entry(void *p1, void *p2, void *p3)
+{
+    running_ret = sensor_app_running_state();
+}
+
+/**
+ * @brief Run the running state in its own thread, it runs until the state changes or a downlink is staged.
+ * 
+ */
+static void start_running_state(void)
+{
+    is_lorawan_connected_fake.return_val = 1;
+    k_thread_create(&running_thread, running_stack, K_THREAD_STACK_SIZEOF(running_stack), running_thread_entry, 
+        NULL, NULL, NULL, K_PRIO_PREEMPT(1), 0, K_NO_WAIT);
+}
+
+static void join_running_state(void)
+{
+    zassert_ok(k_thread_join(&running_thread, K_SECONDS(5)), "Running state did not return");
+    zassert_ok(running_ret, "Running state failed");
+}
+
+static void stop_running_state(void)
+{
+    sensor_app_config.state = SENSOR_APP_STATE_CONFIGURATION;
+    sensor_app_notify_config_changed();
+    join_running_state();
+}
+
+/**
+ * @brief Send a downlink to the app through the callback it set up LoRaWAN with.
+ * 
+ */
+static void send_downlink(const uint8_t *data, uint8_t length)
+{
+    lorawan_setup_t *setup = sensor_lorawan_log_network_config_fake.arg0_val;
+    zassert_not_null(setup, "LoRaWAN was not set up");
+    setup->downlink_callback.cb(SENSOR_DOWNLINK_PORT, 0, 0, 0, length, data);
+}
+
+/**
+ * @brief Check whether an uplink carries the full header from an offset, by the app version that follows the 
+ * hardware version. The compact header is the configuration epoch and the PMIC information, zero in the tests.
+ * 
+ */
+static bool is_full_header(const lorawan_data_t *data, uint8_t offset)
+{
+    const uint8_t *header = &data->data[offset];
+    return data->length >= offset + 6 && header[2] == CONFIG_APP_VERSION_MAJOR && header[3] == CONFIG_APP_VERSION_MINOR 
+        && header[4] == CONFIG_APP_VERSION_PATCH && header[5] == CONFIG_APP_VERSION_COMMIT;
+}
+
 /**
  * @brief Setup sensor power systems 
  * 
@@ -42,10 +364,24 @@ sensor_app_config_t sensor_app_config = {
 static void *after_tests(void)
 {
     int ret;
+    /* NVS is kept in RAM so the tests can check what the app writes. */
+    sensor_nvs_fakes_reset();
+    sensor_nvs_setup_fake.custom_fake = ram_nvs_setup;
+    sensor_nvs_write_fake.custom_fake = ram_nvs_write;
+    sensor_nvs_read_fake.custom_fake = ram_nvs_read;
+    sensor_nvs_delete_fake.custom_fake = ram_nvs_delete;
+    sensor_nvs_clear_fake.custom_fake = ram_nvs_clear;
     ret = sensor_nvs_clear();
     zassert_ok(ret, "Failed to clear NVS");
+    clear_nvs_write_log();
     memset(&sensor_app_config, 0, sizeof(sensor_app_config_t)); // reset the sensor app config
     sensor_pmic_fakes_reset();
+    sensor_radio_fakes_reset();
+    sensor_lorawan_fakes_reset();
+    memset(&test_session, 0, sizeof(test_session));
+    memset(&queued_uplink, 0, sizeof(queued_uplink));
+    is_uplink_queued = 0;
+    k_sem_reset(&uplink_sem);
 }
 
 ZTEST_SUITE(app, NULL, NULL, NULL, after_tests, NULL);
@@ -183,3 +519,379 @@ ZTEST(app, test_app_running_state_fails_when_sensor_2_is_enabled_but_has_null_se
     zassert_equal(sensor_app_config.state, SENSOR_APP_STATE_ERROR, "App state is not error");
 }
 
+/**
+ * @brief Test that intervals stored as a single byte of minutes are read as seconds and stored again as 4 bytes
+ * 
+ */
+ZTEST(app, test_app_init_migrates_legacy_interval_minutes)
+{
+    int ret;
+    uint8_t sensor_minutes = 5;
+    uint8_t lorawan_minutes = 15;
+    uint32_t stored_seconds;
+    ret = sensor_nvs_setup(SENSOR_NVS_ADDRESS_LIMIT);
+    zassert_ok(ret, "NVS setup failed");
+    ret = sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_1_FREQUENCY, &sensor_minutes, sizeof(sensor_minutes));
+    zassert_ok(ret, "Failed to write legacy sensor interval");
+    ret = sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_FREQUENCY, &lorawan_minutes, sizeof(lorawan_minutes));
+    zassert_ok(ret, "Failed to write legacy LoRaWAN interval");
+    ret = sensor_app_init(&sensor_app_config);
+    zassert_ok(ret, "App init failed");
+    zassert_equal(sensor_app_config.sensor_1_frequency, 300, "Expected 300 seconds, actual is %u", 
+        sensor_app_config.sensor_1_frequency);
+    ret = sensor_nvs_read(SENSOR_NVS_ADDRESS_SENSOR_1_FREQUENCY, &stored_seconds, sizeof(stored_seconds));
+    zassert_ok(ret, "Sensor interval should be stored as 4 bytes");
+    zassert_equal(stored_seconds, 300, "Expected 300 seconds stored, actual is %u", stored_seconds);
+    ret = sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_FREQUENCY, &stored_seconds, sizeof(stored_seconds));
+    zassert_ok(ret, "LoRaWAN interval should be stored as 4 bytes");
+    zassert_equal(stored_seconds, 900, "Expected 900 seconds stored, actual is %u", stored_seconds);
+}
+
+/**
+ * @brief Test that intervals already stored as 4 bytes of seconds are kept
+ * 
+ */
+ZTEST(app, test_app_init_keeps_interval_seconds)
+{
+    int ret;
+    uint32_t seconds = 7200;
+    ret = sensor_nvs_setup(SENSOR_NVS_ADDRESS_LIMIT);
+    zassert_ok(ret, "NVS setup failed");
+    ret = sensor_nvs_write(SENSOR_NVS_ADDRESS_SENSOR_2_FREQUENCY, &seconds, sizeof(seconds));
+    zassert_ok(ret, "Failed to write sensor interval");
+    ret = sensor_app_init(&sensor_app_config);
+    zassert_ok(ret, "App init failed");
+    zassert_equal(sensor_app_config.sensor_2_frequency, 7200, "Expected 7200 seconds, actual is %u", 
+        sensor_app_config.sensor_2_frequency);
+}
+
+/**
+ * @brief Test that an interval written over BLE is read from a single byte of minutes or 4 bytes of seconds
+ * 
+ */
+ZTEST(app, test_app_interval_from_write)
+{
+    int ret;
+    uint32_t seconds;
+    uint8_t minutes = 5;
+    uint8_t le_seconds[] = {0x10, 0x0E, 0x00, 0x00};
+    uint8_t wrong_length[] = {0x10, 0x0E};
+    ret = sensor_app_get_interval_from_write(&minutes, sizeof(minutes), 0, &seconds);
+    zassert_ok(ret, "Single byte of minutes should be accepted");
+    zassert_equal(seconds, 300, "Expected 300 seconds, actual is %u", seconds);
+    ret = sensor_app_get_interval_from_write(le_seconds, sizeof(le_seconds), 0, &seconds);
+    zassert_ok(ret, "4 bytes of seconds should be accepted");
+    zassert_equal(seconds, 3600, "Expected 3600 seconds, actual is %u", seconds);
+    ret = sensor_app_get_interval_from_write(wrong_length, sizeof(wrong_length), 0, &seconds);
+    zassert_equal(ret, -EINVAL, "Expected -EINVAL for a 2 byte write, actual is %d", ret);
+}
+
+/**
+ * @brief Test that an uplink interval written over BLE below the downlink floor is rejected
+ * 
+ */
+ZTEST(app, test_app_interval_from_write_below_floor)
+{
+    int ret;
+    uint32_t seconds;
+    uint8_t minutes = 1;
+    uint8_t le_seconds[] = {SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL - 1, 0x00, 0x00, 0x00};
+    ret = sensor_app_get_interval_from_write(le_seconds, sizeof(le_seconds), SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL, &seconds);
+    zassert_equal(ret, -ERANGE, "Expected -ERANGE below the floor, actual is %d", ret);
+    ret = sensor_app_get_interval_from_write(&minutes, sizeof(minutes), SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL, &seconds);
+    zassert_ok(ret, "One minute should be accepted at the floor");
+    zassert_equal(seconds, SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL, "Expected %d seconds, actual is %u", 
+        SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL, seconds);
+}
+
+/**
+ * @brief Test that a session stored without its downlink frame counter and receive parameters is joined again
+ * 
+ */
+ZTEST(app, test_app_lorawan_session_partly_stored_is_not_restored)
+{
+    int ret;
+    const lorawan_session_t *session = &stored_session;
+    ret = sensor_nvs_setup(SENSOR_NVS_ADDRESS_LIMIT);
+    zassert_ok(ret, "NVS setup failed");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR, &session->dev_addr, sizeof(session->dev_addr)), 
+        "Failed to store the session");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP, &session->fcnt_up, sizeof(session->fcnt_up)), 
+        "Failed to store the session");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_NWK_SKEY, session->nwk_skey, sizeof(session->nwk_skey)), 
+        "Failed to store the session");
+    zassert_ok(sensor_nvs_write(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_APP_SKEY, session->app_skey, sizeof(session->app_skey)), 
+        "Failed to store the session");
+    init_app_with_lorawan();
+    sensor_app_config.connect_network_during_configuration = 1;
+    clear_nvs_write_log();
+    ret = sensor_app_configuration_state();
+    zassert_ok(ret, "Connecting to LoRaWAN failed");
+    zassert_equal(sensor_lorawan_setup_fake.call_count, 1, "LoRaWAN setup should be called");
+    zassert_false(sensor_lorawan_setup_fake.arg0_val->is_session_valid, "A partly stored session should not be valid");
+    zassert_equal(count_nvs_writes(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP), 0, 
+        "No frame counters should be reserved without a session");
+}
+
+/**
+ * @brief Test that a restored session reserves the frame counters after the stored one and writes nothing else
+ * 
+ */
+ZTEST(app, test_app_lorawan_session_restored_reserves_frame_counters)
+{
+    int ret;
+    uint32_t fcnt_up;
+    ret = sensor_nvs_setup(SENSOR_NVS_ADDRESS_LIMIT);
+    zassert_ok(ret, "NVS setup failed");
+    store_lorawan_session(&stored_session);
+    init_app_with_lorawan();
+    sensor_app_config.connect_network_during_configuration = 1;
+    sensor_lorawan_setup_fake.custom_fake = restore_lorawan_session;
+    clear_nvs_write_log();
+    ret = sensor_app_configuration_state();
+    zassert_ok(ret, "Connecting to LoRaWAN failed");
+    zassert_true(sensor_lorawan_setup_fake.arg0_val->is_session_valid, "The stored session should be valid");
+    ret = sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP, &fcnt_up, sizeof(fcnt_up));
+    zassert_ok(ret, "Failed to read the frame counter");
+    zassert_equal(fcnt_up, stored_session.fcnt_up + SENSOR_APP_FCNT_GAP, "Expected %u reserved, actual is %u", 
+        stored_session.fcnt_up + SENSOR_APP_FCNT_GAP, fcnt_up);
+    zassert_equal(sensor_lorawan_setup_fake.arg0_val->session.fcnt_up, fcnt_up, 
+        "The session should continue after the reserved frame counters");
+    zassert_equal(nvs_write_count, 1, "Expected only the reservation written, actual is %d writes", nvs_write_count);
+}
+
+/**
+ * @brief Test that the stored frame counter is only written once the uplinks are within the margin of the reservation
+ * 
+ */
+ZTEST(app, test_app_lorawan_frame_counters_reserved_within_margin)
+{
+    int ret;
+    uint32_t fcnt_up;
+    uint32_t reserved = stored_session.fcnt_up + SENSOR_APP_FCNT_GAP;
+    ret = sensor_nvs_setup(SENSOR_NVS_ADDRESS_LIMIT);
+    zassert_ok(ret, "NVS setup failed");
+    store_lorawan_session(&stored_session);
+    init_app_with_lorawan();
+    sensor_app_config.connect_network_during_configuration = 1;
+    sensor_lorawan_setup_fake.custom_fake = restore_lorawan_session;
+    ret = sensor_app_configuration_state();
+    zassert_ok(ret, "Connecting to LoRaWAN failed");
+    sensor_lorawan_get_session_fake.custom_fake = get_lorawan_session;
+    test_session = stored_session;
+    /* Uplinks before the margin use the reserved frame counters without writing them. */
+    test_session.fcnt_up = reserved - SENSOR_APP_FCNT_MARGIN - 1;
+    start_running_state();
+    wait_for_uplink();
+    clear_nvs_write_log();
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    zassert_equal(count_nvs_writes(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP), 0, 
+        "Frame counters should not be reserved outside the margin");
+    /* The uplink that reaches the margin reserves the next frame counters. */
+    test_session.fcnt_up = reserved - SENSOR_APP_FCNT_MARGIN;
+    wait_for_uplink();
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    zassert_equal(count_nvs_writes(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP), 1, 
+        "Frame counters should be reserved once within the margin");
+    ret = sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP, &fcnt_up, sizeof(fcnt_up));
+    zassert_ok(ret, "Failed to read the frame counter");
+    zassert_equal(fcnt_up, test_session.fcnt_up + SENSOR_APP_FCNT_GAP, "Expected %u reserved, actual is %u", 
+        test_session.fcnt_up + SENSOR_APP_FCNT_GAP, fcnt_up);
+    stop_running_state();
+}
+
+/**
+ * @brief Test that a newly joined session replacing a stored one is written with its DevAddr last, so a reset part 
+ * way leaves no session marked valid
+ * 
+ */
+ZTEST(app, test_app_lorawan_session_joined_writes_dev_addr_last)
+{
+    int ret;
+    uint32_t dev_addr;
+    uint32_t fcnt_up;
+    lorawan_session_t old_session = stored_session;
+    old_session.dev_addr = 0x260B0001;
+    ret = sensor_nvs_setup(SENSOR_NVS_ADDRESS_LIMIT);
+    zassert_ok(ret, "NVS setup failed");
+    store_lorawan_session(&old_session);
+    init_app_with_lorawan();
+    sensor_app_config.connect_network_during_configuration = 1;
+    sensor_lorawan_setup_fake.custom_fake = join_lorawan_session;
+    test_session = stored_session;
+    test_session.fcnt_up = 0;
+    test_session.fcnt_down = 0;
+    clear_nvs_write_log();
+    ret = sensor_app_configuration_state();
+    zassert_ok(ret, "Connecting to LoRaWAN failed");
+    zassert_true(nvs_write_count > 1 && nvs_write_count <= TEST_MAX_NVS_WRITES, "Unexpected %d writes", nvs_write_count);
+    zassert_equal(nvs_write_log[nvs_write_count - 1], SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR, 
+        "DevAddr should be written last");
+    zassert_equal(count_nvs_writes(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR), 1, "DevAddr should be written once");
+    for(int i = 0; i < nvs_write_count - 1; i++)
+    {
+        zassert_false(nvs_write_dev_addr_stored[i], "Write %d was made while the old session was still valid", i);
+    }
+    ret = sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_DEV_ADDR, &dev_addr, sizeof(dev_addr));
+    zassert_ok(ret, "Failed to read the DevAddr");
+    zassert_equal(dev_addr, test_session.dev_addr, "Expected DevAddr 0x%08x, actual is 0x%08x", test_session.dev_addr, dev_addr);
+    ret = sensor_nvs_read(SENSOR_NVS_ADDRESS_LORAWAN_SESSION_FCNT_UP, &fcnt_up, sizeof(fcnt_up));
+    zassert_ok(ret, "Failed to read the frame counter");
+    zassert_equal(fcnt_up, SENSOR_APP_FCNT_GAP, "Expected %u reserved, actual is %u", SENSOR_APP_FCNT_GAP, fcnt_up);
+}
+
+/**
+ * @brief Test that the first uplink after boot carries the full header, also when it was sent before the reboot
+ * 
+ */
+ZTEST(app, test_app_header_full_on_first_uplink_after_boot)
+{
+    init_app_with_lorawan();
+    start_running_state();
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_FULL_HEADER_PORT, "First uplink should carry the full header");
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_COMPACT_PORT, "Next uplink should carry the compact header");
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    stop_running_state();
+    /* Boot again with the same configuration. */
+    init_app();
+    start_running_state();
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_FULL_HEADER_PORT, "First uplink after boot should carry the full header");
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    stop_running_state();
+}
+
+/**
+ * @brief Test that the uplink after a configuration change carries the full header
+ * 
+ */
+ZTEST(app, test_app_header_full_after_config_change)
+{
+    init_app_with_lorawan();
+    start_running_state();
+    wait_for_uplink();
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_COMPACT_PORT, "Uplink should carry the compact header");
+    /* Change the interval of sensor 1, as written over BLE. */
+    sensor_app_config.sensor_1_frequency = 1800;
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_FULL_HEADER_PORT, "Uplink after the change should carry the full header");
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_COMPACT_PORT, "Uplink after that should carry the compact header");
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    stop_running_state();
+}
+
+/**
+ * @brief Test that the full header is sent again after SENSOR_APP_FULL_HEADER_INTERVAL uplinks with the compact header
+ * 
+ */
+ZTEST(app, test_app_header_full_after_interval)
+{
+    init_app_with_lorawan();
+    start_running_state();
+    wait_for_uplink();
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    for(int i = 0; i < SENSOR_APP_FULL_HEADER_INTERVAL; i++)
+    {
+        wait_for_uplink();
+        zassert_equal(queued_uplink.data.port, SENSOR_APP_COMPACT_PORT, "Uplink %d should carry the compact header", i);
+        complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    }
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_FULL_HEADER_PORT, "Uplink after %d compact headers should carry the full header", 
+        SENSOR_APP_FULL_HEADER_INTERVAL);
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    stop_running_state();
+}
+
+/**
+ * @brief Test that the uplink acknowledging a downlink carries the full header after the acknowledgement
+ * 
+ */
+ZTEST(app, test_app_header_full_with_downlink_ack)
+{
+    int ret;
+    uint8_t flush_downlink[] = {0x07, SENSOR_DOWNLINK_FLUSH, 0x00};
+    init_app_with_lorawan();
+    sensor_app_config.connect_network_during_configuration = 1;
+    ret = sensor_app_configuration_state();
+    zassert_ok(ret, "Connecting to LoRaWAN failed");
+    start_running_state();
+    wait_for_uplink();
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    send_downlink(flush_downlink, sizeof(flush_downlink));
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_DOWNLINK_ACK_PORT, "Uplink should carry the acknowledgement");
+    zassert_equal(queued_uplink.data.data[0], 0x07, "Acknowledgement should carry the sequence number");
+    zassert_equal(queued_uplink.data.data[1], SENSOR_DOWNLINK_STATUS_OK, "Downlink should be applied");
+    zassert_true(is_full_header(&queued_uplink.data, SENSOR_DOWNLINK_ACK_LENGTH), 
+        "Full header should follow the acknowledgement");
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    stop_running_state();
+}
+
+/**
+ * @brief Test that a full header that failed to send is sent again with the next uplink
+ * 
+ */
+ZTEST(app, test_app_header_full_again_after_failed_uplink)
+{
+    init_app_with_lorawan();
+    start_running_state();
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_FULL_HEADER_PORT, "First uplink should carry the full header");
+    complete_uplink(SENSOR_RADIO_RESULT_FAILED);
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_FULL_HEADER_PORT, "Uplink after a failed one should carry the full header");
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_APP_COMPACT_PORT, "Uplink after a sent one should carry the compact header");
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    stop_running_state();
+}
+
+/**
+ * @brief Test that the configuration of a downlink is committed to NVS in one write before its settings are written
+ * 
+ */
+ZTEST(app, test_app_downlink_config_committed_in_one_write)
+{
+    int ret;
+    /* Sensor 1 read every 1800 seconds and uplinks confirmed with 3 attempts. */
+    uint8_t config_downlink[] = {0x09, SENSOR_DOWNLINK_SENSOR_INTERVAL, 0x05, 0x01, 0x00, 0x00, 0x07, 0x08, 
+        SENSOR_DOWNLINK_LORAWAN_CONFIRMED, 0x01, 0x03};
+    init_app_with_lorawan();
+    sensor_app_config.connect_network_during_configuration = 1;
+    ret = sensor_app_configuration_state();
+    zassert_ok(ret, "Connecting to LoRaWAN failed");
+    start_running_state();
+    wait_for_uplink();
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    clear_nvs_write_log();
+    /* The running state returns to apply the configuration with the sensors stopped. */
+    send_downlink(config_downlink, sizeof(config_downlink));
+    join_running_state();
+    zassert_equal(nvs_write_count, 0, "Nothing should be written before the configuration is applied");
+    start_running_state();
+    wait_for_uplink();
+    zassert_equal(queued_uplink.data.port, SENSOR_DOWNLINK_ACK_PORT, "Uplink should carry the acknowledgement");
+    zassert_equal(queued_uplink.data.data[1], SENSOR_DOWNLINK_STATUS_OK, "Downlink should be applied");
+    zassert_equal(nvs_write_log[0], SENSOR_NVS_ADDRESS_DOWNLINK_CONFIG, "Configuration should be committed first");
+    zassert_equal(count_nvs_writes(SENSOR_NVS_ADDRESS_DOWNLINK_CONFIG), 1, "Configuration should be committed once");
+    zassert_equal(count_nvs_writes(SENSOR_NVS_ADDRESS_SENSOR_1_FREQUENCY), 1, "Sensor interval should be written once");
+    zassert_equal(count_nvs_writes(SENSOR_NVS_ADDRESS_LORAWAN_SEND_ATTEMPTS), 1, "Send attempts should be written once");
+    zassert_equal(nvs_write_count, 3, "Expected 3 writes for the downlink, actual is %d", nvs_write_count);
+    zassert_equal(nvs_entries[SENSOR_NVS_ADDRESS_DOWNLINK_CONFIG].length, 0, "Committed configuration should be deleted once applied");
+    zassert_equal(sensor_app_config.sensor_1_frequency, 1800, "Expected 1800 seconds, actual is %u", 
+        sensor_app_config.sensor_1_frequency);
+    complete_uplink(SENSOR_RADIO_RESULT_SENT);
+    stop_running_state();
+}
+
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Tests:
+ * - Recorded time on air is summed over the rolling window
+ * - Time on air leaves the window 24 hours after its hour
+ * - The governor steps up as the budget runs low
+ * - The defer delay is the time until the oldest time on air leaves the window
+ * - Uplinks longer than the whole budget are rejected
+ */
+
+#include <zephyr/ztest.h>
+#include "sensor_budget.h"
+
+#define TEST_HOUR_MS    SENSOR_BUDGET_BUCKET_MS
+
+ZTEST_SUITE(budget, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Test that the time on air of every hour in the window is summed
+ * 
+ */
+ZTEST(budget, test_budget_record)
+{
+    sensor_budget_t budget = {0};
+    sensor_budget_record(&budget, 1000, 400000);
+    sensor_budget_record(&budget, 2000, 400000);
+    sensor_budget_record(&budget, 5 * TEST_HOUR_MS, 200000);
+    uint32_t used_us = sensor_budget_get_used_us(&budget, 6 * TEST_HOUR_MS);
+    zassert_equal(used_us, 1000000, "Expected 1000000 us, actual is %d", used_us);
+}
+
+/**
+ * @brief Test that time on air leaves the window once its hour is 24 hours old
+ * 
+ */
+ZTEST(budget, test_budget_rolling_window)
+{
+    sensor_budget_t budget = {0};
+    sensor_budget_record(&budget, 0, 1000000);
+    sensor_budget_record(&budget, 10 * TEST_HOUR_MS, 2000000);
+    uint32_t used_us = sensor_budget_get_used_us(&budget, (24 * TEST_HOUR_MS) - 1);
+    zassert_equal(used_us, 3000000, "Expected 3000000 us, actual is %d", used_us);
+    used_us = sensor_budget_get_used_us(&budget, 24 * TEST_HOUR_MS);
+    zassert_equal(used_us, 2000000, "Expected 2000000 us, actual is %d", used_us);
+    used_us = sensor_budget_get_used_us(&budget, 100 * TEST_HOUR_MS);
+    zassert_equal(used_us, 0, "Expected an empty window, actual is %d", used_us);
+}
+
+/**
+ * @brief Test that the governor drops confirmations, then merges, then defers as the budget runs low
+ * 
+ */
+ZTEST(budget, test_budget_levels)
+{
+    sensor_budget_t budget = {0};
+    uint32_t uplink_us = 400000;
+    enum sensor_budget_level level = sensor_budget_get_level(&budget, 0, uplink_us);
+    zassert_equal(level, SENSOR_BUDGET_LEVEL_NORMAL, "Expected normal, actual is %d", level);
+    sensor_budget_record(&budget, 0, (SENSOR_BUDGET_DAILY_US / 2) - uplink_us + 1);
+    level = sensor_budget_get_level(&budget, 0, uplink_us);
+    zassert_equal(level, SENSOR_BUDGET_LEVEL_UNCONFIRMED, "Expected unconfirmed, actual is %d", level);
+    sensor_budget_record(&budget, 0, SENSOR_BUDGET_DAILY_US / 4);
+    level = sensor_budget_get_level(&budget, 0, uplink_us);
+    zassert_equal(level, SENSOR_BUDGET_LEVEL_MERGE, "Expected merge, actual is %d", level);
+    sensor_budget_record(&budget, 0, SENSOR_BUDGET_DAILY_US / 4);
+    level = sensor_budget_get_level(&budget, 0, uplink_us);
+    zassert_equal(level, SENSOR_BUDGET_LEVEL_DEFER, "Expected defer, actual is %d", level);
+    level = sensor_budget_get_level(&budget, 24 * TEST_HOUR_MS, uplink_us);
+    zassert_equal(level, SENSOR_BUDGET_LEVEL_NORMAL, "Expected normal a day later, actual is %d", level);
+}
+
+/**
+ * @brief Test that an uplink that does not fit is deferred until enough time on air leaves the window
+ * 
+ */
+ZTEST(budget, test_budget_delay)
+{
+    sensor_budget_t budget = {0};
+    uint32_t delay_ms;
+    sensor_budget_record(&budget, 0, SENSOR_BUDGET_DAILY_US / 2);
+    sensor_budget_record(&budget, 3 * TEST_HOUR_MS, SENSOR_BUDGET_DAILY_US / 2);
+    int ret = sensor_budget_get_delay_ms(&budget, 5 * TEST_HOUR_MS, 100000, &delay_ms);
+    zassert_ok(ret, "Get delay failed");
+    zassert_equal(delay_ms, 19 * TEST_HOUR_MS, "Expected the first hour to leave the window, delay is %d", delay_ms);
+    sensor_budget_t empty_budget = {0};
+    ret = sensor_budget_get_delay_ms(&empty_budget, 5 * TEST_HOUR_MS, 100000, &delay_ms);
+    zassert_ok(ret, "Get delay failed");
+    zassert_equal(delay_ms, 0, "Expected no delay, actual is %d", delay_ms);
+}
+
+/**
+ * @brief Test that an uplink longer than the whole budget is rejected
+ * 
+ */
+ZTEST(budget, test_budget_too_long)
+{
+    sensor_budget_t budget = {0};
+    uint32_t delay_ms;
+    int ret = sensor_budget_get_delay_ms(&budget, 0, SENSOR_BUDGET_DAILY_US + 1, &delay_ms);
+    zassert_equal(ret, -EINVAL, "Expected -EINVAL, actual is %d", ret);
+}
@@ -20,6 +20,12 @@ typedef struct {
     const struct adc_dt_spec voltage_read;
     /* ADC spec for current sensor. */
     const struct adc_dt_spec current_read;
+    /* QDEC device wired to d1/d2, NULL to decode quadrature with GPIO interrupts. */
+    const struct device *qdec;
+    /* Gain drift of the voltage reading in ppm/°C, positive if the reading rises with temperature. */
+    int16_t voltage_tempco_ppm;
+    /* Gain drift of the current reading in ppm/°C, positive if the reading rises with temperature. */
+    int16_t current_tempco_ppm;
 } sensor_reading_config_t;
 
 // Declare all the fake functions
@@ -29,6 +35,10 @@ DECLARE_FAKE_VALUE_FUNC(float, get_sensor_voltage_reading, sensor_reading_config
 DECLARE_FAKE_VALUE_FUNC(float, get_sensor_current_reading, sensor_reading_config_t *);
 DECLARE_FAKE_VALUE_FUNC(int, get_sensor_pulse_count, sensor_reading_config_t *);
 DECLARE_FAKE_VALUE_FUNC(int, reset_sensor_pulse_count, sensor_reading_config_t *);
+DECLARE_FAKE_VOID_FUNC(sensor_reading_set_temperature, int32_t);
+DECLARE_FAKE_VALUE_FUNC(int, get_sensor_signed_count, sensor_reading_config_t *, int32_t *);
+DECLARE_FAKE_VALUE_FUNC(int, reset_sensor_signed_count, sensor_reading_config_t *);
+DECLARE_FAKE_VALUE_FUNC(int, get_sensor_frequency, sensor_reading_config_t *, float *);
 
 // Reset all fakes
 void sensor_reading_fakes_reset(void);
@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  * Tests:
  * - test correct power calls for each sensor type
+ * - test that reads keep the configured power delay for continuously powered sensors
+ * - test learning the warm-up of switched power sensors
  */
 
 #include <zephyr/ztest.h>
@@ -100,6 +102,8 @@ static void *after_tests(void)
     sensor1_data.power_id = SENSOR_POWER_1;
     sensor2_data.id = SENSOR_2;
     sensor2_data.power_id = SENSOR_POWER_2;
+    memset(&sensor1_data.warmup, 0, sizeof(sensor1_data.warmup));
+    memset(&sensor2_data.warmup, 0, sizeof(sensor2_data.warmup));
     int ret = sensor_data_clear(&sensor1_data);
     zassert_ok(ret, "Sensor data clear failed");
     ret = sensor_data_clear(&sensor2_data);
@@ -349,6 +353,71 @@ ZTEST(data, test_sensor_data_clear_and_read_after_clear)
     zassert_ok(ret, "Sensor data print failed");
 }
 
+/**
+ * @brief Test that clearing the sent samples keeps the samples read after them
+ * 
+ */
+ZTEST(data, test_sensor_data_clear_sent_keeps_newer_samples)
+{
+    int timestamp = 1000;
+    int ret = sensor_data_setup(&sensor1_data, PULSE_SENSOR, SENSOR_VOLTAGE_3V3);
+    zassert_ok(ret, "Sensor data setup failed");
+    for(int i = 0; i < 3; i++)
+    {
+        get_sensor_pulse_count_fake.return_val = 100 + i;
+        ret = sensor_data_read(&sensor1_data, timestamp + i);
+        zassert_ok(ret, "Sensor data read failed");
+    }
+    ret = sensor_data_clear_sent(&sensor1_data, 2);
+    zassert_ok(ret, "Sensor data clear sent failed");
+    zassert_equal(sensor1_data.num_samples, 1, "Expected 1 sample left, actual is %d", sensor1_data.num_samples);
+    zassert_equal(ring_buf_size_get(&sensor1_data.data_ring_buf), sensor1_data.data_size, "Data ring buffer should hold 1 sample");
+    zassert_equal(ring_buf_size_get(&sensor1_data.timestamp_ring_buf), sensor1_data.timestamp_size, "Timestamp ring buffer should hold 1 sample");
+    int value;
+    int read_timestamp;
+    ring_buf_get(&sensor1_data.data_ring_buf, (uint8_t *)&value, sizeof(value));
+    ring_buf_get(&sensor1_data.timestamp_ring_buf, (uint8_t *)&read_timestamp, sizeof(read_timestamp));
+    zassert_equal(value, 102, "Expected newest pulse count 102, actual is %d", value);
+    zassert_equal(read_timestamp, timestamp + 2, "Expected newest timestamp %d, actual is %d", timestamp + 2, read_timestamp);
+}
+
+/**
+ * @brief Test that packing for LoRaWAN only takes the oldest whole samples that fit
+ * 
+ */
+ZTEST(data, test_sensor_data_pack_for_lorawan_leaves_samples_that_do_not_fit)
+{
+    int timestamp = 1000;
+    int ret = sensor_data_setup(&sensor1_data, PULSE_SENSOR, SENSOR_VOLTAGE_3V3);
+    zassert_ok(ret, "Sensor data setup failed");
+    for(int i = 0; i < 3; i++)
+    {
+        get_sensor_pulse_count_fake.return_val = 100 + i;
+        ret = sensor_data_read(&sensor1_data, timestamp + i);
+        zassert_ok(ret, "Sensor data read failed");
+    }
+    size_t sample_size = sensor1_data.timestamp_size + sensor1_data.data_size;
+    uint8_t data[3 * sample_size];
+    uint16_t data_len;
+    uint32_t num_samples;
+    /* Room for 2 samples and part of a third */
+    ret = sensor_data_pack_for_lorawan(&sensor1_data, data, (2 * sample_size) + 1, &data_len, &num_samples);
+    zassert_ok(ret, "Sensor data pack for LoRaWAN failed");
+    zassert_equal(num_samples, 2, "Expected 2 samples packed, actual is %d", num_samples);
+    zassert_equal(data_len, 2 * sample_size, "Expected %d bytes packed, actual is %d", 2 * sample_size, data_len);
+    int value;
+    int packed_timestamp;
+    memcpy(&packed_timestamp, data + sample_size, sensor1_data.timestamp_size);
+    memcpy(&value, data + sample_size + sensor1_data.timestamp_size, sensor1_data.data_size);
+    zassert_equal(packed_timestamp, timestamp + 1, "Expected timestamp %d, actual is %d", timestamp + 1, packed_timestamp);
+    zassert_equal(value, 101, "Expected pulse count 101, actual is %d", value);
+    zassert_equal(ring_buf_size_get(&sensor1_data.data_ring_buf), 3 * sensor1_data.data_size, "Packing should not remove samples");
+    /* No room for a whole sample */
+    ret = sensor_data_pack_for_lorawan(&sensor1_data, data, sample_size - 1, &data_len, &num_samples);
+    zassert_ok(ret, "Sensor data pack for LoRaWAN failed");
+    zassert_equal(num_samples, 0, "Expected no samples packed, actual is %d", num_samples);
+}
+
 /**
  * @brief Test that the correct power calls are made for a voltage sensor with 24V power
  * 
@@ -370,6 +439,44 @@ ZTEST(data, test_sensor_data_power_calls_for_voltage_sensor_24v_power)
     zassert_equal(set_sensor_output_fake.arg1_history[1], SENSOR_VOLTAGE_OFF, "Set sensor output should be called with SENSOR_VOLTAGE_OFF");
 }
 
+/* Power delay of each set sensor output call, taken when it is called */
+static uint32_t set_sensor_output_delays[FFF_ARG_HISTORY_LEN];
+
+static int set_sensor_output_record_delay(sensor_power_config_t *config, enum sensor_voltage voltage)
+{
+    if (set_sensor_output_fake.call_count <= FFF_ARG_HISTORY_LEN) {
+        set_sensor_output_delays[set_sensor_output_fake.call_count - 1] = config->delay_ms;
+    }
+    return 0;
+}
+
+/**
+ * @brief Test that a read powers off without a delay and leaves the configured power delay for a continuously 
+ * powered sensor set up afterwards
+ * 
+ */
+ZTEST(data, test_sensor_data_read_keeps_configured_power_delay)
+{
+    int ret;
+    ret = sensor_data_setup(&sensor1_data, VOLTAGE_SENSOR, SENSOR_VOLTAGE_24V);
+    zassert_ok(ret, "Sensor data setup failed");
+    RESET_FAKE(set_sensor_output);
+    set_sensor_output_fake.custom_fake = set_sensor_output_record_delay;
+    ret = sensor_data_read(&sensor1_data, 1000);
+    zassert_ok(ret, "Sensor data read failed");
+    zassert_equal(set_sensor_output_fake.call_count, 2, "Set sensor output should be called to enable and disable");
+    zassert_equal(set_sensor_output_delays[1], 0, "Power off should not wait, delay is %d", set_sensor_output_delays[1]);
+    uint32_t configured_delay_ms = set_sensor_output_fake.arg0_history[1]->delay_ms;
+    zassert_not_equal(configured_delay_ms, 0, "The configured power delay should be restored after the read");
+    RESET_FAKE(set_sensor_output);
+    set_sensor_output_fake.custom_fake = set_sensor_output_record_delay;
+    ret = sensor_data_setup(&sensor1_data, PULSE_SENSOR, SENSOR_VOLTAGE_3V3);
+    zassert_ok(ret, "Sensor data setup failed");
+    zassert_equal(set_sensor_output_fake.call_count, 1, "Set sensor output should be called to power the sensor");
+    zassert_equal(set_sensor_output_delays[0], configured_delay_ms, "Continuous power should settle with the configured delay, delay is %d", 
+        set_sensor_output_delays[0]);
+}
+
 /**
  * @brief Test that the correct power calls are made for a current sensor with 12V power
  * 
@@ -505,3 +612,87 @@ ZTEST(data, test_sensor_data_format_voltage_sensor_for_lorawan)
     memcpy(&value, data + sensor1_data.timestamp_size, sensor1_data.data_size);
     zassert_equal(value, 1.0, "First data value should be 1.0, got %f", value);
 }
+
+/**
+ * @brief Test that the warm-up is learned from the time the voltage sensor readings become stable
+ * 
+ */
+ZTEST(data, test_sensor_data_learn_warmup_voltage_sensor)
+{
+    float readings[] = {0.0, 1.0, 2.0, 3.0, 3.0, 3.0, 3.0};
+    int ret = sensor_data_setup(&sensor1_data, VOLTAGE_SENSOR, SENSOR_VOLTAGE_12V);
+    zassert_ok(ret, "Sensor data setup failed");
+    zassert_equal(sensor_data_warmup_needs_learning(&sensor1_data), 1, "Warm-up should need learning before it is learned");
+    SET_RETURN_SEQ(get_sensor_voltage_reading, readings, ARRAY_SIZE(readings));
+    ret = sensor_data_learn_warmup(&sensor1_data);
+    zassert_ok(ret, "Sensor data learn warm-up failed");
+    zassert_true(sensor1_data.warmup.warmup_ms >= (3 * SENSOR_WARMUP_STEP_MS), "Warm-up should be at least 3 steps, got %d", sensor1_data.warmup.warmup_ms);
+    zassert_true(sensor1_data.warmup.warmup_ms < SENSOR_WARMUP_MAX_MS, "Warm-up should be less than the max, got %d", sensor1_data.warmup.warmup_ms);
+    zassert_equal(sensor1_data.warmup.type, VOLTAGE_SENSOR, "Warm-up should be learned for VOLTAGE_SENSOR");
+    zassert_equal(sensor1_data.warmup.voltage, SENSOR_VOLTAGE_12V, "Warm-up should be learned for SENSOR_VOLTAGE_12V");
+    zassert_equal(sensor_data_warmup_needs_learning(&sensor1_data), 0, "Warm-up should not need learning after it is learned");
+    zassert_equal(set_sensor_output_fake.arg1_history[set_sensor_output_fake.call_count - 1], SENSOR_VOLTAGE_OFF, "Sensor should be turned off after learning");
+}
+
+/* Reading that drifts by 0.8% each time, within tolerance of the previous reading but never settling */
+static float drifting_voltage;
+
+static float drifting_voltage_reading(sensor_reading_config_t *config)
+{
+    drifting_voltage *= 1.008f;
+    return drifting_voltage;
+}
+
+/**
+ * @brief Test that a slow drift is not taken as stable and that a sensor that never stabilises keeps the default warm-up
+ * 
+ */
+ZTEST(data, test_sensor_data_learn_warmup_never_stabilises)
+{
+    int ret = sensor_data_setup(&sensor1_data, VOLTAGE_SENSOR, SENSOR_VOLTAGE_12V);
+    zassert_ok(ret, "Sensor data setup failed");
+    drifting_voltage = 3.0f;
+    get_sensor_voltage_reading_fake.custom_fake = drifting_voltage_reading;
+    ret = sensor_data_learn_warmup(&sensor1_data);
+    zassert_not_ok(ret, "Sensor data learn warm-up should fail for readings that never stabilise");
+    zassert_equal(sensor1_data.warmup.warmup_ms, 0, "Warm-up should be left unlearned, got %d", sensor1_data.warmup.warmup_ms);
+    zassert_equal(sensor_data_warmup_needs_learning(&sensor1_data), 1, "Warm-up should still need learning");
+    zassert_equal(set_sensor_output_fake.arg1_history[set_sensor_output_fake.call_count - 1], SENSOR_VOLTAGE_OFF, "Sensor should be turned off after learning");
+
+    RESET_FAKE(set_sensor_output);
+    set_sensor_output_fake.custom_fake = set_sensor_output_record_delay;
+    ret = sensor_data_read(&sensor1_data, 1000);
+    zassert_ok(ret, "Sensor data read failed");
+    zassert_equal(set_sensor_output_delays[0], SENSOR_WARMUP_DEFAULT_MS, "Read should wait the default warm-up, delay is %d", 
+        set_sensor_output_delays[0]);
+}
+
+/**
+ * @brief Test that the warm-up has to be learned again when the sensor voltage changes
+ * 
+ */
+ZTEST(data, test_sensor_data_warmup_needs_learning_after_voltage_change)
+{
+    int ret = sensor_data_setup(&sensor1_data, CURRENT_SENSOR, SENSOR_VOLTAGE_5V);
+    zassert_ok(ret, "Sensor data setup failed");
+    get_sensor_current_reading_fake.return_val = 4.0;
+    ret = sensor_data_learn_warmup(&sensor1_data);
+    zassert_ok(ret, "Sensor data learn warm-up failed");
+    zassert_equal(sensor1_data.warmup.warmup_ms, SENSOR_WARMUP_MIN_MS, "Warm-up should be the minimum for readings that are stable immediately");
+    ret = sensor_data_setup(&sensor1_data, CURRENT_SENSOR, SENSOR_VOLTAGE_24V);
+    zassert_ok(ret, "Sensor data setup failed");
+    zassert_equal(sensor_data_warmup_needs_learning(&sensor1_data), 1, "Warm-up should need learning after the voltage changes");
+}
+
+/**
+ * @brief Test that the warm-up is not learned for continuous power sensors
+ * 
+ */
+ZTEST(data, test_sensor_data_learn_warmup_pulse_sensor_fails)
+{
+    int ret = sensor_data_setup(&sensor1_data, PULSE_SENSOR, SENSOR_VOLTAGE_3V3);
+    zassert_ok(ret, "Sensor data setup failed");
+    zassert_equal(sensor_data_warmup_needs_learning(&sensor1_data), 0, "PULSE_SENSOR should not need a warm-up");
+    ret = sensor_data_learn_warmup(&sensor1_data);
+    zassert_not_ok(ret, "Sensor data learn warm-up should fail for PULSE_SENSOR");
+}
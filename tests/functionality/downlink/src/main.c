@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Tests:
+ * - A downlink with every command is parsed into its settings
+ * - A downlink with only a sequence number is valid and changes nothing
+ * - Commands that run past the end or have the wrong length are malformed
+ * - Unknown command types reject the whole downlink
+ * - Out of range values reject the whole downlink
+ * - The acknowledgement is the sequence number and status
+ */
+
+#include <zephyr/ztest.h>
+#include "sensor_downlink.h"
+
+ZTEST_SUITE(downlink, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Test that every command of a downlink is parsed
+ * 
+ */
+ZTEST(downlink, test_downlink_parse_all_commands)
+{
+    uint8_t data[] = {
+        7,
+        SENSOR_DOWNLINK_SENSOR_ENABLED, 2, 1, 1,
+        SENSOR_DOWNLINK_SENSOR_TYPE, 2, 1, CURRENT_SENSOR,
+        SENSOR_DOWNLINK_SENSOR_VOLTAGE, 2, 2, SENSOR_VOLTAGE_12V,
+        SENSOR_DOWNLINK_SENSOR_INTERVAL, 5, 2, 0x00, 0x00, 0x03, 0x84,
+        SENSOR_DOWNLINK_LORAWAN_INTERVAL, 4, 0x00, 0x00, 0x0E, 0x10,
+        SENSOR_DOWNLINK_LORAWAN_CONFIRMED, 1, 0,
+        SENSOR_DOWNLINK_FLUSH, 0,
+        SENSOR_DOWNLINK_REBOOT, 0,
+    };
+    sensor_downlink_commands_t commands;
+    enum sensor_downlink_status status;
+    int ret = sensor_downlink_parse(data, sizeof(data), &commands, &status);
+    zassert_ok(ret, "Parse failed");
+    zassert_equal(status, SENSOR_DOWNLINK_STATUS_OK, "Expected OK, actual is %d", status);
+    zassert_equal(commands.sequence, 7, "Expected sequence 7, actual is %d", commands.sequence);
+    zassert_equal(commands.sensors[0].set_fields, SENSOR_DOWNLINK_SET_ENABLED | SENSOR_DOWNLINK_SET_TYPE,
+        "Sensor 1 fields are %d", commands.sensors[0].set_fields);
+    zassert_equal(commands.sensors[0].is_enabled, 1, "Sensor 1 should be enabled");
+    zassert_equal(commands.sensors[0].type, CURRENT_SENSOR, "Sensor 1 type is %d", commands.sensors[0].type);
+    zassert_equal(commands.sensors[1].set_fields, SENSOR_DOWNLINK_SET_VOLTAGE | SENSOR_DOWNLINK_SET_INTERVAL,
+        "Sensor 2 fields are %d", commands.sensors[1].set_fields);
+    zassert_equal(commands.sensors[1].voltage, SENSOR_VOLTAGE_12V, "Sensor 2 voltage is %d", commands.sensors[1].voltage);
+    zassert_equal(commands.sensors[1].interval, 900, "Sensor 2 interval is %d", commands.sensors[1].interval);
+    zassert_true(commands.is_lorawan_interval_set, "LoRaWAN interval should be set");
+    zassert_equal(commands.lorawan_interval, 3600, "LoRaWAN interval is %d", commands.lorawan_interval);
+    zassert_true(commands.is_send_attempts_set, "Send attempts should be set");
+    zassert_equal(commands.send_attempts, 0, "Send attempts are %d", commands.send_attempts);
+    zassert_true(commands.is_flush, "Flush should be set");
+    zassert_true(commands.is_reboot, "Reboot should be set");
+    zassert_true(sensor_downlink_has_config(&commands), "Downlink changes the configuration");
+}
+
+/**
+ * @brief Test that a downlink with no commands is valid and does not change the configuration
+ * 
+ */
+ZTEST(downlink, test_downlink_parse_empty)
+{
+    uint8_t data[] = {42};
+    sensor_downlink_commands_t commands;
+    enum sensor_downlink_status status;
+    int ret = sensor_downlink_parse(data, sizeof(data), &commands, &status);
+    zassert_ok(ret, "Parse failed");
+    zassert_equal(commands.sequence, 42, "Expected sequence 42, actual is %d", commands.sequence);
+    zassert_false(sensor_downlink_has_config(&commands), "Downlink does not change the configuration");
+    ret = sensor_downlink_parse(data, 0, &commands, &status);
+    zassert_equal(ret, -EINVAL, "A downlink without a sequence number should fail");
+    zassert_equal(status, SENSOR_DOWNLINK_STATUS_MALFORMED, "Expected malformed, actual is %d", status);
+}
+
+/**
+ * @brief Test that commands running past the end of the downlink or with the wrong length are malformed
+ * 
+ */
+ZTEST(downlink, test_downlink_parse_malformed)
+{
+    uint8_t truncated[] = {1, SENSOR_DOWNLINK_LORAWAN_INTERVAL, 4, 0x00, 0x00, 0x0E};
+    uint8_t no_length[] = {1, SENSOR_DOWNLINK_FLUSH};
+    uint8_t wrong_length[] = {1, SENSOR_DOWNLINK_SENSOR_ENABLED, 1, 1};
+    sensor_downlink_commands_t commands;
+    enum sensor_downlink_status status;
+    int ret = sensor_downlink_parse(truncated, sizeof(truncated), &commands, &status);
+    zassert_equal(ret, -EINVAL, "A truncated command should fail");
+    zassert_equal(status, SENSOR_DOWNLINK_STATUS_MALFORMED, "Expected malformed, actual is %d", status);
+    ret = sensor_downlink_parse(no_length, sizeof(no_length), &commands, &status);
+    zassert_equal(ret, -EINVAL, "A command without a length should fail");
+    zassert_equal(status, SENSOR_DOWNLINK_STATUS_MALFORMED, "Expected malformed, actual is %d", status);
+    ret = sensor_downlink_parse(wrong_length, sizeof(wrong_length), &commands, &status);
+    zassert_equal(ret, -EINVAL, "A command with the wrong length should fail");
+    zassert_equal(status, SENSOR_DOWNLINK_STATUS_MALFORMED, "Expected malformed, actual is %d", status);
+}
+
+/**
+ * @brief Test that an unknown command rejects the commands before it as well
+ * 
+ */
+ZTEST(downlink, test_downlink_parse_unknown_type)
+{
+    uint8_t data[] = {3, SENSOR_DOWNLINK_SENSOR_ENABLED, 2, 1, 1, 0x7F, 0};
+    sensor_downlink_commands_t commands;
+    enum sensor_downlink_status status;
+    int ret = sensor_downlink_parse(data, sizeof(data), &commands, &status);
+    zassert_equal(ret, -EINVAL, "An unknown command should fail");
+    zassert_equal(status, SENSOR_DOWNLINK_STATUS_UNKNOWN_TYPE, "Expected unknown type, actual is %d", status);
+    zassert_equal(commands.sequence, 3, "The sequence number is needed for the acknowledgement");
+}
+
+/**
+ * @brief Test that values out of range are rejected
+ * 
+ */
+ZTEST(downlink, test_downlink_parse_invalid_values)
+{
+    uint8_t invalid[][8] = {
+        {1, SENSOR_DOWNLINK_SENSOR_ENABLED, 2, 3, 1},
+        {1, SENSOR_DOWNLINK_SENSOR_ENABLED, 2, 1, 2},
+        {1, SENSOR_DOWNLINK_SENSOR_TYPE, 2, 1, SENSOR_TYPE_LIMIT},
+        {1, SENSOR_DOWNLINK_SENSOR_VOLTAGE, 2, 1, SENSOR_VOLTAGE_INDEX_LIMIT},
+        {1, SENSOR_DOWNLINK_SENSOR_INTERVAL, 5, 1, 0, 0, 0, 0},
+        {1, SENSOR_DOWNLINK_LORAWAN_INTERVAL, 4, 0, 0, 0, SENSOR_DOWNLINK_MIN_LORAWAN_INTERVAL - 1},
+        {1, SENSOR_DOWNLINK_LORAWAN_CONFIRMED, 1, SENSOR_DOWNLINK_MAX_SEND_ATTEMPTS + 1},
+    };
+    uint8_t lengths[] = {5, 5, 5, 5, 8, 7, 4};
+    sensor_downlink_commands_t commands;
+    enum sensor_downlink_status status;
+    for (int i = 0; i < ARRAY_SIZE(lengths); i++) {
+        int ret = sensor_downlink_parse(invalid[i], lengths[i], &commands, &status);
+        zassert_equal(ret, -EINVAL, "Downlink %d should fail", i);
+        zassert_equal(status, SENSOR_DOWNLINK_STATUS_INVALID_VALUE, "Downlink %d status is %d", i, status);
+    }
+}
+
+/**
+ * @brief Test that the acknowledgement holds the sequence number and status
+ * 
+ */
+ZTEST(downlink, test_downlink_write_ack)
+{
+    uint8_t data[SENSOR_DOWNLINK_ACK_LENGTH];
+    int length = sensor_downlink_write_ack(200, SENSOR_DOWNLINK_STATUS_INVALID_VALUE, data);
+    zassert_equal(length, SENSOR_DOWNLINK_ACK_LENGTH, "Expected %d bytes, actual is %d", SENSOR_DOWNLINK_ACK_LENGTH, length);
+    zassert_equal(data[0], 200, "Expected sequence 200, actual is %d", data[0]);
+    zassert_equal(data[1], SENSOR_DOWNLINK_STATUS_INVALID_VALUE, "Expected invalid value, actual is %d", data[1]);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Tests:
+ * - Fragment headers are written and read back the same
+ * - The last fragment of a backlog is flagged
+ * - Channels that do not fit the header are rejected
+ * - Fragments are paced to the duty cycle
+ */
+
+#include <zephyr/ztest.h>
+#include "sensor_fragment.h"
+
+ZTEST_SUITE(fragment, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Test that a fragment header is written most significant byte first and read back the same
+ * 
+ */
+ZTEST(fragment, test_fragment_header_round_trip)
+{
+    uint8_t data[SENSOR_FRAGMENT_HEADER_LENGTH];
+    sensor_fragment_header_t header = {
+        .sequence = 7,
+        .channel = 2,
+        .is_last = 0,
+        .first_timestamp = 0x12345678,
+    };
+    int ret = sensor_fragment_write_header(&header, data);
+    zassert_equal(ret, SENSOR_FRAGMENT_HEADER_LENGTH, "Expected %d bytes written, actual is %d", SENSOR_FRAGMENT_HEADER_LENGTH, ret);
+    const uint8_t expected[] = {7, 2, 0x12, 0x34, 0x56, 0x78};
+    zassert_mem_equal(data, expected, sizeof(expected), "Header bytes are not as expected");
+    sensor_fragment_header_t read_header;
+    ret = sensor_fragment_read_header(data, sizeof(data), &read_header);
+    zassert_ok(ret, "Reading the header failed");
+    zassert_equal(read_header.sequence, 7, "Expected sequence 7, actual is %d", read_header.sequence);
+    zassert_equal(read_header.channel, 2, "Expected channel 2, actual is %d", read_header.channel);
+    zassert_equal(read_header.is_last, 0, "Fragment should not be the last");
+    zassert_equal(read_header.first_timestamp, 0x12345678, "Expected timestamp 0x12345678, actual is 0x%x", read_header.first_timestamp);
+    ret = sensor_fragment_read_header(data, SENSOR_FRAGMENT_HEADER_LENGTH - 1, &read_header);
+    zassert_equal(ret, -EINVAL, "A fragment shorter than the header should fail");
+}
+
+/**
+ * @brief Test that the last fragment of a backlog is flagged in the channel byte
+ * 
+ */
+ZTEST(fragment, test_fragment_last_flag)
+{
+    uint8_t data[SENSOR_FRAGMENT_HEADER_LENGTH];
+    sensor_fragment_header_t header = {
+        .sequence = 255,
+        .channel = 1,
+        .is_last = 1,
+        .first_timestamp = 1000,
+    };
+    sensor_fragment_write_header(&header, data);
+    zassert_equal(data[1], SENSOR_FRAGMENT_LAST_FLAG | 1, "Expected the last flag on channel 1, actual is 0x%x", data[1]);
+    sensor_fragment_header_t read_header;
+    sensor_fragment_read_header(data, sizeof(data), &read_header);
+    zassert_equal(read_header.channel, 1, "Expected channel 1, actual is %d", read_header.channel);
+    zassert_equal(read_header.is_last, 1, "Fragment should be the last");
+    header.channel = SENSOR_FRAGMENT_LAST_FLAG;
+    zassert_equal(sensor_fragment_write_header(&header, data), -EINVAL, "Channel should not fit the header");
+}
+
+/**
+ * @brief Test that fragments are paced to the duty cycle, with a minimum interval
+ * 
+ */
+ZTEST(fragment, test_fragment_interval)
+{
+    /* 61.7 ms on air at 1% needs 6.1 s off */
+    uint32_t interval_ms = sensor_fragment_get_interval_ms(61696);
+    zassert_equal(interval_ms, 6107, "Expected 6107 ms, actual is %d", interval_ms);
+    interval_ms = sensor_fragment_get_interval_ms(28288);
+    zassert_equal(interval_ms, SENSOR_FRAGMENT_MIN_INTERVAL_MS, "Expected the minimum interval, actual is %d", interval_ms);
+}
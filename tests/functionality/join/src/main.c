@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Tests:
+ * - The first join attempt is not delayed
+ * - Failed attempts back off exponentially with a bounded jitter
+ * - The backoff is capped and reset by a successful join
+ * - The first hour allows 36 s of join time on air
+ * - After 11 hours, each day allows 8.7 s of join time on air
+ * - Join requests longer than the daily time on air are rejected
+ */
+
+#include <zephyr/ztest.h>
+#include "sensor_join.h"
+
+#define TEST_HOUR_MS    3600000ULL
+
+ZTEST_SUITE(join, NULL, NULL, NULL, NULL, NULL);
+
+/**
+ * @brief Test that the first join attempt is sent right away
+ * 
+ */
+ZTEST(join, test_join_first_attempt)
+{
+    sensor_join_backoff_t backoff = {0};
+    uint32_t delay_ms;
+    int ret = sensor_join_get_delay_ms(&backoff, 5000, 400000, 12345, &delay_ms);
+    zassert_ok(ret, "Get delay failed");
+    zassert_equal(delay_ms, 0, "Expected no delay, actual is %d", delay_ms);
+}
+
+/**
+ * @brief Test that each failed attempt doubles the backoff and the jitter stays within its percent
+ * 
+ */
+ZTEST(join, test_join_exponential_backoff)
+{
+    sensor_join_backoff_t backoff = {0};
+    uint32_t delay_ms;
+    uint32_t expected_ms = SENSOR_JOIN_BACKOFF_BASE_MS;
+    for (int i = 0; i < 4; i++) {
+        sensor_join_record_attempt(&backoff, 0, 400000, 0);
+        sensor_join_get_delay_ms(&backoff, 0, 400000, 0, &delay_ms);
+        zassert_equal(delay_ms, expected_ms, "Expected %d ms, actual is %d", expected_ms, delay_ms);
+        sensor_join_get_delay_ms(&backoff, 0, 400000, UINT32_MAX, &delay_ms);
+        zassert_true(delay_ms >= expected_ms && delay_ms <= expected_ms + (expected_ms * SENSOR_JOIN_JITTER_PERCENT) / 100, 
+            "Jitter out of range, delay is %d", delay_ms);
+        expected_ms *= 2;
+    }
+}
+
+/**
+ * @brief Test that the backoff stops at its maximum and a successful join resets it
+ * 
+ */
+ZTEST(join, test_join_backoff_max_and_reset)
+{
+    sensor_join_backoff_t backoff = {0};
+    uint32_t delay_ms;
+    for (int i = 0; i < 40; i++) {
+        sensor_join_record_attempt(&backoff, 0, 100000, 0);
+    }
+    sensor_join_get_delay_ms(&backoff, 0, 100000, 0, &delay_ms);
+    zassert_equal(delay_ms, SENSOR_JOIN_BACKOFF_MAX_MS, "Expected the max backoff, actual is %d", delay_ms);
+    sensor_join_record_attempt(&backoff, 0, 100000, 1);
+    sensor_join_get_delay_ms(&backoff, 0, 100000, 0, &delay_ms);
+    zassert_equal(delay_ms, 0, "Expected no delay after a join, actual is %d", delay_ms);
+}
+
+/**
+ * @brief Test that the join time on air of the first hour is limited to 36 s
+ * 
+ */
+ZTEST(join, test_join_first_hour_duty_cycle)
+{
+    sensor_join_backoff_t backoff = {0};
+    uint32_t delay_ms;
+    for (int i = 0; i < 36; i++) {
+        sensor_join_get_delay_ms(&backoff, i * 1000, 1000000, 0, &delay_ms);
+        zassert_equal(delay_ms, 0, "Attempt %d should not be delayed, actual is %d", i, delay_ms);
+        sensor_join_record_attempt(&backoff, i * 1000, 1000000, 1);
+    }
+    sensor_join_get_delay_ms(&backoff, 36000, 1000000, 0, &delay_ms);
+    zassert_equal(delay_ms, TEST_HOUR_MS - 36000, "Expected to wait for the second window, actual is %d", delay_ms);
+}
+
+/**
+ * @brief Test that after 11 hours each day is limited to 8.7 s of join time on air
+ * 
+ */
+ZTEST(join, test_join_daily_duty_cycle)
+{
+    sensor_join_backoff_t backoff = {0};
+    uint32_t delay_ms;
+    sensor_join_record_attempt(&backoff, 0, 1000000, 1);
+    uint64_t now_ms = (11 * TEST_HOUR_MS) + 1000;
+    sensor_join_get_delay_ms(&backoff, now_ms, 8000000, 0, &delay_ms);
+    zassert_equal(delay_ms, 0, "A new daily window should not be delayed, actual is %d", delay_ms);
+    sensor_join_record_attempt(&backoff, now_ms, 8000000, 1);
+    sensor_join_get_delay_ms(&backoff, now_ms, 1000000, 0, &delay_ms);
+    zassert_equal(delay_ms, (24 * TEST_HOUR_MS) - 1000, "Expected to wait for the next day, actual is %d", delay_ms);
+}
+
+/**
+ * @brief Test that a join request longer than the daily time on air is rejected
+ * 
+ */
+ZTEST(join, test_join_time_on_air_too_long)
+{
+    sensor_join_backoff_t backoff = {0};
+    uint32_t delay_ms;
+    int ret = sensor_join_get_delay_ms(&backoff, 0, 9000000, 0, &delay_ms);
+    zassert_equal(ret, -EINVAL, "Expected -EINVAL, actual is %d", ret);
+}
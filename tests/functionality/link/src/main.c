@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Tests:
+ * - Uplinks start at the default data rate until the link is measured
+ * - A strong link steps up one data rate per measurement
+ * - A weak link drops to a slower data rate right away
+ * - LinkCheckAns margins are measured against the data rate of the request
+ * - Consecutive failed confirmed uplinks fall back to a slower data rate
+ * - A link check is needed after uplinks without a measurement
+ * - Uplinks are unconfirmed unless critical or a delivery check is due
+ * - Signs of link loss escalate to confirmed uplinks
+ */
+
+#include <zephyr/ztest.h>
+#include "sensor_link.h"
+
+static void before_tests(void *fixture)
+{
+    sensor_link_reset();
+}
+
+ZTEST_SUITE(link, NULL, NULL, before_tests, NULL, NULL);
+
+/**
+ * @brief Test that uplinks are sent at the default data rate before the link is measured
+ * 
+ */
+ZTEST(link, test_link_default_datarate)
+{
+    int16_t snr;
+    zassert_equal(sensor_link_get_datarate(), SENSOR_LINK_DEFAULT_DATARATE, "Expected the default data rate");
+    zassert_equal(sensor_link_get_snr(&snr), -EAGAIN, "SNR should not be measured");
+}
+
+/**
+ * @brief Test that a strong link steps up one data rate per downlink, up to the max
+ * 
+ */
+ZTEST(link, test_link_strong_link_steps_up)
+{
+    int16_t snr;
+    sensor_link_report_downlink(-60, 10);
+    zassert_equal(sensor_link_get_datarate(), LORAWAN_DR_2, "Expected DR2, actual is DR%d", sensor_link_get_datarate());
+    sensor_link_report_downlink(-60, 10);
+    zassert_equal(sensor_link_get_datarate(), LORAWAN_DR_3, "Expected DR3, actual is DR%d", sensor_link_get_datarate());
+    sensor_link_report_downlink(-60, 10);
+    zassert_equal(sensor_link_get_datarate(), SENSOR_LINK_MAX_DATARATE, "Expected the max data rate");
+    zassert_ok(sensor_link_get_snr(&snr), "SNR should be measured");
+    zassert_equal(snr, 100, "Expected 100, actual is %d", snr);
+}
+
+/**
+ * @brief Test that a weak link drops to the slowest data rate without stepping down
+ * 
+ */
+ZTEST(link, test_link_weak_link_drops)
+{
+    sensor_link_report_downlink(-60, 10);
+    sensor_link_report_downlink(-60, 10);
+    zassert_equal(sensor_link_get_datarate(), LORAWAN_DR_3, "Expected DR3, actual is DR%d", sensor_link_get_datarate());
+    sensor_link_report_downlink(-120, -100);
+    zassert_equal(sensor_link_get_datarate(), SENSOR_LINK_MIN_DATARATE, "Expected the min data rate, actual is DR%d", 
+        sensor_link_get_datarate());
+}
+
+/**
+ * @brief Test that a LinkCheckAns margin is added to the floor of the data rate and checks without gateways are ignored
+ * 
+ */
+ZTEST(link, test_link_link_check)
+{
+    int16_t snr;
+    sensor_link_report_link_check(15, 0);
+    zassert_equal(sensor_link_get_snr(&snr), -EAGAIN, "A link check without gateways should be ignored");
+    sensor_link_report_link_check(15, 1);
+    zassert_ok(sensor_link_get_snr(&snr), "SNR should be measured");
+    /* 15 dB above the -12.5 dB floor of SF9 */
+    zassert_equal(snr, 25, "Expected 25, actual is %d", snr);
+    zassert_equal(sensor_link_get_datarate(), LORAWAN_DR_2, "Expected DR2, actual is DR%d", sensor_link_get_datarate());
+}
+
+/**
+ * @brief Test that consecutive failed confirmed uplinks fall back to a slower data rate and forget the estimate
+ * 
+ */
+ZTEST(link, test_link_failures_fall_back)
+{
+    int16_t snr;
+    sensor_link_report_downlink(-60, 10);
+    zassert_equal(sensor_link_get_datarate(), LORAWAN_DR_2, "Expected DR2, actual is DR%d", sensor_link_get_datarate());
+    for (int i = 0; i < SENSOR_LINK_MAX_FAILURES; i++) {
+        sensor_link_report_uplink(0, 0);
+    }
+    sensor_link_report_uplink(1, 0);
+    sensor_link_report_uplink(1, 0);
+    sensor_link_report_uplink(1, 1);
+    sensor_link_report_uplink(1, 0);
+    sensor_link_report_uplink(1, 0);
+    zassert_equal(sensor_link_get_datarate(), LORAWAN_DR_2, "Unconfirmed and acknowledged uplinks should not fall back");
+    sensor_link_report_uplink(1, 0);
+    zassert_equal(sensor_link_get_datarate(), LORAWAN_DR_1, "Expected DR1, actual is DR%d", sensor_link_get_datarate());
+    zassert_equal(sensor_link_get_snr(&snr), -EAGAIN, "The estimate should be forgotten");
+    for (int i = 0; i < SENSOR_LINK_MAX_FAILURES; i++) {
+        sensor_link_report_uplink(1, 0);
+    }
+    zassert_equal(sensor_link_get_datarate(), SENSOR_LINK_MIN_DATARATE, "Should not fall below the min data rate");
+}
+
+/**
+ * @brief Test that a link check is needed when the link has not been measured for the check interval
+ * 
+ */
+ZTEST(link, test_link_needs_link_check)
+{
+    zassert_true(sensor_link_needs_link_check(), "An unmeasured link should need a link check");
+    sensor_link_report_downlink(-60, 0);
+    zassert_false(sensor_link_needs_link_check(), "A measured link should not need a link check");
+    for (int i = 0; i < SENSOR_LINK_CHECK_INTERVAL - 1; i++) {
+        sensor_link_report_uplink(0, 1);
+    }
+    zassert_false(sensor_link_needs_link_check(), "Link check should not be needed yet");
+    sensor_link_report_uplink(0, 1);
+    zassert_true(sensor_link_needs_link_check(), "Link check should be needed after the interval");
+}
+
+/**
+ * @brief Test that uplinks are unconfirmed by default, with a confirmed uplink for critical data and every 
+ * SENSOR_LINK_CONFIRMED_INTERVAL uplinks
+ * 
+ */
+ZTEST(link, test_link_confirmed_interval)
+{
+    zassert_false(sensor_link_needs_confirmed(0), "Uplinks should be unconfirmed by default");
+    zassert_true(sensor_link_needs_confirmed(1), "Critical uplinks should be confirmed");
+    for (int i = 0; i < SENSOR_LINK_CONFIRMED_INTERVAL; i++) {
+        zassert_false(sensor_link_needs_confirmed(0), "Uplink %d should be unconfirmed", i);
+        sensor_link_report_uplink(0, 1);
+        sensor_link_report_downlink(-90, 5);
+    }
+    zassert_true(sensor_link_needs_confirmed(0), "A delivery check should be due");
+    sensor_link_report_uplink(1, 1);
+    zassert_false(sensor_link_needs_confirmed(0), "The acknowledged uplink checked delivery");
+}
+
+/**
+ * @brief Test that unanswered link checks and failed confirmed uplinks escalate to confirmed uplinks
+ * 
+ */
+ZTEST(link, test_link_confirmed_on_link_loss)
+{
+    for (int i = 0; i < SENSOR_LINK_LOSS_UPLINKS; i++) {
+        zassert_false(sensor_link_needs_confirmed(0), "Uplink %d should be unconfirmed", i);
+        sensor_link_report_uplink(0, 1);
+    }
+    zassert_true(sensor_link_needs_confirmed(0), "Unanswered link checks should escalate to confirmed");
+    sensor_link_report_downlink(-90, 5);
+    zassert_false(sensor_link_needs_confirmed(0), "A downlink shows the link is back");
+    sensor_link_report_uplink(1, 0);
+    zassert_true(sensor_link_needs_confirmed(0), "A failed confirmed uplink should stay confirmed");
+    sensor_link_report_uplink(1, 1);
+    zassert_false(sensor_link_needs_confirmed(0), "An acknowledged uplink shows the link is back");
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Tests:
+ * - Queued uplinks are sent by the radio thread and report their result
+ * - An uplink with attempts that was sent unconfirmed is reported as sent, not acked
+ * - High priority uplinks are sent before low priority uplinks
+ * - A full queue drops its oldest uplink
+ * - Flushing drops all queued uplinks
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fff.h>
+#include "sensor_radio.h"
+
+DEFINE_FFF_GLOBALS;
+
+FAKE_VALUE_FUNC(int, sensor_lorawan_send_data, lorawan_data_t *);
+
+#define TEST_MAX_UPLINKS    (2 * SENSOR_RADIO_QUEUE_LENGTH + 2)
+
+/* Released by the tests to let a send complete */
+K_SEM_DEFINE(send_sem, 0, TEST_MAX_UPLINKS);
+
+/* Ports in the order the uplinks were sent */
+static uint8_t sent_ports[TEST_MAX_UPLINKS];
+static int num_sent;
+
+/* Result of each uplink by its index in user_data */
+static enum sensor_radio_result results[TEST_MAX_UPLINKS];
+static int num_completed;
+
+static int blocking_send_data(lorawan_data_t *data)
+{
+    sent_ports[num_sent++] = data->port;
+    k_sem_take(&send_sem, K_FOREVER);
+    return 0;
+}
+
+static int acked_send_data(lorawan_data_t *data)
+{
+    data->is_acked = 1;
+    return 0;
+}
+
+static void uplink_complete(enum sensor_radio_result result, void *user_data)
+{
+    results[(intptr_t)user_data] = result;
+    num_completed++;
+}
+
+static void queue_uplink(int index, uint8_t port, enum sensor_radio_priority priority, uint8_t attempts)
+{
+    sensor_radio_uplink_t uplink = {
+        .data = {
+            .data = {index},
+            .length = 1,
+            .port = port,
+            .attempts = attempts,
+        },
+        .priority = priority,
+        .callback = uplink_complete,
+        .user_data = (void *)(intptr_t)index,
+    };
+    int ret = sensor_radio_enqueue(&uplink);
+    zassert_ok(ret, "Queueing uplink %d failed", index);
+}
+
+static void before_tests(void *fixture)
+{
+    RESET_FAKE(sensor_lorawan_send_data);
+    FFF_RESET_HISTORY();
+    k_sem_reset(&send_sem);
+    memset(sent_ports, 0, sizeof(sent_ports));
+    memset(results, 0, sizeof(results));
+    num_sent = 0;
+    num_completed = 0;
+}
+
+ZTEST_SUITE(radio, NULL, NULL, before_tests, NULL, NULL);
+
+/**
+ * @brief Test that an unconfirmed uplink is sent and reported as sent
+ * 
+ */
+ZTEST(radio, test_radio_unconfirmed_uplink_sent)
+{
+    queue_uplink(0, 2, SENSOR_RADIO_PRIORITY_HIGH, 0);
+    k_sleep(K_MSEC(100));
+    zassert_equal(sensor_lorawan_send_data_fake.call_count, 1, "Uplink should be sent once");
+    zassert_equal(num_completed, 1, "Callback should be called once");
+    zassert_equal(results[0], SENSOR_RADIO_RESULT_SENT, "Expected sent, actual is %d", results[0]);
+}
+
+/**
+ * @brief Test that a confirmed uplink reports acked on success and failed on failure
+ * 
+ */
+ZTEST(radio, test_radio_confirmed_uplink_result)
+{
+    sensor_lorawan_send_data_fake.custom_fake = acked_send_data;
+    queue_uplink(0, 2, SENSOR_RADIO_PRIORITY_HIGH, 2);
+    k_sleep(K_MSEC(100));
+    zassert_equal(results[0], SENSOR_RADIO_RESULT_ACKED, "Expected acked, actual is %d", results[0]);
+    sensor_lorawan_send_data_fake.custom_fake = NULL;
+    sensor_lorawan_send_data_fake.return_val = -ETIMEDOUT;
+    queue_uplink(1, 2, SENSOR_RADIO_PRIORITY_HIGH, 2);
+    k_sleep(K_MSEC(100));
+    zassert_equal(results[1], SENSOR_RADIO_RESULT_FAILED, "Expected failed, actual is %d", results[1]);
+}
+
+/**
+ * @brief Test that an uplink with attempts that was sent unconfirmed is reported as sent
+ * 
+ */
+ZTEST(radio, test_radio_downgraded_uplink_sent)
+{
+    queue_uplink(0, 2, SENSOR_RADIO_PRIORITY_HIGH, 2);
+    k_sleep(K_MSEC(100));
+    zassert_equal(sensor_lorawan_send_data_fake.call_count, 1, "Uplink should be sent once");
+    zassert_equal(results[0], SENSOR_RADIO_RESULT_SENT, "Expected sent, actual is %d", results[0]);
+}
+
+/**
+ * @brief Test that a high priority uplink queued after a low priority uplink is sent first
+ * 
+ */
+ZTEST(radio, test_radio_high_priority_sent_first)
+{
+    sensor_lorawan_send_data_fake.custom_fake = blocking_send_data;
+    queue_uplink(0, 1, SENSOR_RADIO_PRIORITY_LOW, 0);
+    /* Let the radio thread start sending the first uplink */
+    k_sleep(K_MSEC(10));
+    queue_uplink(1, 3, SENSOR_RADIO_PRIORITY_LOW, 0);
+    queue_uplink(2, 2, SENSOR_RADIO_PRIORITY_HIGH, 0);
+    for (int i = 0; i < 3; i++) {
+        k_sem_give(&send_sem);
+    }
+    k_sleep(K_MSEC(100));
+    zassert_equal(num_sent, 3, "Expected 3 uplinks sent, actual is %d", num_sent);
+    zassert_equal(sent_ports[0], 1, "First uplink should be the one in progress");
+    zassert_equal(sent_ports[1], 2, "High priority uplink should be sent second");
+    zassert_equal(sent_ports[2], 3, "Low priority uplink should be sent last");
+}
+
+/**
+ * @brief Test that a full queue drops its oldest uplink and a flush drops the rest
+ * 
+ */
+ZTEST(radio, test_radio_full_queue_drops_oldest)
+{
+    sensor_lorawan_send_data_fake.custom_fake = blocking_send_data;
+    queue_uplink(0, 2, SENSOR_RADIO_PRIORITY_LOW, 0);
+    k_sleep(K_MSEC(10));
+    /* Uplink 0 is being sent, one more than fits the queue */
+    for (int i = 1; i <= SENSOR_RADIO_QUEUE_LENGTH + 1; i++) {
+        queue_uplink(i, 2, SENSOR_RADIO_PRIORITY_LOW, 0);
+    }
+    zassert_equal(results[1], SENSOR_RADIO_RESULT_DROPPED, "Oldest queued uplink should be dropped");
+    zassert_equal(sensor_radio_get_queued(), SENSOR_RADIO_QUEUE_LENGTH, "Queue should be full");
+    sensor_radio_flush();
+    zassert_equal(sensor_radio_get_queued(), 0, "Queue should be empty after a flush");
+    zassert_equal(num_completed, SENSOR_RADIO_QUEUE_LENGTH + 1, "Expected %d dropped, actual is %d", 
+        SENSOR_RADIO_QUEUE_LENGTH + 1, num_completed);
+    k_sem_give(&send_sem);
+    k_sleep(K_MSEC(100));
+    zassert_equal(num_sent, 1, "Only the uplink in progress should be sent");
+    zassert_equal(results[0], SENSOR_RADIO_RESULT_SENT, "Uplink in progress should complete");
+}
@@ -237,3 +237,305 @@ ZTEST(scheduling, test_scheduling_multiple_schedules_can_be_added_at_the_same_ti
     int current_time = sensor_scheduling_get_seconds();
     zassert_true(current_time - initial_time == 10, "Scheduling get seconds returned %d, expected %d", current_time - initial_time, 10);
 }
+
+/**
+ * @brief Test that more schedules than alarm channels can be added and each is triggered at its own frequency
+ * 
+ */
+ZTEST(scheduling, test_scheduling_more_schedules_than_alarm_channels)
+{
+    int ret;
+    sensor_scheduling_cfg_t schedules[6];
+    for (int i = 0; i < ARRAY_SIZE(schedules); i++) {
+        schedules[i] = (sensor_scheduling_cfg_t){
+            .id = SENSOR_SCHEDULING_ID_SENSOR1,
+            .frequency_seconds = i + 2,
+        };
+        ret = sensor_scheduling_add_schedule(&schedules[i]);
+        zassert_ok(ret, "Scheduling add schedule %d failed", i);
+    }
+    k_sleep(K_SECONDS(4));
+    for (int i = 0; i < ARRAY_SIZE(schedules); i++) {
+        if (schedules[i].frequency_seconds <= 4) {
+            zassert_true(schedules[i].is_triggered, "Schedule %d is not triggered", i);
+        } else {
+            zassert_false(schedules[i].is_triggered, "Schedule %d is triggered early", i);
+        }
+    }
+    k_sleep(K_SECONDS(4));
+    for (int i = 0; i < ARRAY_SIZE(schedules); i++) {
+        zassert_true(schedules[i].is_triggered, "Schedule %d is not triggered", i);
+        ret = sensor_scheduling_remove_schedule(&schedules[i]);
+        zassert_ok(ret, "Scheduling remove schedule %d failed", i);
+    }
+}
+
+/**
+ * @brief Test that removing the nearest schedule still triggers the later schedules
+ * 
+ */
+ZTEST(scheduling, test_scheduling_removing_nearest_schedule_keeps_later_schedule)
+{
+    sensor_scheduling_cfg_t near_schedule = {
+        .id = SENSOR_SCHEDULING_ID_SENSOR1,
+        .frequency_seconds = 2
+    };
+    sensor_scheduling_cfg_t far_schedule = {
+        .id = SENSOR_SCHEDULING_ID_SENSOR2,
+        .frequency_seconds = 4
+    };
+    int ret = sensor_scheduling_add_schedule(&near_schedule);
+    zassert_ok(ret, "Scheduling add schedule failed");
+    ret = sensor_scheduling_add_schedule(&far_schedule);
+    zassert_ok(ret, "Scheduling add schedule failed");
+    ret = sensor_scheduling_remove_schedule(&near_schedule);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+    k_sleep(K_SECONDS(4));
+    zassert_false(near_schedule.is_triggered, "Removed schedule was triggered");
+    zassert_true(far_schedule.is_triggered, "Schedule is not triggered");
+    ret = sensor_scheduling_remove_schedule(&far_schedule);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+}
+
+/**
+ * @brief Test that adding a schedule fails once the queue is full
+ * 
+ */
+ZTEST(scheduling, test_scheduling_add_schedule_when_queue_full)
+{
+    int ret = 0;
+    int added = 0;
+    sensor_scheduling_cfg_t schedules[SENSOR_SCHEDULING_MAX_SCHEDULES + 1];
+    for (int i = 0; i < ARRAY_SIZE(schedules); i++) {
+        schedules[i] = (sensor_scheduling_cfg_t){
+            .id = SENSOR_SCHEDULING_ID_RADIO,
+            .frequency_seconds = 100,
+        };
+        ret = sensor_scheduling_add_schedule(&schedules[i]);
+        if (ret != 0) {
+            break;
+        }
+        added++;
+    }
+    zassert_equal(ret, -ENOMEM, "Expected -ENOMEM when the queue is full, got %d", ret);
+    zassert_false(schedules[added].is_scheduled, "Schedule that failed to add is scheduled");
+    for (int i = 0; i < added; i++) {
+        ret = sensor_scheduling_remove_schedule(&schedules[i]);
+        zassert_ok(ret, "Scheduling remove schedule %d failed", i);
+    }
+}
+
+static int trigger_callback_count;
+
+static void count_trigger(sensor_scheduling_cfg_t *schedule)
+{
+    trigger_callback_count++;
+}
+
+/**
+ * @brief Test that the trigger callback is called once when the schedule is triggered
+ * 
+ */
+ZTEST(scheduling, test_scheduling_trigger_callback)
+{
+    sensor_scheduling_cfg_t schedule = {
+        .id = SENSOR_SCHEDULING_ID_SENSOR1,
+        .frequency_seconds = 2,
+        .trigger_callback = count_trigger,
+    };
+    trigger_callback_count = 0;
+    int ret = sensor_scheduling_add_schedule(&schedule);
+    zassert_ok(ret, "Scheduling add schedule failed");
+    zassert_equal(trigger_callback_count, 0, "Trigger callback called before the alarm");
+    k_sleep(K_SECONDS(3));
+    zassert_true(schedule.is_triggered, "Schedule is not triggered");
+    zassert_equal(trigger_callback_count, 1, "Trigger callback called %d times, expected 1", trigger_callback_count);
+    ret = sensor_scheduling_remove_schedule(&schedule);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+}
+
+/**
+ * @brief Test that an anchored schedule triggers on multiples of its period from the anchor
+ * 
+ */
+ZTEST(scheduling, test_scheduling_anchored_schedule_lines_up_with_anchor)
+{
+    sensor_scheduling_cfg_t schedule = {
+        .id = SENSOR_SCHEDULING_ID_SENSOR1,
+        .frequency_seconds = 3
+    };
+    uint64_t current_ms;
+    int ret = sensor_scheduling_add_anchored_schedule(&schedule, 0);
+    zassert_ok(ret, "Scheduling add anchored schedule failed");
+    zassert_equal(schedule.next_event_ms % 3000, 0, "First event is not on the anchored period");
+    ret = sensor_scheduling_get_ms(&current_ms);
+    zassert_ok(ret, "Scheduling get ms failed");
+    k_sleep(K_MSEC(schedule.next_event_ms + 500 - current_ms));
+    zassert_true(schedule.is_triggered, "Schedule is not triggered");
+    int event_seconds = sensor_scheduling_get_event_seconds(&schedule);
+    zassert_equal(event_seconds % 3, 0, "Event at %d seconds is not a multiple of the period", event_seconds);
+    ret = sensor_scheduling_reset_schedule(&schedule);
+    zassert_ok(ret, "Scheduling reset schedule failed");
+    zassert_equal(schedule.next_event_ms, (uint64_t)(event_seconds + 3) * 1000, "Next event is not one period after the last");
+    zassert_equal(schedule.missed_periods, 0, "Expected no missed periods");
+    ret = sensor_scheduling_remove_schedule(&schedule);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+}
+
+/**
+ * @brief Test that resetting an anchored schedule late skips and counts the missed periods
+ * 
+ */
+ZTEST(scheduling, test_scheduling_anchored_schedule_counts_missed_periods)
+{
+    sensor_scheduling_cfg_t schedule = {
+        .id = SENSOR_SCHEDULING_ID_SENSOR1,
+        .frequency_seconds = 3
+    };
+    uint64_t current_ms;
+    int ret = sensor_scheduling_add_anchored_schedule(&schedule, 0);
+    zassert_ok(ret, "Scheduling add anchored schedule failed");
+    uint64_t event_ms = schedule.next_event_ms;
+    ret = sensor_scheduling_get_ms(&current_ms);
+    zassert_ok(ret, "Scheduling get ms failed");
+    k_sleep(K_MSEC(event_ms + 500 - current_ms));
+    zassert_true(schedule.is_triggered, "Schedule is not triggered");
+    ret = sensor_scheduling_get_ms(&current_ms);
+    zassert_ok(ret, "Scheduling get ms failed");
+    // Reset between the 2nd and 3rd period after the event
+    k_sleep(K_MSEC(event_ms + 7500 - current_ms));
+    ret = sensor_scheduling_reset_schedule(&schedule);
+    zassert_ok(ret, "Scheduling reset schedule failed");
+    zassert_equal(schedule.missed_periods, 2, "Expected 2 missed periods, got %d", schedule.missed_periods);
+    zassert_equal(schedule.next_event_ms, event_ms + 9000, "Next event is not on the anchored period");
+    ret = sensor_scheduling_remove_schedule(&schedule);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+}
+
+/**
+ * @brief Test that the jitter offsets the events of an anchored schedule within its bounds, differently for each seed
+ * 
+ */
+ZTEST(scheduling, test_scheduling_jitter_offsets_anchored_events)
+{
+    sensor_scheduling_cfg_t schedule1 = {
+        .id = SENSOR_SCHEDULING_ID_RADIO,
+        .frequency_seconds = 10
+    };
+    sensor_scheduling_cfg_t schedule2 = {
+        .id = SENSOR_SCHEDULING_ID_RADIO,
+        .frequency_seconds = 10
+    };
+    uint64_t current_ms;
+    int ret = sensor_scheduling_get_ms(&current_ms);
+    zassert_ok(ret, "Scheduling get ms failed");
+    uint64_t anchor_ms = current_ms + 100000;
+    ret = sensor_scheduling_set_jitter(&schedule1, 2000, 1);
+    zassert_ok(ret, "Scheduling set jitter failed");
+    ret = sensor_scheduling_set_jitter(&schedule2, 2000, 2);
+    zassert_ok(ret, "Scheduling set jitter failed");
+    ret = sensor_scheduling_add_anchored_schedule(&schedule1, anchor_ms);
+    zassert_ok(ret, "Scheduling add anchored schedule failed");
+    ret = sensor_scheduling_add_anchored_schedule(&schedule2, anchor_ms);
+    zassert_ok(ret, "Scheduling add anchored schedule failed");
+    zassert_true(schedule1.next_event_ms >= anchor_ms - 2000 && schedule1.next_event_ms <= anchor_ms + 2000, 
+        "First event is outside the jitter bounds");
+    zassert_true(schedule2.next_event_ms >= anchor_ms - 2000 && schedule2.next_event_ms <= anchor_ms + 2000, 
+        "First event is outside the jitter bounds");
+    zassert_not_equal(schedule1.next_event_ms, schedule2.next_event_ms, "Schedules with different seeds should not line up");
+    zassert_equal(schedule1.event_index, 0, "The anchored time should not change with the jitter");
+    ret = sensor_scheduling_remove_schedule(&schedule1);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+    ret = sensor_scheduling_remove_schedule(&schedule2);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+}
+
+/**
+ * @brief Test that a jitter of half the period or more is rejected
+ * 
+ */
+ZTEST(scheduling, test_scheduling_jitter_too_large)
+{
+    sensor_scheduling_cfg_t schedule = {
+        .id = SENSOR_SCHEDULING_ID_RADIO,
+        .frequency_seconds = 10
+    };
+    int ret = sensor_scheduling_set_jitter(&schedule, 5000, 1);
+    zassert_equal(ret, -EINVAL, "Jitter of half the period should be rejected");
+    ret = sensor_scheduling_set_jitter(&schedule, 4999, 1);
+    zassert_ok(ret, "Jitter under half the period should be accepted");
+}
+
+/**
+ * @brief Test that a schedule set to catch up once triggers a single event right away for all of its missed periods
+ * 
+ */
+ZTEST(scheduling, test_scheduling_catch_up_once)
+{
+    sensor_scheduling_cfg_t schedule = {
+        .id = SENSOR_SCHEDULING_ID_RADIO,
+        .frequency_seconds = 2,
+        .catch_up = SENSOR_SCHEDULING_CATCH_UP_ONCE,
+    };
+    uint64_t current_ms;
+    int ret = sensor_scheduling_add_schedule(&schedule);
+    zassert_ok(ret, "Scheduling add schedule failed");
+    uint64_t event_ms = schedule.next_event_ms;
+    ret = sensor_scheduling_get_ms(&current_ms);
+    zassert_ok(ret, "Scheduling get ms failed");
+    // Reset between the 2nd and 3rd period after the event
+    k_sleep(K_MSEC(event_ms + 5500 - current_ms));
+    zassert_true(schedule.is_triggered, "Schedule is not triggered");
+    ret = sensor_scheduling_reset_schedule(&schedule);
+    zassert_ok(ret, "Scheduling reset schedule failed");
+    zassert_true(schedule.is_triggered, "Catch up event did not trigger right away");
+    zassert_equal(schedule.missed_periods, 1, "Expected 1 missed period, got %d", schedule.missed_periods);
+    ret = sensor_scheduling_reset_schedule(&schedule);
+    zassert_ok(ret, "Scheduling reset schedule failed");
+    zassert_false(schedule.is_triggered, "Schedule should be caught up");
+    zassert_equal(schedule.missed_periods, 1, "Expected 1 missed period, got %d", schedule.missed_periods);
+    ret = sensor_scheduling_remove_schedule(&schedule);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+}
+
+/**
+ * @brief Test that a schedule set to catch up all triggers every missed period and records its lateness
+ * 
+ */
+ZTEST(scheduling, test_scheduling_catch_up_all_and_stats)
+{
+    sensor_scheduling_cfg_t schedule = {
+        .id = SENSOR_SCHEDULING_ID_SENSOR1,
+        .frequency_seconds = 2,
+        .catch_up = SENSOR_SCHEDULING_CATCH_UP_ALL,
+    };
+    sensor_scheduling_stats_t stats;
+    uint64_t current_ms;
+    int ret = sensor_scheduling_add_anchored_schedule(&schedule, 0);
+    zassert_ok(ret, "Scheduling add anchored schedule failed");
+    uint64_t event_ms = schedule.next_event_ms;
+    ret = sensor_scheduling_get_ms(&current_ms);
+    zassert_ok(ret, "Scheduling get ms failed");
+    // Reset between the 2nd and 3rd period after the event
+    k_sleep(K_MSEC(event_ms + 5500 - current_ms));
+    zassert_true(schedule.is_triggered, "Schedule is not triggered");
+    for (int i = 1; i <= 2; i++) {
+        ret = sensor_scheduling_reset_schedule(&schedule);
+        zassert_ok(ret, "Scheduling reset schedule failed");
+        zassert_true(schedule.is_triggered, "Missed period %d did not trigger right away", i);
+        zassert_equal(sensor_scheduling_get_event_seconds(&schedule), (event_ms / 1000) + (2 * i), 
+            "Missed period %d is not on the anchored time", i);
+    }
+    ret = sensor_scheduling_reset_schedule(&schedule);
+    zassert_ok(ret, "Scheduling reset schedule failed");
+    zassert_false(schedule.is_triggered, "Schedule should be caught up");
+    zassert_equal(schedule.next_event_ms, event_ms + 6000, "Next event is not on the anchored period");
+    ret = sensor_scheduling_get_stats(&schedule, &stats);
+    zassert_ok(ret, "Scheduling get stats failed");
+    zassert_equal(stats.event_count, 3, "Expected 3 events, got %d", stats.event_count);
+    zassert_equal(stats.missed_periods, 0, "Expected no missed periods, got %d", stats.missed_periods);
+    zassert_true(stats.max_lateness_ms >= 4000, "Max lateness of %d ms is too small", stats.max_lateness_ms);
+    zassert_true(stats.mean_lateness_ms < stats.max_lateness_ms, "Mean lateness should be less than the max");
+    ret = sensor_scheduling_remove_schedule(&schedule);
+    zassert_ok(ret, "Scheduling remove schedule failed");
+}
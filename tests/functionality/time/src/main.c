@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Tests:
+ * - Time is not available before it is synchronized
+ * - Local time converts to UTC after a synchronization
+ * - GPS time from the network converts to UTC
+ * - GPS time that was not set by the network is rejected
+ * - Drift is estimated and corrected between synchronizations
+ * - A synchronization with a drift out of bounds becomes the new reference
+ * - Schedules can be anchored to the next wall-clock boundary
+ * - Time needs to be synchronized again after the resync interval
+ */
+
+#include <zephyr/ztest.h>
+#include "sensor_time.h"
+
+/* 2025-01-01 00:00:00 UTC in milliseconds */
+#define TEST_UTC_MS     1735689600000ULL
+
+static void before_tests(void *fixture)
+{
+    sensor_time_reset();
+}
+
+ZTEST_SUITE(time, NULL, NULL, before_tests, NULL, NULL);
+
+/**
+ * @brief Test that the time is not available before it is synchronized
+ * 
+ */
+ZTEST(time, test_time_not_synced)
+{
+    uint64_t utc_ms;
+    zassert_equal(sensor_time_is_synced(), 0, "Time should not be synced");
+    zassert_equal(sensor_time_needs_sync(0), 1, "Time should need a sync");
+    zassert_equal(sensor_time_local_to_utc_ms(1000, &utc_ms), -EAGAIN, "Conversion should fail before a sync");
+}
+
+/**
+ * @brief Test that the local time converts to UTC after a synchronization
+ * 
+ */
+ZTEST(time, test_time_local_to_utc)
+{
+    uint64_t utc_ms;
+    uint64_t local_ms;
+    int ret = sensor_time_sync(5000, TEST_UTC_MS);
+    zassert_ok(ret, "Time sync failed");
+    zassert_equal(sensor_time_is_synced(), 1, "Time should be synced");
+    ret = sensor_time_local_to_utc_ms(65000, &utc_ms);
+    zassert_ok(ret, "Conversion to UTC failed");
+    zassert_equal(utc_ms, TEST_UTC_MS + 60000, "Expected %llu, actual is %llu", TEST_UTC_MS + 60000, utc_ms);
+    ret = sensor_time_utc_to_local_ms(TEST_UTC_MS - 2000, &local_ms);
+    zassert_ok(ret, "Conversion to local time failed");
+    zassert_equal(local_ms, 3000, "Expected 3000, actual is %llu", local_ms);
+    ret = sensor_time_utc_to_local_ms(TEST_UTC_MS - 10000, &local_ms);
+    zassert_equal(ret, -ERANGE, "Time before the timebase started should fail");
+}
+
+/**
+ * @brief Test that the GPS time from the network converts to UTC
+ * 
+ */
+ZTEST(time, test_time_sync_gps)
+{
+    uint64_t utc_ms;
+    uint32_t gps_seconds = (uint32_t)(TEST_UTC_MS / 1000) - SENSOR_TIME_GPS_UNIX_OFFSET_SECONDS + SENSOR_TIME_GPS_LEAP_SECONDS;
+    int ret = sensor_time_sync_gps(1000, gps_seconds);
+    zassert_ok(ret, "GPS time sync failed");
+    ret = sensor_time_local_to_utc_ms(1000, &utc_ms);
+    zassert_ok(ret, "Conversion to UTC failed");
+    zassert_equal(utc_ms, TEST_UTC_MS, "Expected %llu, actual is %llu", TEST_UTC_MS, utc_ms);
+}
+
+/**
+ * @brief Test that a GPS time that was not set by the network is rejected
+ * 
+ */
+ZTEST(time, test_time_sync_gps_not_set)
+{
+    int ret = sensor_time_sync_gps(1000, 100);
+    zassert_equal(ret, -EINVAL, "GPS time from boot should be rejected");
+    zassert_equal(sensor_time_is_synced(), 0, "Time should not be synced");
+}
+
+/**
+ * @brief Test that the drift is estimated and corrected between synchronizations
+ * 
+ */
+ZTEST(time, test_time_drift_correction)
+{
+    uint64_t utc_ms;
+    int32_t drift_ppm;
+    uint64_t interval_ms = SENSOR_TIME_MIN_DRIFT_INTERVAL_MS;
+    /* The local clock runs 100 ppm slow */
+    uint64_t utc_interval_ms = interval_ms + (interval_ms / 10000);
+    zassert_ok(sensor_time_sync(0, TEST_UTC_MS), "Time sync failed");
+    zassert_equal(sensor_time_get_drift_ppm(&drift_ppm), -EAGAIN, "Drift should not be estimated yet");
+    zassert_ok(sensor_time_sync(interval_ms, TEST_UTC_MS + utc_interval_ms), "Time sync failed");
+    zassert_ok(sensor_time_get_drift_ppm(&drift_ppm), "Drift should be estimated");
+    zassert_equal(drift_ppm, 100, "Expected 100 ppm, actual is %d", drift_ppm);
+    zassert_ok(sensor_time_local_to_utc_ms(2 * interval_ms, &utc_ms), "Conversion to UTC failed");
+    zassert_equal(utc_ms, TEST_UTC_MS + (2 * utc_interval_ms), "Expected %llu, actual is %llu", 
+        TEST_UTC_MS + (2 * utc_interval_ms), utc_ms);
+}
+
+/**
+ * @brief Test that a drift out of bounds is rejected and the rejected sync becomes the new reference
+ * 
+ */
+ZTEST(time, test_time_drift_out_of_bounds)
+{
+    uint64_t utc_ms;
+    uint64_t interval_ms = SENSOR_TIME_MIN_DRIFT_INTERVAL_MS;
+    uint64_t resync_utc_ms = TEST_UTC_MS + interval_ms + (interval_ms / 100);
+    zassert_ok(sensor_time_sync(0, TEST_UTC_MS), "Time sync failed");
+    int ret = sensor_time_sync(interval_ms, resync_utc_ms);
+    zassert_equal(ret, -EINVAL, "A drift of 10000 ppm should be rejected");
+    /* Measured from the rejected sync, the next sync is within bounds */
+    ret = sensor_time_sync(2 * interval_ms, resync_utc_ms + interval_ms);
+    zassert_ok(ret, "Time sync against the new reference failed");
+    zassert_ok(sensor_time_local_to_utc_ms(2 * interval_ms, &utc_ms), "Conversion failed");
+    zassert_equal(utc_ms, resync_utc_ms + interval_ms, "Expected %llu, actual is %llu", resync_utc_ms + interval_ms, utc_ms);
+}
+
+/**
+ * @brief Test that schedules can be anchored to the next wall-clock boundary
+ * 
+ */
+ZTEST(time, test_time_aligned_anchor)
+{
+    uint64_t anchor_ms;
+    /* Local time 10000 is 00:07:30 UTC */
+    zassert_ok(sensor_time_sync(10000, TEST_UTC_MS + 450000), "Time sync failed");
+    int ret = sensor_time_get_aligned_anchor_ms(10000, 15 * 60, &anchor_ms);
+    zassert_ok(ret, "Getting the aligned anchor failed");
+    /* The next quarter hour is 00:15:00 UTC */
+    zassert_equal(anchor_ms, 10000 + 450000, "Expected %llu, actual is %llu", 10000 + 450000, anchor_ms);
+    ret = sensor_time_get_aligned_anchor_ms(10000, 0, &anchor_ms);
+    zassert_equal(ret, -EINVAL, "A period of 0 should fail");
+}
+
+/**
+ * @brief Test that the time needs to be synchronized again after the resync interval
+ * 
+ */
+ZTEST(time, test_time_needs_resync)
+{
+    zassert_ok(sensor_time_sync(1000, TEST_UTC_MS), "Time sync failed");
+    zassert_equal(sensor_time_needs_sync(1000 + SENSOR_TIME_RESYNC_INTERVAL_MS - 1), 0, "Time should not need a sync yet");
+    zassert_equal(sensor_time_needs_sync(1000 + SENSOR_TIME_RESYNC_INTERVAL_MS), 1, "Time should need a sync");
+}
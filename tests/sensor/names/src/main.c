@@ -280,6 +280,30 @@ ZTEST(names, test_get_sensor_type_name_from_index_pulse_sensor)
 	zassert_str_equal(sensor_type_name, expected_name, "%s is not %s", sensor_type_name, expected_name);
 }
 
+/**
+ * @brief Test getting the name of the sensor type from the index for QUADRATURE_SENSOR
+ * 
+ */
+ZTEST(names, test_get_sensor_type_name_from_index_quadrature_sensor)
+{
+	char sensor_type_name[20];
+	char * expected_name = "QUADRATURE_SENSOR";
+	int ret = get_sensor_type_name_from_index(sensor_type_name, QUADRATURE_SENSOR);
+	zassert_str_equal(sensor_type_name, expected_name, "%s is not %s", sensor_type_name, expected_name);
+}
+
+/**
+ * @brief Test getting the name of the sensor type from the index for FREQUENCY_SENSOR
+ * 
+ */
+ZTEST(names, test_get_sensor_type_name_from_index_frequency_sensor)
+{
+	char sensor_type_name[20];
+	char * expected_name = "FREQUENCY_SENSOR";
+	int ret = get_sensor_type_name_from_index(sensor_type_name, FREQUENCY_SENSOR);
+	zassert_str_equal(sensor_type_name, expected_name, "%s is not %s", sensor_type_name, expected_name);
+}
+
 /**
  * @brief Test getting the name of the sensor type from the index for an out of bounds sensor type value too high
  * 
@@ -6,6 +6,7 @@
  * - handles invalid sensor types 
  * - handles sensor timeouts
  * - Pulse sensor interrupt is disabled after sensor type is changed
+ * - Temperature compensation of voltage and current readings
  */
 
 #include <zephyr/ztest.h>
@@ -44,6 +45,22 @@ static void emulate_pulses(sensor_reading_config_t *config, int num_pulses)
     gpio_emul_input_set(config->d1.port, config->d1.pin, 1);
 }
 
+static void emulate_quadrature_cycles(sensor_reading_config_t *config, int num_cycles, bool forward)
+{
+    // Each state is (d1 << 1) | d2, only one line changes per step
+    const uint8_t forward_states[] = {2, 3, 1, 0};
+    const uint8_t reverse_states[] = {1, 3, 2, 0};
+    const uint8_t *states = forward ? forward_states : reverse_states;
+    for(int i = 0; i < num_cycles; i++)
+    {
+        for(int j = 0; j < 4; j++)
+        {
+            gpio_emul_input_set(config->d1.port, config->d1.pin, (states[j] >> 1) & 1);
+            gpio_emul_input_set(config->d2.port, config->d2.pin, states[j] & 1);
+        }
+    }
+}
+
 
 /**
  * @brief Call after each test
@@ -54,6 +71,9 @@ static void *after_tests(void)
 	// Reset all sensors to NULL after each test
     sensor_reading_setup(&sensor1_reading_config, NULL_SENSOR);
     sensor_reading_setup(&sensor2_reading_config, NULL_SENSOR);
+    sensor_reading_set_temperature(TEMPCO_REFERENCE_CENTI_C);
+    sensor1_reading_config.voltage_tempco_ppm = 0;
+    sensor1_reading_config.current_tempco_ppm = 0;
 }
 
 
@@ -378,3 +398,150 @@ ZTEST(reading, test_sensor_pulse_read_two_sensors)
     zassert_equal(expected_pulse_count2, pulse_count, "Sensor 2 expected %d, got %d", expected_pulse_count2, pulse_count);
 }
 
+/**
+ * @brief Test that the current reading is compensated for the shunt drift at high temperature
+ * 
+ */
+ZTEST(reading, test_sensor_current_read_temperature_compensated)
+{
+    int ret = sensor_reading_setup(&sensor1_reading_config, CURRENT_SENSOR);
+    zassert_ok(ret, "Sensor1 failed current setup");
+    // Shunt reads 10% high at 125°C
+    sensor1_reading_config.current_tempco_ppm = 1000;
+    sensor_reading_set_temperature(12500);
+    float input_ma = 22;
+	const uint16_t emul_mv = (input_ma) * CURRENT_READ_RESISTOR;
+    adc_emul_const_value_set(sensor1_reading_config.current_read.dev, sensor1_reading_config.current_read.channel_id, emul_mv);
+    float current = get_sensor_current_reading(&sensor1_reading_config);
+    float expected_output = input_ma / 1.1f;
+    float accepted_error = expected_output * 0.02; // Give 2% error
+	zassert_within(current, expected_output, accepted_error, "Mismatch: got %f, expected %f", current, expected_output);
+}
+
+/**
+ * @brief Test that the voltage reading is not changed at the reference temperature
+ * 
+ */
+ZTEST(reading, test_sensor_voltage_read_at_reference_temperature)
+{
+    int ret = sensor_reading_setup(&sensor1_reading_config, VOLTAGE_SENSOR);
+    zassert_ok(ret, "Sensor1 failed voltage setup");
+    sensor1_reading_config.voltage_tempco_ppm = 1000;
+    sensor_reading_set_temperature(TEMPCO_REFERENCE_CENTI_C);
+    float expected_output = 12;
+    const uint16_t input_mv = (expected_output * 1000);
+	const uint16_t emul_mv = (input_mv * VOLTAGE_READ_DIVIDER_LOW) / (VOLTAGE_READ_DIVIDER_HIGH + VOLTAGE_READ_DIVIDER_LOW);
+    adc_emul_const_value_set(sensor1_reading_config.voltage_read.dev, sensor1_reading_config.voltage_read.channel_id, emul_mv);
+    float voltage = get_sensor_voltage_reading(&sensor1_reading_config);
+    float accepted_error = expected_output * 0.05; // Give 5% error
+	zassert_within(voltage, expected_output, accepted_error, "Mismatch: got %f, expected %f", voltage, expected_output);
+}
+
+/**
+ * @brief Test that the voltage reading is compensated below the reference temperature
+ * 
+ */
+ZTEST(reading, test_sensor_voltage_read_temperature_compensated_cold)
+{
+    int ret = sensor_reading_setup(&sensor1_reading_config, VOLTAGE_SENSOR);
+    zassert_ok(ret, "Sensor1 failed voltage setup");
+    // Divider reads 5% low at -25°C
+    sensor1_reading_config.voltage_tempco_ppm = 1000;
+    sensor_reading_set_temperature(-2500);
+    float input_voltage = 12;
+    const uint16_t input_mv = (input_voltage * 1000);
+	const uint16_t emul_mv = (input_mv * VOLTAGE_READ_DIVIDER_LOW) / (VOLTAGE_READ_DIVIDER_HIGH + VOLTAGE_READ_DIVIDER_LOW);
+    adc_emul_const_value_set(sensor1_reading_config.voltage_read.dev, sensor1_reading_config.voltage_read.channel_id, emul_mv);
+    float voltage = get_sensor_voltage_reading(&sensor1_reading_config);
+    float expected_output = input_voltage / 0.95f;
+    float accepted_error = expected_output * 0.02; // Give 2% error
+	zassert_within(voltage, expected_output, accepted_error, "Mismatch: got %f, expected %f", voltage, expected_output);
+}
+
+/**
+ * @brief Test quadrature count goes up going forward and back down going in reverse
+ * 
+ */
+ZTEST(reading, test_sensor_quadrature_read)
+{
+    gpio_emul_input_set(sensor1_reading_config.d1.port, sensor1_reading_config.d1.pin, 0);
+    gpio_emul_input_set(sensor1_reading_config.d2.port, sensor1_reading_config.d2.pin, 0);
+    int ret = sensor_reading_setup(&sensor1_reading_config, QUADRATURE_SENSOR);
+    zassert_ok(ret, "Sensor1 failed quadrature setup");
+    int32_t count;
+    emulate_quadrature_cycles(&sensor1_reading_config, 5, true);
+    ret = get_sensor_signed_count(&sensor1_reading_config, &count);
+    zassert_ok(ret, "Failed to get signed count");
+    zassert_equal(20, count, "Expected %d, got %d", 20, count);
+    emulate_quadrature_cycles(&sensor1_reading_config, 8, false);
+    ret = get_sensor_signed_count(&sensor1_reading_config, &count);
+    zassert_ok(ret, "Failed to get signed count");
+    zassert_equal(-12, count, "Expected %d, got %d", -12, count);
+    reset_sensor_signed_count(&sensor1_reading_config);
+    ret = get_sensor_signed_count(&sensor1_reading_config, &count);
+    zassert_equal(0, count, "Expected 0 after reset, got %d", count);
+}
+
+/**
+ * @brief Test pulse and direction count goes negative when direction is set
+ * 
+ */
+ZTEST(reading, test_sensor_pulse_dir_read)
+{
+    int ret = sensor_reading_setup(&sensor1_reading_config, PULSE_DIR_SENSOR);
+    zassert_ok(ret, "Sensor1 failed pulse and direction setup");
+    int32_t count;
+    gpio_emul_input_set(sensor1_reading_config.d2.port, sensor1_reading_config.d2.pin, 0);
+    emulate_pulses(&sensor1_reading_config, 6);
+    gpio_emul_input_set(sensor1_reading_config.d2.port, sensor1_reading_config.d2.pin, 1);
+    emulate_pulses(&sensor1_reading_config, 9);
+    ret = get_sensor_signed_count(&sensor1_reading_config, &count);
+    zassert_ok(ret, "Failed to get signed count");
+    zassert_equal(-3, count, "Expected %d, got %d", -3, count);
+}
+
+static void toggle_frequency_input(struct k_timer *timer)
+{
+    sensor_reading_config_t *config = k_timer_user_data_get(timer);
+    gpio_emul_input_set(config->d1.port, config->d1.pin, 1);
+    gpio_emul_input_set(config->d1.port, config->d1.pin, 0);
+}
+
+K_TIMER_DEFINE(frequency_input_timer, toggle_frequency_input, NULL);
+
+/**
+ * @brief Test frequency read outputs the rate of rising edges on d1
+ * 
+ */
+ZTEST(reading, test_sensor_frequency_read)
+{
+    gpio_emul_input_set(sensor1_reading_config.d1.port, sensor1_reading_config.d1.pin, 0);
+    int ret = sensor_reading_setup(&sensor1_reading_config, FREQUENCY_SENSOR);
+    zassert_ok(ret, "Sensor1 failed frequency setup");
+    float frequency;
+    ret = get_sensor_frequency(&sensor1_reading_config, &frequency);
+    zassert_ok(ret, "Failed to get frequency");
+    zassert_within(frequency, 0.0f, 0.001f, "Expected no edges, got %f Hz", frequency);
+    // One rising edge every 5ms
+    float expected_frequency = 200;
+    k_timer_user_data_set(&frequency_input_timer, &sensor1_reading_config);
+    k_timer_start(&frequency_input_timer, K_MSEC(5), K_MSEC(5));
+    ret = get_sensor_frequency(&sensor1_reading_config, &frequency);
+    k_timer_stop(&frequency_input_timer);
+    zassert_ok(ret, "Failed to get frequency");
+    float accepted_error = expected_frequency * 0.1; // Give 10% error
+    zassert_within(frequency, expected_frequency, accepted_error, "Mismatch: got %f, expected %f", frequency, expected_frequency);
+}
+
+/**
+ * @brief Test frequency read fails when the sensor is not set to FREQUENCY_SENSOR
+ * 
+ */
+ZTEST(reading, test_frequency_read_when_frequency_sensor_not_set)
+{
+    int ret = sensor_reading_setup(&sensor1_reading_config, PULSE_SENSOR);
+    zassert_ok(ret, "Sensor1 failed pulse setup");
+    float frequency;
+    ret = get_sensor_frequency(&sensor1_reading_config, &frequency);
+    zassert_not_ok(ret, "Expected frequency read to fail when not set to FREQUENCY_SENSOR");
+}
@@ -410,3 +410,98 @@ ZTEST(timer, test_get_total_seconds_before_top_value_is_reached)
     LOG_INF("Total seconds: %d with top value: %d", total_seconds, top_value_seconds);
     zassert_true(total_seconds == expected_total_seconds, "Total seconds should be %d, actual value %d", expected_total_seconds, total_seconds);
 }
+
+/**
+ * @brief Confirm total milliseconds matches the total seconds read around it and the time slept
+ * 
+ */
+ZTEST(timer, test_get_total_ms)
+{
+    int ret;
+    uint64_t total_ms;
+    /* A few ticks of the counter, it runs at 128 Hz */
+    const uint64_t tolerance_ms = 50;
+    k_sleep(K_SECONDS(2));
+    int seconds_before = sensor_timer_get_total_seconds(timer0);
+    ret = sensor_timer_get_total_ms(timer0, &total_ms);
+    zassert_ok(ret, "Failed to get total ms");
+    int seconds_after = sensor_timer_get_total_seconds(timer0);
+    zassert_true(total_ms / 1000 >= seconds_before && total_ms / 1000 <= seconds_after, 
+        "Total ms %llu is not between total seconds %d and %d", total_ms, seconds_before, seconds_after);
+    zassert_true(total_ms >= 2000 - tolerance_ms && total_ms <= 2000 + tolerance_ms, "Total ms %llu", total_ms);
+}
+
+/**
+ * @brief Confirm total ticks keep increasing across the top value instead of jumping back
+ * 
+ */
+ZTEST(timer, test_get_total_ticks_is_monotonic_across_top_value)
+{
+    int ret;
+    uint64_t ticks_before;
+    uint64_t ticks_after;
+    k_sleep(K_SECONDS(top_value_seconds - 5));
+    ret = sensor_timer_get_total_ticks(timer0, &ticks_before);
+    zassert_ok(ret, "Failed to get total ticks");
+    k_sleep(K_SECONDS(10));
+    ret = sensor_timer_get_total_ticks(timer0, &ticks_after);
+    zassert_ok(ret, "Failed to get total ticks");
+    zassert_true(ticks_after > ticks_before, "Total ticks went from %llu to %llu", ticks_before, ticks_after);
+    zassert_true(ticks_after > counter_get_top_value(timer0), "Total ticks %llu did not include the wrap", ticks_after);
+}
+
+/**
+ * @brief Confirm an alarm with milliseconds is not triggered before the whole alarm time
+ * 
+ */
+ZTEST(timer, test_timer_alarm_with_ms)
+{
+    reset_alarm_triggered_flags();
+    alarm_cfg[SENSOR_TIMER_CHANNEL_0].alarm_seconds = 2;
+    alarm_cfg[SENSOR_TIMER_CHANNEL_0].alarm_ms = 500;
+    int ret;
+    ret = sensor_timer_set_alarm(timer0, &alarm_cfg[SENSOR_TIMER_CHANNEL_0]);
+    alarm_cfg[SENSOR_TIMER_CHANNEL_0].alarm_ms = 0;
+    zassert_ok(ret, "Failed to set alarm");
+    k_sleep(K_SECONDS(1));
+    assert_alarm_triggered_flags(0, 0, 0);
+    k_sleep(K_SECONDS(3));
+    assert_alarm_triggered_flags(1, 0, 0);
+}
+
+/**
+ * @brief Confirm an alarm longer than the top value is only triggered at its deadline
+ * 
+ */
+ZTEST(timer, test_timer_alarm_longer_than_top_value)
+{
+    reset_alarm_triggered_flags();
+    alarm_cfg[SENSOR_TIMER_CHANNEL_0].alarm_seconds = (top_value_seconds * 2) + 60;
+    int ret;
+    ret = sensor_timer_set_alarm(timer0, &alarm_cfg[SENSOR_TIMER_CHANNEL_0]);
+    zassert_ok(ret, "Alarm longer than the top value should be chained");
+    k_sleep(K_SECONDS(top_value_seconds + 30));
+    assert_alarm_triggered_flags(0, 0, 0);
+    k_sleep(K_SECONDS(top_value_seconds));
+    assert_alarm_triggered_flags(0, 0, 0);
+    k_sleep(K_SECONDS(60));
+    assert_alarm_triggered_flags(1, 0, 0);
+}
+
+/**
+ * @brief Confirm cancelling a chained alarm stops it between wake-ups
+ * 
+ */
+ZTEST(timer, test_timer_chained_alarm_cancelled)
+{
+    reset_alarm_triggered_flags();
+    alarm_cfg[SENSOR_TIMER_CHANNEL_1].alarm_seconds = (top_value_seconds * 2);
+    int ret;
+    ret = sensor_timer_set_alarm(timer0, &alarm_cfg[SENSOR_TIMER_CHANNEL_1]);
+    zassert_ok(ret, "Failed to set alarm");
+    k_sleep(K_SECONDS(top_value_seconds + 30));
+    ret = sensor_timer_cancel_alarm(timer0, SENSOR_TIMER_CHANNEL_1);
+    zassert_ok(ret, "Failed to cancel alarm");
+    k_sleep(K_SECONDS(top_value_seconds));
+    assert_alarm_triggered_flags(0, 0, 0);
+}